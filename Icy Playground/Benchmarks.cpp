@@ -0,0 +1,1905 @@
+#include "Benchmarks.hpp"
+#include <Engine\Renderer\RenderQueue.hpp>
+#include <Engine\System\MeshSimplifier.hpp>
+#include <Engine\System\OpenGLClusteredLighting.hpp>
+#include <Engine\System\OpenGLOcclusionCuller.hpp>
+#include <Engine\System\OpenGLParticleSystem.hpp>
+#include <Engine\System\OpenGLSceneBuffer.hpp>
+#include <Engine\System\OpenGLTextRenderer.hpp>
+#include <Engine\System\RadixSort.hpp>
+#include <Engine\System\ThreadPool.hpp>
+#include <Engine\System\TransformHierarchy.hpp>
+#include <Engine\System\VulkanClusteredLighting.hpp>
+#include <Engine\System\VulkanParticleSystem.hpp>
+#include <Engine\System\VulkanRenderer.hpp>
+#include <Engine\System\VulkanTextRenderer.hpp>
+#include <Engine\Window\OpenGLWindow.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct KeyValue
+	{
+		uint64_t key;
+		uint32_t value;
+		bool operator<(const KeyValue& other) const { return key < other.key; }
+	};
+
+	// Pipeline and material switches a backend makes drawing the keys in this order
+	void countStateChanges(const uint64_t* keys, uint32_t count, uint32_t& pipelines, uint32_t& materials)
+	{
+		using icy::Renderer::RenderQueue;
+		pipelines = 0;
+		materials = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (i == 0 || RenderQueue::getPipeline(keys[i]) != RenderQueue::getPipeline(keys[i - 1]))
+				++pipelines;
+			if (i == 0 || RenderQueue::getMaterial(keys[i]) != RenderQueue::getMaterial(keys[i - 1]))
+				++materials;
+		}
+	}
+
+	// Relative to the playground's working directory, the Vulkan passes need their .spv files next to the sources
+	const char* ShaderDirectory = "../Icy/Engine/Shaders/";
+	// Colour and depth images and a render pass over them, for the Vulkan benchmarks that draw without a window
+	const uint64_t OffscreenRenderPassId = 0x6963794f46465343ull;
+	const uint32_t OffscreenWidth = 1280;
+	const uint32_t OffscreenHeight = 720;
+
+	struct OffscreenTarget
+	{
+		VkImage images[2];
+		VkDeviceMemory memories[2];
+		VkImageView views[2];
+		VkRenderPass renderPass;
+		VkFramebuffer framebuffer;
+	};
+
+	void destroyOffscreenTarget(icy::System::VulkanRenderer& renderer, OffscreenTarget& target)
+	{
+		VkDevice device = renderer.getDevice();
+		vkDestroyFramebuffer(device, target.framebuffer, nullptr);
+		vkDestroyRenderPass(device, target.renderPass, nullptr);
+		for (int i = 0; i < 2; ++i)
+		{
+			vkDestroyImageView(device, target.views[i], nullptr);
+			vkDestroyImage(device, target.images[i], nullptr);
+			vkFreeMemory(device, target.memories[i], nullptr);
+		}
+		target = {};
+	}
+
+	// Registered with the pipeline compiler under OffscreenRenderPassId
+	bool createOffscreenTarget(icy::System::VulkanRenderer& renderer, OffscreenTarget& target)
+	{
+		target = {};
+		VkDevice device = renderer.getDevice();
+		const VkFormat formats[2] = { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_D32_SFLOAT };
+		const VkImageUsageFlags usages[2] = { VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		const VkImageAspectFlags aspects[2] = { VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_ASPECT_DEPTH_BIT };
+		for (int i = 0; i < 2; ++i)
+		{
+			VkImageCreateInfo imageInfo = {};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = formats[i];
+			imageInfo.extent = { OffscreenWidth, OffscreenHeight, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = usages[i];
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			if (!renderer.checkResults(vkCreateImage(device, &imageInfo, nullptr, &target.images[i])))
+			{
+				destroyOffscreenTarget(renderer, target);
+				return false;
+			}
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(device, target.images[i], &requirements);
+			VkMemoryAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocateInfo.allocationSize = requirements.size;
+			allocateInfo.memoryTypeIndex = renderer.findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (allocateInfo.memoryTypeIndex == UINT32_MAX || !renderer.checkResults(vkAllocateMemory(device, &allocateInfo, nullptr, &target.memories[i]))
+				|| !renderer.checkResults(vkBindImageMemory(device, target.images[i], target.memories[i], 0)))
+			{
+				destroyOffscreenTarget(renderer, target);
+				return false;
+			}
+			VkImageViewCreateInfo viewInfo = {};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = target.images[i];
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = formats[i];
+			viewInfo.subresourceRange = { aspects[i], 0, 1, 0, 1 };
+			if (!renderer.checkResults(vkCreateImageView(device, &viewInfo, nullptr, &target.views[i])))
+			{
+				destroyOffscreenTarget(renderer, target);
+				return false;
+			}
+		}
+
+		// Cleared every frame, colour kept for a read back and depth thrown away
+		VkAttachmentDescription attachments[2] = {};
+		for (int i = 0; i < 2; ++i)
+		{
+			attachments[i].format = formats[i];
+			attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		VkAttachmentReference color = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkAttachmentReference depth = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &color;
+		subpass.pDepthStencilAttachment = &depth;
+		// The previous frame's writes and read back finish before this frame clears
+		VkSubpassDependency dependency = {};
+		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependency.dstSubpass = 0;
+		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 2;
+		renderPassInfo.pAttachments = attachments;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 1;
+		renderPassInfo.pDependencies = &dependency;
+		if (!renderer.checkResults(vkCreateRenderPass(device, &renderPassInfo, nullptr, &target.renderPass)))
+		{
+			destroyOffscreenTarget(renderer, target);
+			return false;
+		}
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = target.renderPass;
+		framebufferInfo.attachmentCount = 2;
+		framebufferInfo.pAttachments = target.views;
+		framebufferInfo.width = OffscreenWidth;
+		framebufferInfo.height = OffscreenHeight;
+		framebufferInfo.layers = 1;
+		if (!renderer.checkResults(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &target.framebuffer)))
+		{
+			destroyOffscreenTarget(renderer, target);
+			return false;
+		}
+		renderer.getPipelineCompiler().registerRenderPass(OffscreenRenderPassId, target.renderPass);
+		return true;
+	}
+
+	// Clears to black and far depth and sets the viewport and scissor the compiled pipelines leave dynamic
+	void beginOffscreenPass(VkCommandBuffer commands, const OffscreenTarget& target)
+	{
+		VkClearValue clears[2] = {};
+		clears[1].depthStencil.depth = 1.0f;
+		VkRenderPassBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		beginInfo.renderPass = target.renderPass;
+		beginInfo.framebuffer = target.framebuffer;
+		beginInfo.renderArea.extent = { OffscreenWidth, OffscreenHeight };
+		beginInfo.clearValueCount = 2;
+		beginInfo.pClearValues = clears;
+		vkCmdBeginRenderPass(commands, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(OffscreenWidth), static_cast<float>(OffscreenHeight), 0.0f, 1.0f };
+		VkRect2D scissor = { { 0, 0 }, { OffscreenWidth, OffscreenHeight } };
+		vkCmdSetViewport(commands, 0, 1, &viewport);
+		vkCmdSetScissor(commands, 0, 1, &scissor);
+	}
+
+	const int ParticleWarmupSteps = 180;
+	const int ParticleSteps = 60;
+	const float ParticleStepTime = 1.0f / 60.0f;
+	// Most frames the draw variants get to compile in
+	const int ParticleVariantFrames = 600;
+
+	// Lives 1 to 3 seconds at capacity / 2 per second, so the system sits at capacity once warmed up
+	icy::System::ParticleEmitter benchmarkEmitter(uint32_t capacity)
+	{
+		icy::System::ParticleEmitter emitter = {};
+		emitter.velocity[1] = 4.0f;
+		emitter.spread = 0.6f;
+		emitter.gravity[1] = -9.81f;
+		emitter.drag = 0.1f;
+		emitter.rate = capacity * 0.5f;
+		emitter.lifetimeMin = 1.0f;
+		emitter.lifetimeMax = 3.0f;
+		emitter.size = 0.02f;
+		emitter.color = 0x40A0FFFFu;
+		return emitter;
+	}
+
+	// Perspective camera at (0, 2, 10) looking down -z, column major
+	const float BenchmarkCamera[3] = { 0.0f, 2.0f, 10.0f };
+	const float BenchmarkViewProjection[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, -2.0f, 9.8f, 10.0f };
+
+	void reportParticles(const char* backend, const char* device, uint32_t capacity, uint64_t updated, double ms)
+	{
+		std::cout << backend << " on " << device << ", " << capacity << " particles, " << ParticleSteps << " steps" << std::endl;
+		std::cout << "per step              " << ms / ParticleSteps << " ms" << std::endl;
+		std::cout << "updated per ms        " << (ms > 0.0 ? static_cast<double>(updated) / ms : 0.0) << std::endl;
+	}
+
+	int runOpenGLParticles(uint32_t capacity)
+	{
+		icy::Window::StaticOpenGLWindow window;
+		if (!window.createWindow("Particle benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 64, 64, SDL_WINDOW_HIDDEN))
+		{
+			std::cout << "No OpenGL 4.5 context" << std::endl;
+			return 1;
+		}
+		icy::Window::OpenGLBackend& backend = window.getBackend();
+		icy::System::OpenGLParticleSystem particles;
+		if (!particles.create(&backend.getStateCache(), &backend.getUniformAllocator(), ShaderDirectory, capacity))
+			return 1;
+		particles.setEmitter(benchmarkEmitter(particles.getCapacity()));
+
+		uint64_t updated = 0;
+		double ms = 0.0;
+		for (int step = 0; step < ParticleWarmupSteps + ParticleSteps; ++step)
+		{
+			// glFinish on both sides so only this step's work is timed
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			particles.update(ParticleStepTime, BenchmarkCamera, BenchmarkViewProjection);
+			glFinish();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			if (step >= ParticleWarmupSteps)
+			{
+				ms += elapsed.count();
+				updated += particles.getAliveCount();
+			}
+			backend.getStreamBuffer().nextFrame();
+			backend.getUniformAllocator().endFrame();
+		}
+		reportParticles("OpenGL", reinterpret_cast<const char*>(glGetString(GL_RENDERER)), particles.getCapacity(), updated, ms);
+		particles.destroy();
+		return 0;
+	}
+
+	// Compute queue time and how much of it ran alongside graphics, summed over the frames the scheduler timed
+	struct QueueTotals
+	{
+		double computeMs;
+		double overlapMs;
+		int frames;
+	};
+
+	// The scheduler's timings are from the frame slot beginFrame just waited for
+	void addQueueTimes(const icy::System::VulkanQueueScheduler& scheduler, QueueTotals& totals)
+	{
+		totals.computeMs += scheduler.getBusyMs(icy::System::QueueType::Compute);
+		totals.overlapMs += scheduler.getOverlapMs();
+		++totals.frames;
+	}
+
+	void reportQueues(const icy::System::VulkanQueueScheduler& scheduler, const QueueTotals& totals)
+	{
+		scheduler.report(std::cout);
+		const int frames = std::max(totals.frames, 1);
+		std::cout << "compute queue busy    " << totals.computeMs / frames << " ms per frame" << std::endl;
+		std::cout << "overlapped graphics   " << totals.overlapMs / frames << " ms per frame" << std::endl;
+	}
+
+	// One frame without a window: a particle step on the compute queue, then the draw variants from firstFeatures
+	// up to endFeatures into the target, which wait for the step
+	// Returns false when the renderer has no frame to record
+	bool recordParticleFrame(icy::System::VulkanRenderer& renderer, icy::System::VulkanParticleSystem& particles, const OffscreenTarget& target,
+		uint32_t firstFeatures, uint32_t endFeatures)
+	{
+		using namespace icy::System;
+		if (!renderer.beginFrame())
+			return false;
+		renderer.getPipelineCompiler().beginFrame();
+		// The frame's own command buffer when the device has no async compute queue
+		VulkanQueueScheduler& scheduler = renderer.getQueueScheduler();
+		VkCommandBuffer compute = scheduler.begin(QueueType::Compute);
+		particles.update(compute, renderer.getFrameIndex(), ParticleStepTime, BenchmarkCamera, BenchmarkViewProjection);
+		// The last frame's draw still reads the buffers this step writes
+		const SyncPoint lastFrame = scheduler.getLastFrame();
+		const SyncPoint step = scheduler.submit(QueueType::Compute, compute, &lastFrame, 1, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		scheduler.waitInFrame(step, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+
+		VkCommandBuffer commands = renderer.getCommandBuffer();
+		beginOffscreenPass(commands, target);
+		for (uint32_t features = firstFeatures; features < endFeatures; ++features)
+		{
+			// Known variants are a lookup, new ones are queued and skipped by draw() until they are built
+			particles.createDrawPipeline(OffscreenRenderPassId, 0, features);
+			particles.draw(commands);
+		}
+		vkCmdEndRenderPass(commands);
+		renderer.endFrame();
+		return true;
+	}
+
+	int runVulkanParticles(uint32_t capacity)
+	{
+		using namespace icy::System;
+		std::shared_ptr<VulkanRenderer> renderer = VulkanRenderer::getShared();
+		if (!renderer)
+		{
+			std::cout << "No Vulkan device" << std::endl;
+			return 1;
+		}
+		VulkanParticleSystem particles;
+		if (!particles.create(renderer.get(), ShaderDirectory, capacity))
+			return 1;
+		particles.setEmitter(benchmarkEmitter(particles.getCapacity()));
+		OffscreenTarget target;
+		if (!createOffscreenTarget(*renderer, target))
+		{
+			particles.destroy();
+			return 1;
+		}
+
+		// The renderer's frames without a window, steps and draws overlap the way they would in a game
+		VulkanQueueScheduler& scheduler = renderer->getQueueScheduler();
+		uint64_t updated = 0;
+		QueueTotals queues = {};
+		bool bFrames = true;
+		auto start = std::chrono::steady_clock::now();
+		for (int step = 0; bFrames && step < ParticleWarmupSteps + ParticleSteps; ++step)
+		{
+			if (step == ParticleWarmupSteps)
+				start = std::chrono::steady_clock::now();
+			bFrames = recordParticleFrame(*renderer, particles, target, VulkanParticleSystem::DefaultFeatures, VulkanParticleSystem::DefaultFeatures + 1);
+			if (step >= ParticleWarmupSteps)
+			{
+				updated += particles.getAliveCount();
+				addQueueTimes(scheduler, queues);
+			}
+		}
+		renderer->waitForFrames();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		reportParticles("Vulkan", renderer->getDeviceInfo().properties.deviceName, particles.getCapacity(), updated, elapsed.count());
+		reportQueues(scheduler, queues);
+
+		// Then every draw variant, requested by features each frame and drawn once the compiler has built it
+		VulkanPipelineCompiler& compiler = renderer->getPipelineCompiler();
+		const uint32_t variants = particles.getDrawVariants().getPossibleCount();
+		int frames = 0;
+		while (bFrames && frames < ParticleVariantFrames)
+		{
+			// Once nothing is compiling any more, this frame draws every variant
+			const bool bLast = frames > 0 && compiler.getPendingCount() == 0;
+			bFrames = recordParticleFrame(*renderer, particles, target, 0, variants);
+			++frames;
+			if (bLast)
+				break;
+		}
+		renderer->waitForFrames();
+		std::cout << "draw variants over " << frames << " frames" << std::endl;
+		particles.getDrawVariants().report(std::cout);
+
+		particles.destroy();
+		destroyOffscreenTarget(*renderer, target);
+		return bFrames ? 0 : 1;
+	}
+
+	// Lights scattered over a floor at y = 0 that the camera looks across, a quarter of them spots pointing down
+	const int LightWarmupFrames = 5;
+	const int LightFrames = 10;
+	const int LightFrameWidth = 1280;
+	const int LightFrameHeight = 720;
+
+	std::vector<icy::System::ClusterLight> benchmarkLights(uint32_t count)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<icy::System::ClusterLight> lights(count);
+		for (icy::System::ClusterLight& light : lights)
+		{
+			light = {};
+			light.position[0] = -40.0f + 80.0f * unit(random);
+			light.position[1] = 0.2f + 2.8f * unit(random);
+			light.position[2] = -2.0f - 88.0f * unit(random);
+			light.range = 2.0f + 4.0f * unit(random);
+			for (int i = 0; i < 3; ++i)
+				light.color[i] = 0.2f + 0.8f * unit(random);
+			light.intensity = 2.0f;
+			light.type = icy::System::LightType::Point;
+			if (unit(random) < 0.25f)
+			{
+				float angle = 0.35f + 0.5f * unit(random);
+				light.type = icy::System::LightType::Spot;
+				light.direction[1] = -1.0f;
+				light.cosOuter = std::cos(angle);
+				light.cosInner = std::cos(angle * 0.75f);
+			}
+		}
+		return lights;
+	}
+
+	// At (0, 2, 0) looking down -z, 60 degrees high and 16:9
+	icy::System::ClusterCamera benchmarkLightCamera()
+	{
+		icy::System::ClusterCamera camera = {};
+		camera.view[0] = 1.0f;
+		camera.view[5] = 1.0f;
+		camera.view[10] = 1.0f;
+		camera.view[13] = -2.0f;
+		camera.view[15] = 1.0f;
+		camera.tanHalfFovY = std::tan(0.5235988f);
+		camera.tanHalfFovX = camera.tanHalfFovY * LightFrameWidth / LightFrameHeight;
+		camera.nearPlane = 0.1f;
+		camera.farPlane = 100.0f;
+		camera.width = static_cast<float>(LightFrameWidth);
+		camera.height = static_cast<float>(LightFrameHeight);
+		return camera;
+	}
+
+	// One triangle over the whole screen
+	const char* FloorVertexSource =
+		"#version 450\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}\n";
+	// Traces the floor under the camera and lights it, ICY_EVERY_LIGHT loops over all lights instead of the cluster's
+	const char* FloorFragmentSource =
+		"#version 450\n"
+		"layout(location = 0) out vec4 o_Color;\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 ndc = gl_FragCoord.xy / vec2(icy_Clusters.width, icy_Clusters.height) * 2.0 - 1.0;\n"
+		"	vec3 ray = vec3(ndc.x * icy_Clusters.tanHalfFovX, ndc.y * icy_Clusters.tanHalfFovY, -1.0);\n"
+		"	vec3 eye = -icy_Clusters.view[3].xyz;\n"
+		"	vec3 color = vec3(0.0);\n"
+		"	if (ray.y < 0.0)\n"
+		"	{\n"
+		"		vec3 worldPos = eye + ray * (-eye.y / ray.y);\n"
+		"#ifdef ICY_EVERY_LIGHT\n"
+		"		color = icyForwardLighting(worldPos, vec3(0.0, 1.0, 0.0), vec3(0.8));\n"
+		"#else\n"
+		"		color = icyClusteredLighting(gl_FragCoord.xy, worldPos, vec3(0.0, 1.0, 0.0), vec3(0.8));\n"
+		"#endif\n"
+		"	}\n"
+		"	o_Color = vec4(color, 1.0);\n"
+		"}\n";
+
+	GLuint compileFloorProgram(const icy::System::OpenGLClusteredLighting& lighting, bool everyLight)
+	{
+		const std::string fragmentSource = lighting.addPreamble(FloorFragmentSource);
+		const std::string defines = everyLight ? "#define ICY_EVERY_LIGHT\n" : "";
+		const size_t body = fragmentSource.find('\n') + 1;
+		const GLchar* vertexStrings[] = { FloorVertexSource };
+		const GLchar* fragmentStrings[] = { fragmentSource.c_str(), defines.c_str(), fragmentSource.c_str() + body };
+		const GLint fragmentLengths[] = { static_cast<GLint>(body), -1, -1 };
+		GLuint shaders[2] = { glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER) };
+		glShaderSource(shaders[0], 1, vertexStrings, nullptr);
+		glShaderSource(shaders[1], 3, fragmentStrings, fragmentLengths);
+		GLuint program = glCreateProgram();
+		for (GLuint shader : shaders)
+		{
+			glCompileShader(shader);
+			glAttachShader(program, shader);
+			glDeleteShader(shader);
+		}
+		glLinkProgram(program);
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked != GL_TRUE)
+		{
+			char log[1024];
+			glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+			std::cout << "Failed to build the floor shader: " << log << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	void reportLights(const char* backend, const char* device, const icy::System::ClusterStats& cpu, const icy::System::ClusterStats& gpu, uint32_t different)
+	{
+		using namespace icy::System;
+		std::cout << backend << " on " << device << ", " << cpu.lights << " lights, " << ClusterCountX << "x" << ClusterCountY << "x" << ClusterCountZ << " clusters" << std::endl;
+		std::cout << "cpu reference build   " << cpu.buildMs << " ms" << std::endl;
+		std::cout << "gpu build             " << gpu.buildMs << " ms" << std::endl;
+		std::cout << "occupied clusters     " << gpu.occupied << " of " << ClusterCount << std::endl;
+		std::cout << "lights per cluster    " << gpu.averageLights << " average, " << gpu.maxLights << " max" << std::endl;
+		std::cout << "overflowed clusters   " << gpu.overflowed << std::endl;
+		std::cout << "differ from the cpu   " << different << " clusters" << std::endl;
+	}
+
+	// Draws the floor frames times into the bound framebuffer, returns milliseconds per frame
+	double timeFloor(GLuint program, icy::System::OpenGLStateCache& stateCache, icy::System::OpenGLClusteredLighting& lighting, GLuint vertexArray, int frames)
+	{
+		stateCache.useProgram(program);
+		stateCache.bindVertexArray(vertexArray);
+		lighting.bind();
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glFinish();
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; ++frame)
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		glFinish();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / frames;
+	}
+
+	int runOpenGLLights(uint32_t lightCount)
+	{
+		using namespace icy::System;
+		icy::Window::StaticOpenGLWindow window;
+		if (!window.createWindow("Light benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 64, 64, SDL_WINDOW_HIDDEN))
+		{
+			std::cout << "No OpenGL 4.5 context" << std::endl;
+			return 1;
+		}
+		icy::Window::OpenGLBackend& backend = window.getBackend();
+		OpenGLStateCache& stateCache = backend.getStateCache();
+		OpenGLClusteredLighting lighting;
+		if (!lighting.create(&stateCache, &backend.getStreamBuffer(), ShaderDirectory))
+			return 1;
+		const std::vector<ClusterLight> lights = benchmarkLights(lightCount);
+		const ClusterCamera camera = benchmarkLightCamera();
+
+		// The stats come back a few frames late, so bin a few times before reading them
+		for (int frame = 0; frame < LightWarmupFrames; ++frame)
+		{
+			lighting.update(camera, lights.data(), lightCount);
+			glFinish();
+			backend.getStreamBuffer().nextFrame();
+		}
+		lighting.update(camera, lights.data(), lightCount);
+		std::vector<ClusterRange> grid;
+		std::vector<uint32_t> indices;
+		uint32_t overflowed = 0;
+		lighting.readBack(grid, indices, overflowed);
+		LightClusterer reference;
+		reference.build(lights.data(), lightCount, lighting.getParams());
+		const uint32_t different = reference.compare(grid.data(), indices.data(), static_cast<uint32_t>(indices.size()));
+		reportLights("OpenGL", reinterpret_cast<const char*>(glGetString(GL_RENDERER)), reference.getStats(), lighting.getStats(), different);
+
+		// Shade the same floor both ways into an offscreen target and compare the pictures
+		GLuint programs[2] = { compileFloorProgram(lighting, false), compileFloorProgram(lighting, true) };
+		GLuint target = stateCache.createTexture2D(1, GL_RGBA8, LightFrameWidth, LightFrameHeight);
+		GLuint framebuffer = 0;
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, target, 0);
+		GLuint vertexArray = 0;
+		glCreateVertexArrays(1, &vertexArray);
+		stateCache.bindFramebuffer(framebuffer);
+		stateCache.viewport(0, 0, LightFrameWidth, LightFrameHeight);
+		stateCache.disable(GL_DEPTH_TEST);
+		stateCache.disable(GL_BLEND);
+		std::vector<uint8_t> pixels[2];
+		double ms[2] = { 0.0, 0.0 };
+		for (int i = 0; i < 2 && programs[0] != 0 && programs[1] != 0; ++i)
+		{
+			ms[i] = timeFloor(programs[i], stateCache, lighting, vertexArray, LightFrames);
+			pixels[i].resize(LightFrameWidth * LightFrameHeight * 4);
+			glReadPixels(0, 0, LightFrameWidth, LightFrameHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i].data());
+		}
+		int difference = 0;
+		for (size_t i = 0; i < pixels[0].size() && i < pixels[1].size(); ++i)
+			difference = std::max(difference, std::abs(static_cast<int>(pixels[0][i]) - static_cast<int>(pixels[1][i])));
+		std::cout << "clustered shading     " << ms[0] << " ms per " << LightFrameWidth << "x" << LightFrameHeight << " frame" << std::endl;
+		std::cout << "every light shading   " << ms[1] << " ms per frame" << std::endl;
+		std::cout << "largest pixel change  " << difference << " of 255" << std::endl;
+
+		stateCache.bindFramebuffer(0);
+		glDeleteFramebuffers(1, &framebuffer);
+		stateCache.deleteTexture(target);
+		stateCache.deleteVertexArray(vertexArray);
+		for (GLuint program : programs)
+		{
+			if (program != 0)
+				stateCache.deleteProgram(program);
+		}
+		lighting.destroy();
+		return different == 0 && programs[0] != 0 && programs[1] != 0 ? 0 : 1;
+	}
+
+	int runVulkanLights(uint32_t lightCount)
+	{
+		using namespace icy::System;
+		std::shared_ptr<VulkanRenderer> renderer = VulkanRenderer::getShared();
+		if (!renderer)
+		{
+			std::cout << "No Vulkan device" << std::endl;
+			return 1;
+		}
+		VulkanClusteredLighting lighting;
+		if (!lighting.create(renderer.get(), ShaderDirectory))
+			return 1;
+		const std::vector<ClusterLight> lights = benchmarkLights(lightCount);
+		const ClusterCamera camera = benchmarkLightCamera();
+
+		OffscreenTarget target;
+		if (!createOffscreenTarget(*renderer, target))
+		{
+			lighting.destroy();
+			return 1;
+		}
+
+		// Frames like the particle benchmark's, the binning on the compute queue and the frame's pass waiting for it
+		// before its fragments, where shading would read the grid
+		VulkanQueueScheduler& scheduler = renderer->getQueueScheduler();
+		QueueTotals queues = {};
+		bool bFrames = true;
+		for (int frame = 0; frame < LightWarmupFrames + LightFrames; ++frame)
+		{
+			bFrames = renderer->beginFrame();
+			if (!bFrames)
+				break;
+			if (frame >= LightWarmupFrames)
+				addQueueTimes(scheduler, queues);
+			VkCommandBuffer compute = scheduler.begin(QueueType::Compute);
+			lighting.update(compute, renderer->getFrameIndex(), camera, lights.data(), lightCount);
+			if (frame == LightWarmupFrames + LightFrames - 1)
+				lighting.recordReadBack(compute);
+			// The last frame's fragments still read the grid this binning writes
+			const SyncPoint lastFrame = scheduler.getLastFrame();
+			const SyncPoint binned = scheduler.submit(QueueType::Compute, compute, &lastFrame, 1, VK_PIPELINE_STAGE_TRANSFER_BIT);
+			scheduler.waitInFrame(binned, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			beginOffscreenPass(renderer->getCommandBuffer(), target);
+			vkCmdEndRenderPass(renderer->getCommandBuffer());
+			renderer->endFrame();
+		}
+		renderer->waitForFrames();
+
+		std::vector<ClusterRange> grid;
+		std::vector<uint32_t> indices;
+		uint32_t overflowed = 0;
+		lighting.readBack(grid, indices, overflowed);
+		LightClusterer reference;
+		reference.build(lights.data(), lightCount, lighting.getParams());
+		const uint32_t different = reference.compare(grid.data(), indices.data(), static_cast<uint32_t>(indices.size()));
+		reportLights("Vulkan", renderer->getDeviceInfo().properties.deviceName, reference.getStats(), lighting.getStats(), different);
+		reportQueues(scheduler, queues);
+
+		lighting.destroy();
+		destroyOffscreenTarget(*renderer, target);
+		return bFrames && different == 0 ? 0 : 1;
+	}
+
+	// A wall in front of the camera hides most of a field of boxes, the camera strafes past its end so boxes keep
+	// coming into view from behind it
+	const int CullWarmupFrames = 5;
+	const int CullFrames = 60;
+	const int CullReportInterval = 10;
+	const int CullFrameWidth = 1280;
+	const int CullFrameHeight = 720;
+	// Uniform block binding of the camera in the box material
+	const GLuint CullCameraBinding = 1;
+
+	const char* BoxVertexSource =
+		"#version 450\n"
+		"layout(location = 0) in vec3 a_Position;\n"
+		"layout(location = 1) in vec3 a_Normal;\n"
+		"layout(std140, binding = 1) uniform Camera { mat4 viewProjection; } u_Camera;\n"
+		"layout(location = 0) out vec3 v_Normal;\n"
+		"void main()\n"
+		"{\n"
+		"	mat4 model = icy_Draws[ICY_DRAW_ID].model;\n"
+		"	v_Normal = mat3(model) * a_Normal;\n"
+		"	gl_Position = u_Camera.viewProjection * model * vec4(a_Position, 1.0);\n"
+		"}\n";
+	const char* BoxFragmentSource =
+		"#version 450\n"
+		"layout(location = 0) in vec3 v_Normal;\n"
+		"layout(location = 0) out vec4 o_Color;\n"
+		"void main()\n"
+		"{\n"
+		"	float light = max(dot(normalize(v_Normal), normalize(vec3(0.4, 0.8, 0.3))), 0.0);\n"
+		"	o_Color = vec4(vec3(0.2 + 0.8 * light), 1.0);\n"
+		"}\n";
+
+	// Unit cube around the origin with a normal per face
+	icy::System::OpenGLIndirectRenderer::MeshHandle addBoxMesh(icy::System::OpenGLIndirectRenderer& renderer)
+	{
+		icy::System::OpenGLIndirectRenderer::Vertex vertices[24];
+		uint32_t indices[36];
+		for (int face = 0; face < 6; ++face)
+		{
+			const int axis = face / 2;
+			const float sign = face % 2 == 0 ? 1.0f : -1.0f;
+			for (int corner = 0; corner < 4; ++corner)
+			{
+				icy::System::OpenGLIndirectRenderer::Vertex& vertex = vertices[face * 4 + corner];
+				vertex = {};
+				// The two other axes walk the face's corners, flipped on the negative side to keep the winding
+				const float u = (corner == 1 || corner == 2) ? 0.5f : -0.5f;
+				const float v = corner >= 2 ? 0.5f : -0.5f;
+				vertex.position[axis] = 0.5f * sign;
+				vertex.position[(axis + 1) % 3] = u * sign;
+				vertex.position[(axis + 2) % 3] = v;
+				vertex.normal[axis] = sign;
+				vertex.uv[0] = u + 0.5f;
+				vertex.uv[1] = v + 0.5f;
+			}
+			const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+			for (int i = 0; i < 6; ++i)
+				indices[face * 6 + i] = face * 4 + quad[i];
+		}
+		return renderer.addMesh(vertices, 24, indices, 36);
+	}
+
+	struct CullMaterial
+	{
+		icy::System::OpenGLIndirectRenderer::MeshHandle mesh;
+		icy::System::OpenGLIndirectRenderer::MaterialHandle material;
+		icy::System::OpenGLIndirectRenderer::TextureHandle texture;
+	};
+
+	// Column major scale then translation
+	void boxTransform(float x, float y, float z, float width, float height, float depth, float* model)
+	{
+		for (int i = 0; i < 16; ++i)
+			model[i] = 0.0f;
+		model[0] = width;
+		model[5] = height;
+		model[10] = depth;
+		model[12] = x;
+		model[13] = y;
+		model[14] = z;
+		model[15] = 1.0f;
+	}
+
+	// 60 degrees high looking down -z from (x, 2, z), near 0.1 and far 200
+	void cullCamera(float x, float z, float* viewProjection)
+	{
+		const float f = 1.0f / std::tan(0.5235988f);
+		const float aspect = static_cast<float>(CullFrameWidth) / CullFrameHeight;
+		const float nearPlane = 0.1f;
+		const float farPlane = 200.0f;
+		const float a = (farPlane + nearPlane) / (nearPlane - farPlane);
+		const float b = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+		for (int i = 0; i < 16; ++i)
+			viewProjection[i] = 0.0f;
+		viewProjection[0] = f / aspect;
+		viewProjection[5] = f;
+		viewProjection[10] = a;
+		viewProjection[11] = -1.0f;
+		viewProjection[12] = -x * f / aspect;
+		viewProjection[13] = -2.0f * f;
+		viewProjection[14] = b - a * z;
+		viewProjection[15] = z;
+	}
+
+	// The wall first, then boxCount boxes on a grid behind it
+	std::vector<float> cullScene(uint32_t boxCount)
+	{
+		std::vector<float> models((boxCount + 1) * 16);
+		boxTransform(0.0f, 3.0f, -6.0f, 40.0f, 10.0f, 1.0f, models.data());
+		const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(boxCount))));
+		for (uint32_t i = 0; i < boxCount; ++i)
+		{
+			const float x = -60.0f + 120.0f * ((i % columns) + 0.5f) / columns;
+			const float z = -10.0f - 150.0f * ((i / columns) + 0.5f) / columns;
+			boxTransform(x, 0.5f, z, 1.0f, 1.0f, 1.0f, models.data() + (i + 1) * 16);
+		}
+		return models;
+	}
+
+	// Draws one frame of the scene into the bound framebuffer
+	void drawCullFrame(icy::System::OpenGLIndirectRenderer& renderer, icy::System::OpenGLStreamBuffer& streamBuffer, icy::System::OpenGLStateCache& stateCache,
+		const CullMaterial& box, const std::vector<float>& models, const float* viewProjection)
+	{
+		auto camera = streamBuffer.allocate(16 * sizeof(float), streamBuffer.getUniformAlignment());
+		if (camera.data != nullptr)
+		{
+			std::memcpy(camera.data, viewProjection, 16 * sizeof(float));
+			stateCache.bindBufferRange(GL_UNIFORM_BUFFER, CullCameraBinding, streamBuffer.getBuffer(), camera.offset, camera.size);
+		}
+		stateCache.depthMask(true);
+		glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		const uint32_t count = static_cast<uint32_t>(models.size() / 16);
+		for (uint32_t i = 0; i < count; ++i)
+			renderer.submit(box.mesh, box.material, box.texture, models.data() + i * 16, icy::Renderer::RenderQueue::makeKey(0, 0, false, 0, box.material, 0.0f), i);
+		renderer.flush();
+	}
+
+	// Strafes across the scene for CullFrames frames, with the culler when it isn't null
+	// Returns milliseconds per frame and leaves the last frame's pixels
+	double runCullFrames(icy::Window::OpenGLBackend& backend, icy::System::OpenGLOcclusionCuller* culler, const CullMaterial& box,
+		const std::vector<float>& models, std::vector<uint8_t>& pixels)
+	{
+		icy::System::OpenGLIndirectRenderer& renderer = backend.getRenderer();
+		renderer.setOcclusionCuller(culler);
+		double ms = 0.0;
+		double occludedRatio = 0.0;
+		int reported = 0;
+		float viewProjection[16];
+		for (int frame = 0; frame < CullWarmupFrames + CullFrames; ++frame)
+		{
+			// Past the wall's end at x = 20 in the last third
+			const float x = -30.0f + 60.0f * frame / (CullWarmupFrames + CullFrames - 1);
+			cullCamera(x, 0.0f, viewProjection);
+			if (culler != nullptr)
+				culler->setCamera(viewProjection);
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			drawCullFrame(renderer, backend.getStreamBuffer(), backend.getStateCache(), box, models, viewProjection);
+			glFinish();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			backend.getStreamBuffer().nextFrame();
+			if (frame < CullWarmupFrames)
+				continue;
+			ms += elapsed.count();
+
+			// Stats come back a few frames late, the glFinish above makes the latest ones land
+			if (culler == nullptr)
+				continue;
+			const icy::System::OcclusionStats& stats = culler->getStats();
+			occludedRatio += stats.occludedRatio;
+			++reported;
+			if ((frame - CullWarmupFrames) % CullReportInterval == 0)
+			{
+				std::cout << "frame " << stats.frame << ", camera x " << x << ": " << stats.frustumCulled << " outside the frustum, " << stats.occluded << " occluded, "
+					<< stats.secondPhase << " drawn in the second phase, occluded ratio " << stats.occludedRatio << std::endl;
+			}
+		}
+		if (reported > 0)
+			std::cout << "average occluded ratio " << occludedRatio / reported << std::endl;
+		pixels.resize(CullFrameWidth * CullFrameHeight * 4);
+		glReadPixels(0, 0, CullFrameWidth, CullFrameHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		renderer.setOcclusionCuller(nullptr);
+		return ms / CullFrames;
+	}
+
+	int runOpenGLCulling(uint32_t boxCount)
+	{
+		using namespace icy::System;
+		icy::Window::StaticOpenGLWindow window;
+		if (!window.createWindow("Culling benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 64, 64, SDL_WINDOW_HIDDEN))
+		{
+			std::cout << "No OpenGL 4.5 context" << std::endl;
+			return 1;
+		}
+		icy::Window::OpenGLBackend& backend = window.getBackend();
+		OpenGLStateCache& stateCache = backend.getStateCache();
+		OpenGLIndirectRenderer& renderer = backend.getRenderer();
+		if (boxCount + 1 > OpenGLIndirectRenderer::MaxDraws)
+			boxCount = OpenGLIndirectRenderer::MaxDraws - 1;
+		OpenGLOcclusionCuller culler;
+		if (!culler.create(&stateCache, &backend.getStreamBuffer(), ShaderDirectory, OpenGLIndirectRenderer::MaxDraws))
+			return 1;
+		// Every draw needs a texture even though the boxes don't sample it
+		const std::vector<uint8_t> white(OpenGLIndirectRenderer::ArrayTextureSize * OpenGLIndirectRenderer::ArrayTextureSize * 4, 255);
+		CullMaterial box;
+		box.mesh = addBoxMesh(renderer);
+		box.material = renderer.createMaterial(BoxVertexSource, BoxFragmentSource);
+		box.texture = renderer.addTexture(white.data(), OpenGLIndirectRenderer::ArrayTextureSize, OpenGLIndirectRenderer::ArrayTextureSize);
+		if (box.mesh == OpenGLIndirectRenderer::InvalidHandle || box.material == OpenGLIndirectRenderer::InvalidHandle || box.texture == OpenGLIndirectRenderer::InvalidHandle)
+			return 1;
+		const std::vector<float> models = cullScene(boxCount);
+
+		GLuint color = stateCache.createTexture2D(1, GL_RGBA8, CullFrameWidth, CullFrameHeight);
+		GLuint depth = stateCache.createTexture2D(1, GL_DEPTH_COMPONENT32F, CullFrameWidth, CullFrameHeight);
+		GLuint framebuffer = 0;
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, color, 0);
+		glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depth, 0);
+		stateCache.bindFramebuffer(framebuffer);
+		stateCache.viewport(0, 0, CullFrameWidth, CullFrameHeight);
+		stateCache.enable(GL_DEPTH_TEST);
+		stateCache.depthFunc(GL_LESS);
+		stateCache.disable(GL_BLEND);
+		culler.setDepthTarget(depth, CullFrameWidth, CullFrameHeight);
+
+		std::cout << "OpenGL on " << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << ", " << boxCount << " boxes behind a wall, "
+			<< CullFrameWidth << "x" << CullFrameHeight << std::endl;
+		std::vector<uint8_t> pixels[2];
+		const double culledMs = runCullFrames(backend, &culler, box, models, pixels[0]);
+		const double plainMs = runCullFrames(backend, nullptr, box, models, pixels[1]);
+		uint32_t differentPixels = 0;
+		for (size_t i = 0; i < pixels[0].size(); i += 4)
+			differentPixels += std::memcmp(&pixels[0][i], &pixels[1][i], 4) != 0 ? 1 : 0;
+		std::cout << "hi-z culled frame     " << culledMs << " ms" << std::endl;
+		std::cout << "unculled frame        " << plainMs << " ms" << std::endl;
+		std::cout << "pixels that differ    " << differentPixels << std::endl;
+
+		stateCache.bindFramebuffer(0);
+		glDeleteFramebuffers(1, &framebuffer);
+		stateCache.deleteTexture(color);
+		stateCache.deleteTexture(depth);
+		culler.destroy();
+		return differentPixels == 0 ? 0 : 1;
+	}
+
+	// A field of spheres with a LOD chain each, the camera walks into it and then stands still with a little jitter
+	const int LodWarmupFrames = 5;
+	const int LodFrames = 40;
+	const int LodJitterFrames = 30;
+	const int LodReportInterval = 10;
+	const uint32_t LodSubdivisions = 4;
+	const float LodThreshold = 1.0f;
+	const float LodHysteresis = 0.25f;
+
+	// Unit diameter icosphere, every subdivision splits each triangle in four
+	void buildIcosphere(uint32_t subdivisions, std::vector<icy::System::OpenGLIndirectRenderer::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		const float t = 1.618034f;
+		const float corners[12][3] = {
+			{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 }, { 0, -1, t }, { 0, 1, t },
+			{ 0, -1, -t }, { 0, 1, -t }, { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+		const uint32_t faces[60] = {
+			0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11, 1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+			3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9, 4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1 };
+		std::vector<float> positions(corners[0], corners[0] + 36);
+		indices.assign(faces, faces + 60);
+		for (uint32_t level = 0; level < subdivisions; ++level)
+		{
+			// Each edge is split once, the midpoint is shared by the triangles on both sides
+			std::vector<std::pair<uint64_t, uint32_t>> midpoints;
+			auto midpoint = [&](uint32_t a, uint32_t b)
+			{
+				const uint64_t key = a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+				for (const auto& known : midpoints)
+				{
+					if (known.first == key)
+						return known.second;
+				}
+				const uint32_t vertex = static_cast<uint32_t>(positions.size() / 3);
+				for (int axis = 0; axis < 3; ++axis)
+					positions.push_back((positions[a * 3 + axis] + positions[b * 3 + axis]) * 0.5f);
+				midpoints.push_back({ key, vertex });
+				return vertex;
+			};
+			std::vector<uint32_t> split;
+			split.reserve(indices.size() * 4);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const uint32_t a = indices[i];
+				const uint32_t b = indices[i + 1];
+				const uint32_t c = indices[i + 2];
+				const uint32_t ab = midpoint(a, b);
+				const uint32_t bc = midpoint(b, c);
+				const uint32_t ca = midpoint(c, a);
+				const uint32_t triangles[12] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+				split.insert(split.end(), triangles, triangles + 12);
+			}
+			indices.swap(split);
+		}
+
+		vertices.resize(positions.size() / 3);
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const float* p = &positions[i * 3];
+			const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			vertices[i] = {};
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				vertices[i].normal[axis] = p[axis] / length;
+				vertices[i].position[axis] = 0.5f * p[axis] / length;
+			}
+			vertices[i].uv[0] = 0.5f + 0.5f * vertices[i].normal[0];
+			vertices[i].uv[1] = 0.5f + 0.5f * vertices[i].normal[1];
+		}
+	}
+
+	// A 50x50 quad grid with up to LodRelief of bumps, every level of its chain has to stay within the bumps
+	const uint32_t LodGridSize = 50;
+	const float LodRelief = 0.04f;
+
+	bool checkFlatLods()
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> height(0.0f, LodRelief);
+		std::vector<float> positions;
+		positions.reserve((LodGridSize + 1) * (LodGridSize + 1) * 3);
+		for (uint32_t z = 0; z <= LodGridSize; ++z)
+		{
+			for (uint32_t x = 0; x <= LodGridSize; ++x)
+			{
+				positions.push_back(static_cast<float>(x));
+				positions.push_back(height(random));
+				positions.push_back(static_cast<float>(z));
+			}
+		}
+		std::vector<uint32_t> indices;
+		indices.reserve(LodGridSize * LodGridSize * 6);
+		for (uint32_t z = 0; z < LodGridSize; ++z)
+		{
+			for (uint32_t x = 0; x < LodGridSize; ++x)
+			{
+				const uint32_t corner = z * (LodGridSize + 1) + x;
+				const uint32_t quad[6] = { corner, corner + LodGridSize + 1, corner + 1, corner + 1, corner + LodGridSize + 1, corner + LodGridSize + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+		std::vector<icy::System::MeshLod> lods;
+		icy::System::MeshSimplifier::buildLodChain(positions.data(), sizeof(float) * 3, static_cast<uint32_t>(positions.size() / 3),
+			indices.data(), static_cast<uint32_t>(indices.size()), 0.5f, 1.0f, lods);
+		bool bWithin = true;
+		for (size_t i = 0; i < lods.size(); ++i)
+		{
+			if (lods[i].error > LodRelief)
+			{
+				std::cout << "Flat grid level " << i << ": " << lods[i].indices.size() / 3 << " triangles, error " << lods[i].error
+					<< " past the " << LodRelief << " relief" << std::endl;
+				bWithin = false;
+			}
+		}
+		if (bWithin)
+			std::cout << "Flat grid chain of " << lods.size() << " levels down to " << lods.back().indices.size() / 3
+				<< " triangles, error " << lods.back().error << " within the " << LodRelief << " relief" << std::endl;
+		return bWithin;
+	}
+
+	// sphereCount spheres on a grid from 5 to 185 units in front of the camera's start
+	std::vector<float> lodScene(uint32_t sphereCount)
+	{
+		std::vector<float> models(sphereCount * 16);
+		const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(sphereCount))));
+		for (uint32_t i = 0; i < sphereCount; ++i)
+		{
+			const float x = -40.0f + 80.0f * ((i % columns) + 0.5f) / columns;
+			const float z = -5.0f - 180.0f * ((i / columns) + 0.5f) / columns;
+			boxTransform(x, 0.5f, z, 1.0f, 1.0f, 1.0f, models.data() + i * 16);
+		}
+		return models;
+	}
+
+	struct LodTotals
+	{
+		double ms;
+		uint64_t fullTriangles;
+		uint64_t lodTriangles;
+		uint32_t switches;
+		int frames;
+	};
+
+	// Draws frames with the camera at z(frame), adds up the culler's counts of every frame that came back
+	// Leaves the last frame's pixels
+	template <class Path>
+	LodTotals runLodFrames(icy::Window::OpenGLBackend& backend, icy::System::OpenGLOcclusionCuller& culler, const CullMaterial& sphere,
+		const std::vector<float>& models, int frames, Path z, bool report, std::vector<uint8_t>& pixels)
+	{
+		icy::System::OpenGLIndirectRenderer& renderer = backend.getRenderer();
+		renderer.setOcclusionCuller(&culler);
+		LodTotals totals = {};
+		uint64_t lastFrame = culler.getStats().frame;
+		float viewProjection[16];
+		for (int frame = 0; frame < LodWarmupFrames + frames; ++frame)
+		{
+			const float position[3] = { 0.0f, 2.0f, z(frame) };
+			cullCamera(position[0], position[2], viewProjection);
+			culler.setCamera(viewProjection);
+			// Same projection as cullCamera
+			culler.setLodCamera(position, CullFrameHeight, std::tan(0.5235988f));
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			drawCullFrame(renderer, backend.getStreamBuffer(), backend.getStateCache(), sphere, models, viewProjection);
+			glFinish();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			backend.getStreamBuffer().nextFrame();
+
+			// Stats come back a few frames late, the glFinish above makes the latest ones land
+			const icy::System::OcclusionStats& stats = culler.getStats();
+			const bool fresh = stats.frame != lastFrame;
+			lastFrame = stats.frame;
+			if (frame < LodWarmupFrames)
+				continue;
+			totals.ms += elapsed.count();
+			++totals.frames;
+			if (!fresh)
+				continue;
+			totals.fullTriangles += stats.fullTriangles;
+			totals.lodTriangles += stats.lodTriangles;
+			totals.switches += stats.lodSwitches;
+			if (report && (frame - LodWarmupFrames) % LodReportInterval == 0)
+			{
+				std::cout << "frame " << stats.frame << ", camera z " << position[2] << ": " << stats.fullTriangles << " triangles at full detail, "
+					<< stats.lodTriangles << " with LODs, " << stats.lodSwitches << " LOD switches" << std::endl;
+			}
+		}
+		pixels.resize(CullFrameWidth * CullFrameHeight * 4);
+		glReadPixels(0, 0, CullFrameWidth, CullFrameHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		renderer.setOcclusionCuller(nullptr);
+		return totals;
+	}
+
+	int runOpenGLLods(uint32_t sphereCount)
+	{
+		using namespace icy::System;
+		icy::Window::StaticOpenGLWindow window;
+		if (!window.createWindow("LOD benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 64, 64, SDL_WINDOW_HIDDEN))
+		{
+			std::cout << "No OpenGL 4.5 context" << std::endl;
+			return 1;
+		}
+		icy::Window::OpenGLBackend& backend = window.getBackend();
+		OpenGLStateCache& stateCache = backend.getStateCache();
+		OpenGLIndirectRenderer& renderer = backend.getRenderer();
+		if (sphereCount > OpenGLIndirectRenderer::MaxDraws)
+			sphereCount = OpenGLIndirectRenderer::MaxDraws;
+		OpenGLOcclusionCuller culler;
+		if (!culler.create(&stateCache, &backend.getStreamBuffer(), ShaderDirectory, OpenGLIndirectRenderer::MaxDraws))
+			return 1;
+
+		std::vector<OpenGLIndirectRenderer::Vertex> vertices;
+		std::vector<uint32_t> indices;
+		buildIcosphere(LodSubdivisions, vertices, indices);
+		std::vector<MeshLod> lods;
+		auto start = std::chrono::steady_clock::now();
+		MeshSimplifier::buildLodChain(vertices[0].position, sizeof(OpenGLIndirectRenderer::Vertex), static_cast<uint32_t>(vertices.size()),
+			indices.data(), static_cast<uint32_t>(indices.size()), 0.5f, 1.0f, lods);
+		std::chrono::duration<double, std::milli> buildMs = std::chrono::steady_clock::now() - start;
+		std::cout << "LOD chain of a " << indices.size() / 3 << " triangle sphere built in " << buildMs.count() << " ms" << std::endl;
+		for (size_t i = 0; i < lods.size(); ++i)
+			std::cout << "  level " << i << ": " << lods[i].indices.size() / 3 << " triangles, error " << lods[i].error << std::endl;
+
+		const std::vector<uint8_t> white(OpenGLIndirectRenderer::ArrayTextureSize * OpenGLIndirectRenderer::ArrayTextureSize * 4, 255);
+		CullMaterial sphere;
+		sphere.mesh = renderer.addMesh(vertices.data(), static_cast<uint32_t>(vertices.size()), lods.data(), static_cast<uint32_t>(lods.size()));
+		sphere.material = renderer.createMaterial(BoxVertexSource, BoxFragmentSource);
+		sphere.texture = renderer.addTexture(white.data(), OpenGLIndirectRenderer::ArrayTextureSize, OpenGLIndirectRenderer::ArrayTextureSize);
+		if (sphere.mesh == OpenGLIndirectRenderer::InvalidHandle || sphere.material == OpenGLIndirectRenderer::InvalidHandle || sphere.texture == OpenGLIndirectRenderer::InvalidHandle)
+			return 1;
+		const std::vector<float> models = lodScene(sphereCount);
+
+		GLuint color = stateCache.createTexture2D(1, GL_RGBA8, CullFrameWidth, CullFrameHeight);
+		GLuint depth = stateCache.createTexture2D(1, GL_DEPTH_COMPONENT32F, CullFrameWidth, CullFrameHeight);
+		GLuint framebuffer = 0;
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, color, 0);
+		glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depth, 0);
+		stateCache.bindFramebuffer(framebuffer);
+		stateCache.viewport(0, 0, CullFrameWidth, CullFrameHeight);
+		stateCache.enable(GL_DEPTH_TEST);
+		stateCache.depthFunc(GL_LESS);
+		stateCache.disable(GL_BLEND);
+		culler.setDepthTarget(depth, CullFrameWidth, CullFrameHeight);
+
+		std::cout << "OpenGL on " << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << ", " << sphereCount << " spheres, "
+			<< CullFrameWidth << "x" << CullFrameHeight << ", " << LodThreshold << " pixel threshold" << std::endl;
+		// Walks 40 units into the field
+		auto walk = [](int frame) { return -40.0f * frame / (LodWarmupFrames + LodFrames - 1); };
+		std::vector<uint8_t> pixels[2];
+		culler.setLodThreshold(LodThreshold, LodHysteresis);
+		const LodTotals lod = runLodFrames(backend, culler, sphere, models, LodFrames, walk, true, pixels[0]);
+		culler.setLodThreshold(0.0f, LodHysteresis);
+		const LodTotals full = runLodFrames(backend, culler, sphere, models, LodFrames, walk, false, pixels[1]);
+		uint32_t differentPixels = 0;
+		for (size_t i = 0; i < pixels[0].size(); i += 4)
+			differentPixels += std::memcmp(&pixels[0][i], &pixels[1][i], 4) != 0 ? 1 : 0;
+
+		// Half a unit back and forth every frame, the hysteresis should keep the levels from flickering
+		auto jitter = [](int frame) { return -20.0f + (frame % 2 == 0 ? 0.5f : -0.5f); };
+		std::vector<uint8_t> unused;
+		culler.setLodThreshold(LodThreshold, 0.0f);
+		const LodTotals plainJitter = runLodFrames(backend, culler, sphere, models, LodJitterFrames, jitter, false, unused);
+		culler.setLodThreshold(LodThreshold, LodHysteresis);
+		const LodTotals stableJitter = runLodFrames(backend, culler, sphere, models, LodJitterFrames, jitter, false, unused);
+
+		std::cout << "triangles per frame   " << full.fullTriangles / std::max(lod.frames, 1) << " at full detail, "
+			<< lod.lodTriangles / std::max(lod.frames, 1) << " with LODs" << std::endl;
+		std::cout << "LOD frame             " << lod.ms / lod.frames << " ms" << std::endl;
+		std::cout << "full detail frame     " << full.ms / full.frames << " ms" << std::endl;
+		std::cout << "pixels that differ    " << differentPixels << std::endl;
+		std::cout << "jitter LOD switches   " << plainJitter.switches << " without hysteresis, " << stableJitter.switches << " with "
+			<< LodHysteresis << std::endl;
+
+		stateCache.bindFramebuffer(0);
+		glDeleteFramebuffers(1, &framebuffer);
+		stateCache.deleteTexture(color);
+		stateCache.deleteTexture(depth);
+		culler.destroy();
+		return lod.lodTriangles <= full.fullTriangles ? 0 : 1;
+	}
+
+	// The culling scene with a share of the boxes bobbing every frame, drawn from streamed draw data and from the scene buffer
+	const int SceneWarmupFrames = 5;
+	const int SceneFrames = 30;
+	const float SceneCameraX = 25.0f;
+
+	// Moves count boxes, a different run of them every frame, and sets the moved ones on the scene buffer when it isn't null
+	void bobBoxes(std::vector<float>& models, int frame, uint32_t count, icy::System::SceneInstances* instances,
+		const std::vector<icy::System::SceneInstances::InstanceId>& ids)
+	{
+		const uint32_t boxCount = static_cast<uint32_t>(models.size() / 16) - 1;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			// The wall is the first model and stays put
+			const uint32_t box = 1 + (static_cast<uint32_t>(frame) * count + i) % boxCount;
+			models[box * 16 + 13] = 0.5f + 0.25f * std::sin(0.3f * frame + box);
+			if (instances != nullptr)
+				instances->set(ids[box], &models[box * 16], nullptr);
+		}
+	}
+
+	struct SceneTotals
+	{
+		double ms;
+		uint64_t streamBytes;
+		uint64_t deltaBytes;
+		uint64_t fullBytes;
+	};
+
+	// Draws SceneFrames frames with dirty boxes moving, from the scene buffer when fromScene is set
+	// Returns the totals after the warmup and leaves the last frame's pixels
+	SceneTotals runSceneFrames(icy::Window::OpenGLBackend& backend, const CullMaterial& box, std::vector<float> models, uint32_t dirty, bool fromScene,
+		const std::vector<icy::System::SceneInstances::InstanceId>& ids, std::vector<uint8_t>& pixels)
+	{
+		icy::System::OpenGLIndirectRenderer& renderer = backend.getRenderer();
+		icy::System::OpenGLStreamBuffer& streamBuffer = backend.getStreamBuffer();
+		icy::System::OpenGLSceneBuffer& scene = backend.getSceneBuffer();
+		// Every run starts from the same scene
+		const uint32_t count = static_cast<uint32_t>(models.size() / 16);
+		for (uint32_t i = 0; i < count; ++i)
+			scene.getInstances().set(ids[i], &models[i * 16], nullptr);
+
+		SceneTotals totals = {};
+		float viewProjection[16];
+		cullCamera(SceneCameraX, 0.0f, viewProjection);
+		const uint64_t key = icy::Renderer::RenderQueue::makeKey(0, 0, false, 0, box.material, 0.0f);
+		for (int frame = 0; frame < SceneWarmupFrames + SceneFrames; ++frame)
+		{
+			bobBoxes(models, frame, dirty, fromScene ? &scene.getInstances() : nullptr, ids);
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			auto camera = streamBuffer.allocate(16 * sizeof(float), streamBuffer.getUniformAlignment());
+			if (camera.data != nullptr)
+			{
+				std::memcpy(camera.data, viewProjection, 16 * sizeof(float));
+				backend.getStateCache().bindBufferRange(GL_UNIFORM_BUFFER, CullCameraBinding, streamBuffer.getBuffer(), camera.offset, camera.size);
+			}
+			backend.getStateCache().depthMask(true);
+			glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (fromScene)
+					renderer.submitInstance(box.mesh, box.material, ids[i], key);
+				else
+					renderer.submit(box.mesh, box.material, box.texture, &models[i * 16], key, i);
+			}
+			renderer.flush();
+			glFinish();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			const uint64_t streamBytes = static_cast<uint64_t>(streamBuffer.getBytesUsed());
+			streamBuffer.nextFrame();
+			if (frame < SceneWarmupFrames)
+				continue;
+			totals.ms += elapsed.count();
+			totals.streamBytes += streamBytes;
+			totals.deltaBytes += fromScene ? scene.getStats().bytes : count * sizeof(icy::System::SceneInstance);
+			totals.fullBytes += scene.getStats().fullBytes;
+		}
+		pixels.resize(CullFrameWidth * CullFrameHeight * 4);
+		glReadPixels(0, 0, CullFrameWidth, CullFrameHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		return totals;
+	}
+
+	uint32_t differentPixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+	{
+		uint32_t different = 0;
+		for (size_t i = 0; i < a.size(); i += 4)
+			different += std::memcmp(&a[i], &b[i], 4) != 0 ? 1 : 0;
+		return different;
+	}
+
+	int runOpenGLScene(uint32_t boxCount)
+	{
+		using namespace icy::System;
+		icy::Window::StaticOpenGLWindow window;
+		if (!window.createWindow("Scene buffer benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 64, 64, SDL_WINDOW_HIDDEN))
+		{
+			std::cout << "No OpenGL 4.5 context" << std::endl;
+			return 1;
+		}
+		icy::Window::OpenGLBackend& backend = window.getBackend();
+		OpenGLStateCache& stateCache = backend.getStateCache();
+		OpenGLIndirectRenderer& renderer = backend.getRenderer();
+		OpenGLSceneBuffer& scene = backend.getSceneBuffer();
+		if (boxCount + 1 > OpenGLIndirectRenderer::MaxDraws)
+			boxCount = OpenGLIndirectRenderer::MaxDraws - 1;
+		if (!scene.create(&stateCache, &backend.getStreamBuffer(), ShaderDirectory))
+			return 1;
+		// Scene instance ids go up to MaxInstances, the culler keeps a LOD state for each
+		OpenGLOcclusionCuller culler;
+		if (!culler.create(&stateCache, &backend.getStreamBuffer(), ShaderDirectory, OpenGLIndirectRenderer::MaxDraws, SceneInstances::MaxInstances))
+			return 1;
+		const std::vector<uint8_t> white(OpenGLIndirectRenderer::ArrayTextureSize * OpenGLIndirectRenderer::ArrayTextureSize * 4, 255);
+		CullMaterial box;
+		box.mesh = addBoxMesh(renderer);
+		box.material = renderer.createMaterial(BoxVertexSource, BoxFragmentSource);
+		box.texture = renderer.addTexture(white.data(), OpenGLIndirectRenderer::ArrayTextureSize, OpenGLIndirectRenderer::ArrayTextureSize);
+		if (box.mesh == OpenGLIndirectRenderer::InvalidHandle || box.material == OpenGLIndirectRenderer::InvalidHandle || box.texture == OpenGLIndirectRenderer::InvalidHandle)
+			return 1;
+		const std::vector<float> models = cullScene(boxCount);
+		uint32_t texture[4];
+		renderer.getTextureWords(box.texture, texture);
+		std::vector<SceneInstances::InstanceId> ids(models.size() / 16);
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			ids[i] = scene.getInstances().create();
+			scene.getInstances().set(ids[i], &models[i * 16], texture);
+		}
+
+		GLuint color = stateCache.createTexture2D(1, GL_RGBA8, CullFrameWidth, CullFrameHeight);
+		GLuint depth = stateCache.createTexture2D(1, GL_DEPTH_COMPONENT32F, CullFrameWidth, CullFrameHeight);
+		GLuint framebuffer = 0;
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, color, 0);
+		glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depth, 0);
+		stateCache.bindFramebuffer(framebuffer);
+		stateCache.viewport(0, 0, CullFrameWidth, CullFrameHeight);
+		stateCache.enable(GL_DEPTH_TEST);
+		stateCache.depthFunc(GL_LESS);
+		stateCache.disable(GL_BLEND);
+		culler.setDepthTarget(depth, CullFrameWidth, CullFrameHeight);
+
+		std::cout << "OpenGL on " << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << ", " << ids.size() << " draws, "
+			<< sizeof(SceneInstance) << " bytes of draw data each" << std::endl;
+		uint32_t different = 0;
+		const uint32_t rates[] = { 1, 10, 100 };
+		for (uint32_t rate : rates)
+		{
+			const uint32_t dirty = boxCount * rate / 100;
+			std::vector<uint8_t> pixels[2];
+			const SceneTotals streamed = runSceneFrames(backend, box, models, dirty, false, ids, pixels[0]);
+			const SceneTotals delta = runSceneFrames(backend, box, models, dirty, true, ids, pixels[1]);
+			const uint32_t frameDifference = differentPixels(pixels[0], pixels[1]);
+			different += frameDifference;
+			std::cout << rate << "% dirty, " << dirty << " instances" << std::endl;
+			std::cout << "  streamed draw data  " << streamed.deltaBytes / SceneFrames << " bytes, " << streamed.streamBytes / SceneFrames
+				<< " streamed in all, " << streamed.ms / SceneFrames << " ms per frame" << std::endl;
+			std::cout << "  scene buffer delta  " << delta.deltaBytes / SceneFrames << " bytes against " << delta.fullBytes / SceneFrames
+				<< " for a full upload, " << delta.streamBytes / SceneFrames << " streamed in all, " << delta.ms / SceneFrames << " ms per frame" << std::endl;
+			std::cout << "  pixels that differ  " << frameDifference << std::endl;
+		}
+
+		// Scene draws through the culler, its LOD state is indexed by the instance ids
+		std::vector<uint8_t> pixels[2];
+		float viewProjection[16];
+		cullCamera(SceneCameraX, 0.0f, viewProjection);
+		culler.setCamera(viewProjection);
+		const uint32_t dirty = boxCount / 100;
+		runSceneFrames(backend, box, models, dirty, true, ids, pixels[0]);
+		renderer.setOcclusionCuller(&culler);
+		const SceneTotals culled = runSceneFrames(backend, box, models, dirty, true, ids, pixels[1]);
+		renderer.setOcclusionCuller(nullptr);
+		const uint32_t cullDifference = differentPixels(pixels[0], pixels[1]);
+		different += cullDifference;
+		std::cout << "culled scene draws    " << culled.ms / SceneFrames << " ms per frame, " << culler.getStats().occluded << " occluded, "
+			<< cullDifference << " pixels differ" << std::endl;
+
+		stateCache.bindFramebuffer(0);
+		glDeleteFramebuffers(1, &framebuffer);
+		stateCache.deleteTexture(color);
+		stateCache.deleteTexture(depth);
+		culler.destroy();
+		scene.destroy();
+		return different == 0 ? 0 : 1;
+	}
+
+	// HUD lines of TextLineLength characters tiled over the frame until a frame holds the benchmark's glyphs, every
+	// TextDynamicInterval-th line changes every frame like a counter would
+	const int TextWarmupFrames = 3;
+	const int TextFrames = 20;
+	const uint32_t TextFrameWidth = 1280;
+	const uint32_t TextFrameHeight = 720;
+	const uint32_t TextLineLength = 64;
+	const uint32_t TextLineHeight = 16;
+	const uint32_t TextPixelSize = 12;
+	const uint32_t TextDynamicInterval = 32;
+	const uint32_t TextColor = 0xFFE0E0E0u;
+
+	// Distinct lines of printable ASCII with a space every 8 characters
+	std::vector<std::string> textLines(uint32_t count)
+	{
+		std::mt19937 random(11);
+		std::uniform_int_distribution<int> character(33, 126);
+		std::vector<std::string> lines(count);
+		for (std::string& line : lines)
+		{
+			for (uint32_t i = 0; i < TextLineLength; ++i)
+				line += i % 8 == 7 ? ' ' : static_cast<char>(character(random));
+		}
+		return lines;
+	}
+
+	struct TextTotals
+	{
+		double layoutMs;
+		double ms;
+		uint64_t draws;
+		uint64_t glyphs;
+		uint64_t shapeHits;
+		uint64_t shapeMisses;
+		uint64_t rasterized;
+		uint64_t evictions;
+		uint64_t dropped;
+	};
+
+	void addTextStats(TextTotals& totals, const icy::System::TextStats& stats)
+	{
+		totals.glyphs += stats.glyphs;
+		totals.shapeHits += stats.shapeHits;
+		totals.shapeMisses += stats.shapeMisses;
+		totals.rasterized += stats.rasterized;
+		totals.evictions += stats.evictions;
+		totals.dropped += stats.dropped;
+	}
+
+	void addTextTotals(TextTotals& totals, const TextTotals& frame)
+	{
+		totals.layoutMs += frame.layoutMs;
+		totals.ms += frame.ms;
+		totals.draws += frame.draws;
+		totals.glyphs += frame.glyphs;
+		totals.shapeHits += frame.shapeHits;
+		totals.shapeMisses += frame.shapeMisses;
+		totals.rasterized += frame.rasterized;
+		totals.evictions += frame.evictions;
+		totals.dropped += frame.dropped;
+	}
+
+	// Adds line i of the frame's lines to the atlas, returns the milliseconds the layout took
+	// churn : every 16th line takes a size that grows every frame, so the atlas keeps rasterizing and evicting
+	double addTextLine(icy::System::GlyphAtlas& atlas, const std::vector<std::string>& lines, uint32_t i, int frame, bool churn, std::string& dynamic)
+	{
+		const uint32_t rows = TextFrameHeight / TextLineHeight;
+		const float x = static_cast<float>((i / rows) * 37 % (TextFrameWidth - 200));
+		const float y = static_cast<float>((i % rows + 1) * TextLineHeight);
+		const uint32_t size = churn && i % 16 == 0 ? 32 + (static_cast<uint32_t>(frame) * 7) % 160 : TextPixelSize;
+		const char* line = lines[i].c_str();
+		if (i % TextDynamicInterval == 0)
+		{
+			dynamic = "frame " + std::to_string(frame) + " line " + std::to_string(i) + " " + lines[i].substr(0, TextLineLength - 24);
+			line = dynamic.c_str();
+		}
+		auto start = std::chrono::steady_clock::now();
+		atlas.addText(line, x, y, size, TextColor);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	// Draws TextFrames frames of the lines, in one batch or with a draw after every line
+	// Returns the totals after the warmup and leaves the last frame's pixels
+	TextTotals runTextFrames(icy::Window::OpenGLBackend& backend, icy::System::OpenGLTextRenderer& text, const std::vector<std::string>& lines,
+		bool perString, bool churn, std::vector<uint8_t>& pixels)
+	{
+		icy::System::GlyphAtlas& atlas = text.getAtlas();
+		TextTotals totals = {};
+		for (int frame = 0; frame < TextWarmupFrames + TextFrames; ++frame)
+		{
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			TextTotals frameTotals = {};
+			std::string dynamic;
+			for (uint32_t i = 0; i < lines.size(); ++i)
+			{
+				frameTotals.layoutMs += addTextLine(atlas, lines, i, frame, churn, dynamic);
+				if (perString)
+				{
+					text.draw(TextFrameWidth, TextFrameHeight);
+					frameTotals.draws += text.getDrawCount();
+					addTextStats(frameTotals, atlas.getLastStats());
+				}
+			}
+			if (!perString)
+			{
+				text.draw(TextFrameWidth, TextFrameHeight);
+				frameTotals.draws += text.getDrawCount();
+				addTextStats(frameTotals, atlas.getLastStats());
+			}
+			glFinish();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			frameTotals.ms = elapsed.count();
+			backend.getStreamBuffer().nextFrame();
+			if (frame >= TextWarmupFrames)
+				addTextTotals(totals, frameTotals);
+		}
+		pixels.resize(TextFrameWidth * TextFrameHeight * 4);
+		glReadPixels(0, 0, TextFrameWidth, TextFrameHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		return totals;
+	}
+
+	void printTextTotals(const char* name, const TextTotals& totals)
+	{
+		std::cout << name << totals.layoutMs / TextFrames << " ms layout, " << totals.ms / TextFrames << " ms per frame, "
+			<< totals.glyphs / TextFrames << " glyphs in " << totals.draws / TextFrames << " draws" << std::endl;
+		std::cout << "                shaping cache " << totals.shapeHits / TextFrames << " hits, " << totals.shapeMisses / TextFrames
+			<< " misses, atlas " << totals.rasterized / TextFrames << " rasterized, " << totals.dropped / TextFrames << " dropped per frame, "
+			<< totals.evictions << " pages evicted in " << TextFrames << " frames" << std::endl;
+	}
+
+	int runOpenGLText(uint32_t glyphCount, const char* fontPath)
+	{
+		using namespace icy::System;
+		icy::Window::StaticOpenGLWindow window;
+		if (!window.createWindow("Text benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 64, 64, SDL_WINDOW_HIDDEN))
+		{
+			std::cout << "No OpenGL 4.5 context" << std::endl;
+			return 1;
+		}
+		icy::Window::OpenGLBackend& backend = window.getBackend();
+		OpenGLStateCache& stateCache = backend.getStateCache();
+		OpenGLTextRenderer text;
+		if (!text.create(&stateCache, &backend.getStreamBuffer(), ShaderDirectory, fontPath))
+			return 1;
+		// Every glyph of a frame goes through the stream buffer
+		const uint32_t maxGlyphs = static_cast<uint32_t>(icy::Window::OpenGLBackend::StreamRegionSize / 2 / sizeof(GlyphInstance));
+		if (glyphCount > maxGlyphs)
+			glyphCount = maxGlyphs;
+		// Spaces take no quads
+		const uint32_t lineGlyphs = TextLineLength - TextLineLength / 8;
+		const std::vector<std::string> lines = textLines((glyphCount + lineGlyphs - 1) / lineGlyphs);
+
+		GLuint color = stateCache.createTexture2D(1, GL_RGBA8, TextFrameWidth, TextFrameHeight);
+		GLuint framebuffer = 0;
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, color, 0);
+		stateCache.bindFramebuffer(framebuffer);
+		stateCache.viewport(0, 0, TextFrameWidth, TextFrameHeight);
+
+		std::cout << "OpenGL on " << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << ", " << lines.size() << " strings of "
+			<< TextLineLength << " characters per frame, " << fontPath << std::endl;
+		std::vector<uint8_t> pixels[2];
+		// Both runs draw the same text, the dynamic lines of the second come out of the shaping cache the first left
+		const TextTotals batched = runTextFrames(backend, text, lines, false, false, pixels[0]);
+		const uint32_t pages = text.getAtlas().getPageCount();
+		const TextTotals perString = runTextFrames(backend, text, lines, true, false, pixels[1]);
+		std::vector<uint8_t> churnPixels;
+		const TextTotals churn = runTextFrames(backend, text, lines, false, true, churnPixels);
+		printTextTotals("batched       ", batched);
+		printTextTotals("per string    ", perString);
+		printTextTotals("size churn    ", churn);
+
+		// Glyphs overlap, the two runs only blend in the same order when everything is on one page
+		uint32_t different = 0;
+		if (pages == 1)
+		{
+			different = differentPixels(pixels[0], pixels[1]);
+			std::cout << "pixels that differ between batched and per string  " << different << std::endl;
+		}
+		else
+			std::cout << "glyphs on " << pages << " pages, batched and per string draws blend in different orders, not compared" << std::endl;
+
+		stateCache.bindFramebuffer(0);
+		glDeleteFramebuffers(1, &framebuffer);
+		stateCache.deleteTexture(color);
+		text.destroy();
+		return different == 0 && batched.dropped == 0 && perString.dropped == 0 ? 0 : 1;
+	}
+
+	// Frames the Vulkan text pipeline gets to compile in before the timed frames
+	const int TextPipelineFrames = 600;
+
+	// One frame of the lines through the renderer without a window, uploaded and drawn in one batch into the target
+	// Waits for the frame, like the OpenGL run's glFinish, so the frame time covers the GPU work too
+	// Returns false when the renderer has no frame to record
+	bool recordTextFrame(icy::System::VulkanRenderer& renderer, icy::System::VulkanTextRenderer& text, const OffscreenTarget& target,
+		const std::vector<std::string>& lines, int frame, bool churn, TextTotals& frameTotals)
+	{
+		icy::System::GlyphAtlas& atlas = text.getAtlas();
+		frameTotals = {};
+		auto start = std::chrono::steady_clock::now();
+		if (!renderer.beginFrame())
+			return false;
+		renderer.getPipelineCompiler().beginFrame();
+		std::string dynamic;
+		for (uint32_t i = 0; i < lines.size(); ++i)
+			frameTotals.layoutMs += addTextLine(atlas, lines, i, frame, churn, dynamic);
+		VkCommandBuffer commands = renderer.getCommandBuffer();
+		text.update(commands, renderer.getFrameIndex());
+		beginOffscreenPass(commands, target);
+		text.draw(commands, TextFrameWidth, TextFrameHeight);
+		vkCmdEndRenderPass(commands);
+		renderer.endFrame();
+		renderer.waitForFrames();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		frameTotals.ms = elapsed.count();
+		frameTotals.draws = text.getDrawCount();
+		addTextStats(frameTotals, atlas.getLastStats());
+		return true;
+	}
+
+	// Draws TextFrames frames of the lines, returns the totals after the warmup
+	TextTotals runVulkanTextFrames(icy::System::VulkanRenderer& renderer, icy::System::VulkanTextRenderer& text, const OffscreenTarget& target,
+		const std::vector<std::string>& lines, bool churn, bool& bFrames)
+	{
+		TextTotals totals = {};
+		for (int frame = 0; bFrames && frame < TextWarmupFrames + TextFrames; ++frame)
+		{
+			TextTotals frameTotals;
+			bFrames = recordTextFrame(renderer, text, target, lines, frame, churn, frameTotals);
+			if (bFrames && frame >= TextWarmupFrames)
+				addTextTotals(totals, frameTotals);
+		}
+		return totals;
+	}
+
+	int runVulkanText(uint32_t glyphCount, const char* fontPath)
+	{
+		using namespace icy::System;
+		std::shared_ptr<VulkanRenderer> renderer = VulkanRenderer::getShared();
+		if (!renderer)
+		{
+			std::cout << "No Vulkan device" << std::endl;
+			return 1;
+		}
+		VulkanTextRenderer text;
+		if (!text.create(renderer.get(), ShaderDirectory, fontPath))
+			return 1;
+		OffscreenTarget target;
+		if (!createOffscreenTarget(*renderer, target))
+		{
+			text.destroy();
+			return 1;
+		}
+		// Every glyph of a frame goes into the frame slot's part of the glyph buffer
+		if (glyphCount > VulkanTextRenderer::MaxGlyphs)
+			glyphCount = VulkanTextRenderer::MaxGlyphs;
+		const uint32_t lineGlyphs = TextLineLength - TextLineLength / 8;
+		const std::vector<std::string> lines = textLines((glyphCount + lineGlyphs - 1) / lineGlyphs);
+
+		// draw() skips the text until the compiler has built the pipeline, the timed frames start once it has
+		text.createDrawPipeline(OffscreenRenderPassId);
+		bool bFrames = true;
+		int pipelineFrames = 0;
+		TextTotals frameTotals = {};
+		while (bFrames && frameTotals.draws == 0 && pipelineFrames < TextPipelineFrames)
+		{
+			bFrames = recordTextFrame(*renderer, text, target, lines, pipelineFrames, false, frameTotals);
+			++pipelineFrames;
+		}
+		if (frameTotals.draws == 0)
+		{
+			std::cout << "The text pipeline wasn't built in " << pipelineFrames << " frames" << std::endl;
+			bFrames = false;
+		}
+
+		std::cout << "Vulkan on " << renderer->getDeviceInfo().properties.deviceName << ", " << lines.size() << " strings of "
+			<< TextLineLength << " characters per frame, " << fontPath << std::endl;
+		// One upload and one batch per frame, update() can't be recorded inside the render pass a draw per string would need
+		const TextTotals batched = runVulkanTextFrames(*renderer, text, target, lines, false, bFrames);
+		const TextTotals churn = runVulkanTextFrames(*renderer, text, target, lines, true, bFrames);
+		printTextTotals("batched       ", batched);
+		printTextTotals("size churn    ", churn);
+
+		text.destroy();
+		destroyOffscreenTarget(*renderer, target);
+		return bFrames && batched.dropped == 0 ? 0 : 1;
+	}
+
+	// Objects of TransformObjectSize nodes, each a ternary tree a few levels deep under its own root
+	const uint32_t TransformObjectSize = 100;
+	const int TransformRuns = 10;
+
+	// Random position, rotation and scale
+	void randomLocal(std::mt19937& random, float* position, float* rotation, float* scale)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		float length = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			rotation[i] = unit(random);
+			length += rotation[i] * rotation[i];
+		}
+		length = std::sqrt(length);
+		for (int i = 0; i < 4; ++i)
+			rotation[i] /= length;
+		for (int i = 0; i < 3; ++i)
+		{
+			position[i] = unit(random) * 10.0f;
+			scale[i] = 1.0f + 0.1f * unit(random);
+		}
+	}
+
+	std::vector<icy::System::TransformHierarchy::NodeHandle> buildTransformScene(icy::System::TransformHierarchy& hierarchy, uint32_t nodeCount, std::mt19937& random)
+	{
+		using icy::System::TransformHierarchy;
+		std::vector<TransformHierarchy::NodeHandle> nodes(nodeCount);
+		hierarchy.reserve(nodeCount);
+		for (uint32_t i = 0; i < nodeCount; ++i)
+		{
+			const uint32_t first = i - i % TransformObjectSize;
+			const uint32_t index = i - first;
+			nodes[i] = hierarchy.createNode(index == 0 ? TransformHierarchy::InvalidNode : nodes[first + (index - 1) / 3]);
+			float position[3];
+			float rotation[4];
+			float scale[3];
+			randomLocal(random, position, rotation, scale);
+			hierarchy.setLocal(nodes[i], position, rotation, scale);
+		}
+		return nodes;
+	}
+
+	// Best of a few runs in milliseconds, reset restores the unsorted input before each one and isn't timed
+	template <class Reset, class Sort>
+	double timeSort(int runs, Reset reset, Sort sort)
+	{
+		double best = 1e30;
+		for (int run = 0; run < runs; ++run)
+		{
+			reset();
+			auto start = std::chrono::steady_clock::now();
+			sort();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+}
+
+int runSortBenchmark(uint32_t drawCount)
+{
+	using icy::Renderer::RenderQueue;
+	const int Runs = 20;
+	const uint32_t Pipelines = 32;
+	const uint32_t MaterialsPerPipeline = 16;
+
+	// Scene traversal order: no relation between consecutive draws
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<uint32_t> pass(0, 1);
+	std::uniform_int_distribution<uint32_t> layer(0, 3);
+	std::uniform_int_distribution<uint32_t> pipeline(0, Pipelines - 1);
+	std::uniform_int_distribution<uint32_t> material(0, MaterialsPerPipeline - 1);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+	std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+	std::vector<uint64_t> keys(drawCount);
+	std::vector<uint32_t> values(drawCount);
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		uint32_t p = pipeline(random);
+		keys[i] = RenderQueue::makeKey(pass(random), layer(random), chance(random) < 0.1f, p, p * MaterialsPerPipeline + material(random), depth(random));
+		values[i] = i;
+	}
+
+	std::vector<uint64_t> sortedKeys(drawCount);
+	std::vector<uint32_t> sortedValues(drawCount);
+	std::vector<KeyValue> pairs(drawCount);
+	auto resetPairs = [&]()
+	{
+		for (uint32_t i = 0; i < drawCount; ++i)
+			pairs[i] = { keys[i], values[i] };
+	};
+	auto resetArrays = [&]()
+	{
+		std::copy(keys.begin(), keys.end(), sortedKeys.begin());
+		std::copy(values.begin(), values.end(), sortedValues.begin());
+	};
+
+	icy::System::RadixSorter sorter;
+	sorter.reserve(drawCount);
+	icy::System::ThreadPool pool;
+
+	double stdSort = timeSort(Runs, resetPairs, [&]() { std::stable_sort(pairs.begin(), pairs.end()); });
+	double radix = timeSort(Runs, resetArrays, [&]() { sorter.sort(sortedKeys.data(), sortedValues.data(), drawCount); });
+	double parallelRadix = timeSort(Runs, resetArrays, [&]() { sorter.sort(sortedKeys.data(), sortedValues.data(), drawCount, &pool); });
+
+	// Stable sorts of the same input have to agree exactly
+	bool matches = true;
+	for (uint32_t i = 0; i < drawCount; ++i)
+		matches = matches && pairs[i].key == sortedKeys[i] && pairs[i].value == sortedValues[i];
+
+	uint32_t pipelineChanges = 0;
+	uint32_t materialChanges = 0;
+	uint32_t sortedPipelineChanges = 0;
+	uint32_t sortedMaterialChanges = 0;
+	countStateChanges(keys.data(), drawCount, pipelineChanges, materialChanges);
+	countStateChanges(sortedKeys.data(), drawCount, sortedPipelineChanges, sortedMaterialChanges);
+
+	std::cout << drawCount << " draws, best of " << Runs << " runs" << std::endl;
+	std::cout << "std::stable_sort      " << stdSort << " ms" << std::endl;
+	std::cout << "radix, 1 thread       " << radix << " ms (" << sorter.getLastPassCount() << " passes)" << std::endl;
+	std::cout << "radix, " << pool.getThreadCount() + 1 << " threads      " << parallelRadix << " ms" << std::endl;
+	std::cout << "pipeline changes      " << pipelineChanges << " unsorted, " << sortedPipelineChanges << " sorted" << std::endl;
+	std::cout << "material changes      " << materialChanges << " unsorted, " << sortedMaterialChanges << " sorted" << std::endl;
+	if (!matches)
+		std::cout << "Radix sort order differs from std::stable_sort" << std::endl;
+	return matches ? 0 : 1;
+}
+
+int runParticleBenchmark(uint32_t capacity, bool vulkan)
+{
+	return vulkan ? runVulkanParticles(capacity) : runOpenGLParticles(capacity);
+}
+
+int runLightBenchmark(uint32_t lightCount, bool vulkan)
+{
+	return vulkan ? runVulkanLights(lightCount) : runOpenGLLights(lightCount);
+}
+
+int runCullBenchmark(uint32_t boxCount)
+{
+	return runOpenGLCulling(boxCount);
+}
+
+int runLodBenchmark(uint32_t sphereCount)
+{
+	if (!checkFlatLods())
+		return 1;
+	return runOpenGLLods(sphereCount);
+}
+
+int runTransformBenchmark(uint32_t nodeCount)
+{
+	using icy::System::TransformHierarchy;
+	std::mt19937 random(1234);
+	TransformHierarchy hierarchy;
+	std::vector<TransformHierarchy::NodeHandle> nodes = buildTransformScene(hierarchy, nodeCount, random);
+	icy::System::ThreadPool pool;
+
+	// The first update sorts the layout as well
+	auto start = std::chrono::steady_clock::now();
+	hierarchy.update(&pool);
+	std::chrono::duration<double, std::milli> firstMs = std::chrono::steady_clock::now() - start;
+	std::cout << nodeCount << " nodes in " << hierarchy.getLevelCount() << " levels, " << pool.getThreadCount() + 1 << " threads, best of "
+		<< TransformRuns << " runs" << std::endl;
+	std::cout << "first update          " << firstMs.count() << " ms, sorting included" << std::endl;
+	const double allSerial = timeSort(TransformRuns, []() {}, [&]() { hierarchy.updateAll(); });
+	const double allParallel = timeSort(TransformRuns, []() {}, [&]() { hierarchy.updateAll(&pool); });
+	std::cout << "every matrix          " << allSerial << " ms on 1 thread, " << allParallel << " ms on the pool" << std::endl;
+
+	// Each rate sets the same nodes before every run, the setting isn't timed
+	bool matches = true;
+	const uint32_t rates[] = { 1, 100 };
+	for (uint32_t rate : rates)
+	{
+		std::vector<TransformHierarchy::NodeHandle> dirty;
+		for (uint32_t i = 0; i < nodeCount; ++i)
+		{
+			if (random() % 100 < rate)
+				dirty.push_back(nodes[i]);
+		}
+		std::vector<float> locals(dirty.size() * 10);
+		for (size_t i = 0; i < dirty.size(); ++i)
+			randomLocal(random, &locals[i * 10], &locals[i * 10 + 3], &locals[i * 10 + 7]);
+		auto setDirty = [&]()
+		{
+			for (size_t i = 0; i < dirty.size(); ++i)
+				hierarchy.setLocal(dirty[i], &locals[i * 10], &locals[i * 10 + 3], &locals[i * 10 + 7]);
+		};
+		const double serial = timeSort(TransformRuns, setDirty, [&]() { hierarchy.update(); });
+		const double parallel = timeSort(TransformRuns, setDirty, [&]() { hierarchy.update(&pool); });
+		std::cout << rate << "% dirty" << (rate < 10 ? "              " : "            ") << serial << " ms on 1 thread, " << parallel << " ms on the pool, "
+			<< dirty.size() << " nodes set, " << hierarchy.getLastUpdatedCount() << " matrices recomputed" << std::endl;
+
+		// Only recomputing changed subtrees has to land on the same matrices as recomputing everything
+		setDirty();
+		hierarchy.update(&pool);
+		std::vector<float> updated(nodeCount * 16);
+		for (uint32_t i = 0; i < nodeCount; ++i)
+			std::memcpy(&updated[i * 16], hierarchy.getWorld(nodes[i]), 16 * sizeof(float));
+		hierarchy.updateAll(&pool);
+		for (uint32_t i = 0; i < nodeCount; ++i)
+			matches = matches && std::memcmp(&updated[i * 16], hierarchy.getWorld(nodes[i]), 16 * sizeof(float)) == 0;
+	}
+	if (!matches)
+		std::cout << "Dirty updates differ from recomputing every matrix" << std::endl;
+	return matches ? 0 : 1;
+}
+
+int runSceneBenchmark(uint32_t boxCount)
+{
+	return runOpenGLScene(boxCount);
+}
+
+int runTextBenchmark(uint32_t glyphCount, const char* fontPath, bool vulkan)
+{
+	return vulkan ? runVulkanText(glyphCount, fontPath) : runOpenGLText(glyphCount, fontPath);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+// Command line benchmarks, each prints its results and returns the process exit code
+
+// Sorts drawCount random draw keys with std::stable_sort, the radix sort on one thread and on a thread pool,
+// and counts the pipeline and material changes a backend would make in submission order and in sorted order
+int runSortBenchmark(uint32_t drawCount);
+
+// Runs a GPU particle system holding up to capacity particles until it is full, then times whole steps (emit, simulate,
+// compact, sort, draw arguments) from submission to completion and reports particles updated per millisecond
+// vulkan : VulkanParticleSystem on the device VulkanDeviceSelector picks, otherwise OpenGLParticleSystem in a hidden window
+// Vulkan runs the renderer's frames without a window instead, each step on the async compute queue and drawn into an
+// offscreen target once it finished, and times whole frames and how much of the compute overlapped the graphics work
+// Vulkan then draws every draw variant into the target and reports the variants built and their compile times
+// Software rasterisers are picked the usual way, ICY_GPU=llvmpipe for lavapipe and LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe
+int runParticleBenchmark(uint32_t capacity, bool vulkan);
+
+// Bins lightCount point and spot lights into the cluster grid on the GPU and with the CPU reference, checks both grids
+// list the same lights per cluster and reports lights per cluster and build times
+// The OpenGL run also shades a floor with the clustered lights and with every light, and compares the two images
+// The Vulkan run bins on the async compute queue every frame and reports how much of it overlapped the graphics work
+int runLightBenchmark(uint32_t lightCount, bool vulkan);
+
+// Draws boxCount boxes, most of them behind a wall, while the camera strafes past the wall's end, with Hi-Z occlusion
+// culling and without, reports the occluded ratio every few frames and the frame times, and checks the last frames match
+// OpenGL only, OpenGLIndirectRenderer is the only renderer that culls
+int runCullBenchmark(uint32_t boxCount);
+
+// Builds a LOD chain for a sphere with MeshSimplifier and draws sphereCount of them while the camera walks into the field,
+// with the culler picking LODs and at full detail, and reports the chain, the triangles drawn and the frame times
+// A camera jittering in place counts LOD switches with and without hysteresis
+// Fails first when the chain of a bumpy flat grid gets further from it than its bumps are high
+// OpenGL only, the LOD selection runs in OpenGLOcclusionCuller's first phase
+int runLodBenchmark(uint32_t sphereCount);
+
+// Builds a TransformHierarchy of nodeCount nodes, objects of a hundred nodes a few levels deep, and times recomputing
+// every world matrix against dirty updates with 1% and 100% of the nodes set, on one thread and on a thread pool
+// Checks the dirty updates end on the same matrices as recomputing everything
+int runTransformBenchmark(uint32_t nodeCount);
+
+// Draws boxCount boxes with 1%, 10% and 100% of them moving every frame, once from draw data streamed every frame and
+// once from OpenGLSceneBuffer instances that only upload the moved ones, and reports the bytes each uploads per frame
+// Checks both draw the same pixels, also with the scene draws going through the occlusion culler
+// OpenGL only, OpenGLIndirectRenderer is the only renderer drawing from the scene buffer
+int runSceneBenchmark(uint32_t boxCount);
+
+// Draws glyphCount glyphs of HUD lines per frame with OpenGLTextRenderer, batched into one draw per atlas page and with a
+// draw after every string, then with sizes changing every frame so the atlas keeps rasterizing and evicting pages
+// Reports layout and frame times, draws, shaping cache hits and atlas traffic, and checks both draw the same pixels
+// vulkan : VulkanTextRenderer into an offscreen target through the renderer's frames instead, batched and with size churn
+// only, its uploads are recorded outside the render pass so it draws once per frame
+int runTextBenchmark(uint32_t glyphCount, const char* fontPath, bool vulkan);
\ No newline at end of file
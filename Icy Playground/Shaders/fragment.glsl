@@ -3,6 +3,9 @@
 
 layout(location = 0) out vec4 outColor;
 
+// Feature toggles are specialization constants, one SPIR-V module covers every combination
+layout(constant_id = 0) const bool ICY_DEBUG_COLOR = false;
+
 void main() {
-    outColor = vec4(1.0, 0.0, 0.0, 1.0);
+    outColor = ICY_DEBUG_COLOR ? vec4(1.0, 0.0, 1.0, 1.0) : vec4(1.0, 0.0, 0.0, 1.0);
 }
\ No newline at end of file
@@ -1,25 +1,501 @@
+#include "Benchmarks.hpp"
+#include <Engine\Window\OpenGLWindow.hpp>
 #include <Engine\Window\VulkanWindow.hpp>
+#include <Engine\Input\EventPump.hpp>
+#include <Engine\Renderer\OpenGLRenderBackend.hpp>
+#include <Engine\Renderer\RenderCommandList.hpp>
+#include <Engine\Renderer\RenderQueue.hpp>
+#include <Engine\Renderer\RenderThread.hpp>
+#include <Engine\System\AllocationTracker.hpp>
+#include <Engine\System\Application.hpp>
+#include <Engine\System\Profiler.hpp>
+#include <Engine\System\TransformHierarchy.hpp>
 #include <glad\glad.h>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
 
-int main()
+// Count argument of a benchmark, argv[index] when there is one and fallback otherwise
+// Returns false and says so for anything that isn't a number above zero
+bool parseCount(int argc, char* argv[], int index, uint32_t fallback, uint32_t& count)
 {
-	icy::Window::VulkanWindow window;
-	if (window.createWindow("Hello Triangle", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 500, 500, SDL_WINDOW_VULKAN | SDL_WINDOW_SHOWN))
+	if (index >= argc)
 	{
-		while (window.isOpen())
+		count = fallback;
+		return true;
+	}
+	char* end = nullptr;
+	const long value = std::strtol(argv[index], &end, 10);
+	if (end == argv[index] || *end != '\0' || value <= 0 || static_cast<unsigned long>(value) > UINT32_MAX)
+	{
+		std::cout << argv[1] << " needs a count above zero, got " << argv[index] << std::endl;
+		return false;
+	}
+	count = static_cast<uint32_t>(value);
+	return true;
+}
+
+// Backend argument of a benchmark, argv[index] has to be gl or vulkan
+// Returns false and prints usage for anything else
+bool parseBackend(char* argv[], int index, const char* usage, bool& vulkan)
+{
+	vulkan = std::strcmp(argv[index], "vulkan") == 0;
+	if (vulkan || std::strcmp(argv[index], "gl") == 0)
+		return true;
+	std::cout << "Unknown backend " << argv[index] << ", usage: " << argv[1] << " " << usage << std::endl;
+	return false;
+}
+
+// Material of the render thread benchmark, the scene's 32 x 32 grid of nodes seen from above
+const char* TestVertexSource =
+	"#version 450\n"
+	"layout(location = 0) in vec3 a_Position;\n"
+	"layout(location = 1) in vec3 a_Normal;\n"
+	"layout(location = 0) out vec3 v_Normal;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 world = icy_Draws[ICY_DRAW_ID].model * vec4(a_Position, 1.0);\n"
+	"	v_Normal = a_Normal;\n"
+	"	gl_Position = vec4((world.x - 15.5) / 17.0, (world.z + 15.5) / 17.0, 0.5 - world.y / 8.0, 1.0);\n"
+	"}\n";
+const char* TestFragmentSource =
+	"#version 450\n"
+	"layout(location = 0) in vec3 v_Normal;\n"
+	"layout(location = 0) out vec4 o_Color;\n"
+	"void main()\n"
+	"{\n"
+	"	o_Color = vec4(0.5 + 0.5 * normalize(v_Normal), 1.0);\n"
+	"}\n";
+
+class Playground : public icy::System::Application
+{
+public:
+	// Frames the allocation test runs before it starts counting
+	static constexpr int WarmupFrames = 60;
+	// Scene the allocation test records every frame, and the nodes of it that move each frame
+	static constexpr uint32_t TestNodes = 1024;
+	static constexpr uint32_t TestMovers = 32;
+	// Material ids in the scene's draw keys, the render thread benchmark spreads them over GLTestMaterials programs
+	static constexpr uint32_t TestMaterials = 64;
+	static constexpr uint32_t GLTestMaterials = 4;
+
+	Playground()
+		: m_TestCommands(128 * 1024), m_TestQueue(TestNodes), m_RenderThread(128 * 1024)
+	{
+		m_TestFrames = 0;
+		m_TestMesh = 0;
+		m_TestTexture = 0;
+		for (uint32_t i = 0; i < TestMaterials; ++i)
+			m_TestMaterials[i] = i;
+		m_bThreadBenchmark = false;
+		m_FrameMs = 0.0;
+		m_GameWaitMs = 0.0;
+		m_Frame = 0;
+		m_AllocatingFrames = 0;
+		m_WorstFrame = 0;
+		m_WorstAllocations = 0;
+		m_bTestPassed = true;
+	}
+
+	bool create()
+	{
+		if (!m_Window.createWindow("Hello Triangle", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 500, 500, SDL_WINDOW_SHOWN))
+			return false;
+		m_Events.addHandler(SDL_KEYDOWN, onKeyDown, this);
+		m_Events.addHandler(SDL_QUIT, onQuit, this);
+		m_Window.getBackend().getSwapchain().setClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+		setFrameCap(60.0);
+		return true;
+	}
+
+	// Where the GPU time of the last frame went, per queue
+	void reportQueues()
+	{
+		m_Window.getBackend().getRenderer().getQueueScheduler().report(std::cout);
+	}
+
+	// Runs the frame loop without a window, recording a scene's transforms, draw keys and commands every frame
+	// Any frame that allocates after the warm-up fails the test
+	bool runAllocationTest(int frames)
+	{
+		m_TestFrames = frames;
+		createTestScene();
+		run();
+		return m_bTestPassed;
+	}
+
+	// Runs the same scene in a hidden OpenGL window for frames frames after a warm-up, twice
+	// First every frame's commands are executed on this thread right after they are recorded, then they go to the render
+	// thread, which executes frame N - 1 while this thread records frame N, and the frame times of both are reported
+	bool runThreadBenchmark(int frames)
+	{
+		if (!m_GLWindow.createWindow("Render thread benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 500, 500, SDL_WINDOW_HIDDEN))
+		{
+			std::cout << "No OpenGL 4.5 context" << std::endl;
+			return false;
+		}
+		// Frame times, not the display's refresh rate
+		SDL_GL_SetSwapInterval(0);
+		icy::Window::OpenGLBackend& backend = m_GLWindow.getBackend();
+		icy::System::OpenGLIndirectRenderer& renderer = backend.getRenderer();
+		m_TestMesh = addTestMesh(renderer);
+		const int textureSize = icy::System::OpenGLIndirectRenderer::ArrayTextureSize;
+		const std::vector<uint8_t> white(textureSize * textureSize * 4, 255);
+		m_TestTexture = renderer.addTexture(white.data(), textureSize, textureSize);
+		icy::System::OpenGLIndirectRenderer::MaterialHandle materials[GLTestMaterials];
+		for (uint32_t i = 0; i < GLTestMaterials; ++i)
 		{
-			SDL_Event ev;
-			while (window.pollEvents(&ev))
+			materials[i] = renderer.createMaterial(TestVertexSource, TestFragmentSource);
+			if (materials[i] == icy::System::OpenGLIndirectRenderer::InvalidHandle)
+				return false;
+		}
+		for (uint32_t i = 0; i < TestMaterials; ++i)
+			m_TestMaterials[i] = materials[i % GLTestMaterials];
+		if (m_TestMesh == icy::System::OpenGLIndirectRenderer::InvalidHandle || m_TestTexture == icy::System::OpenGLIndirectRenderer::InvalidHandle)
+			return false;
+		createTestScene();
+		m_GLRenderer.reset(new icy::Renderer::OpenGLRenderBackend(m_GLWindow.getSDLWindow(), backend));
+		m_TestFrames = frames;
+		m_bThreadBenchmark = true;
+		setFrameCap(0.0);
+		setDumpStatsOnExit(false);
+
+		m_Frame = 0;
+		run();
+		const double singleMs = m_FrameMs;
+		if (!m_RenderThread.start(m_GLRenderer.get()))
+			return false;
+		m_Frame = 0;
+		run();
+		m_RenderThread.stop();
+
+		std::cout << m_TestFrames << " frames of " << TestNodes << " draws after " << WarmupFrames << " frames of warm-up" << std::endl;
+		std::cout << "one thread            " << singleMs << " ms per frame" << std::endl;
+		std::cout << "render thread         " << m_FrameMs << " ms per frame, the game thread waited " << m_GameWaitMs / m_TestFrames << " ms of it" << std::endl;
+		return true;
+	}
+
+protected:
+	virtual void processInput()
+	{
+		if (m_TestFrames > 0)
+			return;
+		m_Events.pump();
+		if (!m_Window.isOpen())
+			quit();
+	}
+	virtual void update(double dt) {}
+	virtual void render(double alpha)
+	{
+		++m_Frame;
+		if (m_bThreadBenchmark)
+		{
+			renderThreadTestFrame();
+			return;
+		}
+		if (m_TestFrames == 0)
+		{
+			// Every Vulkan window shares this renderer and goes out in the same submit
+			icy::System::VulkanRenderer& renderer = m_Window.getBackend().getRenderer();
+			if (renderer.beginFrame())
+				renderer.endFrame();
+			return;
+		}
+		icy::System::AllocationScope frame;
+		recordTestFrame(m_TestCommands);
+		const uint64_t allocations = frame.getAllocations();
+		if (m_Frame <= WarmupFrames)
+		{
+			if (m_Frame == WarmupFrames)
+				m_WarmCounts = icy::System::AllocationTracker::getGlobalCounts();
+			return;
+		}
+		if (allocations > 0)
+		{
+			++m_AllocatingFrames;
+			if (allocations > m_WorstAllocations)
+			{
+				m_WorstAllocations = allocations;
+				m_WorstFrame = m_Frame - WarmupFrames;
+			}
+		}
+		if (m_Frame == WarmupFrames + m_TestFrames)
+		{
+			// The per frame counts only see this thread, the totals also catch anything the engine's threads allocated
+			icy::System::AllocationCounts counts = icy::System::AllocationTracker::getGlobalCounts();
+			const uint64_t total = counts.allocations - m_WarmCounts.allocations;
+			m_bTestPassed = m_AllocatingFrames == 0 && total == 0;
+			std::cout << total << " allocations (" << counts.bytes - m_WarmCounts.bytes << " bytes) in " << m_TestFrames << " frames after warm-up" << std::endl;
+			std::cout << m_AllocatingFrames << " frames allocated";
+			if (m_AllocatingFrames > 0)
+				std::cout << ", worst was frame " << m_WorstFrame << " with " << m_WorstAllocations;
+			std::cout << ", " << m_TestCommands.getCount() << " commands per frame" << std::endl;
+			quit();
+		}
+	}
+
+private:
+	// Unit cube with a normal per corner
+	static icy::System::OpenGLIndirectRenderer::MeshHandle addTestMesh(icy::System::OpenGLIndirectRenderer& renderer)
+	{
+		icy::System::OpenGLIndirectRenderer::Vertex vertices[8];
+		for (int i = 0; i < 8; ++i)
+		{
+			vertices[i] = {};
+			for (int axis = 0; axis < 3; ++axis)
 			{
-				if (ev.type == SDL_KEYDOWN)
-				{
-					if (ev.key.keysym.sym == SDLK_ESCAPE)
-					{
-						window.close();
-					}
-				}
+				vertices[i].position[axis] = (i >> axis) & 1 ? 0.5f : -0.5f;
+				vertices[i].normal[axis] = vertices[i].position[axis] * 2.0f;
 			}
 		}
-		window.close();
+		const uint32_t indices[36] = {
+			0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+			2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+		return renderer.addMesh(vertices, 8, indices, 36);
+	}
+
+	void createTestScene()
+	{
+		m_TestTransforms.reserve(TestNodes);
+		for (uint32_t i = 0; i < TestNodes; ++i)
+			m_TestNodes[i] = m_TestTransforms.createNode(i == 0 ? icy::System::TransformHierarchy::InvalidNode : m_TestNodes[(i - 1) / 4]);
+	}
+
+	// One frame of the render thread benchmark, times the frames after the warm-up
+	void renderThreadTestFrame()
+	{
+		if (m_Frame == WarmupFrames + 1)
+		{
+			m_TimingStart = std::chrono::steady_clock::now();
+			m_GameWaitMs = 0.0;
+		}
+		if (m_RenderThread.isRunning())
+		{
+			// Waits only if the render thread is still on the frame before last
+			recordTestFrame(m_RenderThread.beginFrame());
+			m_GameWaitMs += m_RenderThread.getGameWaitMs();
+			m_RenderThread.endFrame();
+		}
+		else
+		{
+			recordTestFrame(m_TestCommands);
+			m_GLRenderer->execute(m_TestCommands);
+		}
+		if (m_Frame == WarmupFrames + m_TestFrames)
+		{
+			m_FrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_TimingStart).count() / m_TestFrames;
+			quit();
+		}
+	}
+
+	// What the render loop does on the CPU every frame, without a window to present to
+	void recordTestFrame(icy::Renderer::RenderCommandList& commands)
+	{
+		ICY_PROFILE_ZONE("Record test frame");
+		const float time = static_cast<float>(m_Frame) / 60.0f;
+		const float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		const float scale[3] = { 1.0f, 1.0f, 1.0f };
+		for (uint32_t i = 0; i < TestMovers; ++i)
+		{
+			const uint32_t node = (static_cast<uint32_t>(m_Frame) * TestMovers + i) % TestNodes;
+			const float position[3] = { static_cast<float>(node % 32), std::sin(time + node), -static_cast<float>(node / 32) };
+			m_TestTransforms.setLocal(m_TestNodes[node], position, rotation, scale);
+		}
+		m_TestTransforms.update();
+
+		m_TestQueue.clear();
+		for (uint32_t i = 0; i < TestNodes; ++i)
+		{
+			const float depth = -m_TestTransforms.getWorld(m_TestNodes[i])[14] / 256.0f;
+			m_TestQueue.push(icy::Renderer::RenderQueue::makeKey(0, 0, i % 8 == 0, i % 4, m_TestMaterials[i % TestMaterials], depth), i);
+		}
+		m_TestQueue.sort();
+
+		commands.clear();
+		icy::Renderer::SetViewportCommand* viewport = commands.push<icy::Renderer::SetViewportCommand>();
+		*viewport = { 0, 0, 500, 500 };
+		icy::Renderer::ClearCommand* clear = commands.push<icy::Renderer::ClearCommand>();
+		*clear = { { 0.1f, 0.2f, 0.3f, 1.0f }, 1.0f, icy::Renderer::ClearCommand::Color | icy::Renderer::ClearCommand::Depth };
+		for (uint32_t i = 0; i < m_TestQueue.getCount(); ++i)
+		{
+			const uint32_t node = m_TestQueue.getValue(i);
+			icy::Renderer::DrawMeshCommand* draw = commands.push<icy::Renderer::DrawMeshCommand>();
+			if (draw == nullptr)
+				break;
+			draw->mesh = m_TestMesh;
+			draw->material = icy::Renderer::RenderQueue::getMaterial(m_TestQueue.getKey(i));
+			draw->texture = m_TestTexture;
+			std::memcpy(draw->model, m_TestTransforms.getWorld(m_TestNodes[node]), sizeof(draw->model));
+			draw->sortKey = m_TestQueue.getKey(i);
+		}
+		commands.push<icy::Renderer::PresentCommand>();
+	}
+
+	static void onKeyDown(const SDL_Event& ev, void* userData)
+	{
+		if (ev.key.keysym.sym == SDLK_ESCAPE)
+		{
+			static_cast<Playground*>(userData)->m_Window.close();
+		}
+	}
+	static void onQuit(const SDL_Event& ev, void* userData)
+	{
+		static_cast<Playground*>(userData)->m_Window.close();
+	}
+
+private:
+	// The playground only targets Vulkan, so it takes the statically dispatched window
+	icy::Window::StaticVulkanWindow m_Window;
+	icy::Input::EventPump m_Events;
+	icy::System::TransformHierarchy m_TestTransforms;
+	icy::System::TransformHierarchy::NodeHandle m_TestNodes[TestNodes];
+	icy::Renderer::RenderCommandList m_TestCommands;
+	icy::Renderer::RenderQueue m_TestQueue;
+	int m_TestFrames;
+	icy::System::OpenGLIndirectRenderer::MeshHandle m_TestMesh;
+	icy::System::OpenGLIndirectRenderer::TextureHandle m_TestTexture;
+	uint32_t m_TestMaterials[TestMaterials];
+	// Render thread benchmark only
+	icy::Window::StaticOpenGLWindow m_GLWindow;
+	std::unique_ptr<icy::Renderer::OpenGLRenderBackend> m_GLRenderer;
+	icy::Renderer::RenderThread m_RenderThread;
+	bool m_bThreadBenchmark;
+	std::chrono::steady_clock::time_point m_TimingStart;
+	double m_FrameMs;
+	double m_GameWaitMs;
+	int m_Frame;
+	icy::System::AllocationCounts m_WarmCounts;
+	uint64_t m_AllocatingFrames;
+	int m_WorstFrame;
+	uint64_t m_WorstAllocations;
+	bool m_bTestPassed;
+};
+
+int main(int argc, char* argv[])
+{
+	// --alloc-test N : run N frames headless and fail if the loop allocates once warmed up
+	if (argc == 3 && std::strcmp(argv[1], "--alloc-test") == 0)
+	{
+		if (!icy::System::AllocationTracker::isEnabled())
+		{
+			std::cout << "Build the engine with ICY_TRACK_ALLOCATIONS to run the allocation test" << std::endl;
+			return 1;
+		}
+		uint32_t frames = 0;
+		if (!parseCount(argc, argv, 2, 0, frames))
+			return 1;
+		if (frames > INT_MAX)
+		{
+			std::cout << "--alloc-test runs at most " << INT_MAX << " frames" << std::endl;
+			return 1;
+		}
+		Playground playground;
+		return playground.runAllocationTest(static_cast<int>(frames)) ? 0 : 1;
+	}
+
+	// --thread-bench [N] : frame times of the playground loop with commands executed inline and on the render thread, 600 frames by default
+	if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--thread-bench") == 0)
+	{
+		uint32_t frames = 0;
+		if (!parseCount(argc, argv, 2, 600, frames))
+			return 1;
+		if (frames > INT_MAX)
+		{
+			std::cout << "--thread-bench runs at most " << INT_MAX << " frames" << std::endl;
+			return 1;
+		}
+		Playground playground;
+		return playground.runThreadBenchmark(static_cast<int>(frames)) ? 0 : 1;
+	}
+
+	// --sort-bench [N] : time the draw key sort and count the state changes it saves, 100k draws by default
+	if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--sort-bench") == 0)
+	{
+		uint32_t count = 0;
+		if (!parseCount(argc, argv, 2, 100000, count))
+			return 1;
+		return runSortBenchmark(count);
+	}
+
+	// --particle-bench gl|vulkan [N] : particles updated per millisecond with up to N live particles, 64k by default
+	if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "--particle-bench") == 0)
+	{
+		uint32_t count = 0;
+		bool vulkan = false;
+		if (!parseBackend(argv, 2, "gl|vulkan [N]", vulkan) || !parseCount(argc, argv, 3, 1 << 16, count))
+			return 1;
+		return runParticleBenchmark(count, vulkan);
+	}
+
+	// --light-bench gl|vulkan [N] : clustered lighting with N lights against the CPU reference and plain forward shading, 512 by default
+	if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "--light-bench") == 0)
+	{
+		uint32_t count = 0;
+		bool vulkan = false;
+		if (!parseBackend(argv, 2, "gl|vulkan [N]", vulkan) || !parseCount(argc, argv, 3, 512, count))
+			return 1;
+		return runLightBenchmark(count, vulkan);
+	}
+
+	// --cull-bench [N] : Hi-Z occlusion culling of N boxes behind a wall against drawing all of them, 4096 by default
+	if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--cull-bench") == 0)
+	{
+		uint32_t count = 0;
+		if (!parseCount(argc, argv, 2, 4096, count))
+			return 1;
+		return runCullBenchmark(count);
+	}
+
+	// --lod-bench [N] : N spheres drawn with screen error driven LODs against full detail, 2048 by default
+	if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--lod-bench") == 0)
+	{
+		uint32_t count = 0;
+		if (!parseCount(argc, argv, 2, 2048, count))
+			return 1;
+		return runLodBenchmark(count);
+	}
+
+	// --transform-bench [N] : world matrix updates of a hierarchy of N nodes at 1% and 100% dirty, 1M by default
+	if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--transform-bench") == 0)
+	{
+		uint32_t count = 0;
+		if (!parseCount(argc, argv, 2, 1000000, count))
+			return 1;
+		return runTransformBenchmark(count);
+	}
+
+	// --scene-bench [N] : bytes uploaded per frame by the scene buffer's deltas against streaming every draw, 8192 boxes by default
+	if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--scene-bench") == 0)
+	{
+		uint32_t count = 0;
+		if (!parseCount(argc, argv, 2, 8192, count))
+			return 1;
+		return runSceneBenchmark(count);
+	}
+
+	// --text-bench gl|vulkan [N] [font] : N glyphs drawn per frame by the text renderer, 100000 and Consolas by default
+	if (argc >= 3 && argc <= 5 && std::strcmp(argv[1], "--text-bench") == 0)
+	{
+		uint32_t count = 0;
+		bool vulkan = false;
+		if (!parseBackend(argv, 2, "gl|vulkan [N] [font]", vulkan) || !parseCount(argc, argv, 3, 100000, count))
+			return 1;
+		return runTextBenchmark(count, argc == 5 ? argv[4] : "C:/Windows/Fonts/consola.ttf", vulkan);
+	}
+
+	ICY_PROFILE_BEGIN_SESSION();
+	ICY_PROFILE_THREAD("Main");
+	Playground playground;
+	if (playground.create())
+	{
+		playground.run();
+		playground.reportQueues();
 	}
+	ICY_PROFILE_END_SESSION("icy_trace.json");
+	return 0;
 }
\ No newline at end of file
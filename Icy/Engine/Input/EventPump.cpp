@@ -0,0 +1,115 @@
+#include "EventPump.hpp"
+#include <SDL\SDL.h>
+
+icy::Input::EventPump::EventPump()
+{
+	m_Head = 0;
+	m_Count = 0;
+	m_HandlerCount = 0;
+}
+
+bool icy::Input::EventPump::addHandler(Uint32 type, EventHandler handler, void* userData)
+{
+	if (m_HandlerCount == MaxHandlers)
+		return false;
+	m_Handlers[m_HandlerCount++] = { type, handler, userData };
+	return true;
+}
+
+void icy::Input::EventPump::removeHandler(Uint32 type, EventHandler handler, void* userData)
+{
+	for (int i = 0; i < m_HandlerCount; ++i)
+	{
+		if (m_Handlers[i].type == type && m_Handlers[i].function == handler && m_Handlers[i].userData == userData)
+		{
+			// Keep registration order, handlers run in the order they were added
+			for (int j = i + 1; j < m_HandlerCount; ++j)
+				m_Handlers[j - 1] = m_Handlers[j];
+			--m_HandlerCount;
+			return;
+		}
+	}
+}
+
+int icy::Input::EventPump::pump()
+{
+	SDL_PumpEvents();
+	return dispatchAll();
+}
+
+int icy::Input::EventPump::wait(int timeoutMs)
+{
+	// SDL_WaitEventTimeout removes the event it woke up for, so it goes out first
+	SDL_Event first;
+	int woke = timeoutMs == WaitForever ? SDL_WaitEvent(&first) : SDL_WaitEventTimeout(&first, timeoutMs);
+	if (woke == 0)
+		return 0;
+	dispatch(first);
+	return 1 + pump();
+}
+
+bool icy::Input::EventPump::poll(SDL_Event& event)
+{
+	if (m_Count == 0)
+	{
+		SDL_PumpEvents();
+		if (fill() == 0)
+			return false;
+	}
+	event = m_Ring[m_Head];
+	m_Head = (m_Head + 1) % Capacity;
+	--m_Count;
+	return true;
+}
+
+int icy::Input::EventPump::fill()
+{
+	int added = 0;
+	while (m_Count < Capacity)
+	{
+		// SDL_PeepEvents wants contiguous memory, so fill up to the end of the ring then wrap
+		int tail = (m_Head + m_Count) % Capacity;
+		int space = tail >= m_Head ? Capacity - tail : m_Head - tail;
+		if (space > Capacity - m_Count)
+			space = Capacity - m_Count;
+		int got = SDL_PeepEvents(&m_Ring[tail], space, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+		if (got <= 0)
+			break;
+		m_Count += got;
+		added += got;
+		if (got < space)
+			break;
+	}
+	return added;
+}
+
+int icy::Input::EventPump::dispatchAll()
+{
+	int dispatched = 0;
+	for (;;)
+	{
+		// Whatever poll() left in the ring goes first to keep the order
+		if (m_Count == 0 && fill() == 0)
+			break;
+		while (m_Count > 0)
+		{
+			// A copy, a handler that polls or fills can reuse the slot while it still reads the event
+			const SDL_Event event = m_Ring[m_Head];
+			m_Head = (m_Head + 1) % Capacity;
+			--m_Count;
+			dispatch(event);
+			++dispatched;
+		}
+	}
+	return dispatched;
+}
+
+void icy::Input::EventPump::dispatch(const SDL_Event& event)
+{
+	for (int i = 0; i < m_HandlerCount; ++i)
+	{
+		const Handler& handler = m_Handlers[i];
+		if (handler.type == event.type || handler.type == AnyEvent)
+			handler.function(event, handler.userData);
+	}
+}
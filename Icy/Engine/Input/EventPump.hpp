@@ -0,0 +1,56 @@
+#pragma once
+#include <SDL\SDL_events.h>
+
+namespace icy
+{
+	namespace Input
+	{
+		// Drains the SDL event queue in bulk into a fixed ring and dispatches each event to the handlers registered for its type
+		// One SDL_PumpEvents and a few SDL_PeepEvents per frame replace one SDL_PollEvent (and one pump) per event
+		class EventPump
+		{
+		public:
+			typedef void (*EventHandler)(const SDL_Event& event, void* userData);
+			static constexpr int Capacity = 256;
+			static constexpr int MaxHandlers = 32;
+			// Handlers registered for this type receive every event
+			static constexpr Uint32 AnyEvent = SDL_FIRSTEVENT;
+			static constexpr int WaitForever = -1;
+
+			EventPump();
+
+			// type : SDL_EventType to listen for, or AnyEvent
+			bool addHandler(Uint32 type, EventHandler handler, void* userData);
+			void removeHandler(Uint32 type, EventHandler handler, void* userData);
+
+			// Pumps the OS once, drains everything that is queued and dispatches it, returns the number of events
+			int pump();
+			// Sleeps until an event arrives or timeoutMs passes, then behaves like pump()
+			// Use this in tools that only need to redraw on input so they cost nothing while idle
+			int wait(int timeoutMs);
+
+			// Polling style access to the same ring, refilled in bulk when it runs dry
+			// Events read this way are not dispatched to handlers
+			bool poll(SDL_Event& event);
+
+		private:
+			struct Handler
+			{
+				Uint32 type;
+				EventHandler function;
+				void* userData;
+			};
+			// Copies as many queued SDL events as fit into the ring, returns how many
+			int fill();
+			int dispatchAll();
+			void dispatch(const SDL_Event& event);
+
+		private:
+			SDL_Event m_Ring[Capacity];
+			int m_Head;
+			int m_Count;
+			Handler m_Handlers[MaxHandlers];
+			int m_HandlerCount;
+		};
+	}
+}
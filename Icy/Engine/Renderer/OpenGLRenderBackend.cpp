@@ -0,0 +1,69 @@
+#include "OpenGLRenderBackend.hpp"
+#include "RenderQueue.hpp"
+#include <SDL\SDL.h>
+
+icy::Renderer::OpenGLRenderBackend::OpenGLRenderBackend(SDL_Window* window, icy::Window::OpenGLBackend& backend)
+	: m_Backend(backend)
+{
+	m_Window = window;
+}
+
+bool icy::Renderer::OpenGLRenderBackend::attachThread()
+{
+	return SDL_GL_MakeCurrent(m_Window, m_Backend.getContext()) == 0;
+}
+
+void icy::Renderer::OpenGLRenderBackend::detachThread()
+{
+	SDL_GL_MakeCurrent(m_Window, nullptr);
+}
+
+void icy::Renderer::OpenGLRenderBackend::execute(const RenderCommandList& commands)
+{
+	icy::System::OpenGLStateCache& state = m_Backend.getStateCache();
+	icy::System::OpenGLIndirectRenderer& renderer = m_Backend.getRenderer();
+
+	for (const RenderCommandHeader* command = commands.first(); command != nullptr; command = commands.next(command))
+	{
+		switch (command->type)
+		{
+		case RenderCommandType::SetViewport:
+		{
+			const auto& viewport = RenderCommandList::get<SetViewportCommand>(command);
+			state.viewport(viewport.x, viewport.y, viewport.width, viewport.height);
+			break;
+		}
+		case RenderCommandType::Clear:
+		{
+			const auto& clear = RenderCommandList::get<ClearCommand>(command);
+			GLbitfield mask = 0;
+			if (clear.flags & ClearCommand::Color)
+			{
+				glClearColor(clear.color[0], clear.color[1], clear.color[2], clear.color[3]);
+				state.colorMask(true, true, true, true);
+				mask |= GL_COLOR_BUFFER_BIT;
+			}
+			if (clear.flags & ClearCommand::Depth)
+			{
+				glClearDepth(clear.depth);
+				// glClear respects the depth mask
+				state.depthMask(true);
+				mask |= GL_DEPTH_BUFFER_BIT;
+			}
+			glClear(mask);
+			break;
+		}
+		case RenderCommandType::DrawMesh:
+		{
+			const auto& draw = RenderCommandList::get<DrawMeshCommand>(command);
+			uint64_t key = draw.sortKey != 0 ? draw.sortKey : RenderQueue::makeKey(0, 0, false, 0, draw.material, 0.0f);
+			renderer.submit(draw.mesh, draw.material, draw.texture, draw.model, key);
+			break;
+		}
+		case RenderCommandType::Present:
+			renderer.flush();
+			m_Backend.present(m_Window);
+			break;
+		}
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "RenderBackend.hpp"
+#include <Engine\Window\OpenGLBackend.hpp>
+
+namespace icy
+{
+	namespace Renderer
+	{
+		// Plays command lists back through an OpenGL window's state cache and indirect renderer
+		// Takes the backend rather than a window type so static and dynamic windows both work
+		class OpenGLRenderBackend : public RenderBackend
+		{
+		public:
+			OpenGLRenderBackend(SDL_Window* window, icy::Window::OpenGLBackend& backend);
+			virtual bool attachThread();
+			virtual void detachThread();
+			virtual void execute(const RenderCommandList& commands);
+
+		private:
+			SDL_Window* m_Window;
+			icy::Window::OpenGLBackend& m_Backend;
+		};
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "RenderCommandList.hpp"
+
+namespace icy
+{
+	namespace Renderer
+	{
+		// Executes recorded command lists on whatever thread submits to the GPU
+		class RenderBackend
+		{
+		public:
+			virtual ~RenderBackend() {};
+			// Binds the graphics context to the calling thread (e.g. makes the GL context current)
+			virtual bool attachThread() = 0;
+			// Releases the graphics context from the calling thread so another one can attach it
+			virtual void detachThread() = 0;
+			// Translates and submits one frame worth of commands
+			virtual void execute(const RenderCommandList& commands) = 0;
+		};
+	}
+}
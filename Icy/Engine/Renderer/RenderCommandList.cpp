@@ -0,0 +1,28 @@
+#include "RenderCommandList.hpp"
+
+icy::Renderer::RenderCommandList::RenderCommandList(size_t capacity)
+	: m_Data(new uint8_t[capacity])
+{
+	m_Capacity = capacity;
+	m_Size = 0;
+	m_Count = 0;
+	m_Dropped = 0;
+}
+
+const icy::Renderer::RenderCommandHeader* icy::Renderer::RenderCommandList::first() const
+{
+	return m_Size == 0 ? nullptr : reinterpret_cast<const RenderCommandHeader*>(m_Data.get());
+}
+
+const icy::Renderer::RenderCommandHeader* icy::Renderer::RenderCommandList::next(const RenderCommandHeader* command) const
+{
+	const uint8_t* next = reinterpret_cast<const uint8_t*>(command) + command->size;
+	return next < m_Data.get() + m_Size ? reinterpret_cast<const RenderCommandHeader*>(next) : nullptr;
+}
+
+void icy::Renderer::RenderCommandList::clear()
+{
+	m_Size = 0;
+	m_Count = 0;
+	m_Dropped = 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace icy
+{
+	namespace Renderer
+	{
+		enum class RenderCommandType : uint32_t
+		{
+			SetViewport,
+			Clear,
+			DrawMesh,
+			Present
+		};
+
+		// Commands are plain data so they can be copied into the list and read back on another thread
+		struct SetViewportCommand
+		{
+			static constexpr RenderCommandType Type = RenderCommandType::SetViewport;
+			int32_t x, y, width, height;
+		};
+		struct ClearCommand
+		{
+			static constexpr RenderCommandType Type = RenderCommandType::Clear;
+			static constexpr uint32_t Color = 1;
+			static constexpr uint32_t Depth = 2;
+			float color[4];
+			float depth;
+			uint32_t flags;
+		};
+		struct DrawMeshCommand
+		{
+			static constexpr RenderCommandType Type = RenderCommandType::DrawMesh;
+			uint32_t mesh;
+			uint32_t material;
+			uint32_t texture;
+			// column major 4x4 transform
+			float model[16];
+			// From RenderQueue::makeKey, 0 sorts by material only
+			uint64_t sortKey;
+		};
+		struct PresentCommand
+		{
+			static constexpr RenderCommandType Type = RenderCommandType::Present;
+		};
+
+		struct RenderCommandHeader
+		{
+			RenderCommandType type;
+			// bytes from this header to the next one
+			uint32_t size;
+		};
+
+		// Linear, fixed capacity list of backend agnostic render commands
+		// The memory is allocated once, recording a frame never touches the heap
+		class RenderCommandList
+		{
+		public:
+			static constexpr size_t DefaultCapacity = 4 * 1024 * 1024;
+
+			explicit RenderCommandList(size_t capacity = DefaultCapacity);
+			RenderCommandList(RenderCommandList&&) = default;
+			RenderCommandList(const RenderCommandList&) = delete;
+			RenderCommandList& operator=(const RenderCommandList&) = delete;
+
+			// Appends a command and returns it for filling in, nullptr when the list is full
+			template <class T>
+			T* push()
+			{
+				const size_t size = alignSize(sizeof(RenderCommandHeader) + sizeof(T));
+				if (m_Size + size > m_Capacity)
+				{
+					++m_Dropped;
+					return nullptr;
+				}
+				RenderCommandHeader* header = reinterpret_cast<RenderCommandHeader*>(m_Data.get() + m_Size);
+				header->type = T::Type;
+				header->size = static_cast<uint32_t>(size);
+				m_Size += size;
+				++m_Count;
+				return new (header + 1) T();
+			}
+
+			// Iteration, first() returns nullptr for an empty list and next() returns nullptr after the last command
+			const RenderCommandHeader* first() const;
+			const RenderCommandHeader* next(const RenderCommandHeader* command) const;
+			template <class T>
+			static const T& get(const RenderCommandHeader* command) { return *reinterpret_cast<const T*>(command + 1); }
+
+			void clear();
+			size_t getSize() const { return m_Size; }
+			uint32_t getCount() const { return m_Count; }
+			// Commands that did not fit since the last clear()
+			uint32_t getDropped() const { return m_Dropped; }
+
+		private:
+			static size_t alignSize(size_t size) { return (size + 7) & ~size_t(7); }
+
+		private:
+			std::unique_ptr<uint8_t[]> m_Data;
+			size_t m_Capacity;
+			size_t m_Size;
+			uint32_t m_Count;
+			uint32_t m_Dropped;
+		};
+	}
+}
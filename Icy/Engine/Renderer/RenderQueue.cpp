@@ -0,0 +1,64 @@
+#include "RenderQueue.hpp"
+
+namespace
+{
+	const uint32_t DepthBits = 24;
+	const uint32_t DepthMax = (1u << DepthBits) - 1;
+}
+
+uint64_t icy::Renderer::RenderQueue::makeKey(uint32_t pass, uint32_t layer, bool translucent, uint32_t pipeline, uint32_t material, float depth)
+{
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	uint64_t quantised = static_cast<uint64_t>(depth * DepthMax);
+	uint64_t key = static_cast<uint64_t>(pass & 0xF) << 60;
+	key |= static_cast<uint64_t>(layer & 0xF) << 56;
+	pipeline &= MaxPipelines - 1;
+	material &= MaxMaterials - 1;
+	if (translucent)
+	{
+		key |= uint64_t(1) << 55;
+		key |= (DepthMax - quantised) << 31;
+		key |= static_cast<uint64_t>(pipeline) << 19;
+		key |= static_cast<uint64_t>(material) << 3;
+	}
+	else
+	{
+		key |= static_cast<uint64_t>(pipeline) << 43;
+		key |= static_cast<uint64_t>(material) << 27;
+		key |= quantised << 3;
+	}
+	return key;
+}
+
+uint32_t icy::Renderer::RenderQueue::getPipeline(uint64_t key)
+{
+	return static_cast<uint32_t>(key >> (isTranslucent(key) ? 19 : 43)) & (MaxPipelines - 1);
+}
+
+uint32_t icy::Renderer::RenderQueue::getMaterial(uint64_t key)
+{
+	return static_cast<uint32_t>(key >> (isTranslucent(key) ? 3 : 27)) & (MaxMaterials - 1);
+}
+
+icy::Renderer::RenderQueue::RenderQueue(uint32_t capacity)
+{
+	m_Keys.resize(capacity);
+	m_Values.resize(capacity);
+	m_Count = 0;
+	m_Sorter.reserve(capacity);
+}
+
+bool icy::Renderer::RenderQueue::push(uint64_t key, uint32_t value)
+{
+	if (m_Count == m_Keys.size())
+		return false;
+	m_Keys[m_Count] = key;
+	m_Values[m_Count] = value;
+	++m_Count;
+	return true;
+}
+
+void icy::Renderer::RenderQueue::sort(icy::System::ThreadPool* pool)
+{
+	m_Sorter.sort(m_Keys.data(), m_Values.data(), m_Count, pool);
+}
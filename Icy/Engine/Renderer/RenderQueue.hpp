@@ -0,0 +1,56 @@
+#pragma once
+#include <Engine\System\RadixSort.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace icy
+{
+	namespace Renderer
+	{
+		// Draw ordering for a frame: every draw gets a 64 bit key and the queue sorts them before a backend submits them
+		// Key layout from the top bit down:
+		// pass (4) | layer (4) | translucent (1) | opaque: pipeline (12) material (16) depth (24) | translucent: far to near depth (24) pipeline (12) material (16)
+		// Opaque draws are grouped by state and drawn near to far inside a group to help early depth rejection,
+		// translucent ones are blended back to front and only grouped where their depth ties
+		class RenderQueue
+		{
+		public:
+			static constexpr uint32_t MaxPasses = 16;
+			static constexpr uint32_t MaxLayers = 16;
+			static constexpr uint32_t MaxPipelines = 1 << 12;
+			static constexpr uint32_t MaxMaterials = 1 << 16;
+			static constexpr uint32_t DefaultCapacity = 1 << 17;
+
+			// depth : view depth normalised to [0, 1], clamped
+			static uint64_t makeKey(uint32_t pass, uint32_t layer, bool translucent, uint32_t pipeline, uint32_t material, float depth);
+			static uint32_t getPass(uint64_t key) { return static_cast<uint32_t>(key >> 60); }
+			static uint32_t getLayer(uint64_t key) { return static_cast<uint32_t>(key >> 56) & 0xF; }
+			static bool isTranslucent(uint64_t key) { return ((key >> 55) & 1) != 0; }
+			static uint32_t getPipeline(uint64_t key);
+			static uint32_t getMaterial(uint64_t key);
+
+			explicit RenderQueue(uint32_t capacity = DefaultCapacity);
+			RenderQueue(const RenderQueue&) = delete;
+			RenderQueue& operator=(const RenderQueue&) = delete;
+
+			// value : whatever identifies the draw for the backend, usually an index into the frame's draw list
+			// Returns false when the queue is full
+			bool push(uint64_t key, uint32_t value);
+			// pool : sorts on its threads once the queue is big enough, nullptr sorts on the calling thread
+			void sort(icy::System::ThreadPool* pool = nullptr);
+			void clear() { m_Count = 0; }
+
+			uint32_t getCount() const { return m_Count; }
+			uint64_t getKey(uint32_t index) const { return m_Keys[index]; }
+			uint32_t getValue(uint32_t index) const { return m_Values[index]; }
+			const uint64_t* getKeys() const { return m_Keys.data(); }
+			const uint32_t* getValues() const { return m_Values.data(); }
+
+		private:
+			std::vector<uint64_t> m_Keys;
+			std::vector<uint32_t> m_Values;
+			uint32_t m_Count;
+			icy::System::RadixSorter m_Sorter;
+		};
+	}
+}
\ No newline at end of file
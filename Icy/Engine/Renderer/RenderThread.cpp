@@ -0,0 +1,89 @@
+#include "RenderThread.hpp"
+#include <chrono>
+#include <Engine\System\Profiler.hpp>
+
+icy::Renderer::RenderThread::RenderThread(size_t commandListCapacity)
+	: m_Lists{ RenderCommandList(commandListCapacity), RenderCommandList(commandListCapacity) }
+{
+	m_Backend = nullptr;
+	m_Running.store(false);
+	m_Submitted.store(0);
+	m_Consumed.store(0);
+	m_GameWaitMs = 0.0;
+	m_RenderMs.store(0.0);
+}
+
+icy::Renderer::RenderThread::~RenderThread()
+{
+	stop();
+}
+
+bool icy::Renderer::RenderThread::start(RenderBackend* backend)
+{
+	if (isRunning() || backend == nullptr)
+		return false;
+	m_Backend = backend;
+	m_Submitted.store(0);
+	m_Consumed.store(0);
+	m_Lists[0].clear();
+	m_Lists[1].clear();
+	m_Running.store(true);
+
+	m_Backend->detachThread();
+	m_Thread = std::thread(&RenderThread::run, this);
+	return true;
+}
+
+void icy::Renderer::RenderThread::stop()
+{
+	if (!isRunning())
+		return;
+	m_Running.store(false);
+	m_RenderWait.wake();
+	m_Thread.join();
+	m_Backend->attachThread();
+}
+
+icy::Renderer::RenderCommandList& icy::Renderer::RenderThread::beginFrame()
+{
+	// The list for frame N was last used by frame N-2, which has to be consumed first
+	ICY_PROFILE_ZONE("Wait for render thread");
+	const uint64_t frame = m_Submitted.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	m_GameWait.wait([this, frame] { return m_Consumed.load(std::memory_order_acquire) + 2 > frame; });
+	m_GameWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	RenderCommandList& list = m_Lists[frame % 2];
+	list.clear();
+	return list;
+}
+
+void icy::Renderer::RenderThread::endFrame()
+{
+	m_Submitted.fetch_add(1, std::memory_order_release);
+	m_RenderWait.wake();
+}
+
+void icy::Renderer::RenderThread::run()
+{
+	ICY_PROFILE_THREAD("Render");
+	m_Backend->attachThread();
+	uint64_t frame = 0;
+	for (;;)
+	{
+		m_RenderWait.wait([this, frame] { return m_Submitted.load(std::memory_order_acquire) > frame || !m_Running.load(); });
+		// Once stopped, finish the frames already handed over and leave
+		if (m_Submitted.load(std::memory_order_acquire) <= frame)
+			break;
+
+		ICY_PROFILE_ZONE("Execute command list");
+		auto start = std::chrono::steady_clock::now();
+		m_Backend->execute(m_Lists[frame % 2]);
+		m_RenderMs.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+
+		++frame;
+		m_Consumed.store(frame, std::memory_order_release);
+		m_GameWait.wake();
+	}
+	m_Backend->detachThread();
+}
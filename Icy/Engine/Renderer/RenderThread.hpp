@@ -0,0 +1,100 @@
+#pragma once
+#include "RenderBackend.hpp"
+#include "RenderCommandList.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace icy
+{
+	namespace Renderer
+	{
+		// Blocks a thread until a condition holds, spinning briefly before it parks
+		// Wakers only take the mutex when somebody is actually parked. Waiter and waker each store then load (m_Parked,
+		// then the state ready() reads, against the state, then m_Parked), the seq_cst fences keep either side from
+		// reading before its own store is visible so one of them always sees the other
+		class WaitPoint
+		{
+		public:
+			WaitPoint() : m_Parked(0) {}
+			template <class Ready>
+			void wait(Ready ready)
+			{
+				for (int i = 0; i < SpinCount; ++i)
+				{
+					if (ready())
+						return;
+					std::this_thread::yield();
+				}
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Parked.fetch_add(1);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				m_Wake.wait(lock, ready);
+				m_Parked.fetch_sub(1);
+			}
+			// Call after publishing the state the waiter checks
+			void wake()
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (m_Parked.load() != 0)
+				{
+					std::lock_guard<std::mutex> lock(m_Mutex);
+					m_Wake.notify_all();
+				}
+			}
+
+		private:
+			static constexpr int SpinCount = 64;
+			std::mutex m_Mutex;
+			std::condition_variable m_Wake;
+			std::atomic<int> m_Parked;
+		};
+
+		// Runs a RenderBackend on its own thread
+		// The game thread records frame N into one command list while the render thread submits frame N-1 from the other,
+		// the hand-off is two atomic frame counters and never allocates
+		class RenderThread
+		{
+		public:
+			explicit RenderThread(size_t commandListCapacity = RenderCommandList::DefaultCapacity);
+			~RenderThread();
+			RenderThread(const RenderThread&) = delete;
+			RenderThread& operator=(const RenderThread&) = delete;
+
+			// Detaches the backend from the calling thread and starts submitting on the render thread
+			bool start(RenderBackend* backend);
+			// Submits what is left, joins the render thread and attaches the backend back to the calling thread
+			void stop();
+			bool isRunning() const { return m_Thread.joinable(); }
+
+			// Game thread: returns the empty list for the next frame
+			// Waits if the render thread has not finished the frame that used this list yet
+			RenderCommandList& beginFrame();
+			// Game thread: hands the recorded list to the render thread
+			void endFrame();
+
+			// Time the game thread spent waiting for the render thread in the last beginFrame(), in milliseconds
+			double getGameWaitMs() const { return m_GameWaitMs; }
+			// Time the render thread spent executing the last frame, in milliseconds
+			double getRenderMs() const { return m_RenderMs.load(std::memory_order_relaxed); }
+
+		private:
+			void run();
+
+		private:
+			RenderCommandList m_Lists[2];
+			RenderBackend* m_Backend;
+			std::thread m_Thread;
+			std::atomic<bool> m_Running;
+			// Frames handed over by the game thread and frames finished by the render thread
+			std::atomic<uint64_t> m_Submitted;
+			std::atomic<uint64_t> m_Consumed;
+			WaitPoint m_GameWait;
+			WaitPoint m_RenderWait;
+			double m_GameWaitMs;
+			std::atomic<double> m_RenderMs;
+		};
+	}
+}
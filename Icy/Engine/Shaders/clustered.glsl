@@ -0,0 +1,124 @@
+// Clustered forward lighting: the lights, the froxel grid lightclusters.comp bins them into and the lookup fragments use
+// OpenGL: OpenGLClusteredLighting inserts this after the #version line of the shaders it builds or is handed
+// Vulkan: #include it with GL_GOOGLE_include_directive, ICY_CLUSTER_SET picks the descriptor set (1 by default)
+// Fragment shaders call icyClusteredLighting, which only loops over the lights of the fragment's cluster
+
+#ifdef VULKAN
+#ifndef ICY_CLUSTER_SET
+#define ICY_CLUSTER_SET 1
+#endif
+#define ICY_CLUSTER_BINDING(vulkan, gl) set = ICY_CLUSTER_SET, binding = vulkan
+#else
+#define ICY_CLUSTER_BINDING(vulkan, gl) binding = gl
+#endif
+
+// Only the binning pass writes the grid, fragment shaders can't declare writable buffers on every device
+#ifdef ICY_CLUSTER_WRITE
+#define ICY_CLUSTER_ACCESS
+#else
+#define ICY_CLUSTER_ACCESS readonly
+#endif
+
+#define ICY_LIGHT_POINT 0u
+#define ICY_LIGHT_SPOT 1u
+
+// Matches icy::System::ClusterLight
+struct IcyLight
+{
+	vec3 position;
+	float range;
+	vec3 direction;
+	float cosOuter;
+	vec3 color;
+	float intensity;
+	uint type;
+	float cosInner;
+	vec2 pad;
+};
+
+// Matches icy::System::ClusterParams
+layout(std140, ICY_CLUSTER_BINDING(0, 4)) uniform IcyClusterParams
+{
+	mat4 view;
+	float tanHalfFovX;
+	float tanHalfFovY;
+	float nearPlane;
+	float farPlane;
+	float width;
+	float height;
+	float sliceScale;
+	float sliceBias;
+	uvec3 gridSize;
+	uint lightCount;
+} icy_Clusters;
+
+layout(std430, ICY_CLUSTER_BINDING(1, 4)) readonly buffer IcyLightBuffer { IcyLight icy_Lights[]; };
+// (offset, count) into icy_ClusterIndices per cluster, x fastest, then y, then depth
+layout(std430, ICY_CLUSTER_BINDING(2, 5)) ICY_CLUSTER_ACCESS buffer IcyClusterGrid { uvec2 icy_ClusterGrid[]; };
+// The counters fill the first ClusterCounterSize bytes
+layout(std430, ICY_CLUSTER_BINDING(3, 6)) ICY_CLUSTER_ACCESS buffer IcyClusterIndices
+{
+	uint icy_ClusterIndexCount;
+	uint icy_ClusterOverflow;
+	uvec2 icy_ClusterPad;
+	uint icy_ClusterIndices[];
+};
+
+// Same steps as icy::System::LightClusterer::getClusterIndex
+uint icyClusterIndex(vec2 fragCoord, float viewDepth)
+{
+#ifdef VULKAN
+	// The grid counts rows from the bottom like GL, Vulkan's framebuffer starts at the top
+	fragCoord.y = icy_Clusters.height - fragCoord.y;
+#endif
+	uvec3 size = icy_Clusters.gridSize;
+	uint x = min(uint(max(fragCoord.x, 0.0) / icy_Clusters.width * float(size.x)), size.x - 1u);
+	uint y = min(uint(max(fragCoord.y, 0.0) / icy_Clusters.height * float(size.y)), size.y - 1u);
+	float slice = floor(log(max(viewDepth, icy_Clusters.nearPlane)) * icy_Clusters.sliceScale + icy_Clusters.sliceBias);
+	uint z = uint(clamp(slice, 0.0, float(size.z - 1u)));
+	return x + size.x * (y + size.y * z);
+}
+
+// Light arriving at worldPos from one light, and the direction towards it
+vec3 icyLightRadiance(IcyLight light, vec3 worldPos, out vec3 toLight)
+{
+	vec3 offset = light.position - worldPos;
+	float distanceSq = dot(offset, offset);
+	toLight = offset * inversesqrt(max(distanceSq, 1e-8));
+	// Inverse square, windowed so it reaches 0 at the range the light was binned with
+	float ratio = distanceSq / (light.range * light.range);
+	float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+	float attenuation = window * window / max(distanceSq, 1e-4);
+	if (light.type == ICY_LIGHT_SPOT)
+		attenuation *= smoothstep(light.cosOuter, light.cosInner, dot(-toLight, light.direction));
+	return light.color * (light.intensity * attenuation);
+}
+
+// Diffuse lighting of a surface at worldPos from the lights of the cluster it falls in
+// fragCoord : gl_FragCoord.xy
+vec3 icyClusteredLighting(vec2 fragCoord, vec3 worldPos, vec3 normal, vec3 albedo)
+{
+	float viewDepth = -(icy_Clusters.view * vec4(worldPos, 1.0)).z;
+	uvec2 range = icy_ClusterGrid[icyClusterIndex(fragCoord, viewDepth)];
+	vec3 result = vec3(0.0);
+	for (uint i = 0u; i < range.y; ++i)
+	{
+		vec3 toLight;
+		vec3 radiance = icyLightRadiance(icy_Lights[icy_ClusterIndices[range.x + i]], worldPos, toLight);
+		result += radiance * max(dot(normal, toLight), 0.0);
+	}
+	return result * albedo;
+}
+
+// The same lighting looping over every light, what clustering saves and what it has to match
+vec3 icyForwardLighting(vec3 worldPos, vec3 normal, vec3 albedo)
+{
+	vec3 result = vec3(0.0);
+	for (uint i = 0u; i < icy_Clusters.lightCount; ++i)
+	{
+		vec3 toLight;
+		vec3 radiance = icyLightRadiance(icy_Lights[i], worldPos, toLight);
+		result += radiance * max(dot(normal, toLight), 0.0);
+	}
+	return result * albedo;
+}
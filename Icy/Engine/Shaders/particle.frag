@@ -0,0 +1,23 @@
+#version 450
+// Vulkan: glslangValidator -V particle.frag -o particle.frag.spv
+
+layout(location = 0) in vec2 v_Corner;
+layout(location = 1) in vec4 v_Color;
+
+layout(location = 0) out vec4 o_Color;
+
+// Draw variants of VulkanParticleSystem, OpenGL always draws the default
+#ifdef VULKAN
+layout(constant_id = 0) const bool ICY_SOFT_EDGES = true;
+#else
+const bool ICY_SOFT_EDGES = true;
+#endif
+
+void main()
+{
+	// Round soft particles out of the quad, or the whole quad without
+	float falloff = ICY_SOFT_EDGES ? 1.0 - dot(v_Corner, v_Corner) : 1.0;
+	if (falloff <= 0.0)
+		discard;
+	o_Color = vec4(v_Color.rgb, v_Color.a * falloff);
+}
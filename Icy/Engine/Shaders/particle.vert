@@ -0,0 +1,70 @@
+#version 450
+// Camera facing quads for the particles of the last particle step, drawn with the indirect args it wrote
+// Vulkan: glslangValidator -V particle.vert -o particle.vert.spv
+
+#ifdef VULKAN
+#define ICY_SET(n) set = n,
+#define ICY_VERTEX_INDEX gl_VertexIndex
+#define ICY_INSTANCE_INDEX gl_InstanceIndex
+// Draw variants of VulkanParticleSystem, OpenGL always draws the default
+layout(constant_id = 1) const bool ICY_FADE_OUT = true;
+#else
+const bool ICY_FADE_OUT = true;
+#define ICY_SET(n)
+#define ICY_VERTEX_INDEX gl_VertexID
+#define ICY_INSTANCE_INDEX gl_InstanceID
+#endif
+
+struct Particle
+{
+	vec3 position;
+	float age;
+	vec3 velocity;
+	float lifetime;
+	uint color;
+	float size;
+	uint pad0;
+	uint pad1;
+};
+
+layout(std140, ICY_SET(0) binding = 0) uniform ParticleParams
+{
+	mat4 viewProjection;
+	vec3 emitterPosition;
+	uint emitCount;
+	vec3 emitterVelocity;
+	float spread;
+	vec3 gravity;
+	float deltaTime;
+	vec3 cameraPosition;
+	float drag;
+	float lifetimeMin;
+	float lifetimeMax;
+	float size;
+	uint color;
+	uint seed;
+	uint current;
+	uint next;
+	uint capacity;
+} params;
+
+layout(std430, ICY_SET(1) binding = 0) readonly buffer ParticleBuffer { Particle particles[]; };
+layout(std430, ICY_SET(1) binding = 3) readonly buffer AliveBuffer { uvec2 aliveList[]; };
+
+layout(location = 0) out vec2 v_Corner;
+layout(location = 1) out vec4 v_Color;
+
+void main()
+{
+	// The step that wrote the draw args left its sorted particles in the next list
+	uint index = aliveList[params.next * params.capacity + uint(ICY_INSTANCE_INDEX)].y;
+	Particle particle = particles[index];
+
+	vec2 corner = vec2(float(ICY_VERTEX_INDEX & 1), float(ICY_VERTEX_INDEX >> 1)) * 2.0 - 1.0;
+	// Offset in clip space so the quad always faces the camera and still shrinks with distance
+	gl_Position = params.viewProjection * vec4(particle.position, 1.0) + vec4(corner * particle.size, 0.0, 0.0);
+	v_Corner = corner;
+	v_Color = unpackUnorm4x8(particle.color);
+	if (ICY_FADE_OUT)
+		v_Color.a *= 1.0 - particle.age / particle.lifetime;
+}
@@ -0,0 +1,22 @@
+#version 450
+// Vulkan: glslangValidator -V text.frag -o text.frag.spv
+
+#ifdef VULKAN
+#define ICY_TEXT_BINDING(vulkanSet, vulkan, gl) set = vulkanSet, binding = vulkan
+#else
+#define ICY_TEXT_BINDING(vulkanSet, vulkan, gl) binding = gl
+#endif
+
+layout(ICY_TEXT_BINDING(1, 0, 2)) uniform sampler2D atlasPage;
+
+layout(location = 0) in vec2 v_Texel;
+layout(location = 1) in vec4 v_Color;
+
+layout(location = 0) out vec4 o_Color;
+
+void main()
+{
+	// Quads sit on whole pixels, so every fragment lands on exactly one texel of the glyph
+	float coverage = texelFetch(atlasPage, ivec2(v_Texel), 0).r;
+	o_Color = vec4(v_Color.rgb, v_Color.a * coverage);
+}
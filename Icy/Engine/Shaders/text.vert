@@ -0,0 +1,52 @@
+#version 450
+// Glyph quads out of GlyphAtlas, one instance per glyph and one draw per atlas page
+// Vulkan: glslangValidator -V text.vert -o text.vert.spv
+
+#ifdef VULKAN
+#define ICY_TEXT_BINDING(vulkanSet, vulkan, gl) set = vulkanSet, binding = vulkan
+#define ICY_VERTEX_INDEX gl_VertexIndex
+#define ICY_INSTANCE_INDEX gl_InstanceIndex
+#else
+#define ICY_TEXT_BINDING(vulkanSet, vulkan, gl) binding = gl
+#define ICY_VERTEX_INDEX gl_VertexID
+#define ICY_INSTANCE_INDEX gl_InstanceID
+#endif
+
+// Matches GlyphInstance, 20 bytes, a vec2 would align the struct to 8 and pad it to 24
+struct Glyph
+{
+	float x;
+	float y;
+	uint atlasXY;
+	uint size;
+	uint color;
+};
+
+// xy : 2 / target size in pixels
+#ifdef VULKAN
+layout(push_constant) uniform TextConstants { vec4 pixelToClip; };
+#else
+layout(location = 0) uniform vec4 pixelToClip;
+#endif
+
+layout(std430, ICY_TEXT_BINDING(2, 0, 0)) readonly buffer GlyphBuffer { Glyph glyphs[]; };
+
+layout(location = 0) out vec2 v_Texel;
+layout(location = 1) out vec4 v_Color;
+
+void main()
+{
+	Glyph glyph = glyphs[ICY_INSTANCE_INDEX];
+	vec2 corner = vec2(float(ICY_VERTEX_INDEX & 1), float(ICY_VERTEX_INDEX >> 1));
+	vec2 size = vec2(float(glyph.size & 0xFFFFu), float(glyph.size >> 16));
+	vec2 atlas = vec2(float(glyph.atlasXY & 0xFFFFu), float(glyph.atlasXY >> 16));
+
+	// Pixels count down from the top left, Vulkan's clip space already points y down
+	vec2 clip = (vec2(glyph.x, glyph.y) + corner * size) * pixelToClip.xy - 1.0;
+#ifndef VULKAN
+	clip.y = -clip.y;
+#endif
+	gl_Position = vec4(clip, 0.0, 1.0);
+	v_Texel = atlas + corner * size;
+	v_Color = unpackUnorm4x8(glyph.color);
+}
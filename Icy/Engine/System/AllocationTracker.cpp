@@ -0,0 +1,351 @@
+#include "AllocationTracker.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#if defined(ICY_TRACK_ALLOCATIONS) && defined(_WIN32)
+#include <malloc.h>
+#if defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+#endif
+
+namespace
+{
+	// Plain data only, these have to work before any constructor has run and inside malloc itself
+	thread_local icy::System::AllocationCounts t_Counts = { 0, 0, 0 };
+	std::atomic<uint64_t> g_Allocations(0);
+	std::atomic<uint64_t> g_Frees(0);
+	std::atomic<uint64_t> g_Bytes(0);
+
+	void recordAllocation(size_t size)
+	{
+		++t_Counts.allocations;
+		t_Counts.bytes += size;
+		g_Allocations.fetch_add(1, std::memory_order_relaxed);
+		g_Bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void recordFree()
+	{
+		++t_Counts.frees;
+		g_Frees.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+bool icy::System::AllocationTracker::isEnabled()
+{
+#ifdef ICY_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+icy::System::AllocationCounts icy::System::AllocationTracker::getThreadCounts()
+{
+	return t_Counts;
+}
+
+icy::System::AllocationCounts icy::System::AllocationTracker::getGlobalCounts()
+{
+	AllocationCounts counts;
+	counts.allocations = g_Allocations.load(std::memory_order_relaxed);
+	counts.frees = g_Frees.load(std::memory_order_relaxed);
+	counts.bytes = g_Bytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+#ifdef ICY_TRACK_ALLOCATIONS
+
+#if defined(__GLIBC__)
+// glibc exports its allocator under these names as well, so malloc can be replaced and still forward to the real one
+// operator new goes through malloc and is counted there
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* pointer, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void* pointer);
+
+	void* malloc(size_t size)
+	{
+		void* pointer = __libc_malloc(size);
+		if (pointer != nullptr)
+			recordAllocation(size);
+		return pointer;
+	}
+
+	void* calloc(size_t count, size_t size)
+	{
+		void* pointer = __libc_calloc(count, size);
+		if (pointer != nullptr)
+			recordAllocation(count * size);
+		return pointer;
+	}
+
+	void* realloc(void* pointer, size_t size)
+	{
+		void* result = __libc_realloc(pointer, size);
+		// A move to a new block is a free and an allocation as far as latency goes
+		if (result != nullptr)
+			recordAllocation(size);
+		if (pointer != nullptr && (result != nullptr || size == 0))
+			recordFree();
+		return result;
+	}
+
+	void* memalign(size_t alignment, size_t size)
+	{
+		void* pointer = __libc_memalign(alignment, size);
+		if (pointer != nullptr)
+			recordAllocation(size);
+		return pointer;
+	}
+
+	void* aligned_alloc(size_t alignment, size_t size)
+	{
+		return memalign(alignment, size);
+	}
+
+	int posix_memalign(void** result, size_t alignment, size_t size)
+	{
+		if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+			return EINVAL;
+		void* pointer = memalign(alignment, size);
+		if (pointer == nullptr)
+			return ENOMEM;
+		*result = pointer;
+		return 0;
+	}
+
+	void free(void* pointer)
+	{
+		if (pointer != nullptr)
+			recordFree();
+		__libc_free(pointer);
+	}
+}
+
+#define ICY_COUNT_IN_NEW 0
+#else
+#define ICY_COUNT_IN_NEW 1
+#endif
+
+namespace
+{
+#if defined(_WIN32) && defined(_DEBUG)
+	// The debug CRT reports malloc through this hook, operator new is counted on its own so it sets t_InsideNew
+	thread_local bool t_InsideNew = false;
+
+	int crtAllocHook(int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* fileName, int line)
+	{
+		if (blockType == _CRT_BLOCK || t_InsideNew)
+			return 1;
+		if (allocType == _HOOK_ALLOC)
+			recordAllocation(size);
+		else if (allocType == _HOOK_REALLOC)
+		{
+			recordAllocation(size);
+			recordFree();
+		}
+		else if (allocType == _HOOK_FREE)
+			recordFree();
+		return 1;
+	}
+
+	struct InstallCrtHook
+	{
+		InstallCrtHook() { _CrtSetAllocHook(crtAllocHook); }
+	} g_InstallCrtHook;
+
+#define ICY_NEW_GUARD_BEGIN() t_InsideNew = true
+#define ICY_NEW_GUARD_END() t_InsideNew = false
+#else
+#define ICY_NEW_GUARD_BEGIN()
+#define ICY_NEW_GUARD_END()
+#endif
+
+	void* trackedNew(size_t size)
+	{
+		if (size == 0)
+			size = 1;
+		ICY_NEW_GUARD_BEGIN();
+		void* pointer = std::malloc(size);
+		ICY_NEW_GUARD_END();
+#if ICY_COUNT_IN_NEW
+		if (pointer != nullptr)
+			recordAllocation(size);
+#endif
+		return pointer;
+	}
+
+	void trackedDelete(void* pointer)
+	{
+		if (pointer == nullptr)
+			return;
+#if ICY_COUNT_IN_NEW
+		recordFree();
+#endif
+		ICY_NEW_GUARD_BEGIN();
+		std::free(pointer);
+		ICY_NEW_GUARD_END();
+	}
+
+#ifdef __cpp_aligned_new
+	// Over aligned types, new of those skips the plain operator new
+	void* trackedAlignedNew(size_t size, std::align_val_t alignment)
+	{
+		if (size == 0)
+			size = 1;
+		const size_t bytes = static_cast<size_t>(alignment);
+		ICY_NEW_GUARD_BEGIN();
+#ifdef _WIN32
+		void* pointer = _aligned_malloc(size, bytes);
+#else
+		void* pointer = nullptr;
+		if (posix_memalign(&pointer, bytes < sizeof(void*) ? sizeof(void*) : bytes, size) != 0)
+			pointer = nullptr;
+#endif
+		ICY_NEW_GUARD_END();
+#if ICY_COUNT_IN_NEW
+		if (pointer != nullptr)
+			recordAllocation(size);
+#endif
+		return pointer;
+	}
+
+	void trackedAlignedDelete(void* pointer)
+	{
+		if (pointer == nullptr)
+			return;
+#if ICY_COUNT_IN_NEW
+		recordFree();
+#endif
+		ICY_NEW_GUARD_BEGIN();
+#ifdef _WIN32
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+		ICY_NEW_GUARD_END();
+	}
+#endif
+}
+
+void* operator new(size_t size)
+{
+	void* pointer = trackedNew(size);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](size_t size)
+{
+	void* pointer = trackedNew(size);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return trackedNew(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return trackedNew(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	trackedDelete(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	trackedDelete(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	trackedDelete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	trackedDelete(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	trackedDelete(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	trackedDelete(pointer);
+}
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* pointer = trackedAlignedNew(size, alignment);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* pointer = trackedAlignedNew(size, alignment);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return trackedAlignedNew(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return trackedAlignedNew(size, alignment);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	trackedAlignedDelete(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+	trackedAlignedDelete(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+	trackedAlignedDelete(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept
+{
+	trackedAlignedDelete(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	trackedAlignedDelete(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	trackedAlignedDelete(pointer);
+}
+#endif
+
+#endif
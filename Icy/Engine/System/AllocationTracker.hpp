@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace icy
+{
+	namespace System
+	{
+		struct AllocationCounts
+		{
+			uint64_t allocations;
+			uint64_t frees;
+			uint64_t bytes;
+		};
+
+		// Counts every heap allocation per thread and for the whole process
+		// Only active when the engine is built with ICY_TRACK_ALLOCATIONS, as the Debug configurations are, which replaces the global operator new/delete
+		// and, on glibc, interposes malloc/free; otherwise every count stays at zero
+		class AllocationTracker
+		{
+		public:
+			static bool isEnabled();
+			static AllocationCounts getThreadCounts();
+			static AllocationCounts getGlobalCounts();
+		};
+
+		// Snapshot of the calling thread's counts, reports what was allocated since it was created
+		class AllocationScope
+		{
+		public:
+			AllocationScope() { m_Start = AllocationTracker::getThreadCounts(); }
+			uint64_t getAllocations() const { return AllocationTracker::getThreadCounts().allocations - m_Start.allocations; }
+			uint64_t getBytes() const { return AllocationTracker::getThreadCounts().bytes - m_Start.bytes; }
+
+		private:
+			AllocationCounts m_Start;
+		};
+	}
+}
@@ -0,0 +1,93 @@
+#include "Application.hpp"
+#include "Profiler.hpp"
+#include <iostream>
+#include <thread>
+#ifdef _WIN32
+#include <Windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+icy::System::Application::Application()
+{
+	m_Timestep = 1.0 / 60.0;
+	m_FrameCap = 0.0;
+	m_MaxUpdates = 8;
+	m_bRunning = false;
+	m_bDumpStats = true;
+	m_SleepSlack = std::chrono::milliseconds(2);
+}
+
+void icy::System::Application::run()
+{
+#ifdef _WIN32
+	// The default scheduler tick is 15.6ms, far too coarse to pace frames with
+	timeBeginPeriod(1);
+#endif
+	m_bRunning = true;
+	const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_Timestep));
+	Clock::time_point previous = Clock::now();
+	Clock::time_point frameStart = previous;
+	Clock::duration accumulator(0);
+
+	while (m_bRunning)
+	{
+		ICY_PROFILE_ZONE("Frame");
+		Clock::time_point now = Clock::now();
+		accumulator += now - previous;
+		previous = now;
+
+		{
+			ICY_PROFILE_ZONE("Input");
+			processInput();
+		}
+
+		int updates = 0;
+		while (accumulator >= step && updates < m_MaxUpdates)
+		{
+			ICY_PROFILE_ZONE("Update");
+			update(m_Timestep);
+			accumulator -= step;
+			++updates;
+		}
+		// Drop the time we couldn't catch up on rather than carrying it into the next frame
+		if (updates == m_MaxUpdates && accumulator >= step)
+			accumulator = Clock::duration(0);
+
+		{
+			ICY_PROFILE_ZONE("Render");
+			render(std::chrono::duration<double>(accumulator).count() / m_Timestep);
+		}
+
+		if (m_FrameCap > 0.0)
+			waitUntil(frameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_FrameCap)));
+
+		Clock::time_point frameEnd = Clock::now();
+		m_Stats.addFrame(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+		frameStart = frameEnd;
+	}
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+	if (m_bDumpStats)
+		m_Stats.dump(std::cout);
+}
+
+void icy::System::Application::waitUntil(Clock::time_point target)
+{
+	ICY_PROFILE_FUNCTION();
+	for (;;)
+	{
+		Clock::time_point now = Clock::now();
+		if (target - now <= m_SleepSlack)
+			break;
+		Clock::time_point expected = now + std::chrono::milliseconds(1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		// Learn how badly the OS oversleeps so the spin phase covers it
+		auto late = Clock::now() - expected;
+		// A single huge stall shouldn't turn every following frame into a busy wait
+		if (late > m_SleepSlack && late < std::chrono::milliseconds(MaxSleepSlackMs))
+			m_SleepSlack = std::chrono::duration_cast<std::chrono::nanoseconds>(late);
+	}
+	while (Clock::now() < target)
+		std::this_thread::yield();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include "FrameStats.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		// Fixed timestep loop, update() always advances by the same dt and render() gets how far into the next step it is
+		// Derive from it, implement the hooks and call run()
+		class Application
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+			static constexpr int MaxSleepSlackMs = 4;
+
+			Application();
+			virtual ~Application() {}
+
+			// Runs until quit() is called, dumps the frame stats on the way out if enabled
+			void run();
+			void quit() { m_bRunning = false; }
+
+			// seconds : simulation step, 1/60 by default
+			void setFixedTimestep(double seconds) { m_Timestep = seconds; }
+			// fps : frame cap, 0 renders as fast as possible
+			void setFrameCap(double fps) { m_FrameCap = fps; }
+			// Caps how many steps one frame may run so a long stall doesn't snowball
+			void setMaxUpdatesPerFrame(int count) { m_MaxUpdates = count; }
+			void setDumpStatsOnExit(bool dump) { m_bDumpStats = dump; }
+
+			const FrameStats& getFrameStats() const { return m_Stats; }
+			double getTimestep() const { return m_Timestep; }
+			uint64_t getFrameIndex() const { return m_Stats.getFrameCount(); }
+
+		protected:
+			// Called once per frame before any updates
+			virtual void processInput() {}
+			// dt : always the fixed timestep
+			virtual void update(double dt) = 0;
+			// alpha : 0 to 1, how far between the previous and current simulation state to draw
+			virtual void render(double alpha) = 0;
+
+		private:
+			// Sleeps most of the way to target and spins through the rest
+			void waitUntil(Clock::time_point target);
+
+		private:
+			double m_Timestep;
+			double m_FrameCap;
+			int m_MaxUpdates;
+			bool m_bRunning;
+			bool m_bDumpStats;
+			// How late a sleep has woken up at worst, spinning starts this far ahead of the target
+			std::chrono::nanoseconds m_SleepSlack;
+			FrameStats m_Stats;
+		};
+	}
+}
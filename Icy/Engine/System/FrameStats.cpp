@@ -0,0 +1,84 @@
+#include "FrameStats.hpp"
+#include <algorithm>
+#include <cmath>
+
+icy::System::FrameStats::FrameStats()
+{
+	m_HitchFactor = 2.0;
+	reset();
+}
+
+void icy::System::FrameStats::addFrame(double frameMs)
+{
+	// Compare against the median before this frame moves it
+	if (m_Count >= 16 && frameMs > m_Median * m_HitchFactor)
+		++m_Hitches;
+
+	m_Window[m_Next] = frameMs;
+	m_Next = (m_Next + 1) % WindowSize;
+	if (m_Count < WindowSize)
+		++m_Count;
+	++m_TotalFrames;
+	m_TotalMs += frameMs;
+
+	int bucket = static_cast<int>(frameMs);
+	m_Histogram[std::min(std::max(bucket, 0), BucketCount - 1)]++;
+
+	// A fresh median every few frames is plenty for hitch detection
+	if (m_Count == 16 || (m_TotalFrames & 63) == 0)
+		m_Median = percentile(50.0);
+}
+
+void icy::System::FrameStats::reset()
+{
+	m_Next = 0;
+	m_Count = 0;
+	m_Median = 0.0;
+	m_Hitches = 0;
+	m_TotalFrames = 0;
+	m_TotalMs = 0.0;
+	std::fill(m_Histogram, m_Histogram + BucketCount, 0u);
+}
+
+int icy::System::FrameStats::sortedWindow(double* out) const
+{
+	std::copy(m_Window, m_Window + m_Count, out);
+	std::sort(out, out + m_Count);
+	return m_Count;
+}
+
+double icy::System::FrameStats::percentile(double p) const
+{
+	if (m_Count == 0)
+		return 0.0;
+	double sorted[WindowSize];
+	int count = sortedWindow(sorted);
+	// Nearest rank
+	int rank = static_cast<int>(std::ceil(p / 100.0 * count)) - 1;
+	return sorted[std::min(std::max(rank, 0), count - 1)];
+}
+
+double icy::System::FrameStats::average() const
+{
+	return m_TotalFrames == 0 ? 0.0 : m_TotalMs / static_cast<double>(m_TotalFrames);
+}
+
+double icy::System::FrameStats::worst() const
+{
+	if (m_Count == 0)
+		return 0.0;
+	return *std::max_element(m_Window, m_Window + m_Count);
+}
+
+void icy::System::FrameStats::dump(std::ostream& out) const
+{
+	out << "Frames: " << m_TotalFrames << " avg " << average() << "ms" << std::endl;
+	out << "p50 " << percentile(50.0) << "ms p95 " << percentile(95.0) << "ms p99 " << percentile(99.0) << "ms worst " << worst() << "ms" << std::endl;
+	out << "Hitches (> " << m_HitchFactor << "x median): " << m_Hitches << std::endl;
+	for (int i = 0; i < BucketCount; ++i)
+	{
+		if (m_Histogram[i] == 0)
+			continue;
+		out << (i == BucketCount - 1 ? ">=" : "") << i << "ms: " << m_Histogram[i] << std::endl;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+namespace icy
+{
+	namespace System
+	{
+		// Rolling window of frame times with percentiles and hitch counting, recording never allocates
+		class FrameStats
+		{
+		public:
+			static constexpr int WindowSize = 1024;
+			// Histogram buckets are 1ms wide, everything past the last bucket lands in it
+			static constexpr int BucketCount = 100;
+
+			FrameStats();
+
+			void addFrame(double frameMs);
+			void reset();
+
+			// p : 0 to 100, computed over the rolling window
+			double percentile(double p) const;
+			double average() const;
+			double worst() const;
+			// Frames that took longer than hitchFactor times the rolling median, over the whole run
+			uint64_t getHitchCount() const { return m_Hitches; }
+			uint64_t getFrameCount() const { return m_TotalFrames; }
+			const uint32_t* getHistogram() const { return m_Histogram; }
+
+			// hitchFactor : how many times the median a frame has to take to count as a hitch
+			void setHitchFactor(double hitchFactor) { m_HitchFactor = hitchFactor; }
+
+			void dump(std::ostream& out) const;
+
+		private:
+			int sortedWindow(double* out) const;
+
+		private:
+			double m_Window[WindowSize];
+			int m_Next;
+			int m_Count;
+			double m_Median;
+			double m_HitchFactor;
+			uint64_t m_Hitches;
+			uint64_t m_TotalFrames;
+			double m_TotalMs;
+			uint32_t m_Histogram[BucketCount];
+		};
+	}
+}
@@ -0,0 +1,427 @@
+#include "GlyphAtlas.hpp"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Next code point of UTF-8 text, malformed bytes come out as U+FFFD
+	uint32_t decodeUtf8(const uint8_t*& text)
+	{
+		const uint32_t lead = *text++;
+		if (lead < 0x80)
+			return lead;
+		uint32_t count = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+		if (count == 0)
+			return 0xFFFD;
+		uint32_t codePoint = lead & (0x3F >> count);
+		for (; count > 0; --count)
+		{
+			if ((*text & 0xC0) != 0x80)
+				return 0xFFFD;
+			codePoint = (codePoint << 6) | (*text++ & 0x3F);
+		}
+		return codePoint;
+	}
+
+	uint64_t glyphKey(uint32_t glyphIndex, uint32_t pixelSize)
+	{
+		return (static_cast<uint64_t>(pixelSize) << 32) | glyphIndex;
+	}
+}
+
+icy::System::GlyphAtlas::GlyphAtlas()
+{
+	m_Library = nullptr;
+	m_Face = nullptr;
+	m_FaceSize = 0;
+	m_Frame = 1;
+	m_Epoch = 1;
+	m_InstanceCount = 0;
+	m_Stats = {};
+	m_LastStats = {};
+}
+
+icy::System::GlyphAtlas::~GlyphAtlas()
+{
+	destroy();
+}
+
+bool icy::System::GlyphAtlas::create(const char* fontPath)
+{
+	destroy();
+	if (FT_Init_FreeType(&m_Library) != 0)
+	{
+		std::cout << "Failed to initialise FreeType" << std::endl;
+		m_Library = nullptr;
+		return false;
+	}
+	if (FT_New_Face(m_Library, fontPath, 0, &m_Face) != 0)
+	{
+		std::cout << "Failed to load font " << fontPath << std::endl;
+		m_Face = nullptr;
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::GlyphAtlas::destroy()
+{
+	if (m_Face != nullptr)
+		FT_Done_Face(m_Face);
+	if (m_Library != nullptr)
+		FT_Done_FreeType(m_Library);
+	m_Library = nullptr;
+	m_Face = nullptr;
+	m_FaceSize = 0;
+	m_Pages.clear();
+	m_Glyphs.clear();
+	m_Shaped.clear();
+	m_InstanceCount = 0;
+	++m_Epoch;
+}
+
+bool icy::System::GlyphAtlas::addText(const char* text, float x, float y, uint32_t pixelSize, uint32_t color)
+{
+	if (m_Face == nullptr || pixelSize == 0)
+		return false;
+	// FNV-1a of the text and the size, the text is compared too so a collision only costs a layout
+	uint64_t hash = 14695981039346656037ull;
+	for (const char* c = text; *c != '\0'; ++c)
+	{
+		hash ^= static_cast<uint8_t>(*c);
+		hash *= 1099511628211ull;
+	}
+	hash = (hash ^ pixelSize) * 1099511628211ull;
+
+	ShapedText& shaped = m_Shaped[hash];
+	if (shaped.bComplete && shaped.epoch == m_Epoch && shaped.pixelSize == pixelSize && shaped.text == text)
+		++m_Stats.shapeHits;
+	else
+	{
+		shaped.text = text;
+		shaped.pixelSize = pixelSize;
+		shape(shaped);
+		++m_Stats.shapeMisses;
+	}
+	shaped.lastUsedFrame = m_Frame;
+
+	for (uint32_t mask = shaped.pageMask, page = 0; mask != 0; mask >>= 1, ++page)
+	{
+		if (mask & 1)
+			m_Pages[page].lastUsedFrame = m_Frame;
+	}
+	// Whole pixels, glyphs are sampled texel for texel
+	const float originX = std::floor(x + 0.5f);
+	const float originY = std::floor(y + 0.5f);
+	for (const ShapedGlyph& glyph : shaped.glyphs)
+	{
+		GlyphInstance instance;
+		instance.x = originX + glyph.x;
+		instance.y = originY + glyph.y;
+		instance.atlasX = glyph.atlasX;
+		instance.atlasY = glyph.atlasY;
+		instance.width = glyph.width;
+		instance.height = glyph.height;
+		instance.color = color;
+		m_Pages[glyph.page].instances.push_back(instance);
+	}
+	m_InstanceCount += static_cast<uint32_t>(shaped.glyphs.size());
+	m_Stats.glyphs += static_cast<uint32_t>(shaped.glyphs.size());
+	++m_Stats.strings;
+	return shaped.bComplete;
+}
+
+void icy::System::GlyphAtlas::endFrame()
+{
+	for (Page& page : m_Pages)
+		page.instances.clear();
+	m_InstanceCount = 0;
+	m_LastStats = m_Stats;
+	m_Stats = {};
+
+	// Strings that change every frame (counters, timings) would grow the cache forever
+	if (m_Shaped.size() > MaxCachedStrings)
+	{
+		for (auto it = m_Shaped.begin(); it != m_Shaped.end();)
+		{
+			if (it->second.lastUsedFrame < m_Frame)
+				it = m_Shaped.erase(it);
+			else
+				++it;
+		}
+	}
+	++m_Frame;
+}
+
+bool icy::System::GlyphAtlas::takeDirtyRows(uint32_t page, uint32_t& first, uint32_t& count)
+{
+	Page& dirty = m_Pages[page];
+	if (dirty.dirtyFirst >= dirty.dirtyEnd)
+		return false;
+	first = dirty.dirtyFirst;
+	count = dirty.dirtyEnd - dirty.dirtyFirst;
+	dirty.dirtyFirst = PageSize;
+	dirty.dirtyEnd = 0;
+	return true;
+}
+
+void icy::System::GlyphAtlas::shape(ShapedText& shaped)
+{
+	if (m_FaceSize != shaped.pixelSize)
+	{
+		FT_Set_Pixel_Sizes(m_Face, 0, shaped.pixelSize);
+		m_FaceSize = shaped.pixelSize;
+	}
+	const float lineHeight = static_cast<float>(m_Face->size->metrics.height) / 64.0f;
+	const bool bKerning = FT_HAS_KERNING(m_Face) != 0;
+
+	shaped.glyphs.clear();
+	shaped.pageMask = 0;
+	shaped.bComplete = true;
+	float penX = 0.0f;
+	float penY = 0.0f;
+	uint32_t previous = 0;
+	const uint8_t* text = reinterpret_cast<const uint8_t*>(shaped.text.c_str());
+	while (*text != '\0')
+	{
+		const uint32_t codePoint = decodeUtf8(text);
+		if (codePoint == '\n')
+		{
+			penX = 0.0f;
+			penY += lineHeight;
+			previous = 0;
+			continue;
+		}
+		const uint32_t glyphIndex = FT_Get_Char_Index(m_Face, codePoint);
+		if (bKerning && previous != 0 && glyphIndex != 0)
+		{
+			FT_Vector kerning;
+			if (FT_Get_Kerning(m_Face, previous, glyphIndex, FT_KERNING_DEFAULT, &kerning) == 0)
+				penX += static_cast<float>(kerning.x) / 64.0f;
+		}
+		previous = glyphIndex;
+
+		Glyph glyph;
+		if (!findGlyph(glyphIndex, shaped.pixelSize, glyph))
+		{
+			shaped.bComplete = false;
+			++m_Stats.dropped;
+		}
+		else if (glyph.page != InvalidPage)
+		{
+			ShapedGlyph placed;
+			placed.page = glyph.page;
+			placed.x = std::floor(penX + 0.5f) + static_cast<float>(glyph.left);
+			placed.y = penY + static_cast<float>(glyph.top);
+			placed.atlasX = glyph.atlasX;
+			placed.atlasY = glyph.atlasY;
+			placed.width = glyph.width;
+			placed.height = glyph.height;
+			shaped.glyphs.push_back(placed);
+			shaped.pageMask |= 1u << glyph.page;
+		}
+		penX += glyph.advance;
+	}
+	// Pages cleared while packing this string's glyphs can't have held any of them, they were all in use
+	shaped.epoch = m_Epoch;
+}
+
+bool icy::System::GlyphAtlas::findGlyph(uint32_t glyphIndex, uint32_t pixelSize, Glyph& glyph)
+{
+	const uint64_t key = glyphKey(glyphIndex, pixelSize);
+	auto found = m_Glyphs.find(key);
+	if (found != m_Glyphs.end())
+	{
+		glyph = found->second;
+		if (glyph.page != InvalidPage)
+			m_Pages[glyph.page].lastUsedFrame = m_Frame;
+		return true;
+	}
+
+	glyph = {};
+	glyph.page = InvalidPage;
+	if (FT_Load_Glyph(m_Face, glyphIndex, FT_LOAD_RENDER) != 0)
+	{
+		// Kept as an empty glyph so it isn't loaded again every frame
+		m_Glyphs[key] = glyph;
+		return true;
+	}
+	const FT_GlyphSlot slot = m_Face->glyph;
+	const FT_Bitmap& bitmap = slot->bitmap;
+	glyph.advance = static_cast<float>(slot->advance.x) / 64.0f;
+	glyph.left = slot->bitmap_left;
+	glyph.top = -slot->bitmap_top;
+	if (bitmap.width == 0 || bitmap.rows == 0)
+	{
+		m_Glyphs[key] = glyph;
+		return true;
+	}
+
+	uint32_t page = 0;
+	uint32_t x = 0;
+	uint32_t y = 0;
+	if (!pack(bitmap.width + Padding, bitmap.rows + Padding, page, x, y))
+		return false;
+	Page& target = m_Pages[page];
+	for (uint32_t row = 0; row < bitmap.rows; ++row)
+		std::memcpy(&target.pixels[(y + row) * PageSize + x], bitmap.buffer + static_cast<ptrdiff_t>(row) * bitmap.pitch, bitmap.width);
+	target.dirtyFirst = std::min(target.dirtyFirst, y);
+	target.dirtyEnd = std::max(target.dirtyEnd, y + bitmap.rows);
+	target.glyphs.push_back(key);
+	target.lastUsedFrame = m_Frame;
+
+	glyph.page = page;
+	glyph.atlasX = static_cast<uint16_t>(x);
+	glyph.atlasY = static_cast<uint16_t>(y);
+	glyph.width = static_cast<uint16_t>(bitmap.width);
+	glyph.height = static_cast<uint16_t>(bitmap.rows);
+	m_Glyphs[key] = glyph;
+	++m_Stats.rasterized;
+	return true;
+}
+
+bool icy::System::GlyphAtlas::pack(uint32_t width, uint32_t height, uint32_t& page, uint32_t& x, uint32_t& y)
+{
+	if (width > PageSize || height > PageSize)
+		return false;
+	// Once every page is open the next one to clear is the least recently used page without a glyph of this frame on
+	// it. It takes no glyphs until then, glyphs packed into its gaps would keep it from ever being cleared
+	uint32_t victim = InvalidPage;
+	if (m_Pages.size() == MaxPages)
+	{
+		for (uint32_t i = 0; i < MaxPages; ++i)
+		{
+			if (m_Pages[i].lastUsedFrame < m_Frame && (victim == InvalidPage || m_Pages[i].lastUsedFrame < m_Pages[victim].lastUsedFrame))
+				victim = i;
+		}
+	}
+	// Most recently used pages first, so a frame's glyphs gather on few pages and the others age out
+	uint32_t order[MaxPages];
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < m_Pages.size(); ++i)
+	{
+		if (i != victim)
+			order[count++] = i;
+	}
+	std::sort(order, order + count, [this](uint32_t a, uint32_t b) { return m_Pages[a].lastUsedFrame > m_Pages[b].lastUsedFrame; });
+	size_t node = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		page = order[i];
+		if (findPosition(m_Pages[page], width, height, node, x, y))
+		{
+			place(m_Pages[page], node, x, y, width, height);
+			return true;
+		}
+	}
+
+	if (m_Pages.size() < MaxPages)
+	{
+		page = static_cast<uint32_t>(m_Pages.size());
+		openPage();
+	}
+	else if (victim != InvalidPage)
+	{
+		page = victim;
+		clearPage(page);
+	}
+	else
+		return false;
+	if (!findPosition(m_Pages[page], width, height, node, x, y))
+		return false;
+	place(m_Pages[page], node, x, y, width, height);
+	return true;
+}
+
+bool icy::System::GlyphAtlas::findPosition(const Page& page, uint32_t width, uint32_t height, size_t& node, uint32_t& x, uint32_t& y) const
+{
+	// Lowest top over every node the rectangle could start at, the narrower node on ties
+	uint32_t bestY = PageSize;
+	uint32_t bestWidth = PageSize + 1;
+	const std::vector<SkylineNode>& skyline = page.skyline;
+	for (size_t i = 0; i < skyline.size() && skyline[i].x + width <= PageSize; ++i)
+	{
+		uint32_t top = 0;
+		uint32_t remaining = width;
+		for (size_t j = i; remaining > 0; ++j)
+		{
+			top = std::max(top, skyline[j].y);
+			remaining -= std::min(remaining, skyline[j].width);
+		}
+		if (top + height > PageSize)
+			continue;
+		if (top < bestY || (top == bestY && skyline[i].width < bestWidth))
+		{
+			bestY = top;
+			bestWidth = skyline[i].width;
+			node = i;
+			x = skyline[i].x;
+			y = top;
+		}
+	}
+	return bestWidth <= PageSize;
+}
+
+void icy::System::GlyphAtlas::place(Page& page, size_t node, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	std::vector<SkylineNode>& skyline = page.skyline;
+	skyline.insert(skyline.begin() + node, SkylineNode{ x, y + height, width });
+	// Cut the nodes the new one covers
+	for (size_t i = node + 1; i < skyline.size();)
+	{
+		const uint32_t end = skyline[i - 1].x + skyline[i - 1].width;
+		if (skyline[i].x >= end)
+			break;
+		const uint32_t shrink = end - skyline[i].x;
+		if (skyline[i].width <= shrink)
+		{
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+		skyline[i].x += shrink;
+		skyline[i].width -= shrink;
+		break;
+	}
+	// Merge neighbours at the same height
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+			++i;
+	}
+}
+
+void icy::System::GlyphAtlas::openPage()
+{
+	m_Pages.emplace_back();
+	Page& page = m_Pages.back();
+	page.pixels.assign(PageSize * PageSize, 0);
+	page.skyline.push_back(SkylineNode{ 0, 0, PageSize });
+	page.lastUsedFrame = 0;
+	page.dirtyFirst = PageSize;
+	page.dirtyEnd = 0;
+}
+
+void icy::System::GlyphAtlas::clearPage(uint32_t page)
+{
+	Page& cleared = m_Pages[page];
+	for (uint64_t key : cleared.glyphs)
+		m_Glyphs.erase(key);
+	cleared.glyphs.clear();
+	// Nothing samples texels outside a glyph's rectangle, only the CPU copy needs clearing
+	std::fill(cleared.pixels.begin(), cleared.pixels.end(), static_cast<uint8_t>(0));
+	cleared.skyline.clear();
+	cleared.skyline.push_back(SkylineNode{ 0, 0, PageSize });
+	// Every layout that placed a glyph here is stale
+	++m_Epoch;
+	++m_Stats.evictions;
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+namespace icy
+{
+	namespace System
+	{
+		// One glyph quad as Engine\Shaders\text.vert reads it (std430, 20 bytes)
+		struct GlyphInstance
+		{
+			// Top left corner in pixels, from the top left of the target
+			float x;
+			float y;
+			// Rectangle of the glyph in its atlas page, in texels
+			uint16_t atlasX;
+			uint16_t atlasY;
+			uint16_t width;
+			uint16_t height;
+			// RGBA8, red in the lowest byte
+			uint32_t color;
+		};
+
+		// Counted from one endFrame() to the next
+		struct TextStats
+		{
+			// Glyphs and strings added
+			uint32_t glyphs;
+			uint32_t strings;
+			// Strings whose layout came out of the shaping cache, and those that had to be shaped
+			uint32_t shapeHits;
+			uint32_t shapeMisses;
+			// Glyphs rasterized into the atlas
+			uint32_t rasterized;
+			// Pages cleared to make room
+			uint32_t evictions;
+			// Glyphs left out because every page was in use this frame
+			uint32_t dropped;
+		};
+
+		// CPU side of the text renderers, shared by OpenGLTextRenderer and VulkanTextRenderer
+		// Glyphs are rasterized with FreeType the first time a size of them is drawn and packed into R8 atlas pages with a
+		// skyline packer. When a glyph fits nowhere a new page is opened, past MaxPages the least recently used page no
+		// glyph of this frame is on is cleared and packed again. Laid out strings are cached, so a string drawn again only
+		// copies its quads into the per page instance lists the renderers draw with one instanced draw per page
+		class GlyphAtlas
+		{
+		public:
+			static constexpr uint32_t PageSize = 1024;
+			static constexpr uint32_t MaxPages = 4;
+			// Laid out strings kept past the frame they were last drawn in, beyond it the unused ones are dropped
+			static constexpr uint32_t MaxCachedStrings = 4096;
+
+			GlyphAtlas();
+			~GlyphAtlas();
+			GlyphAtlas(const GlyphAtlas&) = delete;
+			GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+			// fontPath : any font FreeType reads, the first face is used
+			bool create(const char* fontPath);
+			void destroy();
+			bool isCreated() const { return m_Face != nullptr; }
+
+			// Lays out UTF-8 text with kerning and adds its glyphs to this frame, '\n' starts a new line
+			// x, y : pen position on the baseline of the first line, in pixels from the top left of the target
+			// pixelSize : em height in pixels, color : RGBA8 with red in the lowest byte
+			// Returns false if a glyph had to be left out, see TextStats::dropped
+			bool addText(const char* text, float x, float y, uint32_t pixelSize, uint32_t color);
+			// Forgets this frame's glyphs, the renderers call it once they drew them
+			void endFrame();
+
+			// Pages opened so far, pages and their instance lists are indexed below it
+			uint32_t getPageCount() const { return static_cast<uint32_t>(m_Pages.size()); }
+			const std::vector<GlyphInstance>& getInstances(uint32_t page) const { return m_Pages[page].instances; }
+			uint32_t getInstanceCount() const { return m_InstanceCount; }
+			// PageSize x PageSize coverage, one byte per texel
+			const uint8_t* getPixels(uint32_t page) const { return m_Pages[page].pixels.data(); }
+			// Rows of page written since the last call, the renderers upload them before drawing
+			// Returns false if nothing changed
+			bool takeDirtyRows(uint32_t page, uint32_t& first, uint32_t& count);
+			// The frame so far, and the last one endFrame() finished
+			const TextStats& getStats() const { return m_Stats; }
+			const TextStats& getLastStats() const { return m_LastStats; }
+
+		private:
+			struct Glyph
+			{
+				// InvalidPage for glyphs without pixels, like spaces
+				uint32_t page;
+				uint16_t atlasX;
+				uint16_t atlasY;
+				uint16_t width;
+				uint16_t height;
+				// Offset of the bitmap's top left from the pen
+				int32_t left;
+				int32_t top;
+				float advance;
+			};
+			struct SkylineNode
+			{
+				uint32_t x;
+				uint32_t y;
+				uint32_t width;
+			};
+			struct Page
+			{
+				std::vector<uint8_t> pixels;
+				std::vector<SkylineNode> skyline;
+				// Glyph keys packed into the page, forgotten when it is cleared
+				std::vector<uint64_t> glyphs;
+				std::vector<GlyphInstance> instances;
+				uint64_t lastUsedFrame;
+				uint32_t dirtyFirst;
+				uint32_t dirtyEnd;
+			};
+			// A glyph of a laid out string, placed relative to the string's pen position
+			struct ShapedGlyph
+			{
+				uint32_t page;
+				float x;
+				float y;
+				uint16_t atlasX;
+				uint16_t atlasY;
+				uint16_t width;
+				uint16_t height;
+			};
+			struct ShapedText
+			{
+				std::string text;
+				uint32_t pixelSize;
+				// Atlas placements are only valid while no page was cleared since the layout
+				uint64_t epoch;
+				uint64_t lastUsedFrame;
+				// Bit per page the glyphs are on
+				uint32_t pageMask;
+				bool bComplete;
+				std::vector<ShapedGlyph> glyphs;
+			};
+
+			static constexpr uint32_t InvalidPage = 0xFFFFFFFFu;
+			static constexpr uint32_t Padding = 1;
+
+			void shape(ShapedText& shaped);
+			// The glyph at the current face size, rasterized and packed the first time
+			// Returns false if it fits nowhere, glyph still has its advance then
+			bool findGlyph(uint32_t glyphIndex, uint32_t pixelSize, Glyph& glyph);
+			bool pack(uint32_t width, uint32_t height, uint32_t& page, uint32_t& x, uint32_t& y);
+			// Bottom left skyline position for a width x height rectangle, returns false if it doesn't fit
+			bool findPosition(const Page& page, uint32_t width, uint32_t height, size_t& node, uint32_t& x, uint32_t& y) const;
+			void place(Page& page, size_t node, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+			void openPage();
+			void clearPage(uint32_t page);
+
+		private:
+			FT_LibraryRec_* m_Library;
+			FT_FaceRec_* m_Face;
+			uint32_t m_FaceSize;
+			std::vector<Page> m_Pages;
+			// Glyph index and pixel size to its atlas placement
+			std::unordered_map<uint64_t, Glyph> m_Glyphs;
+			// Hash of the text and size to its layout
+			std::unordered_map<uint64_t, ShapedText> m_Shaped;
+			uint64_t m_Frame;
+			uint64_t m_Epoch;
+			uint32_t m_InstanceCount;
+			TextStats m_Stats;
+			TextStats m_LastStats;
+		};
+	}
+}
\ No newline at end of file
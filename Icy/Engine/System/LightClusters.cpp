@@ -0,0 +1,238 @@
+#include "LightClusters.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+static_assert(sizeof(icy::System::ClusterLight) == 64, "Has to match the std430 Light struct");
+static_assert(sizeof(icy::System::ClusterParams) == 112, "Has to match the std140 ClusterParams block");
+
+namespace
+{
+	// A light in view space, with the sphere around everything it can reach
+	struct ViewLight
+	{
+		float center[3];
+		float radius;
+		float apex[3];
+		float range;
+		float direction[3];
+		float cosOuter;
+		float sinOuter;
+		bool spot;
+	};
+
+	void transformPoint(const float* m, const float* p, float* out)
+	{
+		for (int i = 0; i < 3; ++i)
+			out[i] = m[i] * p[0] + m[4 + i] * p[1] + m[8 + i] * p[2] + m[12 + i];
+	}
+
+	void transformDirection(const float* m, const float* d, float* out)
+	{
+		for (int i = 0; i < 3; ++i)
+			out[i] = m[i] * d[0] + m[4 + i] * d[1] + m[8 + i] * d[2];
+	}
+
+	// Same steps as the light staging of lightclusters.comp
+	ViewLight toViewSpace(const icy::System::ClusterLight& light, const float* view)
+	{
+		ViewLight result;
+		transformPoint(view, light.position, result.apex);
+		transformDirection(view, light.direction, result.direction);
+		result.range = light.range;
+		result.cosOuter = light.cosOuter;
+		result.sinOuter = std::sqrt(std::max(0.0f, 1.0f - light.cosOuter * light.cosOuter));
+		result.spot = light.type == icy::System::LightType::Spot;
+		float offset = 0.0f;
+		result.radius = light.range;
+		if (result.spot)
+		{
+			// Smallest sphere around the cone, wide cones are bounded by their cap
+			if (light.cosOuter < 0.70710678f)
+			{
+				offset = light.range * light.cosOuter;
+				result.radius = light.range * result.sinOuter;
+			}
+			else
+			{
+				offset = light.range / (2.0f * light.cosOuter);
+				result.radius = offset;
+			}
+		}
+		for (int i = 0; i < 3; ++i)
+			result.center[i] = result.apex[i] + result.direction[i] * offset;
+		return result;
+	}
+
+	// Same test as lightAffectsCluster in lightclusters.comp
+	bool affects(const ViewLight& light, const float* boxMin, const float* boxMax)
+	{
+		float distanceSq = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			float d = std::max(std::max(boxMin[i] - light.center[i], 0.0f), light.center[i] - boxMax[i]);
+			distanceSq += d * d;
+		}
+		if (distanceSq > light.radius * light.radius)
+			return false;
+		if (!light.spot)
+			return true;
+
+		// Cone against the sphere around the cluster
+		float toCluster[3];
+		float lengthSq = 0.0f;
+		float along = 0.0f;
+		float clusterRadiusSq = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			float center = (boxMin[i] + boxMax[i]) * 0.5f;
+			float half = (boxMax[i] - boxMin[i]) * 0.5f;
+			toCluster[i] = center - light.apex[i];
+			lengthSq += toCluster[i] * toCluster[i];
+			along += toCluster[i] * light.direction[i];
+			clusterRadiusSq += half * half;
+		}
+		float clusterRadius = std::sqrt(clusterRadiusSq);
+		float closest = light.cosOuter * std::sqrt(std::max(lengthSq - along * along, 0.0f)) - along * light.sinOuter;
+		return !(closest > clusterRadius || along > clusterRadius + light.range || along < -clusterRadius);
+	}
+
+	// View space bounds of cluster (x, y, z), same steps as clusterBounds in lightclusters.comp
+	void clusterBounds(const icy::System::ClusterParams& params, uint32_t x, uint32_t y, uint32_t z, float* boxMin, float* boxMax)
+	{
+		float nearDepth = std::exp((static_cast<float>(z) - params.sliceBias) / params.sliceScale);
+		float farDepth = std::exp((static_cast<float>(z + 1) - params.sliceBias) / params.sliceScale);
+		float x0 = (-1.0f + 2.0f * static_cast<float>(x) / static_cast<float>(params.gridSize[0])) * params.tanHalfFovX;
+		float x1 = (-1.0f + 2.0f * static_cast<float>(x + 1) / static_cast<float>(params.gridSize[0])) * params.tanHalfFovX;
+		float y0 = (-1.0f + 2.0f * static_cast<float>(y) / static_cast<float>(params.gridSize[1])) * params.tanHalfFovY;
+		float y1 = (-1.0f + 2.0f * static_cast<float>(y + 1) / static_cast<float>(params.gridSize[1])) * params.tanHalfFovY;
+		// The tile's side planes fan out from the eye, the box has to hold both ends of the slice
+		boxMin[0] = std::min(x0 * nearDepth, x0 * farDepth);
+		boxMax[0] = std::max(x1 * nearDepth, x1 * farDepth);
+		boxMin[1] = std::min(y0 * nearDepth, y0 * farDepth);
+		boxMax[1] = std::max(y1 * nearDepth, y1 * farDepth);
+		boxMin[2] = -farDepth;
+		boxMax[2] = -nearDepth;
+	}
+}
+
+icy::System::LightClusterer::LightClusterer()
+{
+	m_Stats = {};
+}
+
+void icy::System::LightClusterer::fillParams(const ClusterCamera& camera, uint32_t lightCount, ClusterParams& params)
+{
+	std::memcpy(params.view, camera.view, sizeof(params.view));
+	params.tanHalfFovX = camera.tanHalfFovX;
+	params.tanHalfFovY = camera.tanHalfFovY;
+	params.nearPlane = camera.nearPlane;
+	params.farPlane = camera.farPlane;
+	params.width = camera.width;
+	params.height = camera.height;
+	const float logRange = std::log(camera.farPlane / camera.nearPlane);
+	params.sliceScale = static_cast<float>(ClusterCountZ) / logRange;
+	params.sliceBias = -static_cast<float>(ClusterCountZ) * std::log(camera.nearPlane) / logRange;
+	params.gridSize[0] = ClusterCountX;
+	params.gridSize[1] = ClusterCountY;
+	params.gridSize[2] = ClusterCountZ;
+	params.lightCount = lightCount;
+}
+
+uint32_t icy::System::LightClusterer::getClusterIndex(const ClusterParams& params, float x, float y, float viewDepth)
+{
+	uint32_t tileX = std::min(static_cast<uint32_t>(std::max(x, 0.0f) / params.width * params.gridSize[0]), params.gridSize[0] - 1);
+	uint32_t tileY = std::min(static_cast<uint32_t>(std::max(y, 0.0f) / params.height * params.gridSize[1]), params.gridSize[1] - 1);
+	float slice = std::floor(std::log(std::max(viewDepth, params.nearPlane)) * params.sliceScale + params.sliceBias);
+	uint32_t tileZ = static_cast<uint32_t>(std::min(std::max(slice, 0.0f), static_cast<float>(params.gridSize[2] - 1)));
+	return tileX + params.gridSize[0] * (tileY + params.gridSize[1] * tileZ);
+}
+
+void icy::System::LightClusterer::build(const ClusterLight* lights, uint32_t count, const ClusterParams& params)
+{
+	ICY_PROFILE_FUNCTION();
+	auto start = std::chrono::steady_clock::now();
+	std::vector<ViewLight> viewLights(count);
+	for (uint32_t i = 0; i < count; ++i)
+		viewLights[i] = toViewSpace(lights[i], params.view);
+
+	m_Grid.assign(ClusterCount, ClusterRange{ 0, 0 });
+	m_Indices.clear();
+	m_Indices.reserve(ClusterIndexCapacity);
+	uint32_t overflowed = 0;
+	uint32_t clusterLights[MaxLightsPerCluster];
+	for (uint32_t z = 0; z < ClusterCountZ; ++z)
+	{
+		for (uint32_t y = 0; y < ClusterCountY; ++y)
+		{
+			for (uint32_t x = 0; x < ClusterCountX; ++x)
+			{
+				float boxMin[3];
+				float boxMax[3];
+				clusterBounds(params, x, y, z, boxMin, boxMax);
+				uint32_t found = 0;
+				bool full = false;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					if (!affects(viewLights[i], boxMin, boxMax))
+						continue;
+					if (found == MaxLightsPerCluster)
+					{
+						full = true;
+						break;
+					}
+					clusterLights[found++] = i;
+				}
+				// A cluster that doesn't fit in the index list gets no lights at all, like on the GPU
+				if (m_Indices.size() + found > ClusterIndexCapacity)
+				{
+					full = true;
+					found = 0;
+				}
+				if (full)
+					++overflowed;
+				ClusterRange& range = m_Grid[x + ClusterCountX * (y + ClusterCountY * z)];
+				range.offset = static_cast<uint32_t>(m_Indices.size());
+				range.count = found;
+				m_Indices.insert(m_Indices.end(), clusterLights, clusterLights + found);
+			}
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	m_Stats = computeStats(m_Grid.data(), count);
+	m_Stats.overflowed = overflowed;
+	m_Stats.buildMs = elapsed.count();
+}
+
+uint32_t icy::System::LightClusterer::compare(const ClusterRange* grid, const uint32_t* indices, uint32_t indexCount) const
+{
+	uint32_t different = 0;
+	for (uint32_t i = 0; i < ClusterCount; ++i)
+	{
+		const ClusterRange& expected = m_Grid[i];
+		const ClusterRange& actual = grid[i];
+		if (actual.count != expected.count || actual.count > indexCount || actual.offset > indexCount - actual.count ||
+			!std::equal(indices + actual.offset, indices + actual.offset + actual.count, m_Indices.data() + expected.offset))
+			++different;
+	}
+	return different;
+}
+
+icy::System::ClusterStats icy::System::LightClusterer::computeStats(const ClusterRange* grid, uint32_t lightCount)
+{
+	ClusterStats stats = {};
+	stats.lights = lightCount;
+	for (uint32_t i = 0; i < ClusterCount; ++i)
+	{
+		if (grid[i].count == 0)
+			continue;
+		++stats.occupied;
+		stats.indices += grid[i].count;
+		stats.maxLights = std::max(stats.maxLights, grid[i].count);
+	}
+	stats.averageLights = stats.occupied > 0 ? static_cast<float>(stats.indices) / static_cast<float>(stats.occupied) : 0.0f;
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		enum class LightType : uint32_t
+		{
+			Point,
+			Spot
+		};
+
+		// One light as Engine\Shaders\lightclusters.comp and clustered.glsl read it (std430, 64 bytes), in world space
+		struct ClusterLight
+		{
+			float position[3];
+			// Distance at which the light has faded to nothing, nothing past it is lit
+			float range;
+			// Spot lights only, normalised
+			float direction[3];
+			// Cosine of the spot's outer half angle, where it has faded to nothing
+			float cosOuter;
+			float color[3];
+			float intensity;
+			LightType type;
+			// Cosine of the spot's inner half angle, where it starts to fade
+			float cosInner;
+			float pad[2];
+		};
+
+		// The perspective camera the froxels are cut from
+		struct ClusterCamera
+		{
+			// World to view, column major, looking down -z
+			float view[16];
+			// tan of half the horizontal and vertical field of view
+			float tanHalfFovX;
+			float tanHalfFovY;
+			float nearPlane;
+			float farPlane;
+			// Framebuffer size in pixels, the fragment shaders find their cluster from gl_FragCoord
+			float width;
+			float height;
+		};
+
+		// The ClusterParams uniform block of lightclusters.comp and clustered.glsl (std140)
+		struct ClusterParams
+		{
+			float view[16];
+			float tanHalfFovX;
+			float tanHalfFovY;
+			float nearPlane;
+			float farPlane;
+			float width;
+			float height;
+			// Depth slice of a view depth d is floor(log(d) * sliceScale + sliceBias)
+			float sliceScale;
+			float sliceBias;
+			uint32_t gridSize[3];
+			uint32_t lightCount;
+		};
+
+		// Where a cluster's lights sit in the index list
+		struct ClusterRange
+		{
+			uint32_t offset;
+			uint32_t count;
+		};
+
+		struct ClusterStats
+		{
+			uint32_t lights;
+			// Clusters with at least one light
+			uint32_t occupied;
+			// Entries of the index list in use
+			uint32_t indices;
+			uint32_t maxLights;
+			// Over the occupied clusters
+			float averageLights;
+			// Clusters that had more lights than MaxLightsPerCluster or found the index list full
+			uint32_t overflowed;
+			// Time building the grid took, on the CPU or the GPU depending on who filled the stats
+			double buildMs;
+		};
+
+		// Froxel grid, tiles of the screen split in depth slices that grow exponentially from the near plane
+		static constexpr uint32_t ClusterCountX = 16;
+		static constexpr uint32_t ClusterCountY = 9;
+		static constexpr uint32_t ClusterCountZ = 24;
+		static constexpr uint32_t ClusterCount = ClusterCountX * ClusterCountY * ClusterCountZ;
+		// Lights one update can bin
+		static constexpr uint32_t ClusterMaxLights = 4096;
+		// Lights beyond this in one cluster are dropped, in light order
+		static constexpr uint32_t MaxLightsPerCluster = 64;
+		// The index list has room for this many lights per cluster on average
+		static constexpr uint32_t ClusterIndexCapacity = ClusterCount * 32;
+		// Clusters per workgroup of lightclusters.comp, also the lights it stages in shared memory at once
+		static constexpr uint32_t ClusterWorkgroupSize = 128;
+		// The counter block of the index list: entries in use and clusters that overflowed
+		static constexpr uint32_t ClusterCounterSize = 16;
+
+		// The CPU side of clustered forward lighting, shared by the Vulkan and OpenGL backends
+		// Fills the constants the binning pass and the fragment shaders read, and bins the lights on the CPU the
+		// same way lightclusters.comp does, as a reference to test the GPU grid against
+		class LightClusterer
+		{
+		public:
+			LightClusterer();
+
+			static void fillParams(const ClusterCamera& camera, uint32_t lightCount, ClusterParams& params);
+			// Cluster a fragment at pixel (x, y) from the bottom left and view depth (distance along -z) falls in
+			static uint32_t getClusterIndex(const ClusterParams& params, float x, float y, float viewDepth);
+
+			// Bins count lights into the grid, clusters list their lights in ascending light order
+			void build(const ClusterLight* lights, uint32_t count, const ClusterParams& params);
+			const std::vector<ClusterRange>& getGrid() const { return m_Grid; }
+			const std::vector<uint32_t>& getIndices() const { return m_Indices; }
+			const ClusterStats& getStats() const { return m_Stats; }
+
+			// Clusters whose light list differs from the last build()
+			// The GPU hands out offsets in whatever order its atomics ran, only the lists are compared
+			uint32_t compare(const ClusterRange* grid, const uint32_t* indices, uint32_t indexCount) const;
+
+			// overflowed and buildMs are left to the caller
+			static ClusterStats computeStats(const ClusterRange* grid, uint32_t lightCount);
+
+		private:
+			std::vector<ClusterRange> m_Grid;
+			std::vector<uint32_t> m_Indices;
+			ClusterStats m_Stats;
+		};
+	}
+}
\ No newline at end of file
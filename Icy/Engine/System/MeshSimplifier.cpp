@@ -0,0 +1,648 @@
+#include "MeshSimplifier.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	// Bit pattern of a position, vertices are only welded when they match exactly
+	struct PositionKey
+	{
+		uint32_t bits[3];
+		bool operator==(const PositionKey& other) const { return std::memcmp(bits, other.bits, sizeof(bits)) == 0; }
+	};
+	struct PositionHash
+	{
+		size_t operator()(const PositionKey& key) const { return key.bits[0] * 73856093u ^ key.bits[1] * 19349663u ^ key.bits[2] * 83492791u; }
+	};
+
+	void cross(const double* a, const double* b, double* result)
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	// Unnormalised normal of the triangle abc
+	void triangleNormal(const float* a, const float* b, const float* c, double* normal)
+	{
+		const double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		cross(ab, ac, normal);
+	}
+
+	// Distance from p to the triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+	double pointTriangleDistance(const float* p, const float* a, const float* b, const float* c)
+	{
+		double ab[3], ac[3], ap[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			ab[i] = b[i] - a[i];
+			ac[i] = c[i] - a[i];
+			ap[i] = p[i] - a[i];
+		}
+		auto dot = [](const double* x, const double* y) { return x[0] * y[0] + x[1] * y[1] + x[2] * y[2]; };
+		double closest[3];
+		const double d1 = dot(ab, ap);
+		const double d2 = dot(ac, ap);
+		const double bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+		const double d3 = dot(ab, bp);
+		const double d4 = dot(ac, bp);
+		const double cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+		const double d5 = dot(ab, cp);
+		const double d6 = dot(ac, cp);
+		const double va = d3 * d6 - d5 * d4;
+		const double vb = d5 * d2 - d1 * d6;
+		const double vc = d1 * d4 - d3 * d2;
+		if (d1 <= 0.0 && d2 <= 0.0)
+		{
+			for (int i = 0; i < 3; ++i)
+				closest[i] = a[i];
+		}
+		else if (d3 >= 0.0 && d4 <= d3)
+		{
+			for (int i = 0; i < 3; ++i)
+				closest[i] = b[i];
+		}
+		else if (d6 >= 0.0 && d5 <= d6)
+		{
+			for (int i = 0; i < 3; ++i)
+				closest[i] = c[i];
+		}
+		else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+		{
+			const double v = d1 / (d1 - d3);
+			for (int i = 0; i < 3; ++i)
+				closest[i] = a[i] + v * ab[i];
+		}
+		else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+		{
+			const double w = d2 / (d2 - d6);
+			for (int i = 0; i < 3; ++i)
+				closest[i] = a[i] + w * ac[i];
+		}
+		else if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+		{
+			const double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			for (int i = 0; i < 3; ++i)
+				closest[i] = b[i] + w * (c[i] - b[i]);
+		}
+		else
+		{
+			const double denominator = 1.0 / (va + vb + vc);
+			const double v = vb * denominator;
+			const double w = vc * denominator;
+			for (int i = 0; i < 3; ++i)
+				closest[i] = a[i] + ab[i] * v + ac[i] * w;
+		}
+		const double offset[3] = { p[0] - closest[0], p[1] - closest[1], p[2] - closest[2] };
+		return std::sqrt(dot(offset, offset));
+	}
+
+	// Border edges are held by a plane through them, perpendicular to their triangle and this much heavier than its area
+	const double BorderWeight = 10.0;
+	// Cells along the longest side of the grid measureDistance buckets triangles into
+	const uint32_t MaxGridCells = 128;
+}
+
+icy::System::MeshSimplifier::MeshSimplifier()
+{
+	m_Positions = nullptr;
+	m_Stride = 0;
+	m_TriangleCount = 0;
+	m_Error = 0.0f;
+}
+
+void icy::System::MeshSimplifier::setMesh(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	m_Positions = reinterpret_cast<const uint8_t*>(positions);
+	m_Stride = stride;
+	m_Triangles.assign(indices, indices + indexCount / 3 * 3);
+	m_TriangleCount = indexCount / 3;
+	m_Removed.assign(m_TriangleCount, false);
+	m_Error = 0.0f;
+	m_Queue = decltype(m_Queue)();
+
+	// Weld by position, a position held by several vertices is an attribute seam and stays where it is
+	m_Canonical.resize(vertexCount);
+	m_Locked.assign(vertexCount, false);
+	std::unordered_map<PositionKey, uint32_t, PositionHash> welded;
+	welded.reserve(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		PositionKey key;
+		std::memcpy(key.bits, position(i), sizeof(key.bits));
+		auto inserted = welded.insert({ key, i });
+		m_Canonical[i] = inserted.first->second;
+		if (!inserted.second)
+			m_Locked[inserted.first->second] = true;
+	}
+
+	m_Quadrics.assign(vertexCount, Quadric());
+	m_VertexTriangles.assign(vertexCount, std::vector<uint32_t>());
+	m_Versions.assign(vertexCount, 0);
+	m_Border.assign(vertexCount, false);
+	m_CollapsedInto.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+		m_CollapsedInto[i] = i;
+	for (uint32_t t = 0; t < m_TriangleCount; ++t)
+	{
+		const uint32_t* corners = &m_Triangles[t * 3];
+		double normal[3];
+		triangleNormal(position(corners[0]), position(corners[1]), position(corners[2]), normal);
+		const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int i = 0; i < 3; ++i)
+			m_VertexTriangles[m_Canonical[corners[i]]].push_back(t);
+		if (length == 0.0)
+			continue;
+		const float* a = position(corners[0]);
+		const double n[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+		const double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+		for (int i = 0; i < 3; ++i)
+			addPlane(m_Quadrics[m_Canonical[corners[i]]], n[0], n[1], n[2], d, length * 0.5, length * 0.5);
+	}
+
+	// Edges held by a single triangle are open borders
+	for (uint32_t t = 0; t < m_TriangleCount; ++t)
+	{
+		const uint32_t* corners = &m_Triangles[t * 3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const uint32_t a = m_Canonical[corners[i]];
+			const uint32_t b = m_Canonical[corners[(i + 1) % 3]];
+			if (countSharedTriangles(a, b) != 1)
+				continue;
+			m_Border[a] = m_Border[b] = true;
+			const float* pa = position(a);
+			const float* pb = position(b);
+			double normal[3];
+			triangleNormal(position(corners[0]), position(corners[1]), position(corners[2]), normal);
+			const double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+			double side[3];
+			cross(edge, normal, side);
+			const double length = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+			if (length == 0.0)
+				continue;
+			const double n[3] = { side[0] / length, side[1] / length, side[2] / length };
+			const double d = -(n[0] * pa[0] + n[1] * pa[1] + n[2] * pa[2]);
+			const double scale = BorderWeight * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+			// Only adds to the error, the average is still over the triangles' area
+			addPlane(m_Quadrics[a], n[0], n[1], n[2], d, scale, 0.0);
+			addPlane(m_Quadrics[b], n[0], n[1], n[2], d, scale, 0.0);
+		}
+	}
+
+	for (uint32_t t = 0; t < m_TriangleCount; ++t)
+	{
+		const uint32_t* corners = &m_Triangles[t * 3];
+		for (int i = 0; i < 3; ++i)
+			pushEdge(m_Canonical[corners[i]], m_Canonical[corners[(i + 1) % 3]]);
+	}
+}
+
+
+float icy::System::MeshSimplifier::simplify(uint32_t targetIndexCount, float maxError)
+{
+	ICY_PROFILE_FUNCTION();
+	while (m_TriangleCount * 3 > targetIndexCount && !m_Queue.empty())
+	{
+		const Collapse next = m_Queue.top();
+		if (next.error > maxError)
+			break;
+		m_Queue.pop();
+		// Either end changed since the cost was worked out, a fresh entry is in the queue if the edge still exists
+		if (m_CollapsedInto[next.from] != next.from || m_CollapsedInto[next.to] != next.to || m_Versions[next.from] != next.fromVersion || m_Versions[next.to] != next.toVersion)
+			continue;
+		if (!canCollapse(next.from, next.to) || breaksLink(next.from, next.to) || flipsTriangle(next.from, next.to))
+			continue;
+		collapse(next.from, next.to);
+		m_Error = std::max(m_Error, next.error);
+	}
+	return m_Error;
+}
+
+void icy::System::MeshSimplifier::getIndices(std::vector<uint32_t>& indices) const
+{
+	indices.clear();
+	indices.reserve(m_TriangleCount * 3);
+	for (size_t t = 0; t < m_Removed.size(); ++t)
+	{
+		if (!m_Removed[t])
+			indices.insert(indices.end(), &m_Triangles[t * 3], &m_Triangles[t * 3] + 3);
+	}
+}
+
+float icy::System::MeshSimplifier::measureDistance() const
+{
+	// Bucket the live triangles into a uniform grid over the mesh with cells about as wide as an average triangle, so each
+	// vertex only tests the triangles in the cells around it
+	const uint32_t vertexCount = static_cast<uint32_t>(m_CollapsedInto.size());
+	if (m_TriangleCount == 0 || vertexCount == 0)
+		return 0.0f;
+	float lower[3];
+	float upper[3];
+	std::memcpy(lower, position(0), sizeof(lower));
+	std::memcpy(upper, position(0), sizeof(upper));
+	for (uint32_t vertex = 1; vertex < vertexCount; ++vertex)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			lower[i] = std::min(lower[i], position(vertex)[i]);
+			upper[i] = std::max(upper[i], position(vertex)[i]);
+		}
+	}
+	const float extent = std::max(upper[0] - lower[0], std::max(upper[1] - lower[1], upper[2] - lower[2]));
+	double area = 0.0;
+	for (uint32_t t = 0; t < m_Removed.size(); ++t)
+	{
+		if (m_Removed[t])
+			continue;
+		const uint32_t* corners = &m_Triangles[t * 3];
+		double normal[3];
+		triangleNormal(position(corners[0]), position(corners[1]), position(corners[2]), normal);
+		area += 0.5 * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	}
+	const float width = static_cast<float>(std::sqrt(area / m_TriangleCount));
+	const uint32_t resolution = width > 0.0f ? std::max(1u, std::min(static_cast<uint32_t>(extent / width), MaxGridCells)) : 1u;
+	const float cellSize = extent > 0.0f ? extent / resolution : 1.0f;
+	uint32_t cells[3];
+	for (int i = 0; i < 3; ++i)
+		cells[i] = std::max(1u, std::min(static_cast<uint32_t>((upper[i] - lower[i]) / cellSize) + 1, resolution));
+	auto cellOf = [&](const float* p, int axis)
+	{
+		const float cell = (p[axis] - lower[axis]) / cellSize;
+		return cell <= 0.0f ? 0u : std::min(static_cast<uint32_t>(cell), cells[axis] - 1);
+	};
+
+	// Triangles of each cell, listed in every cell their bounds overlap
+	std::vector<uint32_t> cellStart(cells[0] * cells[1] * cells[2] + 1, 0);
+	std::vector<uint32_t> cellTriangles;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (uint32_t t = 0; t < m_Removed.size(); ++t)
+		{
+			if (m_Removed[t])
+				continue;
+			const uint32_t* corners = &m_Triangles[t * 3];
+			const float* a = position(corners[0]);
+			const float* b = position(corners[1]);
+			const float* c = position(corners[2]);
+			uint32_t first[3];
+			uint32_t last[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				const float low[3] = { std::min(a[0], std::min(b[0], c[0])), std::min(a[1], std::min(b[1], c[1])), std::min(a[2], std::min(b[2], c[2])) };
+				const float high[3] = { std::max(a[0], std::max(b[0], c[0])), std::max(a[1], std::max(b[1], c[1])), std::max(a[2], std::max(b[2], c[2])) };
+				first[i] = cellOf(low, i);
+				last[i] = cellOf(high, i);
+			}
+			for (uint32_t z = first[2]; z <= last[2]; ++z)
+			{
+				for (uint32_t y = first[1]; y <= last[1]; ++y)
+				{
+					for (uint32_t x = first[0]; x <= last[0]; ++x)
+					{
+						const uint32_t cell = (z * cells[1] + y) * cells[0] + x;
+						if (pass == 0)
+							++cellStart[cell + 1];
+						else
+							cellTriangles[cellStart[cell]++] = t;
+					}
+				}
+			}
+		}
+		if (pass == 0)
+		{
+			for (size_t cell = 1; cell < cellStart.size(); ++cell)
+				cellStart[cell] += cellStart[cell - 1];
+			cellTriangles.resize(cellStart.back());
+		}
+		else
+		{
+			// Filling moved every start to the next cell's
+			for (size_t cell = cellStart.size() - 1; cell > 0; --cell)
+				cellStart[cell] = cellStart[cell - 1];
+			cellStart[0] = 0;
+		}
+	}
+
+	// Only vertices that collapsed left the surface, the rest are corners of it
+	double farthest = 0.0;
+	const int maxRing = static_cast<int>(std::max(cells[0], std::max(cells[1], cells[2])));
+	for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		if (m_Canonical[vertex] != vertex || m_CollapsedInto[vertex] == vertex)
+			continue;
+		const float* p = position(vertex);
+		const int center[3] = { static_cast<int>(cellOf(p, 0)), static_cast<int>(cellOf(p, 1)), static_cast<int>(cellOf(p, 2)) };
+		double nearest = -1.0;
+		// Rings of cells around the vertex's own, until the nearest triangle so far is closer than any face of the box
+		// searched, a triangle not found yet lies wholly outside it
+		for (int ring = 0; ring <= maxRing; ++ring)
+		{
+			if (ring > 0 && nearest >= 0.0)
+			{
+				// Faces on the grid's edge have nothing beyond them
+				bool bOpen = false;
+				double outside = DBL_MAX;
+				for (int i = 0; i < 3; ++i)
+				{
+					if (center[i] - ring >= 0)
+					{
+						outside = std::min(outside, static_cast<double>(p[i]) - (lower[i] + (center[i] - ring + 1) * cellSize));
+						bOpen = true;
+					}
+					if (center[i] + ring < static_cast<int>(cells[i]))
+					{
+						outside = std::min(outside, (lower[i] + (center[i] + ring) * cellSize) - static_cast<double>(p[i]));
+						bOpen = true;
+					}
+				}
+				if (!bOpen || nearest <= outside)
+					break;
+			}
+			int first[3];
+			int last[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				first[i] = std::max(center[i] - ring, 0);
+				last[i] = std::min(center[i] + ring, static_cast<int>(cells[i]) - 1);
+			}
+			for (int z = first[2]; z <= last[2]; ++z)
+			{
+				for (int y = first[1]; y <= last[1]; ++y)
+				{
+					for (int x = first[0]; x <= last[0]; ++x)
+					{
+						if (std::max(std::abs(x - center[0]), std::max(std::abs(y - center[1]), std::abs(z - center[2]))) != ring)
+							continue;
+						const uint32_t cell = (z * cells[1] + y) * cells[0] + x;
+						for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+						{
+							const uint32_t* corners = &m_Triangles[cellTriangles[i] * 3];
+							const double distance = pointTriangleDistance(p, position(corners[0]), position(corners[1]), position(corners[2]));
+							nearest = nearest < 0.0 || distance < nearest ? distance : nearest;
+						}
+					}
+				}
+			}
+		}
+		farthest = std::max(farthest, nearest);
+	}
+	return static_cast<float>(farthest);
+}
+
+void icy::System::MeshSimplifier::buildLodChain(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+	float reduction, float maxError, std::vector<MeshLod>& levels)
+{
+	ICY_PROFILE_FUNCTION();
+	levels.clear();
+	levels.push_back({ std::vector<uint32_t>(indices, indices + indexCount), 0.0f });
+	MeshSimplifier simplifier;
+	simplifier.setMesh(positions, stride, vertexCount, indices, indexCount);
+	while (levels.size() < MaxLodLevels)
+	{
+		const uint32_t previous = static_cast<uint32_t>(levels.back().indices.size());
+		const uint32_t target = static_cast<uint32_t>(previous / 3 * reduction) * 3;
+		simplifier.simplify(target, maxError);
+		// Not worth a level of its own
+		if (simplifier.getIndexCount() == 0 || simplifier.getIndexCount() > previous - previous / 10)
+			break;
+		levels.push_back({ std::vector<uint32_t>(), std::max(simplifier.measureDistance(), levels.back().error) });
+		simplifier.getIndices(levels.back().indices);
+	}
+}
+
+void icy::System::MeshSimplifier::addPlane(Quadric& quadric, double a, double b, double c, double d, double scale, double weight)
+{
+	quadric.m[0] += scale * a * a;
+	quadric.m[1] += scale * a * b;
+	quadric.m[2] += scale * a * c;
+	quadric.m[3] += scale * a * d;
+	quadric.m[4] += scale * b * b;
+	quadric.m[5] += scale * b * c;
+	quadric.m[6] += scale * b * d;
+	quadric.m[7] += scale * c * c;
+	quadric.m[8] += scale * c * d;
+	quadric.m[9] += scale * d * d;
+	quadric.weight += weight;
+}
+
+double icy::System::MeshSimplifier::evaluate(const Quadric& quadric, const float* position)
+{
+	const double x = position[0];
+	const double y = position[1];
+	const double z = position[2];
+	const double* m = quadric.m;
+	const double sum = m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+		+ m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+		+ m[7] * z * z + 2.0 * m[8] * z
+		+ m[9];
+	return sum > 0.0 ? sum : 0.0;
+}
+
+const float* icy::System::MeshSimplifier::position(uint32_t vertex) const
+{
+	return reinterpret_cast<const float*>(m_Positions + static_cast<size_t>(vertex) * m_Stride);
+}
+
+uint32_t icy::System::MeshSimplifier::countSharedTriangles(uint32_t a, uint32_t b) const
+{
+	uint32_t count = 0;
+	for (uint32_t t : m_VertexTriangles[a])
+	{
+		if (m_Removed[t])
+			continue;
+		const uint32_t* corners = &m_Triangles[t * 3];
+		if (m_Canonical[corners[0]] == b || m_Canonical[corners[1]] == b || m_Canonical[corners[2]] == b)
+			++count;
+	}
+	return count;
+}
+
+bool icy::System::MeshSimplifier::canCollapse(uint32_t from, uint32_t to) const
+{
+	if (m_Locked[from])
+		return false;
+	// A border vertex may only slide along its border
+	return !m_Border[from] || (m_Border[to] && countSharedTriangles(from, to) == 1);
+}
+
+void icy::System::MeshSimplifier::pushEdge(uint32_t a, uint32_t b)
+{
+	if (a == b)
+		return;
+	Quadric sum = m_Quadrics[a];
+	for (int i = 0; i < 10; ++i)
+		sum.m[i] += m_Quadrics[b].m[i];
+	sum.weight += m_Quadrics[b].weight;
+	const double weight = sum.weight > 0.0 ? sum.weight : 1.0;
+
+	// Keep the cheaper of the two directions that are allowed
+	Collapse best = { 0.0f, 0, 0, 0, 0 };
+	bool found = false;
+	const uint32_t ends[2][2] = { { a, b }, { b, a } };
+	for (const auto& end : ends)
+	{
+		if (!canCollapse(end[0], end[1]))
+			continue;
+		const float error = static_cast<float>(std::sqrt(evaluate(sum, position(end[1])) / weight));
+		if (!found || error < best.error)
+			best = { error, end[0], end[1], m_Versions[end[0]], m_Versions[end[1]] };
+		found = true;
+	}
+	if (found)
+		m_Queue.push(best);
+}
+
+bool icy::System::MeshSimplifier::flipsTriangle(uint32_t from, uint32_t to) const
+{
+	const float* target = position(to);
+	for (uint32_t t : m_VertexTriangles[from])
+	{
+		if (m_Removed[t])
+			continue;
+		const uint32_t* corners = &m_Triangles[t * 3];
+		const float* moved[3];
+		bool collapses = false;
+		for (int i = 0; i < 3; ++i)
+		{
+			const uint32_t vertex = m_Canonical[corners[i]];
+			collapses = collapses || vertex == to;
+			moved[i] = vertex == from ? target : position(corners[i]);
+		}
+		// Goes away with the edge
+		if (collapses)
+			continue;
+		double before[3];
+		double after[3];
+		triangleNormal(position(corners[0]), position(corners[1]), position(corners[2]), before);
+		triangleNormal(moved[0], moved[1], moved[2], after);
+		if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+			return true;
+	}
+	return false;
+}
+
+bool icy::System::MeshSimplifier::breaksLink(uint32_t from, uint32_t to) const
+{
+	// Other two vertices of the live triangles around each end, and the vertices opposite the edge
+	std::vector<uint32_t> fromPairs;
+	std::vector<uint32_t> toPairs;
+	std::vector<uint32_t> opposite;
+	const uint32_t ends[2] = { from, to };
+	for (int e = 0; e < 2; ++e)
+	{
+		std::vector<uint32_t>& pairs = e == 0 ? fromPairs : toPairs;
+		for (uint32_t t : m_VertexTriangles[ends[e]])
+		{
+			if (m_Removed[t])
+				continue;
+			const uint32_t* corners = &m_Triangles[t * 3];
+			uint32_t others[2];
+			uint32_t count = 0;
+			bool onEdge = false;
+			for (int i = 0; i < 3; ++i)
+			{
+				const uint32_t vertex = m_Canonical[corners[i]];
+				if (vertex == ends[1 - e])
+					onEdge = true;
+				else if (vertex != ends[e] && count < 2)
+					others[count++] = vertex;
+			}
+			if (onEdge)
+			{
+				if (e == 0 && count == 1)
+					opposite.push_back(others[0]);
+				continue;
+			}
+			if (count == 2)
+			{
+				pairs.push_back(others[0]);
+				pairs.push_back(others[1]);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < fromPairs.size(); i += 2)
+	{
+		for (size_t j = 0; j < toPairs.size(); j += 2)
+		{
+			const bool sameEdge = (fromPairs[i] == toPairs[j] && fromPairs[i + 1] == toPairs[j + 1])
+				|| (fromPairs[i] == toPairs[j + 1] && fromPairs[i + 1] == toPairs[j]);
+			if (sameEdge)
+				return true;
+			// A vertex next to both ends that isn't opposite the edge
+			for (int a = 0; a < 2; ++a)
+			{
+				for (int b = 0; b < 2; ++b)
+				{
+					if (fromPairs[i + a] == toPairs[j + b] && std::find(opposite.begin(), opposite.end(), fromPairs[i + a]) == opposite.end())
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+void icy::System::MeshSimplifier::collapse(uint32_t from, uint32_t to)
+{
+	// from is never on a seam, so it is its only vertex; to may have several, take the one on this side of the seam
+	uint32_t replacement = to;
+	for (uint32_t t : m_VertexTriangles[from])
+	{
+		if (m_Removed[t])
+			continue;
+		const uint32_t* corners = &m_Triangles[t * 3];
+		for (int i = 0; i < 3; ++i)
+		{
+			if (m_Canonical[corners[i]] == to)
+				replacement = corners[i];
+		}
+	}
+
+	for (uint32_t t : m_VertexTriangles[from])
+	{
+		if (m_Removed[t])
+			continue;
+		uint32_t* corners = &m_Triangles[t * 3];
+		if (m_Canonical[corners[0]] == to || m_Canonical[corners[1]] == to || m_Canonical[corners[2]] == to)
+		{
+			m_Removed[t] = true;
+			--m_TriangleCount;
+			continue;
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			if (corners[i] == from)
+				corners[i] = replacement;
+		}
+		m_VertexTriangles[to].push_back(t);
+	}
+	m_VertexTriangles[from].clear();
+	m_CollapsedInto[from] = to;
+
+	Quadric& quadric = m_Quadrics[to];
+	for (int i = 0; i < 10; ++i)
+		quadric.m[i] += m_Quadrics[from].m[i];
+	quadric.weight += m_Quadrics[from].weight;
+	++m_Versions[to];
+
+	// Every edge around to costs something else now
+	std::vector<uint32_t>& triangles = m_VertexTriangles[to];
+	triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [this](uint32_t t) { return m_Removed[t]; }), triangles.end());
+	for (uint32_t t : triangles)
+	{
+		const uint32_t* corners = &m_Triangles[t * 3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const uint32_t vertex = m_Canonical[corners[i]];
+			if (vertex != to)
+				pushEdge(to, vertex);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		// One level of detail, indices into the vertices of the mesh it was built from
+		struct MeshLod
+		{
+			std::vector<uint32_t> indices;
+			// Farthest the full mesh's vertices lie from this level, in model units, see MeshSimplifier::measureDistance
+			float error;
+		};
+
+		// Offline edge collapse simplifier driven by quadric error metrics (Garland and Heckbert)
+		// Every vertex sums the planes of the triangles around it, weighted by their area, and an edge costs the distance
+		// its collapse moves the surface from those planes. Vertices only ever collapse onto other vertices, so every level
+		// indexes the original vertex buffer. Open borders keep their shape, vertices that share a position with another
+		// vertex (UV or normal seams) never move, and collapses that would flip a triangle or break the surface's manifold are skipped
+		class MeshSimplifier
+		{
+		public:
+			// Levels buildLodChain makes at most, the full mesh included
+			static constexpr uint32_t MaxLodLevels = 8;
+
+			MeshSimplifier();
+
+			// positions : xyz of vertexCount vertices, stride bytes apart, read until the last simplify()
+			// indices : triangle list, indexCount a multiple of 3
+			void setMesh(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+			// Collapses edges until at most targetIndexCount indices are left or the next collapse would cost more than maxError
+			// Carries on from the previous call, so a falling target walks down a chain of levels
+			// Returns the error reached so far
+			float simplify(uint32_t targetIndexCount, float maxError);
+			// The triangles left, in their original order
+			void getIndices(std::vector<uint32_t>& indices) const;
+			uint32_t getIndexCount() const { return m_TriangleCount * 3; }
+			// Largest cost of a collapse so far, an average distance over the area each vertex stands for
+			float getError() const { return m_Error; }
+			// Farthest any vertex of the mesh lies from the triangles left, what the chain records as a level's error
+			float measureDistance() const;
+
+			// Level 0 is the mesh itself, each next level keeps about reduction of the triangles of the one before,
+			// the chain stops at MaxLodLevels, at maxError or when a level saves less than a tenth of the triangles
+			// Errors grow along the chain, each is the larger of measureDistance() and the one before
+			static void buildLodChain(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+				float reduction, float maxError, std::vector<MeshLod>& levels);
+
+		private:
+			// Symmetric 4x4 matrix of a sum of squared plane distances, the upper triangle row by row
+			struct Quadric
+			{
+				double m[10];
+				// Area of the triangles that went in, turns the sum into an average squared distance
+				double weight;
+			};
+			struct Collapse
+			{
+				float error;
+				uint32_t from;
+				uint32_t to;
+				// Versions of both vertices when the cost was worked out, a collapse is stale once either changed
+				uint32_t fromVersion;
+				uint32_t toVersion;
+				bool operator>(const Collapse& other) const { return error > other.error; }
+			};
+
+			// scale : multiplies the plane, weight : added to the weight of the average
+			static void addPlane(Quadric& quadric, double a, double b, double c, double d, double scale, double weight);
+			static double evaluate(const Quadric& quadric, const float* position);
+			const float* position(uint32_t vertex) const;
+			// Triangles still alive around both vertices
+			uint32_t countSharedTriangles(uint32_t a, uint32_t b) const;
+			bool canCollapse(uint32_t from, uint32_t to) const;
+			void pushEdge(uint32_t a, uint32_t b);
+			bool flipsTriangle(uint32_t from, uint32_t to) const;
+			// Link condition: the only vertices next to both ends are the ones opposite the edge, and no triangle around from
+			// matches one around to in its other two vertices. Otherwise the collapse pinches the surface or doubles a triangle
+			bool breaksLink(uint32_t from, uint32_t to) const;
+			void collapse(uint32_t from, uint32_t to);
+
+		private:
+			const uint8_t* m_Positions;
+			uint32_t m_Stride;
+			std::vector<uint32_t> m_Triangles;
+			std::vector<bool> m_Removed;
+			uint32_t m_TriangleCount;
+			// First vertex with the same position, topology works on these
+			std::vector<uint32_t> m_Canonical;
+			std::vector<Quadric> m_Quadrics;
+			std::vector<std::vector<uint32_t>> m_VertexTriangles;
+			std::vector<uint32_t> m_Versions;
+			std::vector<bool> m_Locked;
+			std::vector<bool> m_Border;
+			// The vertex each collapsed vertex went into, itself otherwise
+			std::vector<uint32_t> m_CollapsedInto;
+			std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_Queue;
+			float m_Error;
+		};
+	}
+}
\ No newline at end of file
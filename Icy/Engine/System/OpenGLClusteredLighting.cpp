@@ -0,0 +1,206 @@
+#include "OpenGLClusteredLighting.hpp"
+#include <cstring>
+#include <iostream>
+#include "OpenGLShaders.hpp"
+
+namespace
+{
+	// Bytes of one readback slot, the grid followed by the counters
+	const GLsizeiptr ReadbackGridSize = icy::System::ClusterCount * sizeof(icy::System::ClusterRange);
+	const GLsizeiptr ReadbackSlotSize = ReadbackGridSize + icy::System::ClusterCounterSize;
+}
+
+icy::System::OpenGLClusteredLighting::OpenGLClusteredLighting()
+{
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+	m_Program = 0;
+	m_Params = {};
+	m_ParamsAllocation = {};
+	m_LightsAllocation = {};
+	m_GridBuffer = 0;
+	m_IndexBuffer = 0;
+	m_ReadbackBuffer = 0;
+	m_Readback = nullptr;
+	for (int i = 0; i < ReadbackSlots; ++i)
+	{
+		m_ReadbackFences[i] = nullptr;
+		m_Queries[i] = 0;
+		m_ReadbackLights[i] = 0;
+	}
+	m_ReadbackSlot = 0;
+	m_Stats = {};
+}
+
+icy::System::OpenGLClusteredLighting::~OpenGLClusteredLighting()
+{
+	destroy();
+}
+
+bool icy::System::OpenGLClusteredLighting::create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory)
+{
+	destroy();
+	m_StateCache = stateCache;
+	m_StreamBuffer = streamBuffer;
+	const std::string directory = shaderDirectory;
+	m_Preamble = readShaderFile(directory + "clustered.glsl", "lighting");
+	const std::string computeSource = readShaderFile(directory + "lightclusters.comp", "lighting");
+	if (m_Preamble.empty() || computeSource.empty())
+	{
+		destroy();
+		return false;
+	}
+
+	m_Program = compileComputeProgram(computeSource, ("#define ICY_CLUSTER_WRITE\n" + m_Preamble).c_str(), "light binning");
+	if (m_Program == 0)
+	{
+		destroy();
+		return false;
+	}
+
+	// Written by the binning pass and read by fragments, only the readback copies reach the CPU
+	m_GridBuffer = m_StateCache->createBuffer(ClusterCount * sizeof(ClusterRange), nullptr, 0);
+	m_IndexBuffer = m_StateCache->createBuffer(ClusterCounterSize + ClusterIndexCapacity * sizeof(uint32_t), nullptr, 0);
+	const GLbitfield readFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	m_ReadbackBuffer = m_StateCache->createBuffer(ReadbackSlots * ReadbackSlotSize, nullptr, readFlags);
+	m_Readback = static_cast<const uint8_t*>(glMapNamedBufferRange(m_ReadbackBuffer, 0, ReadbackSlots * ReadbackSlotSize, readFlags));
+	glCreateQueries(GL_TIME_ELAPSED, ReadbackSlots, m_Queries);
+	if (m_Readback == nullptr)
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::OpenGLClusteredLighting::destroy()
+{
+	if (m_StateCache == nullptr)
+		return;
+	for (int i = 0; i < ReadbackSlots; ++i)
+	{
+		if (m_ReadbackFences[i] != nullptr)
+			glDeleteSync(m_ReadbackFences[i]);
+		m_ReadbackFences[i] = nullptr;
+	}
+	if (m_Queries[0] != 0)
+		glDeleteQueries(ReadbackSlots, m_Queries);
+	for (int i = 0; i < ReadbackSlots; ++i)
+		m_Queries[i] = 0;
+	if (m_Program != 0)
+		m_StateCache->deleteProgram(m_Program);
+	if (m_Readback != nullptr)
+		glUnmapNamedBuffer(m_ReadbackBuffer);
+	const GLuint buffers[] = { m_GridBuffer, m_IndexBuffer, m_ReadbackBuffer };
+	for (GLuint buffer : buffers)
+	{
+		if (buffer != 0)
+			m_StateCache->deleteBuffer(buffer);
+	}
+
+	m_Preamble.clear();
+	m_Program = 0;
+	m_GridBuffer = 0;
+	m_IndexBuffer = 0;
+	m_ReadbackBuffer = 0;
+	m_Readback = nullptr;
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+}
+
+std::string icy::System::OpenGLClusteredLighting::addPreamble(const char* source) const
+{
+	return insertAfterVersion(source, m_Preamble);
+}
+
+void icy::System::OpenGLClusteredLighting::update(const ClusterCamera& camera, const ClusterLight* lights, uint32_t count)
+{
+	// Take the stats from the oldest copy if it has landed, never wait for it
+	m_ReadbackSlot = (m_ReadbackSlot + 1) % ReadbackSlots;
+	collect(m_ReadbackSlot);
+
+	if (count > ClusterMaxLights)
+		count = ClusterMaxLights;
+	LightClusterer::fillParams(camera, count, m_Params);
+	m_ParamsAllocation = m_StreamBuffer->allocate(sizeof(m_Params), m_StreamBuffer->getUniformAlignment());
+	// Never bound empty, a zero sized range is an error even when nothing reads it
+	const GLsizeiptr lightBytes = (count > 0 ? count : 1) * sizeof(ClusterLight);
+	m_LightsAllocation = m_StreamBuffer->allocate(lightBytes, m_StreamBuffer->getStorageAlignment());
+	if (m_ParamsAllocation.data == nullptr || m_LightsAllocation.data == nullptr)
+	{
+		std::cout << "Stream buffer is out of space for the lights" << std::endl;
+		m_ParamsAllocation = {};
+		m_LightsAllocation = {};
+		return;
+	}
+	std::memcpy(m_ParamsAllocation.data, &m_Params, sizeof(m_Params));
+	if (count > 0)
+		std::memcpy(m_LightsAllocation.data, lights, count * sizeof(ClusterLight));
+	else
+		std::memset(m_LightsAllocation.data, 0, sizeof(ClusterLight));
+
+	// The counters start from zero, a clear is ordered before the dispatch without a barrier
+	glClearNamedBufferSubData(m_IndexBuffer, GL_R32UI, 0, ClusterCounterSize, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	bind();
+	m_StateCache->useProgram(m_Program);
+	glBeginQuery(GL_TIME_ELAPSED, m_Queries[m_ReadbackSlot]);
+	glDispatchCompute((ClusterCount + ClusterWorkgroupSize - 1) / ClusterWorkgroupSize, 1, 1);
+	glEndQuery(GL_TIME_ELAPSED);
+	// Fragments read the grid next, and the copies below read it as a transfer
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	const GLintptr slotOffset = m_ReadbackSlot * ReadbackSlotSize;
+	glCopyNamedBufferSubData(m_GridBuffer, m_ReadbackBuffer, 0, slotOffset, ReadbackGridSize);
+	glCopyNamedBufferSubData(m_IndexBuffer, m_ReadbackBuffer, 0, slotOffset + ReadbackGridSize, ClusterCounterSize);
+	m_ReadbackFences[m_ReadbackSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_ReadbackLights[m_ReadbackSlot] = count;
+}
+
+void icy::System::OpenGLClusteredLighting::bind()
+{
+	if (m_ParamsAllocation.data == nullptr)
+		return;
+	const GLuint stream = m_StreamBuffer->getBuffer();
+	m_StateCache->bindBufferRange(GL_UNIFORM_BUFFER, ParamsBinding, stream, m_ParamsAllocation.offset, m_ParamsAllocation.size);
+	m_StateCache->bindBufferRange(GL_SHADER_STORAGE_BUFFER, LightsBinding, stream, m_LightsAllocation.offset, m_LightsAllocation.size);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, GridBinding, m_GridBuffer);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, IndicesBinding, m_IndexBuffer);
+}
+
+bool icy::System::OpenGLClusteredLighting::readBack(std::vector<ClusterRange>& grid, std::vector<uint32_t>& indices, uint32_t& overflowed)
+{
+	if (m_IndexBuffer == 0)
+		return false;
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	uint32_t counters[ClusterCounterSize / sizeof(uint32_t)];
+	glGetNamedBufferSubData(m_IndexBuffer, 0, ClusterCounterSize, counters);
+	// Clusters that didn't fit still added to the counter
+	const uint32_t indexCount = counters[0] < ClusterIndexCapacity ? counters[0] : ClusterIndexCapacity;
+	overflowed = counters[1];
+	grid.resize(ClusterCount);
+	indices.resize(indexCount);
+	glGetNamedBufferSubData(m_GridBuffer, 0, ClusterCount * sizeof(ClusterRange), grid.data());
+	if (indexCount > 0)
+		glGetNamedBufferSubData(m_IndexBuffer, ClusterCounterSize, indexCount * sizeof(uint32_t), indices.data());
+	return true;
+}
+
+void icy::System::OpenGLClusteredLighting::collect(int slot)
+{
+	GLsync& fence = m_ReadbackFences[slot];
+	if (fence == nullptr)
+		return;
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+	{
+		const uint8_t* copy = m_Readback + slot * ReadbackSlotSize;
+		m_Stats = LightClusterer::computeStats(reinterpret_cast<const ClusterRange*>(copy), m_ReadbackLights[slot]);
+		m_Stats.overflowed = reinterpret_cast<const uint32_t*>(copy + ReadbackGridSize)[1];
+		// Done with the fence, so the query result is there too
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(m_Queries[slot], GL_QUERY_RESULT, &elapsed);
+		m_Stats.buildMs = static_cast<double>(elapsed) / 1e6;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
\ No newline at end of file
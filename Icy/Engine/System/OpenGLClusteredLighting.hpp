@@ -0,0 +1,79 @@
+#pragma once
+#include "LightClusters.hpp"
+#include "OpenGLStateCache.hpp"
+#include "OpenGLStreamBuffer.hpp"
+#include <string>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		// Clustered forward lighting for the OpenGL backend
+		// Every update uploads the lights into the stream buffer and bins them into the froxel grid with
+		// Engine\Shaders\lightclusters.comp, fragment shaders built with getPreamble() then loop over their cluster's lights only
+		// The grid is copied into a ring and read a few frames late for the stats, the CPU never waits on it
+		class OpenGLClusteredLighting
+		{
+		public:
+			static constexpr int ReadbackSlots = 3;
+			// Uniform block binding of the params and storage block bindings of the lights, grid and index list,
+			// clear of what the indirect renderer and the particles use
+			static constexpr GLuint ParamsBinding = 4;
+			static constexpr GLuint LightsBinding = 4;
+			static constexpr GLuint GridBinding = 5;
+			static constexpr GLuint IndicesBinding = 6;
+
+			OpenGLClusteredLighting();
+			~OpenGLClusteredLighting();
+			OpenGLClusteredLighting(const OpenGLClusteredLighting&) = delete;
+			OpenGLClusteredLighting& operator=(const OpenGLClusteredLighting&) = delete;
+
+			// shaderDirectory : where clustered.glsl and lightclusters.comp are, ending in a separator
+			// Needs a current 4.5 context
+			bool create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory);
+			void destroy();
+
+			// clustered.glsl, to insert after the #version line of fragment shaders that call icyClusteredLighting
+			const std::string& getPreamble() const { return m_Preamble; }
+			// source with the preamble inserted after its #version line
+			std::string addPreamble(const char* source) const;
+
+			// Uploads count lights (up to ClusterMaxLights) and bins them for this frame
+			void update(const ClusterCamera& camera, const ClusterLight* lights, uint32_t count);
+			// Binds what the last update built for shaders using the preamble, in the same frame as the update
+			void bind();
+
+			// Stats of the newest grid that made it back, the build time is the GPU's
+			const ClusterStats& getStats() const { return m_Stats; }
+			const ClusterParams& getParams() const { return m_Params; }
+			// Reads the last update's grid back and waits for it, for tests against LightClusterer
+			bool readBack(std::vector<ClusterRange>& grid, std::vector<uint32_t>& indices, uint32_t& overflowed);
+
+		private:
+			void collect(int slot);
+
+		private:
+			OpenGLStateCache* m_StateCache;
+			OpenGLStreamBuffer* m_StreamBuffer;
+			std::string m_Preamble;
+			GLuint m_Program;
+			ClusterParams m_Params;
+			// Where this frame's params and lights sit in the stream buffer
+			OpenGLStreamBuffer::Allocation m_ParamsAllocation;
+			OpenGLStreamBuffer::Allocation m_LightsAllocation;
+
+			GLuint m_GridBuffer;
+			// The counters followed by ClusterIndexCapacity light indices
+			GLuint m_IndexBuffer;
+			// Grid then counters, per slot
+			GLuint m_ReadbackBuffer;
+			const uint8_t* m_Readback;
+			GLsync m_ReadbackFences[ReadbackSlots];
+			GLuint m_Queries[ReadbackSlots];
+			uint32_t m_ReadbackLights[ReadbackSlots];
+			int m_ReadbackSlot;
+			ClusterStats m_Stats;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,512 @@
+#include "OpenGLIndirectRenderer.hpp"
+#include <SDL\SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Shared by every stage, declares the per draw data and the texture lookup
+	const char* BindlessPreamble =
+		"#extension GL_ARB_bindless_texture : require\n"
+		"struct IcyDrawData { mat4 model; uvec4 texture; };\n"
+		"layout(std430, binding = 0) readonly buffer IcyDrawBuffer { IcyDrawData icy_Draws[]; };\n"
+		"vec4 icySampleTexture(uint draw, vec2 uv) { return texture(sampler2D(icy_Draws[draw].texture.xy), uv); }\n";
+	const char* ArrayPreamble =
+		"struct IcyDrawData { mat4 model; uvec4 texture; };\n"
+		"layout(std430, binding = 0) readonly buffer IcyDrawBuffer { IcyDrawData icy_Draws[]; };\n"
+		"layout(binding = 0) uniform sampler2DArray icy_Textures;\n"
+		"vec4 icySampleTexture(uint draw, vec2 uv) { return texture(icy_Textures, vec3(uv, float(icy_Draws[draw].texture.x))); }\n";
+	// Vertex stage only, where the draw id comes from
+	// It is the draw's baseInstance, the draw's index in its batch or a scene instance id
+	const char* DrawParametersPreamble =
+		"#extension GL_ARB_shader_draw_parameters : require\n"
+		"#define ICY_DRAW_ID uint(gl_BaseInstanceARB)\n";
+	// Without shader_draw_parameters it is an instanced attribute offset by baseInstance
+	const char* DrawIndexPreamble =
+		"layout(location = 15) in uint icy_DrawIndex;\n"
+		"#define ICY_DRAW_ID icy_DrawIndex\n";
+
+	int mipLevels(int width, int height)
+	{
+		int levels = 1;
+		int size = width > height ? width : height;
+		while (size > 1)
+		{
+			size >>= 1;
+			++levels;
+		}
+		return levels;
+	}
+
+	// Moves a model space bounding sphere by a column major transform, scaled by its longest axis, returns that scale
+	float transformSphere(const float* model, const float* sphere, float* result)
+	{
+		float scale = 0.0f;
+		for (int column = 0; column < 3; ++column)
+		{
+			const float* axis = model + column * 4;
+			scale = std::max(scale, axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		}
+		scale = std::sqrt(scale);
+		for (int row = 0; row < 3; ++row)
+			result[row] = model[row] * sphere[0] + model[4 + row] * sphere[1] + model[8 + row] * sphere[2] + model[12 + row];
+		result[3] = sphere[3] * scale;
+		return scale;
+	}
+}
+
+icy::System::OpenGLIndirectRenderer::OpenGLIndirectRenderer()
+{
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+	m_Bindless = false;
+	m_DrawParameters = false;
+	m_GetTextureHandle = nullptr;
+	m_MakeResident = nullptr;
+	m_MakeNonResident = nullptr;
+	m_VertexBuffer = 0;
+	m_IndexBuffer = 0;
+	m_DrawIndexBuffer = 0;
+	m_MeshLodBuffer = 0;
+	m_VertexArray = 0;
+	m_VertexCount = 0;
+	m_IndexCount = 0;
+	m_TextureArray = 0;
+	m_TextureLayers = 0;
+	m_SortPool = nullptr;
+	m_Culler = nullptr;
+	m_Scene = nullptr;
+	m_LastStats = {};
+}
+
+icy::System::OpenGLIndirectRenderer::~OpenGLIndirectRenderer()
+{
+	destroy();
+}
+
+bool icy::System::OpenGLIndirectRenderer::create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer)
+{
+	destroy();
+	m_StateCache = stateCache;
+	m_StreamBuffer = streamBuffer;
+
+	m_DrawParameters = SDL_GL_ExtensionSupported("GL_ARB_shader_draw_parameters") == SDL_TRUE;
+	loadBindlessFunctions();
+
+	m_VertexBuffer = m_StateCache->createBuffer(MaxVertices * sizeof(Vertex), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	m_IndexBuffer = m_StateCache->createBuffer(MaxIndices * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	// baseInstance + 0 fetches the draw index when gl_BaseInstanceARB is not available
+	std::vector<uint32_t> drawIndices(MaxDrawIndices);
+	for (uint32_t i = 0; i < MaxDrawIndices; ++i)
+		drawIndices[i] = i;
+	m_DrawIndexBuffer = m_StateCache->createBuffer(MaxDrawIndices * sizeof(uint32_t), drawIndices.data(), 0);
+	m_MeshLodBuffer = m_StateCache->createBuffer(MaxMeshes * sizeof(OcclusionMeshLods), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	glCreateVertexArrays(1, &m_VertexArray);
+	glVertexArrayVertexBuffer(m_VertexArray, 0, m_VertexBuffer, 0, sizeof(Vertex));
+	glVertexArrayElementBuffer(m_VertexArray, m_IndexBuffer);
+	glEnableVertexArrayAttrib(m_VertexArray, 0);
+	glVertexArrayAttribFormat(m_VertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+	glVertexArrayAttribBinding(m_VertexArray, 0, 0);
+	glEnableVertexArrayAttrib(m_VertexArray, 1);
+	glVertexArrayAttribFormat(m_VertexArray, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+	glVertexArrayAttribBinding(m_VertexArray, 1, 0);
+	glEnableVertexArrayAttrib(m_VertexArray, 2);
+	glVertexArrayAttribFormat(m_VertexArray, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, uv));
+	glVertexArrayAttribBinding(m_VertexArray, 2, 0);
+	glVertexArrayVertexBuffer(m_VertexArray, 1, m_DrawIndexBuffer, 0, sizeof(uint32_t));
+	glVertexArrayBindingDivisor(m_VertexArray, 1, 1);
+	glEnableVertexArrayAttrib(m_VertexArray, DrawIndexLocation);
+	glVertexArrayAttribIFormat(m_VertexArray, DrawIndexLocation, 1, GL_UNSIGNED_INT, 0);
+	glVertexArrayAttribBinding(m_VertexArray, DrawIndexLocation, 1);
+
+	if (!m_Bindless)
+	{
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_TextureArray);
+		glTextureStorage3D(m_TextureArray, mipLevels(ArrayTextureSize, ArrayTextureSize), GL_RGBA8, ArrayTextureSize, ArrayTextureSize, ArrayTextureLayers);
+		glTextureParameteri(m_TextureArray, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(m_TextureArray, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	m_Submissions.reserve(MaxDraws);
+	m_SortKeys.reserve(MaxDraws);
+	m_SortOrder.reserve(MaxDraws);
+	m_Sorter.reserve(MaxDraws);
+	m_Batches.reserve(MaxDraws);
+	return true;
+}
+
+void icy::System::OpenGLIndirectRenderer::destroy()
+{
+	if (m_StateCache == nullptr)
+		return;
+
+	for (auto handle : m_TextureHandles)
+		m_MakeNonResident(handle);
+	for (auto texture : m_Textures)
+		m_StateCache->deleteTexture(texture);
+	for (auto program : m_Programs)
+		m_StateCache->deleteProgram(program);
+	if (m_TextureArray != 0)
+		m_StateCache->deleteTexture(m_TextureArray);
+	m_StateCache->deleteVertexArray(m_VertexArray);
+	m_StateCache->deleteBuffer(m_VertexBuffer);
+	m_StateCache->deleteBuffer(m_IndexBuffer);
+	m_StateCache->deleteBuffer(m_DrawIndexBuffer);
+	m_StateCache->deleteBuffer(m_MeshLodBuffer);
+
+	m_TextureHandles.clear();
+	m_Textures.clear();
+	m_Programs.clear();
+	m_Meshes.clear();
+	m_Submissions.clear();
+	m_TextureArray = 0;
+	m_TextureLayers = 0;
+	m_MeshLodBuffer = 0;
+	m_VertexCount = 0;
+	m_IndexCount = 0;
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+}
+
+icy::System::OpenGLIndirectRenderer::MeshHandle icy::System::OpenGLIndirectRenderer::addMesh(const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	MeshLod lod;
+	lod.indices.assign(indices, indices + indexCount);
+	lod.error = 0.0f;
+	return addMesh(vertices, vertexCount, &lod, 1);
+}
+
+icy::System::OpenGLIndirectRenderer::MeshHandle icy::System::OpenGLIndirectRenderer::addMesh(const Vertex* vertices, uint32_t vertexCount, const MeshLod* lods, uint32_t lodCount)
+{
+	if (lodCount > MeshSimplifier::MaxLodLevels)
+		lodCount = MeshSimplifier::MaxLodLevels;
+	uint32_t indexCount = 0;
+	for (uint32_t i = 0; i < lodCount; ++i)
+		indexCount += static_cast<uint32_t>(lods[i].indices.size());
+	if (lodCount == 0 || m_Meshes.size() == MaxMeshes || m_VertexCount + vertexCount > MaxVertices || m_IndexCount + indexCount > MaxIndices)
+		return InvalidHandle;
+
+	// The levels follow each other in the index buffer and share the vertices
+	OcclusionMeshLods table = {};
+	table.lodCount = lodCount;
+	uint32_t firstIndex = m_IndexCount;
+	for (uint32_t i = 0; i < lodCount; ++i)
+	{
+		const uint32_t count = static_cast<uint32_t>(lods[i].indices.size());
+		m_StateCache->bufferSubData(m_IndexBuffer, firstIndex * sizeof(uint32_t), count * sizeof(uint32_t), lods[i].indices.data());
+		table.levels[i] = { count, firstIndex, lods[i].error, 0 };
+		firstIndex += count;
+	}
+	m_StateCache->bufferSubData(m_VertexBuffer, m_VertexCount * sizeof(Vertex), vertexCount * sizeof(Vertex), vertices);
+	m_StateCache->bufferSubData(m_MeshLodBuffer, m_Meshes.size() * sizeof(OcclusionMeshLods), sizeof(OcclusionMeshLods), &table);
+	MeshInfo mesh = { table.levels[0].count, m_IndexCount, static_cast<int32_t>(m_VertexCount), { 0.0f, 0.0f, 0.0f, 0.0f } };
+
+	// Sphere around the bounding box, what the occlusion culler tests
+	if (vertexCount > 0)
+	{
+		float lower[3];
+		float upper[3];
+		for (int axis = 0; axis < 3; ++axis)
+			lower[axis] = upper[axis] = vertices[0].position[axis];
+		for (uint32_t i = 1; i < vertexCount; ++i)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				lower[axis] = std::min(lower[axis], vertices[i].position[axis]);
+				upper[axis] = std::max(upper[axis], vertices[i].position[axis]);
+			}
+		}
+		for (int axis = 0; axis < 3; ++axis)
+			mesh.bounds[axis] = (lower[axis] + upper[axis]) * 0.5f;
+		float radius = 0.0f;
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			float distance = 0.0f;
+			for (int axis = 0; axis < 3; ++axis)
+				distance += (vertices[i].position[axis] - mesh.bounds[axis]) * (vertices[i].position[axis] - mesh.bounds[axis]);
+			radius = std::max(radius, distance);
+		}
+		mesh.bounds[3] = std::sqrt(radius);
+	}
+	m_Meshes.push_back(mesh);
+	m_VertexCount += vertexCount;
+	m_IndexCount += indexCount;
+	return static_cast<MeshHandle>(m_Meshes.size() - 1);
+}
+
+icy::System::OpenGLIndirectRenderer::TextureHandle icy::System::OpenGLIndirectRenderer::addTexture(const void* rgba, int width, int height)
+{
+	if (m_Bindless)
+	{
+		GLuint texture = m_StateCache->createTexture2D(mipLevels(width, height), GL_RGBA8, width, height);
+		m_StateCache->textureSubImage2D(texture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+		glGenerateTextureMipmap(texture);
+		// Sampling state is frozen once a handle exists
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLuint64 handle = m_GetTextureHandle(texture);
+		m_MakeResident(handle);
+		m_Textures.push_back(texture);
+		m_TextureHandles.push_back(handle);
+		return static_cast<TextureHandle>(m_Textures.size() - 1);
+	}
+
+	if (width != ArrayTextureSize || height != ArrayTextureSize || m_TextureLayers == ArrayTextureLayers)
+		return InvalidHandle;
+	glTextureSubImage3D(m_TextureArray, 0, 0, 0, m_TextureLayers, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	glGenerateTextureMipmap(m_TextureArray);
+	return static_cast<TextureHandle>(m_TextureLayers++);
+}
+
+icy::System::OpenGLIndirectRenderer::MaterialHandle icy::System::OpenGLIndirectRenderer::createMaterial(const char* vertexSource, const char* fragmentSource)
+{
+	GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if (vertex == 0 || fragment == 0)
+	{
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+		return InvalidHandle;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	glLinkProgram(program);
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		std::cout << "Failed to link material: " << log << std::endl;
+		glDeleteProgram(program);
+		return InvalidHandle;
+	}
+	m_Programs.push_back(program);
+	return static_cast<MaterialHandle>(m_Programs.size() - 1);
+}
+
+void icy::System::OpenGLIndirectRenderer::submit(MeshHandle mesh, MaterialHandle material, TextureHandle texture, const float* model, uint64_t sortKey,
+	uint32_t instance)
+{
+	if (m_Submissions.size() == MaxDraws)
+		return;
+	m_Submissions.emplace_back();
+	Submission& submission = m_Submissions.back();
+	submission.material = material;
+	submission.mesh = mesh;
+	submission.texture = texture;
+	submission.instance = instance;
+	submission.fromScene = false;
+	std::memcpy(submission.model, model, sizeof(submission.model));
+	m_SortKeys.push_back(sortKey);
+	m_SortOrder.push_back(static_cast<uint32_t>(m_Submissions.size() - 1));
+}
+
+void icy::System::OpenGLIndirectRenderer::submitInstance(MeshHandle mesh, MaterialHandle material, SceneInstances::InstanceId instance, uint64_t sortKey)
+{
+	if (m_Submissions.size() == MaxDraws || m_Scene == nullptr || !m_Scene->isCreated() || !m_Scene->getInstances().isAlive(instance))
+		return;
+	// The model is only looked up if the draw is culled
+	m_Submissions.emplace_back();
+	Submission& submission = m_Submissions.back();
+	submission.material = material;
+	submission.mesh = mesh;
+	submission.texture = InvalidHandle;
+	submission.instance = instance;
+	submission.fromScene = true;
+	m_SortKeys.push_back(sortKey);
+	m_SortOrder.push_back(static_cast<uint32_t>(m_Submissions.size() - 1));
+}
+
+void icy::System::OpenGLIndirectRenderer::getTextureWords(TextureHandle texture, uint32_t* words) const
+{
+	if (m_Bindless)
+	{
+		GLuint64 handle = m_TextureHandles[texture];
+		words[0] = static_cast<uint32_t>(handle);
+		words[1] = static_cast<uint32_t>(handle >> 32);
+	}
+	else
+	{
+		words[0] = texture;
+		words[1] = 0;
+	}
+	words[2] = words[3] = 0;
+}
+
+void icy::System::OpenGLIndirectRenderer::flush()
+{
+	m_LastStats = {};
+	if (m_Scene != nullptr)
+		m_Scene->update();
+	if (m_Submissions.empty())
+		return;
+
+	// Keys put draws sharing state next to each other, each run of one material becomes a multi draw
+	m_Sorter.sort(m_SortKeys.data(), m_SortOrder.data(), static_cast<uint32_t>(m_SortKeys.size()), m_SortPool);
+
+	// The commands of every batch sit together so the culler can address them by draw,
+	// the draw data range starts at each batch so a draw's index in it is its baseInstance
+	// Scene draws break the runs too, their baseInstance is their instance id in the whole scene buffer
+	const uint32_t total = static_cast<uint32_t>(m_SortOrder.size());
+	const bool culling = m_Culler != nullptr && m_Culler->isActive();
+	auto commands = m_StreamBuffer->allocate(total * sizeof(DrawCommand), 16);
+	OpenGLStreamBuffer::Allocation cullDraws = {};
+	if (culling)
+		cullDraws = m_StreamBuffer->allocate(total * sizeof(OcclusionDraw), m_StreamBuffer->getStorageAlignment());
+	if (commands.data == nullptr || (culling && cullDraws.data == nullptr))
+	{
+		std::cout << "Stream buffer out of space, dropped " << total << " draws" << std::endl;
+		m_Submissions.clear();
+		m_SortKeys.clear();
+		m_SortOrder.clear();
+		return;
+	}
+
+	DrawCommand* command = static_cast<DrawCommand*>(commands.data);
+	OcclusionDraw* cullDraw = static_cast<OcclusionDraw*>(cullDraws.data);
+	m_Batches.clear();
+	uint32_t begin = 0;
+	while (begin < total)
+	{
+		const Submission& first = m_Submissions[m_SortOrder[begin]];
+		const MaterialHandle material = first.material;
+		const bool fromScene = first.fromScene;
+		uint32_t end = begin + 1;
+		while (end < total && m_Submissions[m_SortOrder[end]].material == material && m_Submissions[m_SortOrder[end]].fromScene == fromScene)
+			++end;
+		uint32_t count = end - begin;
+
+		OpenGLStreamBuffer::Allocation draws = {};
+		if (!fromScene)
+		{
+			draws = m_StreamBuffer->allocate(count * sizeof(DrawData), m_StreamBuffer->getStorageAlignment());
+			if (draws.data == nullptr)
+			{
+				std::cout << "Stream buffer out of space, dropped " << total - begin << " draws" << std::endl;
+				break;
+			}
+		}
+
+		DrawData* data = static_cast<DrawData*>(draws.data);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const Submission& submission = m_Submissions[m_SortOrder[begin + i]];
+			const MeshInfo& mesh = m_Meshes[submission.mesh];
+			const float* model = submission.model;
+			if (fromScene)
+			{
+				command[begin + i] = { mesh.indexCount, 1, mesh.firstIndex, mesh.baseVertex, submission.instance };
+				model = m_Scene->getInstances().get(submission.instance).model;
+			}
+			else
+			{
+				command[begin + i] = { mesh.indexCount, 1, mesh.firstIndex, mesh.baseVertex, i };
+				std::memcpy(data[i].model, submission.model, sizeof(data[i].model));
+				getTextureWords(submission.texture, data[i].texture);
+			}
+			if (culling)
+			{
+				OcclusionDraw& target = cullDraw[begin + i];
+				target.scale = transformSphere(model, mesh.bounds, target.sphere);
+				target.mesh = submission.mesh;
+				target.instance = submission.instance < m_Culler->getMaxInstances() ? submission.instance : OcclusionNoInstance;
+				target.pad = 0;
+			}
+		}
+
+		if (fromScene)
+			m_Batches.push_back({ material, begin, count, m_Scene->getBuffer(), 0, OpenGLSceneBuffer::BufferSize });
+		else
+			m_Batches.push_back({ material, begin, count, m_StreamBuffer->getBuffer(), draws.offset, draws.size });
+		m_LastStats.draws += count;
+		begin = end;
+	}
+
+	m_StateCache->bindVertexArray(m_VertexArray);
+	if (!m_Bindless)
+		m_StateCache->bindTextureUnit(TextureArrayUnit, m_TextureArray);
+	// What last frame's depth hid is re-tested against this frame's once the visible part is drawn
+	if (culling && m_Culler->cullFirstPhase(commands, cullDraws, m_LastStats.draws, m_MeshLodBuffer))
+	{
+		drawBatches(m_Culler->getCommandBuffer(), 0);
+		m_Culler->buildPyramid();
+		m_Culler->cullSecondPhase();
+		drawBatches(m_Culler->getCommandBuffer(), m_Culler->getSecondPhaseOffset());
+	}
+	else
+		drawBatches(m_StreamBuffer->getBuffer(), commands.offset);
+
+	m_Submissions.clear();
+	m_SortKeys.clear();
+	m_SortOrder.clear();
+}
+
+void icy::System::OpenGLIndirectRenderer::drawBatches(GLuint commandBuffer, GLintptr commandsOffset)
+{
+	m_StateCache->bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	for (const Batch& batch : m_Batches)
+	{
+		m_StateCache->useProgram(m_Programs[batch.material]);
+		m_StateCache->bindBufferRange(GL_SHADER_STORAGE_BUFFER, DrawDataBinding, batch.drawsBuffer, batch.drawsOffset, batch.drawsSize);
+		const GLintptr offset = commandsOffset + batch.first * sizeof(DrawCommand);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset), batch.count, 0);
+		++m_LastStats.multiDrawCalls;
+	}
+}
+
+void icy::System::OpenGLIndirectRenderer::loadBindlessFunctions()
+{
+	// glad was generated without extensions, so these come straight from SDL
+	m_Bindless = false;
+	if (SDL_GL_ExtensionSupported("GL_ARB_bindless_texture") != SDL_TRUE)
+		return;
+	m_GetTextureHandle = reinterpret_cast<GetTextureHandleProc>(SDL_GL_GetProcAddress("glGetTextureHandleARB"));
+	m_MakeResident = reinterpret_cast<MakeTextureHandleResidentProc>(SDL_GL_GetProcAddress("glMakeTextureHandleResidentARB"));
+	m_MakeNonResident = reinterpret_cast<MakeTextureHandleNonResidentProc>(SDL_GL_GetProcAddress("glMakeTextureHandleNonResidentARB"));
+	m_Bindless = m_GetTextureHandle != nullptr && m_MakeResident != nullptr && m_MakeNonResident != nullptr;
+}
+
+GLuint icy::System::OpenGLIndirectRenderer::compileShader(GLenum type, const char* source)
+{
+	// The preamble has to follow the #version line
+	const char* body = source;
+	const char* version = std::strstr(source, "#version");
+	if (version != nullptr)
+	{
+		const char* newline = std::strchr(version, '\n');
+		body = newline != nullptr ? newline + 1 : version + std::strlen(version);
+	}
+
+	const char* drawId = "";
+	if (type == GL_VERTEX_SHADER)
+		drawId = m_DrawParameters ? DrawParametersPreamble : DrawIndexPreamble;
+	const GLchar* strings[] = { source, drawId, m_Bindless ? BindlessPreamble : ArrayPreamble, body };
+	const GLint lengths[] = { static_cast<GLint>(body - source), -1, -1, -1 };
+
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 4, strings, lengths);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		std::cout << "Failed to compile shader: " << log << std::endl;
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
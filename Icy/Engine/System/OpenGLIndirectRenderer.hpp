@@ -0,0 +1,195 @@
+#pragma once
+#include "MeshSimplifier.hpp"
+#include "OpenGLOcclusionCuller.hpp"
+#include "OpenGLSceneBuffer.hpp"
+#include "OpenGLStateCache.hpp"
+#include "OpenGLStreamBuffer.hpp"
+#include "RadixSort.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		// GPU driven scene renderer for the OpenGL backend
+		// Every mesh lives in one shared vertex/index buffer so a whole material batch is a single glMultiDrawElementsIndirect.
+		// Per draw data (transform, texture) is read from an SSBO indexed by the draw id,
+		// textures are ARB_bindless_texture handles when the driver has them and layers of one texture array otherwise
+		// With an occlusion culler the draws are culled on the GPU and go out in two passes, see OpenGLOcclusionCuller,
+		// which also picks the level of detail of meshes added with a LOD chain
+		// Draws of OpenGLSceneBuffer instances read their data from the scene buffer and upload nothing but the command
+		class OpenGLIndirectRenderer
+		{
+		public:
+			typedef uint32_t MeshHandle;
+			typedef uint32_t MaterialHandle;
+			typedef uint32_t TextureHandle;
+			static constexpr uint32_t InvalidHandle = 0xFFFFFFFFu;
+
+			static constexpr uint32_t MaxVertices = 1 << 18;
+			static constexpr uint32_t MaxIndices = 1 << 20;
+			static constexpr uint32_t MaxDraws = 1 << 14;
+			static constexpr uint32_t MaxMeshes = 1 << 12;
+			// Draw data is indexed by baseInstance, which is the instance id for scene draws
+			static constexpr uint32_t MaxDrawIndices = SceneInstances::MaxInstances > MaxDraws ? SceneInstances::MaxInstances : MaxDraws;
+			// Texture array fallback, every texture must have this size
+			static constexpr int ArrayTextureSize = 512;
+			static constexpr int ArrayTextureLayers = 256;
+
+			// Shader bindings reserved by the renderer
+			static constexpr GLuint DrawDataBinding = 0;
+			static constexpr GLuint TextureArrayUnit = 0;
+			static constexpr GLuint DrawIndexLocation = 15;
+
+			struct Vertex
+			{
+				float position[3];
+				float normal[3];
+				float uv[2];
+			};
+
+			struct FrameStats
+			{
+				uint32_t draws;
+				uint32_t multiDrawCalls;
+			};
+
+			OpenGLIndirectRenderer();
+			~OpenGLIndirectRenderer();
+			OpenGLIndirectRenderer(const OpenGLIndirectRenderer&) = delete;
+			OpenGLIndirectRenderer& operator=(const OpenGLIndirectRenderer&) = delete;
+
+			// Creates the shared buffers, needs a current 4.5 context
+			bool create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer);
+			void destroy();
+			bool hasBindlessTextures() const { return m_Bindless; }
+			bool hasDrawParameters() const { return m_DrawParameters; }
+
+			// Copies the mesh into the shared buffers, returns InvalidHandle when they are full
+			MeshHandle addMesh(const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+			// Copies a mesh with levels of detail, see MeshSimplifier::buildLodChain, every level indexes the same vertices
+			// Level 0 is drawn unless the occlusion culler picks a coarser one
+			MeshHandle addMesh(const Vertex* vertices, uint32_t vertexCount, const MeshLod* lods, uint32_t lodCount);
+			// rgba : width * height RGBA8 pixels
+			// Without bindless textures the size must match ArrayTextureSize
+			TextureHandle addTexture(const void* rgba, int width, int height);
+			// Compiles a program with the renderer preamble inserted after each #version line
+			// The preamble declares ICY_DRAW_ID, the IcyDrawData array icy_Draws and icySampleTexture(draw, uv)
+			// ICY_DRAW_ID is the draw's baseInstance, the index of its data in whichever buffer icy_Draws is bound to
+			// The vertex shader has to forward ICY_DRAW_ID to the fragment shader as a flat varying if it samples textures
+			MaterialHandle createMaterial(const char* vertexSource, const char* fragmentSource);
+
+			// Queues a draw for this frame
+			// model : column major 4x4 transform
+			// sortKey : draw order, see icy::Renderer::RenderQueue::makeKey, equal keys keep their submission order
+			// instance : id the same object keeps from frame to frame so its LOD doesn't flicker, below the culler's instance count
+			void submit(MeshHandle mesh, MaterialHandle material, TextureHandle texture, const float* model, uint64_t sortKey,
+				uint32_t instance = InvalidHandle);
+			// Queues a draw of a live instance of the scene buffer, its transform and texture are read from there
+			// The instance id doubles as the culler's instance, so it shouldn't be mixed with ids passed to submit()
+			void submitInstance(MeshHandle mesh, MaterialHandle material, SceneInstances::InstanceId instance, uint64_t sortKey);
+			// The words IcyDrawData holds for texture, what SceneInstance::texture needs for these materials
+			void getTextureWords(TextureHandle texture, uint32_t* words) const;
+			// Sorts everything submitted by key and issues one multi draw per run of draws sharing a material, then clears the queue
+			void flush();
+			// Lets flush() sort on the pool's threads when a frame has enough draws
+			void setSortThreadPool(ThreadPool* pool) { m_SortPool = pool; }
+			// Scene buffer submitInstance draws from, flush() brings it up to date first
+			void setSceneBuffer(OpenGLSceneBuffer* scene) { m_Scene = scene; }
+			// Culls every flush against the frustum and last frame's depth while the culler is active, nullptr turns it off
+			// The culler must have been created with at least MaxDraws draws and uses texture unit PyramidUnit
+			void setOcclusionCuller(OpenGLOcclusionCuller* culler) { m_Culler = culler; }
+			const FrameStats& getLastFrameStats() const { return m_LastStats; }
+
+		private:
+			struct MeshInfo
+			{
+				uint32_t indexCount;
+				uint32_t firstIndex;
+				int32_t baseVertex;
+				// Bounding sphere in model space, center and radius
+				float bounds[4];
+			};
+			struct Submission
+			{
+				MaterialHandle material;
+				MeshHandle mesh;
+				TextureHandle texture;
+				uint32_t instance;
+				// The transform and texture are the scene buffer's
+				bool fromScene;
+				float model[16];
+			};
+			// Matches DrawElementsIndirectCommand in the GL spec
+			struct DrawCommand
+			{
+				uint32_t count;
+				uint32_t instanceCount;
+				uint32_t firstIndex;
+				int32_t baseVertex;
+				uint32_t baseInstance;
+			};
+			// Matches IcyDrawData in the shader preamble (std430)
+			struct DrawData
+			{
+				float model[16];
+				uint32_t texture[4];
+			};
+
+			// A run of draws sharing a material and the buffer their data is in, first indexes the frame's commands
+			struct Batch
+			{
+				MaterialHandle material;
+				uint32_t first;
+				uint32_t count;
+				GLuint drawsBuffer;
+				GLintptr drawsOffset;
+				GLsizeiptr drawsSize;
+			};
+
+			void drawBatches(GLuint commandBuffer, GLintptr commandsOffset);
+			void loadBindlessFunctions();
+			GLuint compileShader(GLenum type, const char* source);
+
+		private:
+			typedef GLuint64(APIENTRY* GetTextureHandleProc)(GLuint texture);
+			typedef void (APIENTRY* MakeTextureHandleResidentProc)(GLuint64 handle);
+			typedef void (APIENTRY* MakeTextureHandleNonResidentProc)(GLuint64 handle);
+
+			OpenGLStateCache* m_StateCache;
+			OpenGLStreamBuffer* m_StreamBuffer;
+			bool m_Bindless;
+			bool m_DrawParameters;
+			GetTextureHandleProc m_GetTextureHandle;
+			MakeTextureHandleResidentProc m_MakeResident;
+			MakeTextureHandleNonResidentProc m_MakeNonResident;
+
+			GLuint m_VertexBuffer;
+			GLuint m_IndexBuffer;
+			GLuint m_DrawIndexBuffer;
+			// OcclusionMeshLods of every mesh
+			GLuint m_MeshLodBuffer;
+			GLuint m_VertexArray;
+			uint32_t m_VertexCount;
+			uint32_t m_IndexCount;
+			GLuint m_TextureArray;
+			int m_TextureLayers;
+
+			std::vector<MeshInfo> m_Meshes;
+			std::vector<GLuint> m_Programs;
+			std::vector<GLuint> m_Textures;
+			std::vector<GLuint64> m_TextureHandles;
+			std::vector<Submission> m_Submissions;
+			// Sort keys and the submission index each belongs to
+			std::vector<uint64_t> m_SortKeys;
+			std::vector<uint32_t> m_SortOrder;
+			RadixSorter m_Sorter;
+			ThreadPool* m_SortPool;
+			std::vector<Batch> m_Batches;
+			OpenGLOcclusionCuller* m_Culler;
+			OpenGLSceneBuffer* m_Scene;
+			FrameStats m_LastStats;
+		};
+	}
+}
@@ -0,0 +1,350 @@
+#include "OpenGLOcclusionCuller.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "OpenGLShaders.hpp"
+
+namespace
+{
+	int previousPowerOfTwo(int size)
+	{
+		int power = 1;
+		while (power * 2 <= size)
+			power *= 2;
+		return power;
+	}
+
+	GLuint groupCount(uint32_t threads, uint32_t groupSize)
+	{
+		return (threads + groupSize - 1) / groupSize;
+	}
+}
+
+icy::System::OpenGLOcclusionCuller::OpenGLOcclusionCuller()
+{
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+	m_MaxDraws = 0;
+	m_MaxInstances = 0;
+	m_DepthProgram = 0;
+	m_DownsampleProgram = 0;
+	m_CullPrograms[0] = m_CullPrograms[1] = 0;
+	m_DepthTexture = 0;
+	m_PyramidWidth = 0;
+	m_PyramidHeight = 0;
+	m_PyramidLevels = 0;
+	m_Pyramid = 0;
+	m_bPyramid = false;
+	std::memset(m_PyramidViewProjection, 0, sizeof(m_PyramidViewProjection));
+	m_bCamera = false;
+	m_bLodCamera = false;
+	m_LodThreshold = 1.0f;
+	m_Params = {};
+	m_Params.lodHysteresis = 0.25f;
+	m_Commands = {};
+	m_Draws = {};
+	m_MeshLods = 0;
+	m_CommandBuffer = 0;
+	m_StateBuffer = 0;
+	m_LodStateBuffer = 0;
+	m_ReadbackBuffer = 0;
+	m_Readback = nullptr;
+	for (int i = 0; i < ReadbackSlots; ++i)
+	{
+		m_ReadbackFences[i] = nullptr;
+		m_ReadbackFrame[i] = 0;
+		m_ReadbackDraws[i] = 0;
+	}
+	m_ReadbackSlot = 0;
+	m_Frame = 0;
+	m_Stats = {};
+}
+
+icy::System::OpenGLOcclusionCuller::~OpenGLOcclusionCuller()
+{
+	destroy();
+}
+
+bool icy::System::OpenGLOcclusionCuller::create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory, uint32_t maxDraws,
+	uint32_t maxInstances)
+{
+	destroy();
+	m_StateCache = stateCache;
+	m_StreamBuffer = streamBuffer;
+	m_MaxDraws = maxDraws;
+	m_MaxInstances = maxInstances != 0 ? maxInstances : maxDraws;
+
+	const std::string directory = shaderDirectory;
+	const std::string pyramidSource = readShaderFile(directory + "hiz.comp", "culling");
+	const std::string cullSource = readShaderFile(directory + "occlusion.comp", "culling");
+	if (pyramidSource.empty() || cullSource.empty())
+	{
+		destroy();
+		return false;
+	}
+	m_DepthProgram = compileComputeProgram(pyramidSource, "#define ICY_PASS 0\n", "culling");
+	m_DownsampleProgram = compileComputeProgram(pyramidSource, "#define ICY_PASS 1\n", "culling");
+	m_CullPrograms[0] = compileComputeProgram(cullSource, "#define ICY_PHASE 1\n", "culling");
+	m_CullPrograms[1] = compileComputeProgram(cullSource, "#define ICY_PHASE 2\n", "culling");
+	if (m_DepthProgram == 0 || m_DownsampleProgram == 0 || m_CullPrograms[0] == 0 || m_CullPrograms[1] == 0)
+	{
+		destroy();
+		return false;
+	}
+
+	// Two phases of commands, the counters and a state per draw, only the counters' copies reach the CPU
+	// Instances start out at level 0
+	m_CommandBuffer = m_StateCache->createBuffer(2 * m_MaxDraws * 5 * sizeof(uint32_t), nullptr, 0);
+	m_StateBuffer = m_StateCache->createBuffer(CounterSize + m_MaxDraws * sizeof(uint32_t), nullptr, 0);
+	const std::vector<uint32_t> lodStates(m_MaxInstances, 0);
+	m_LodStateBuffer = m_StateCache->createBuffer(m_MaxInstances * sizeof(uint32_t), lodStates.data(), 0);
+	const GLbitfield readFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	m_ReadbackBuffer = m_StateCache->createBuffer(ReadbackSlots * CounterSize, nullptr, readFlags);
+	m_Readback = static_cast<const uint32_t*>(glMapNamedBufferRange(m_ReadbackBuffer, 0, ReadbackSlots * CounterSize, readFlags));
+	if (m_Readback == nullptr)
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::OpenGLOcclusionCuller::destroy()
+{
+	if (m_StateCache == nullptr)
+		return;
+	for (int i = 0; i < ReadbackSlots; ++i)
+	{
+		if (m_ReadbackFences[i] != nullptr)
+			glDeleteSync(m_ReadbackFences[i]);
+		m_ReadbackFences[i] = nullptr;
+	}
+	const GLuint programs[] = { m_DepthProgram, m_DownsampleProgram, m_CullPrograms[0], m_CullPrograms[1] };
+	for (GLuint program : programs)
+	{
+		if (program != 0)
+			m_StateCache->deleteProgram(program);
+	}
+	if (m_Pyramid != 0)
+		m_StateCache->deleteTexture(m_Pyramid);
+	if (m_Readback != nullptr)
+		glUnmapNamedBuffer(m_ReadbackBuffer);
+	const GLuint buffers[] = { m_CommandBuffer, m_StateBuffer, m_LodStateBuffer, m_ReadbackBuffer };
+	for (GLuint buffer : buffers)
+	{
+		if (buffer != 0)
+			m_StateCache->deleteBuffer(buffer);
+	}
+
+	m_DepthProgram = 0;
+	m_DownsampleProgram = 0;
+	m_CullPrograms[0] = m_CullPrograms[1] = 0;
+	m_DepthTexture = 0;
+	m_Pyramid = 0;
+	m_bPyramid = false;
+	m_bCamera = false;
+	m_bLodCamera = false;
+	m_MeshLods = 0;
+	m_CommandBuffer = 0;
+	m_StateBuffer = 0;
+	m_LodStateBuffer = 0;
+	m_ReadbackBuffer = 0;
+	m_Readback = nullptr;
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+}
+
+bool icy::System::OpenGLOcclusionCuller::setDepthTarget(GLuint depthTexture, int width, int height)
+{
+	if (m_StateCache == nullptr)
+		return false;
+	const int pyramidWidth = previousPowerOfTwo(width);
+	const int pyramidHeight = previousPowerOfTwo(height);
+	if (depthTexture == m_DepthTexture && pyramidWidth == m_PyramidWidth && pyramidHeight == m_PyramidHeight)
+		return true;
+
+	if (m_Pyramid != 0)
+		m_StateCache->deleteTexture(m_Pyramid);
+	m_Pyramid = 0;
+	m_bPyramid = false;
+	m_DepthTexture = depthTexture;
+	if (depthTexture == 0 || width <= 0 || height <= 0)
+	{
+		m_DepthTexture = 0;
+		return depthTexture == 0;
+	}
+
+	// Level 0 is the largest power of two that fits, each of its texels covers up to 2x2 depth texels
+	m_PyramidWidth = pyramidWidth;
+	m_PyramidHeight = pyramidHeight;
+	m_PyramidLevels = 1;
+	for (int size = pyramidWidth > pyramidHeight ? pyramidWidth : pyramidHeight; size > 1; size >>= 1)
+		++m_PyramidLevels;
+	m_Pyramid = m_StateCache->createTexture2D(m_PyramidLevels, GL_R32F, m_PyramidWidth, m_PyramidHeight);
+	glTextureParameteri(m_Pyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(m_Pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	return m_Pyramid != 0;
+}
+
+void icy::System::OpenGLOcclusionCuller::setCamera(const float* viewProjection)
+{
+	std::memcpy(m_Params.viewProjection, viewProjection, sizeof(m_Params.viewProjection));
+	extractFrustum(viewProjection, m_Params);
+	m_bCamera = true;
+}
+
+void icy::System::OpenGLOcclusionCuller::setLodCamera(const float* position, int viewportHeight, float tanHalfFovY)
+{
+	for (int i = 0; i < 3; ++i)
+		m_Params.cameraPosition[i] = position[i];
+	m_Params.cameraPosition[3] = 1.0f;
+	m_Params.lodScale = tanHalfFovY > 0.0f ? 0.5f * viewportHeight / tanHalfFovY : 0.0f;
+	m_bLodCamera = m_Params.lodScale > 0.0f;
+}
+
+void icy::System::OpenGLOcclusionCuller::setLodThreshold(float pixels, float hysteresis)
+{
+	m_LodThreshold = pixels > 0.0f ? pixels : 0.0f;
+	m_Params.lodHysteresis = std::min(std::max(hysteresis, 0.0f), 1.0f);
+}
+
+bool icy::System::OpenGLOcclusionCuller::cullFirstPhase(const OpenGLStreamBuffer::Allocation& commands, const OpenGLStreamBuffer::Allocation& draws, uint32_t count, GLuint meshLods)
+{
+	// Take the counts from the oldest copy if they have landed, never wait for them
+	m_ReadbackSlot = (m_ReadbackSlot + 1) % ReadbackSlots;
+	collect(m_ReadbackSlot);
+	++m_Frame;
+
+	m_Commands = commands;
+	m_Draws = draws;
+	m_MeshLods = meshLods;
+	// Without a LOD camera every draw keeps level 0
+	m_Params.lodThreshold = m_bLodCamera && meshLods != 0 ? m_LodThreshold : 0.0f;
+	m_Params.drawCount = count < m_MaxDraws ? count : m_MaxDraws;
+	m_Params.pyramidSize[0] = static_cast<float>(m_PyramidWidth);
+	m_Params.pyramidSize[1] = static_cast<float>(m_PyramidHeight);
+	m_Params.secondPhaseOffset = m_MaxDraws;
+	// Without last frame's pyramid everything in the frustum is drawn in the first phase
+	m_Params.pyramidLevels = m_bPyramid ? m_PyramidLevels : 0;
+	if (!uploadParams(m_PyramidViewProjection))
+		return false;
+
+	// The counters start from zero, a clear is ordered before the dispatch without a barrier
+	glClearNamedBufferSubData(m_StateBuffer, GL_R32UI, 0, CounterSize, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	m_StateCache->useProgram(m_CullPrograms[0]);
+	glDispatchCompute(groupCount(m_Params.drawCount, WorkgroupSize), 1, 1);
+	// The commands are read as draw arguments next, the states by the second phase
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	return true;
+}
+
+void icy::System::OpenGLOcclusionCuller::buildPyramid()
+{
+	m_StateCache->bindTextureUnit(PyramidUnit, m_DepthTexture);
+	glBindImageTexture(TargetImageUnit, m_Pyramid, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	m_StateCache->useProgram(m_DepthProgram);
+	glDispatchCompute(groupCount(m_PyramidWidth, 8), groupCount(m_PyramidHeight, 8), 1);
+
+	m_StateCache->useProgram(m_DownsampleProgram);
+	for (int level = 1; level < m_PyramidLevels; ++level)
+	{
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		const int width = m_PyramidWidth >> level > 0 ? m_PyramidWidth >> level : 1;
+		const int height = m_PyramidHeight >> level > 0 ? m_PyramidHeight >> level : 1;
+		glBindImageTexture(SourceImageUnit, m_Pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(TargetImageUnit, m_Pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute(groupCount(width, 8), groupCount(height, 8), 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	m_bPyramid = true;
+	std::memcpy(m_PyramidViewProjection, m_Params.viewProjection, sizeof(m_PyramidViewProjection));
+}
+
+void icy::System::OpenGLOcclusionCuller::cullSecondPhase()
+{
+	m_Params.pyramidLevels = m_PyramidLevels;
+	if (!uploadParams(m_PyramidViewProjection))
+		return;
+	m_StateCache->useProgram(m_CullPrograms[1]);
+	glDispatchCompute(groupCount(m_Params.drawCount, WorkgroupSize), 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	glCopyNamedBufferSubData(m_StateBuffer, m_ReadbackBuffer, 0, m_ReadbackSlot * CounterSize, CounterSize);
+	m_ReadbackFences[m_ReadbackSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_ReadbackFrame[m_ReadbackSlot] = m_Frame;
+	m_ReadbackDraws[m_ReadbackSlot] = m_Params.drawCount;
+}
+
+GLintptr icy::System::OpenGLOcclusionCuller::getSecondPhaseOffset() const
+{
+	return m_MaxDraws * 5 * sizeof(uint32_t);
+}
+
+void icy::System::OpenGLOcclusionCuller::extractFrustum(const float* viewProjection, OcclusionParams& params)
+{
+	// Gribb and Hartmann, the planes are sums and differences of the last row with the others
+	const float* m = viewProjection;
+	for (int i = 0; i < 6; ++i)
+	{
+		const int row = i / 2;
+		const float sign = i % 2 == 0 ? 1.0f : -1.0f;
+		float plane[4];
+		for (int column = 0; column < 4; ++column)
+			plane[column] = m[column * 4 + 3] + sign * m[column * 4 + row];
+		const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (int j = 0; j < 4; ++j)
+			params.frustum[i][j] = length > 0.0f ? plane[j] / length : plane[j];
+	}
+}
+
+bool icy::System::OpenGLOcclusionCuller::uploadParams(const float* pyramidViewProjection)
+{
+	std::memcpy(m_Params.pyramidViewProjection, pyramidViewProjection, sizeof(m_Params.pyramidViewProjection));
+	auto params = m_StreamBuffer->allocate(sizeof(m_Params), m_StreamBuffer->getUniformAlignment());
+	if (params.data == nullptr)
+	{
+		std::cout << "Stream buffer is out of space for the culling params" << std::endl;
+		return false;
+	}
+	std::memcpy(params.data, &m_Params, sizeof(m_Params));
+
+	// Both phases bind everything, the draws in between may have moved the bindings
+	const GLuint stream = m_StreamBuffer->getBuffer();
+	m_StateCache->bindBufferRange(GL_UNIFORM_BUFFER, ParamsBinding, stream, params.offset, params.size);
+	m_StateCache->bindBufferRange(GL_SHADER_STORAGE_BUFFER, CommandsBinding, stream, m_Commands.offset, m_Commands.size);
+	m_StateCache->bindBufferRange(GL_SHADER_STORAGE_BUFFER, DrawsBinding, stream, m_Draws.offset, m_Draws.size);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, CulledBinding, m_CommandBuffer);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, StateBinding, m_StateBuffer);
+	// Never left unbound, the table isn't read while lodThreshold is 0
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshLodsBinding, m_MeshLods != 0 ? m_MeshLods : m_LodStateBuffer);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, LodStateBinding, m_LodStateBuffer);
+	m_StateCache->bindTextureUnit(PyramidUnit, m_Pyramid);
+	return true;
+}
+
+void icy::System::OpenGLOcclusionCuller::collect(int slot)
+{
+	GLsync& fence = m_ReadbackFences[slot];
+	if (fence == nullptr)
+		return;
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+	{
+		const uint32_t* counters = m_Readback + slot * (CounterSize / sizeof(uint32_t));
+		m_Stats.frame = m_ReadbackFrame[slot];
+		m_Stats.draws = m_ReadbackDraws[slot];
+		m_Stats.frustumCulled = counters[0];
+		m_Stats.firstPhaseOccluded = counters[1];
+		m_Stats.secondPhase = counters[2];
+		m_Stats.occluded = counters[3];
+		const uint32_t inFrustum = m_Stats.draws - m_Stats.frustumCulled;
+		m_Stats.occludedRatio = inFrustum > 0 ? static_cast<float>(m_Stats.occluded) / inFrustum : 0.0f;
+		m_Stats.fullTriangles = counters[4];
+		m_Stats.lodTriangles = counters[5];
+		m_Stats.lodSwitches = counters[6];
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
\ No newline at end of file
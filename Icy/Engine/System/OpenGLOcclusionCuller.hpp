@@ -0,0 +1,201 @@
+#pragma once
+#include "MeshSimplifier.hpp"
+#include "OpenGLStateCache.hpp"
+#include "OpenGLStreamBuffer.hpp"
+#include <cstdint>
+
+namespace icy
+{
+	namespace System
+	{
+		// Matches IcyOcclusionParams in Engine\Shaders\occlusion.comp (std140)
+		struct OcclusionParams
+		{
+			float viewProjection[16];
+			float pyramidViewProjection[16];
+			// Normalised planes pointing inwards, a sphere is outside when dot(xyz, center) + w < -radius
+			float frustum[6][4];
+			float pyramidSize[2];
+			uint32_t drawCount;
+			uint32_t pyramidLevels;
+			uint32_t secondPhaseOffset;
+			// Pixels per world unit at a distance of one, a LOD's error projects to error * lodScale / distance
+			float lodScale;
+			// Largest projected error in pixels a LOD may have, 0 draws every mesh at its full detail
+			float lodThreshold;
+			// Share of the threshold a coarser LOD than last frame's has to stay under, so levels don't flicker at the threshold
+			float lodHysteresis;
+			float cameraPosition[4];
+		};
+		static_assert(sizeof(OcclusionParams) == 272, "OcclusionParams must match the std140 block");
+
+		// Matches IcyCullDraw, what the culler knows about each draw (std430)
+		struct OcclusionDraw
+		{
+			// World space bounding sphere
+			float sphere[4];
+			// Indexes the LOD table
+			uint32_t mesh;
+			// Keeps the draw's LOD from frame to frame, OcclusionNoInstance for none
+			uint32_t instance;
+			// Longest axis of the model transform, scales the LOD errors to world units
+			float scale;
+			uint32_t pad;
+		};
+		static constexpr uint32_t OcclusionNoInstance = 0xFFFFFFFFu;
+
+		// Matches IcyMeshLods, the index range and error of every level of a mesh (std430)
+		struct OcclusionMeshLods
+		{
+			uint32_t lodCount;
+			uint32_t pad[3];
+			struct Level
+			{
+				uint32_t count;
+				uint32_t firstIndex;
+				float error;
+				uint32_t pad;
+			} levels[MeshSimplifier::MaxLodLevels];
+		};
+		static_assert(sizeof(OcclusionMeshLods) == 16 + 16 * MeshSimplifier::MaxLodLevels, "OcclusionMeshLods must match the std430 struct");
+
+		// How one frame's draws were culled
+		struct OcclusionStats
+		{
+			// The flush the counts belong to, they come back a few flushes late
+			uint64_t frame;
+			uint32_t draws;
+			uint32_t frustumCulled;
+			// Hidden behind last frame's depth in the first phase, of which secondPhase turned out visible this frame
+			uint32_t firstPhaseOccluded;
+			uint32_t secondPhase;
+			uint32_t occluded;
+			// Occluded draws over draws inside the frustum
+			float occludedRatio;
+			// Triangles of the drawn draws at their full detail and at the LOD the culler picked
+			uint32_t fullTriangles;
+			uint32_t lodTriangles;
+			// Draws with an instance whose LOD changed since the frame before
+			uint32_t lodSwitches;
+		};
+
+		// Hierarchical-Z occlusion culling for OpenGLIndirectRenderer
+		// Every flush tests the draws' bounding spheres against the frustum and against a max depth pyramid of the
+		// previous frame (Engine\Shaders\occlusion.comp), draws what passes, rebuilds the pyramid from that depth
+		// (Engine\Shaders\hiz.comp) and re-tests what the old depth hid, so objects that came into view this frame
+		// are drawn in a second pass instead of popping in a frame late
+		// The first phase also picks each draw's level of detail from its projected error, see setLodCamera
+		class OpenGLOcclusionCuller
+		{
+		public:
+			static constexpr int ReadbackSlots = 3;
+			static constexpr uint32_t WorkgroupSize = 64;
+			// Uniform and storage block bindings of occlusion.comp, clear of the other GL systems
+			static constexpr GLuint ParamsBinding = 7;
+			static constexpr GLuint CommandsBinding = 7;
+			static constexpr GLuint DrawsBinding = 8;
+			static constexpr GLuint CulledBinding = 9;
+			static constexpr GLuint StateBinding = 10;
+			static constexpr GLuint MeshLodsBinding = 11;
+			static constexpr GLuint LodStateBinding = 12;
+			// Texture unit of the depth buffer and the pyramid, image units of hiz.comp
+			static constexpr GLuint PyramidUnit = 1;
+			static constexpr GLuint SourceImageUnit = 0;
+			static constexpr GLuint TargetImageUnit = 1;
+			// Counters at the start of the state buffer
+			static constexpr GLsizeiptr CounterSize = 32;
+
+			OpenGLOcclusionCuller();
+			~OpenGLOcclusionCuller();
+			OpenGLOcclusionCuller(const OpenGLOcclusionCuller&) = delete;
+			OpenGLOcclusionCuller& operator=(const OpenGLOcclusionCuller&) = delete;
+
+			// shaderDirectory : where hiz.comp and occlusion.comp are, ending in a separator
+			// maxDraws : most draws a single flush culls
+			// maxInstances : instance ids draws may have, 0 for as many as maxDraws, SceneInstances::MaxInstances for scene draws
+			// Needs a current 4.5 context
+			bool create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory, uint32_t maxDraws,
+				uint32_t maxInstances = 0);
+			void destroy();
+
+			// The depth texture attached to the framebuffer the draws go into, GL_LESS with the default depth range
+			// A new texture or size starts over without a pyramid, 0 turns culling off
+			bool setDepthTarget(GLuint depthTexture, int width, int height);
+			// Column major view projection the next flush is drawn with
+			void setCamera(const float* viewProjection);
+			// Where the camera is and how it projects, for the LOD selection of the next flushes
+			// viewportHeight : pixels, tanHalfFovY : tangent of half the vertical field of view
+			void setLodCamera(const float* position, int viewportHeight, float tanHalfFovY);
+			// pixels : largest projected error a LOD may have, 0 turns LOD selection off
+			// hysteresis : share of pixels a coarser LOD than the draw's last one has to stay under
+			void setLodThreshold(float pixels, float hysteresis);
+			// Has a depth target and a camera, OpenGLIndirectRenderer draws without culling otherwise
+			bool isActive() const { return m_DepthTexture != 0 && m_bCamera; }
+			// Draws with higher instance ids go without LOD hysteresis
+			uint32_t getMaxInstances() const { return m_MaxInstances; }
+
+			// The steps of a culled flush, in this order
+			// commands, draws : the draws' DrawElementsIndirectCommands and OcclusionDraws, count of each
+			// meshLods : OcclusionMeshLods of every mesh the draws use, the commands' index ranges are their level 0
+			// Returns false when nothing was culled and the draws should go out as they are
+			bool cullFirstPhase(const OpenGLStreamBuffer::Allocation& commands, const OpenGLStreamBuffer::Allocation& draws, uint32_t count, GLuint meshLods);
+			// Rebuilds the pyramid from the depth target, after the first phase's draws
+			void buildPyramid();
+			void cullSecondPhase();
+
+			// Holds both phases' commands, the first phase's at 0
+			GLuint getCommandBuffer() const { return m_CommandBuffer; }
+			GLintptr getSecondPhaseOffset() const;
+			GLuint getPyramid() const { return m_Pyramid; }
+
+			// The newest frame whose counts made it back, the CPU never waits for them
+			const OcclusionStats& getStats() const { return m_Stats; }
+
+			// Fills the planes of viewProjection into params.frustum
+			static void extractFrustum(const float* viewProjection, OcclusionParams& params);
+
+		private:
+			bool uploadParams(const float* pyramidViewProjection);
+			void collect(int slot);
+
+		private:
+			OpenGLStateCache* m_StateCache;
+			OpenGLStreamBuffer* m_StreamBuffer;
+			uint32_t m_MaxDraws;
+			uint32_t m_MaxInstances;
+			GLuint m_DepthProgram;
+			GLuint m_DownsampleProgram;
+			GLuint m_CullPrograms[2];
+
+			GLuint m_DepthTexture;
+			int m_PyramidWidth;
+			int m_PyramidHeight;
+			int m_PyramidLevels;
+			// R32F, farthest depth per texel, built from the last flush's depth
+			GLuint m_Pyramid;
+			bool m_bPyramid;
+			float m_PyramidViewProjection[16];
+			bool m_bCamera;
+			bool m_bLodCamera;
+			float m_LodThreshold;
+			OcclusionParams m_Params;
+			OpenGLStreamBuffer::Allocation m_Commands;
+			OpenGLStreamBuffer::Allocation m_Draws;
+			GLuint m_MeshLods;
+
+			GLuint m_CommandBuffer;
+			GLuint m_StateBuffer;
+			// Last LOD of every instance
+			GLuint m_LodStateBuffer;
+			// Counters per slot
+			GLuint m_ReadbackBuffer;
+			const uint32_t* m_Readback;
+			GLsync m_ReadbackFences[ReadbackSlots];
+			uint64_t m_ReadbackFrame[ReadbackSlots];
+			uint32_t m_ReadbackDraws[ReadbackSlots];
+			int m_ReadbackSlot;
+			uint64_t m_Frame;
+			OcclusionStats m_Stats;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "OpenGLParticleSystem.hpp"
+#include <cstdio>
+#include <iostream>
+#include "OpenGLShaders.hpp"
+
+namespace
+{
+	GLuint groupCount(uint32_t threads)
+	{
+		return (threads + icy::System::ParticleWorkgroupSize - 1) / icy::System::ParticleWorkgroupSize;
+	}
+}
+
+icy::System::OpenGLParticleSystem::OpenGLParticleSystem()
+{
+	m_StateCache = nullptr;
+	m_Constants = nullptr;
+	m_Emitter = {};
+	m_Params = {};
+	m_bReset = true;
+	m_ParticleBuffer = 0;
+	m_CounterBuffer = 0;
+	m_DeadBuffer = 0;
+	m_AliveBuffer = 0;
+	m_ReadbackBuffer = 0;
+	m_Readback = nullptr;
+	for (int i = 0; i < ReadbackSlots; ++i)
+	{
+		m_ReadbackFences[i] = nullptr;
+		m_ReadbackStep[i] = 0;
+		m_ReadbackList[i] = 0;
+	}
+	m_ReadbackSlot = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ParticlePass::Count); ++i)
+		m_Programs[i] = 0;
+	m_DrawProgram = 0;
+	m_VertexArray = 0;
+}
+
+icy::System::OpenGLParticleSystem::~OpenGLParticleSystem()
+{
+	destroy();
+}
+
+bool icy::System::OpenGLParticleSystem::create(OpenGLStateCache* stateCache, OpenGLUniformAllocator* constants, const char* shaderDirectory, uint32_t capacity)
+{
+	destroy();
+	m_StateCache = stateCache;
+	m_Constants = constants;
+	const GLsizeiptr count = m_Simulation.reset(capacity);
+	m_bReset = true;
+
+	const std::string directory = shaderDirectory;
+	const std::string computeSource = readShaderFile(directory + "particles.comp", "particle");
+	const std::string vertexSource = readShaderFile(directory + "particle.vert", "particle");
+	const std::string fragmentSource = readShaderFile(directory + "particle.frag", "particle");
+	if (computeSource.empty() || vertexSource.empty() || fragmentSource.empty())
+	{
+		destroy();
+		return false;
+	}
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ParticlePass::Count); ++i)
+	{
+		char define[32];
+		std::snprintf(define, sizeof(define), "#define ICY_PASS %u\n", i);
+		m_Programs[i] = compileComputeProgram(computeSource, define, "particle");
+		if (m_Programs[i] == 0)
+		{
+			destroy();
+			return false;
+		}
+	}
+	const GLuint drawShaders[] = { compileShader(GL_VERTEX_SHADER, vertexSource, "", "particle"), compileShader(GL_FRAGMENT_SHADER, fragmentSource, "", "particle") };
+	m_DrawProgram = linkProgram(drawShaders, 2, "particle");
+	if (m_DrawProgram == 0)
+	{
+		destroy();
+		return false;
+	}
+
+	// Only ever touched by the GPU, apart from the counters copied into the mapped readback ring
+	m_ParticleBuffer = m_StateCache->createBuffer(count * ParticleStride, nullptr, 0);
+	m_CounterBuffer = m_StateCache->createBuffer(ParticleCounterSize, nullptr, 0);
+	m_DeadBuffer = m_StateCache->createBuffer(count * sizeof(uint32_t), nullptr, 0);
+	// Two lists of (key, index) pairs
+	m_AliveBuffer = m_StateCache->createBuffer(2 * count * 2 * sizeof(uint32_t), nullptr, 0);
+	const GLbitfield readFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	m_ReadbackBuffer = m_StateCache->createBuffer(ReadbackSlots * ParticleCounterSize, nullptr, readFlags);
+	m_Readback = static_cast<const uint32_t*>(glMapNamedBufferRange(m_ReadbackBuffer, 0, ReadbackSlots * ParticleCounterSize, readFlags));
+	glCreateVertexArrays(1, &m_VertexArray);
+	if (m_Readback == nullptr)
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::OpenGLParticleSystem::destroy()
+{
+	if (m_StateCache == nullptr)
+		return;
+	for (int i = 0; i < ReadbackSlots; ++i)
+	{
+		if (m_ReadbackFences[i] != nullptr)
+			glDeleteSync(m_ReadbackFences[i]);
+		m_ReadbackFences[i] = nullptr;
+		m_ReadbackStep[i] = 0;
+	}
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ParticlePass::Count); ++i)
+	{
+		if (m_Programs[i] != 0)
+			m_StateCache->deleteProgram(m_Programs[i]);
+		m_Programs[i] = 0;
+	}
+	if (m_DrawProgram != 0)
+		m_StateCache->deleteProgram(m_DrawProgram);
+	if (m_Readback != nullptr)
+		glUnmapNamedBuffer(m_ReadbackBuffer);
+	const GLuint buffers[] = { m_ParticleBuffer, m_CounterBuffer, m_DeadBuffer, m_AliveBuffer, m_ReadbackBuffer };
+	for (GLuint buffer : buffers)
+	{
+		if (buffer != 0)
+			m_StateCache->deleteBuffer(buffer);
+	}
+	if (m_VertexArray != 0)
+		m_StateCache->deleteVertexArray(m_VertexArray);
+
+	m_DrawProgram = 0;
+	m_ParticleBuffer = 0;
+	m_CounterBuffer = 0;
+	m_DeadBuffer = 0;
+	m_AliveBuffer = 0;
+	m_ReadbackBuffer = 0;
+	m_Readback = nullptr;
+	m_VertexArray = 0;
+	m_StateCache = nullptr;
+	m_Constants = nullptr;
+}
+
+void icy::System::OpenGLParticleSystem::update(float dt, const float* cameraPosition, const float* viewProjection)
+{
+	// Read the oldest copy if it has landed, never wait for it
+	m_ReadbackSlot = (m_ReadbackSlot + 1) % ReadbackSlots;
+	GLsync& fence = m_ReadbackFences[m_ReadbackSlot];
+	if (fence != nullptr)
+	{
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			const uint32_t* counters = m_Readback + m_ReadbackSlot * (ParticleCounterSize / sizeof(uint32_t));
+			m_Simulation.setReadback(m_ReadbackStep[m_ReadbackSlot], counters[1 + m_ReadbackList[m_ReadbackSlot]]);
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_ParticleBuffer);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_CounterBuffer);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_DeadBuffer);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_AliveBuffer);
+	if (m_bReset)
+	{
+		// Fills the dead list with every particle, once
+		ParticleParams resetParams = {};
+		resetParams.capacity = m_Simulation.getCapacity();
+		m_Constants->bind(ParamsBinding, &resetParams, sizeof(resetParams));
+		runPass(ParticlePass::Reset, groupCount(resetParams.capacity));
+		m_bReset = false;
+	}
+
+	m_Simulation.step(m_Emitter, dt, cameraPosition, viewProjection, m_Params);
+	m_Constants->bind(ParamsBinding, &m_Params, sizeof(m_Params));
+	if (m_Params.emitCount > 0)
+		runPass(ParticlePass::Emit, groupCount(m_Params.emitCount));
+	runPass(ParticlePass::Prepare, 1);
+	// Sized by the live count the GPU just wrote
+	m_StateCache->useProgram(m_Programs[static_cast<uint32_t>(ParticlePass::Simulate)]);
+	m_StateCache->bindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_CounterBuffer);
+	glDispatchComputeIndirect(ParticleDispatchArgsOffset);
+	barrier();
+	sort(m_Params.next);
+	runPass(ParticlePass::Finish, 1);
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(m_CounterBuffer, m_ReadbackBuffer, 0, m_ReadbackSlot * ParticleCounterSize, ParticleCounterSize);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_ReadbackStep[m_ReadbackSlot] = m_Simulation.getStepIndex();
+	m_ReadbackList[m_ReadbackSlot] = m_Params.next;
+}
+
+void icy::System::OpenGLParticleSystem::draw()
+{
+	m_StateCache->useProgram(m_DrawProgram);
+	m_StateCache->bindVertexArray(m_VertexArray);
+	m_Constants->bind(ParamsBinding, &m_Params, sizeof(m_Params));
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_ParticleBuffer);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_AliveBuffer);
+	m_StateCache->bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CounterBuffer);
+	// Sorted back to front, so they blend over each other and test against the scene without writing depth
+	m_StateCache->enable(GL_BLEND);
+	m_StateCache->blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	m_StateCache->enable(GL_DEPTH_TEST);
+	m_StateCache->depthFunc(GL_LEQUAL);
+	m_StateCache->depthMask(false);
+	glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(static_cast<uintptr_t>(ParticleDrawArgsOffset)));
+	m_StateCache->depthMask(true);
+}
+
+void icy::System::OpenGLParticleSystem::runPass(ParticlePass pass, GLuint groups)
+{
+	m_StateCache->useProgram(m_Programs[static_cast<uint32_t>(pass)]);
+	glDispatchCompute(groups, 1, 1);
+	barrier();
+}
+
+void icy::System::OpenGLParticleSystem::barrier()
+{
+	// Every pass reads what the one before it wrote, the indirect dispatch and draw included
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void icy::System::OpenGLParticleSystem::sort(uint32_t list)
+{
+	// Same schedule as VulkanParticleSystem::recordSort, the step goes in a plain uniform instead of push constants
+	const GLuint program = m_Programs[static_cast<uint32_t>(ParticlePass::Sort)];
+	const uint32_t size = m_Simulation.getSortSize();
+	const GLuint groups = size / ParticleSortBlock;
+	m_StateCache->useProgram(program);
+	glProgramUniform4ui(program, 0, 0, 0, 0, list);
+	glDispatchCompute(groups, 1, 1);
+	barrier();
+	for (uint32_t k = ParticleSortBlock * 2; k <= size; k <<= 1)
+	{
+		for (uint32_t j = k / 2; j >= ParticleSortBlock; j >>= 1)
+		{
+			glProgramUniform4ui(program, 0, k, j, 1, list);
+			glDispatchCompute(groups, 1, 1);
+			barrier();
+		}
+		glProgramUniform4ui(program, 0, k, 0, 2, list);
+		glDispatchCompute(groups, 1, 1);
+		barrier();
+	}
+}
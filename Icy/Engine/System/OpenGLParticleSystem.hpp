@@ -0,0 +1,75 @@
+#pragma once
+#include "OpenGLStateCache.hpp"
+#include "OpenGLUniformAllocator.hpp"
+#include "ParticleSimulation.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		// GPU particles for the OpenGL backend, the same passes as VulkanParticleSystem built from the
+		// Engine\Shaders sources with GL 4.5 compute shaders, dispatch indirect and draw indirect
+		class OpenGLParticleSystem
+		{
+		public:
+			// Counters are copied into a ring this long and read once their fence has signalled
+			static constexpr int ReadbackSlots = 3;
+			// Uniform block binding of ParticleParams, the storage blocks use 0 to 3
+			static constexpr GLuint ParamsBinding = 0;
+
+			OpenGLParticleSystem();
+			~OpenGLParticleSystem();
+			OpenGLParticleSystem(const OpenGLParticleSystem&) = delete;
+			OpenGLParticleSystem& operator=(const OpenGLParticleSystem&) = delete;
+
+			// shaderDirectory : where particles.comp, particle.vert and particle.frag are, ending in a separator
+			// capacity : maximum live particles, rounded up to a power of two
+			// Needs a current 4.5 context
+			bool create(OpenGLStateCache* stateCache, OpenGLUniformAllocator* constants, const char* shaderDirectory, uint32_t capacity);
+			void destroy();
+
+			void setEmitter(const ParticleEmitter& emitter) { m_Emitter = emitter; }
+			const ParticleEmitter& getEmitter() const { return m_Emitter; }
+
+			// Runs one step: emit, simulate and compact, sort and write the draw arguments
+			// cameraPosition, viewProjection : sort origin and the transform draw() uses, column major
+			void update(float dt, const float* cameraPosition, const float* viewProjection);
+			// Draws what the last update left with alpha blending, depth tested without writing
+			void draw();
+
+			uint32_t getCapacity() const { return m_Simulation.getCapacity(); }
+			// Live particles a few frames ago, the GPU is never waited on for the current count
+			uint32_t getAliveCount() const { return m_Simulation.getLastAliveCount(); }
+			const ParticleSimulation& getSimulation() const { return m_Simulation; }
+
+		private:
+			void runPass(ParticlePass pass, GLuint groups);
+			void barrier();
+			void sort(uint32_t list);
+
+		private:
+			OpenGLStateCache* m_StateCache;
+			OpenGLUniformAllocator* m_Constants;
+			ParticleSimulation m_Simulation;
+			ParticleEmitter m_Emitter;
+			ParticleParams m_Params;
+			bool m_bReset;
+
+			GLuint m_ParticleBuffer;
+			GLuint m_CounterBuffer;
+			GLuint m_DeadBuffer;
+			GLuint m_AliveBuffer;
+			GLuint m_ReadbackBuffer;
+			const uint32_t* m_Readback;
+			GLsync m_ReadbackFences[ReadbackSlots];
+			uint64_t m_ReadbackStep[ReadbackSlots];
+			uint32_t m_ReadbackList[ReadbackSlots];
+			int m_ReadbackSlot;
+
+			GLuint m_Programs[static_cast<uint32_t>(ParticlePass::Count)];
+			GLuint m_DrawProgram;
+			// Core profiles can't draw without one, the quads have no vertex attributes
+			GLuint m_VertexArray;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "OpenGLSceneBuffer.hpp"
+#include <iostream>
+#include "OpenGLShaders.hpp"
+
+icy::System::OpenGLSceneBuffer::OpenGLSceneBuffer()
+{
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+	m_Program = 0;
+	m_Buffer = 0;
+}
+
+icy::System::OpenGLSceneBuffer::~OpenGLSceneBuffer()
+{
+	destroy();
+}
+
+bool icy::System::OpenGLSceneBuffer::create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory)
+{
+	destroy();
+	m_StateCache = stateCache;
+	m_StreamBuffer = streamBuffer;
+
+	const std::string source = readShaderFile(std::string(shaderDirectory) + "scenescatter.comp", "scene");
+	m_Program = source.empty() ? 0 : compileComputeProgram(source, "", "scene");
+	if (m_Program == 0)
+	{
+		destroy();
+		return false;
+	}
+
+	// Only the scatter writes it, nothing is read before an instance's first delta
+	m_Buffer = m_StateCache->createBuffer(BufferSize, nullptr, 0);
+	m_Instances.markAll();
+	return true;
+}
+
+void icy::System::OpenGLSceneBuffer::destroy()
+{
+	if (m_StateCache == nullptr)
+		return;
+	if (m_Program != 0)
+		m_StateCache->deleteProgram(m_Program);
+	if (m_Buffer != 0)
+		m_StateCache->deleteBuffer(m_Buffer);
+	m_Program = 0;
+	m_Buffer = 0;
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+}
+
+void icy::System::OpenGLSceneBuffer::update()
+{
+	if (m_Program == 0)
+		return;
+	const uint32_t count = m_Instances.getDeltaCount();
+	if (count == 0)
+	{
+		// Still resets the stats for this frame
+		m_Instances.takeDelta(nullptr, nullptr);
+		return;
+	}
+
+	const GLsizeiptr alignment = m_StreamBuffer->getStorageAlignment();
+	auto ids = m_StreamBuffer->allocate((count + 1) * sizeof(uint32_t), alignment);
+	auto instances = m_StreamBuffer->allocate(count * sizeof(SceneInstance), alignment);
+	if (ids.data == nullptr || instances.data == nullptr)
+	{
+		std::cout << "Stream buffer out of space, " << count << " scene instances wait for the next frame" << std::endl;
+		return;
+	}
+	uint32_t* header = static_cast<uint32_t*>(ids.data);
+	header[0] = m_Instances.takeDelta(header + 1, static_cast<SceneInstance*>(instances.data));
+	if (header[0] == 0)
+		return;
+
+	m_StateCache->useProgram(m_Program);
+	m_StateCache->bindBufferBase(GL_SHADER_STORAGE_BUFFER, InstancesBinding, m_Buffer);
+	m_StateCache->bindBufferRange(GL_SHADER_STORAGE_BUFFER, DeltaIdsBinding, m_StreamBuffer->getBuffer(), ids.offset, ids.size);
+	m_StateCache->bindBufferRange(GL_SHADER_STORAGE_BUFFER, DeltaInstancesBinding, m_StreamBuffer->getBuffer(), instances.offset, instances.size);
+	glDispatchCompute((header[0] + SceneInstances::ScatterWorkgroupSize - 1) / SceneInstances::ScatterWorkgroupSize, 1, 1);
+	// Draws read the instances in their vertex shaders and the culler doesn't touch them
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include "OpenGLStateCache.hpp"
+#include "OpenGLStreamBuffer.hpp"
+#include "SceneInstances.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		// Persistent GPU instance buffer for the OpenGL backend, one SceneInstance per instance id
+		// update() writes the delta of the instances that changed into the stream buffer and scatters it into the SSBO with
+		// Engine\Shaders\scenescatter.comp, so a frame uploads only what changed instead of every instance
+		// OpenGLIndirectRenderer::submitInstance draws straight out of the buffer
+		class OpenGLSceneBuffer
+		{
+		public:
+			// Storage block bindings of scenescatter.comp, clear of the other GL systems
+			static constexpr GLuint InstancesBinding = 13;
+			static constexpr GLuint DeltaIdsBinding = 14;
+			static constexpr GLuint DeltaInstancesBinding = 15;
+			static constexpr GLsizeiptr BufferSize = SceneInstances::MaxInstances * sizeof(SceneInstance);
+
+			OpenGLSceneBuffer();
+			~OpenGLSceneBuffer();
+			OpenGLSceneBuffer(const OpenGLSceneBuffer&) = delete;
+			OpenGLSceneBuffer& operator=(const OpenGLSceneBuffer&) = delete;
+
+			// shaderDirectory : where scenescatter.comp is, ending in a separator
+			// Needs a current 4.5 context, instances created before are uploaded by the first update
+			bool create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory);
+			void destroy();
+			bool isCreated() const { return m_Program != 0; }
+
+			// Create, set and destroy instances here, the GPU buffer follows on the next update
+			SceneInstances& getInstances() { return m_Instances; }
+			const SceneInstances& getInstances() const { return m_Instances; }
+			// Scatters the changes since the last update into the buffer, before anything reads it this frame
+			// OpenGLIndirectRenderer::flush calls it when the backend hands it the buffer
+			void update();
+			// SceneInstance array indexed by instance id
+			GLuint getBuffer() const { return m_Buffer; }
+			// Bytes the last update uploaded against a full upload
+			const SceneUploadStats& getStats() const { return m_Instances.getStats(); }
+
+		private:
+			OpenGLStateCache* m_StateCache;
+			OpenGLStreamBuffer* m_StreamBuffer;
+			GLuint m_Program;
+			GLuint m_Buffer;
+			SceneInstances m_Instances;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "OpenGLShaders.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	// Offset of the line after #version, 0 without one
+	size_t findBody(const std::string& source)
+	{
+		size_t version = source.find("#version");
+		size_t body = version == std::string::npos ? 0 : source.find('\n', version);
+		return body == std::string::npos ? source.size() : body + 1;
+	}
+}
+
+std::string icy::System::readShaderFile(const std::string& path, const char* name)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream.is_open())
+	{
+		std::cout << "Missing " << name << " shader " << path << std::endl;
+		return std::string();
+	}
+	std::ostringstream contents;
+	contents << stream.rdbuf();
+	return contents.str();
+}
+
+std::string icy::System::insertAfterVersion(const std::string& source, const std::string& text)
+{
+	const size_t body = findBody(source);
+	return source.substr(0, body) + text + source.substr(body);
+}
+
+GLuint icy::System::compileShader(GLenum type, const std::string& source, const char* defines, const char* name)
+{
+	const size_t body = findBody(source);
+	const GLchar* strings[] = { source.c_str(), defines, source.c_str() + body };
+	const GLint lengths[] = { static_cast<GLint>(body), -1, static_cast<GLint>(source.size() - body) };
+
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 3, strings, lengths);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		std::cout << "Failed to compile " << name << " shader: " << log << std::endl;
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+GLuint icy::System::linkProgram(const GLuint* shaders, int count, const char* name)
+{
+	bool compiled = true;
+	for (int i = 0; i < count; ++i)
+		compiled = compiled && shaders[i] != 0;
+	GLuint program = compiled ? glCreateProgram() : 0;
+	for (int i = 0; i < count; ++i)
+	{
+		if (program != 0)
+			glAttachShader(program, shaders[i]);
+		// Flagged for deletion, they go with the program
+		if (shaders[i] != 0)
+			glDeleteShader(shaders[i]);
+	}
+	if (program == 0)
+		return 0;
+	glLinkProgram(program);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		std::cout << "Failed to link " << name << " program: " << log << std::endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+GLuint icy::System::compileComputeProgram(const std::string& source, const char* defines, const char* name)
+{
+	const GLuint shader = compileShader(GL_COMPUTE_SHADER, source, defines, name);
+	return linkProgram(&shader, 1, name);
+}
\ No newline at end of file
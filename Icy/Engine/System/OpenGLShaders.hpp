@@ -0,0 +1,23 @@
+#pragma once
+#include <glad\glad.h>
+#include <string>
+
+namespace icy
+{
+	namespace System
+	{
+		// GLSL loading, compiling and linking shared by the OpenGL systems
+		// name : what the shaders are for, it only goes into the messages, e.g. "particle" prints "Missing particle shader"
+
+		// Contents of the file at path, empty if it can't be read
+		std::string readShaderFile(const std::string& path, const char* name);
+		// Inserts text after the #version line, where defines and shared declarations have to go
+		std::string insertAfterVersion(const std::string& source, const std::string& text);
+		// Compiles source with defines inserted after its #version line, returns 0 on failure
+		GLuint compileShader(GLenum type, const std::string& source, const char* defines, const char* name);
+		// Deletes the shaders either way, returns 0 if any failed to compile or the link failed
+		GLuint linkProgram(const GLuint* shaders, int count, const char* name);
+		// A program of one compute shader, returns 0 on failure
+		GLuint compileComputeProgram(const std::string& source, const char* defines, const char* name);
+	}
+}
\ No newline at end of file
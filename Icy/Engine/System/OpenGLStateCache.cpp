@@ -0,0 +1,366 @@
+#include "OpenGLStateCache.hpp"
+#include <cstring>
+
+namespace
+{
+	// Value no real GL name or enum uses, marks a piece of state we know nothing about
+	constexpr GLuint Unknown = 0xFFFFFFFFu;
+}
+
+icy::System::OpenGLStateCache::OpenGLStateCache()
+{
+	m_Stats = {};
+	m_LastStats = {};
+	invalidate();
+}
+
+void icy::System::OpenGLStateCache::invalidate()
+{
+	m_Program = Unknown;
+	m_VertexArray = Unknown;
+	m_Framebuffer = Unknown;
+	for (auto& buffer : m_Buffers)
+		buffer = Unknown;
+	for (auto& target : m_Indexed)
+		for (auto& binding : target)
+			binding = { Unknown, 0, 0 };
+	for (int i = 0; i < MaxTextureUnits; ++i)
+	{
+		m_Textures[i] = Unknown;
+		m_Samplers[i] = Unknown;
+	}
+	std::memset(m_Caps, -1, sizeof(m_Caps));
+	m_BlendSrc = m_BlendDst = Unknown;
+	m_DepthFunc = Unknown;
+	m_DepthMask = -1;
+	m_ColorMask = -1;
+	m_CullFace = Unknown;
+	m_Viewport[0] = m_Viewport[1] = m_Viewport[2] = m_Viewport[3] = -1;
+	m_Scissor[0] = m_Scissor[1] = m_Scissor[2] = m_Scissor[3] = -1;
+}
+
+void icy::System::OpenGLStateCache::endFrame()
+{
+	m_LastStats = m_Stats;
+	m_Stats = {};
+}
+
+void icy::System::OpenGLStateCache::useProgram(GLuint program)
+{
+	if (changed(m_Program != program))
+	{
+		m_Program = program;
+		glUseProgram(program);
+	}
+}
+
+void icy::System::OpenGLStateCache::bindVertexArray(GLuint vertexArray)
+{
+	if (changed(m_VertexArray != vertexArray))
+	{
+		m_VertexArray = vertexArray;
+		glBindVertexArray(vertexArray);
+	}
+}
+
+void icy::System::OpenGLStateCache::bindFramebuffer(GLuint framebuffer)
+{
+	if (changed(m_Framebuffer != framebuffer))
+	{
+		m_Framebuffer = framebuffer;
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+}
+
+void icy::System::OpenGLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+	int slot = toBufferTarget(target);
+	if (slot < 0)
+	{
+		changed(true);
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if (changed(m_Buffers[slot] != buffer))
+	{
+		m_Buffers[slot] = buffer;
+		glBindBuffer(target, buffer);
+	}
+}
+
+void icy::System::OpenGLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	int slot = toIndexedTarget(target);
+	if (slot < 0 || index >= MaxIndexedBindings)
+	{
+		changed(true);
+		glBindBufferBase(target, index, buffer);
+		return;
+	}
+	// a size of zero marks a whole buffer binding
+	IndexedBinding& binding = m_Indexed[slot][index];
+	if (changed(binding.buffer != buffer || binding.offset != 0 || binding.size != 0))
+	{
+		binding = { buffer, 0, 0 };
+		glBindBufferBase(target, index, buffer);
+		// glBindBufferBase also binds the generic target
+		m_Buffers[toBufferTarget(target)] = buffer;
+	}
+}
+
+void icy::System::OpenGLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	int slot = toIndexedTarget(target);
+	if (slot < 0 || index >= MaxIndexedBindings)
+	{
+		changed(true);
+		glBindBufferRange(target, index, buffer, offset, size);
+		return;
+	}
+	IndexedBinding& binding = m_Indexed[slot][index];
+	if (changed(binding.buffer != buffer || binding.offset != offset || binding.size != size))
+	{
+		binding = { buffer, offset, size };
+		glBindBufferRange(target, index, buffer, offset, size);
+		m_Buffers[toBufferTarget(target)] = buffer;
+	}
+}
+
+void icy::System::OpenGLStateCache::bindTextureUnit(GLuint unit, GLuint texture)
+{
+	if (unit >= MaxTextureUnits)
+	{
+		changed(true);
+		glBindTextureUnit(unit, texture);
+		return;
+	}
+	if (changed(m_Textures[unit] != texture))
+	{
+		m_Textures[unit] = texture;
+		glBindTextureUnit(unit, texture);
+	}
+}
+
+void icy::System::OpenGLStateCache::bindSampler(GLuint unit, GLuint sampler)
+{
+	if (unit >= MaxTextureUnits)
+	{
+		changed(true);
+		glBindSampler(unit, sampler);
+		return;
+	}
+	if (changed(m_Samplers[unit] != sampler))
+	{
+		m_Samplers[unit] = sampler;
+		glBindSampler(unit, sampler);
+	}
+}
+
+void icy::System::OpenGLStateCache::setEnabled(GLenum cap, bool enabled)
+{
+	int slot = toCapability(cap);
+	if (slot < 0)
+	{
+		changed(true);
+		enabled ? glEnable(cap) : glDisable(cap);
+		return;
+	}
+	int8_t value = enabled ? 1 : 0;
+	if (changed(m_Caps[slot] != value))
+	{
+		m_Caps[slot] = value;
+		enabled ? glEnable(cap) : glDisable(cap);
+	}
+}
+
+void icy::System::OpenGLStateCache::blendFunc(GLenum src, GLenum dst)
+{
+	if (changed(m_BlendSrc != src || m_BlendDst != dst))
+	{
+		m_BlendSrc = src;
+		m_BlendDst = dst;
+		glBlendFunc(src, dst);
+	}
+}
+
+void icy::System::OpenGLStateCache::depthFunc(GLenum func)
+{
+	if (changed(m_DepthFunc != func))
+	{
+		m_DepthFunc = func;
+		glDepthFunc(func);
+	}
+}
+
+void icy::System::OpenGLStateCache::depthMask(bool write)
+{
+	int8_t value = write ? 1 : 0;
+	if (changed(m_DepthMask != value))
+	{
+		m_DepthMask = value;
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void icy::System::OpenGLStateCache::colorMask(bool r, bool g, bool b, bool a)
+{
+	int8_t value = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+	if (changed(m_ColorMask != value))
+	{
+		m_ColorMask = value;
+		glColorMask(r, g, b, a);
+	}
+}
+
+void icy::System::OpenGLStateCache::cullFace(GLenum mode)
+{
+	if (changed(m_CullFace != mode))
+	{
+		m_CullFace = mode;
+		glCullFace(mode);
+	}
+}
+
+void icy::System::OpenGLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (changed(m_Viewport[0] != x || m_Viewport[1] != y || m_Viewport[2] != width || m_Viewport[3] != height))
+	{
+		m_Viewport[0] = x;
+		m_Viewport[1] = y;
+		m_Viewport[2] = width;
+		m_Viewport[3] = height;
+		glViewport(x, y, width, height);
+	}
+}
+
+void icy::System::OpenGLStateCache::scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (changed(m_Scissor[0] != x || m_Scissor[1] != y || m_Scissor[2] != width || m_Scissor[3] != height))
+	{
+		m_Scissor[0] = x;
+		m_Scissor[1] = y;
+		m_Scissor[2] = width;
+		m_Scissor[3] = height;
+		glScissor(x, y, width, height);
+	}
+}
+
+GLuint icy::System::OpenGLStateCache::createBuffer(GLsizeiptr size, const void* data, GLbitfield flags)
+{
+	GLuint buffer = 0;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, size, data, flags);
+	return buffer;
+}
+
+void icy::System::OpenGLStateCache::bufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	glNamedBufferSubData(buffer, offset, size, data);
+}
+
+GLuint icy::System::OpenGLStateCache::createTexture2D(GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+	GLuint texture = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, levels, internalFormat, width, height);
+	return texture;
+}
+
+void icy::System::OpenGLStateCache::textureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	glTextureSubImage2D(texture, level, x, y, width, height, format, type, pixels);
+}
+
+void icy::System::OpenGLStateCache::deleteBuffer(GLuint buffer)
+{
+	for (auto& bound : m_Buffers)
+		if (bound == buffer)
+			bound = Unknown;
+	for (auto& target : m_Indexed)
+		for (auto& binding : target)
+			if (binding.buffer == buffer)
+				binding = { Unknown, 0, 0 };
+	glDeleteBuffers(1, &buffer);
+}
+
+void icy::System::OpenGLStateCache::deleteTexture(GLuint texture)
+{
+	for (auto& bound : m_Textures)
+		if (bound == texture)
+			bound = Unknown;
+	glDeleteTextures(1, &texture);
+}
+
+void icy::System::OpenGLStateCache::deleteProgram(GLuint program)
+{
+	if (m_Program == program)
+		m_Program = Unknown;
+	glDeleteProgram(program);
+}
+
+void icy::System::OpenGLStateCache::deleteVertexArray(GLuint vertexArray)
+{
+	if (m_VertexArray == vertexArray)
+		m_VertexArray = Unknown;
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+void icy::System::OpenGLStateCache::deleteFramebuffer(GLuint framebuffer)
+{
+	if (m_Framebuffer == framebuffer)
+		m_Framebuffer = Unknown;
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+int icy::System::OpenGLStateCache::toCapability(GLenum cap)
+{
+	switch (cap)
+	{
+	case GL_BLEND: return CapBlend;
+	case GL_DEPTH_TEST: return CapDepthTest;
+	case GL_CULL_FACE: return CapCullFace;
+	case GL_SCISSOR_TEST: return CapScissorTest;
+	case GL_STENCIL_TEST: return CapStencilTest;
+	case GL_POLYGON_OFFSET_FILL: return CapPolygonOffsetFill;
+	case GL_FRAMEBUFFER_SRGB: return CapFramebufferSRGB;
+	case GL_MULTISAMPLE: return CapMultisample;
+	case GL_RASTERIZER_DISCARD: return CapRasterizerDiscard;
+	case GL_PROGRAM_POINT_SIZE: return CapProgramPointSize;
+	case GL_DEPTH_CLAMP: return CapDepthClamp;
+	case GL_TEXTURE_CUBE_MAP_SEAMLESS: return CapCubeMapSeamless;
+	default: return -1;
+	}
+}
+
+int icy::System::OpenGLStateCache::toBufferTarget(GLenum target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER: return TargetArray;
+	case GL_DRAW_INDIRECT_BUFFER: return TargetDrawIndirect;
+	case GL_DISPATCH_INDIRECT_BUFFER: return TargetDispatchIndirect;
+	case GL_PIXEL_PACK_BUFFER: return TargetPixelPack;
+	case GL_PIXEL_UNPACK_BUFFER: return TargetPixelUnpack;
+	case GL_COPY_READ_BUFFER: return TargetCopyRead;
+	case GL_COPY_WRITE_BUFFER: return TargetCopyWrite;
+	case GL_QUERY_BUFFER: return TargetQuery;
+	case GL_TEXTURE_BUFFER: return TargetTexture;
+	case GL_UNIFORM_BUFFER: return TargetUniform;
+	case GL_SHADER_STORAGE_BUFFER: return TargetShaderStorage;
+	case GL_ATOMIC_COUNTER_BUFFER: return TargetAtomicCounter;
+	case GL_TRANSFORM_FEEDBACK_BUFFER: return TargetTransformFeedback;
+	default: return -1;
+	}
+}
+
+int icy::System::OpenGLStateCache::toIndexedTarget(GLenum target)
+{
+	switch (target)
+	{
+	case GL_UNIFORM_BUFFER: return IndexedUniform;
+	case GL_SHADER_STORAGE_BUFFER: return IndexedShaderStorage;
+	case GL_ATOMIC_COUNTER_BUFFER: return IndexedAtomicCounter;
+	case GL_TRANSFORM_FEEDBACK_BUFFER: return IndexedTransformFeedback;
+	default: return -1;
+	}
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <glad\glad.h>
+#include <cstdint>
+
+namespace icy
+{
+	namespace System
+	{
+		// Shadow copy of the OpenGL state the engine touches.
+		// Every setter compares against the shadow copy first and only calls the driver when the value changes.
+		// Buffers and textures are edited through DSA, so nothing ever has to be bound just to upload data.
+		class OpenGLStateCache
+		{
+		public:
+			static constexpr int MaxTextureUnits = 32;
+			static constexpr int MaxIndexedBindings = 16;
+
+			// Number of GL calls that reached the driver and that were filtered out
+			struct FrameStats
+			{
+				uint32_t issued;
+				uint32_t avoided;
+			};
+
+			OpenGLStateCache();
+			// Forgets everything we know about the driver state, the next call to every setter will go through
+			// Call this after code outside of the cache touched GL state
+			void invalidate();
+			// Ends the current frame, the counters move to getLastFrameStats() and start again from zero
+			void endFrame();
+			const FrameStats& getFrameStats() const { return m_Stats; }
+			const FrameStats& getLastFrameStats() const { return m_LastStats; }
+
+			// Binding state
+			void useProgram(GLuint program);
+			void bindVertexArray(GLuint vertexArray);
+			void bindFramebuffer(GLuint framebuffer);
+			// target : one of the non indexed buffer targets (GL_DRAW_INDIRECT_BUFFER, GL_PIXEL_UNPACK_BUFFER...)
+			// GL_ELEMENT_ARRAY_BUFFER belongs to the vertex array, set it with glVertexArrayElementBuffer instead
+			void bindBuffer(GLenum target, GLuint buffer);
+			// target : GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_ATOMIC_COUNTER_BUFFER or GL_TRANSFORM_FEEDBACK_BUFFER
+			void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+			void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+			void bindTextureUnit(GLuint unit, GLuint texture);
+			void bindSampler(GLuint unit, GLuint sampler);
+
+			// Fixed function state
+			void enable(GLenum cap) { setEnabled(cap, true); }
+			void disable(GLenum cap) { setEnabled(cap, false); }
+			void setEnabled(GLenum cap, bool enabled);
+			void blendFunc(GLenum src, GLenum dst);
+			void depthFunc(GLenum func);
+			void depthMask(bool write);
+			void colorMask(bool r, bool g, bool b, bool a);
+			void cullFace(GLenum mode);
+			void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+			void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+			// DSA object helpers, nothing is bound while creating or editing
+			// flags : glNamedBufferStorage flags, e.g. GL_DYNAMIC_STORAGE_BIT
+			GLuint createBuffer(GLsizeiptr size, const void* data, GLbitfield flags);
+			void bufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+			GLuint createTexture2D(GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height);
+			void textureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+
+			// Deletes the object and drops any binding that still refers to it,
+			// GL recycles names so a stale binding would make us skip a bind we need
+			void deleteBuffer(GLuint buffer);
+			void deleteTexture(GLuint texture);
+			void deleteProgram(GLuint program);
+			void deleteVertexArray(GLuint vertexArray);
+			void deleteFramebuffer(GLuint framebuffer);
+
+		private:
+			enum Capability
+			{
+				CapBlend,
+				CapDepthTest,
+				CapCullFace,
+				CapScissorTest,
+				CapStencilTest,
+				CapPolygonOffsetFill,
+				CapFramebufferSRGB,
+				CapMultisample,
+				CapRasterizerDiscard,
+				CapProgramPointSize,
+				CapDepthClamp,
+				CapCubeMapSeamless,
+				CapCount
+			};
+			enum BufferTarget
+			{
+				TargetArray,
+				TargetDrawIndirect,
+				TargetDispatchIndirect,
+				TargetPixelPack,
+				TargetPixelUnpack,
+				TargetCopyRead,
+				TargetCopyWrite,
+				TargetQuery,
+				TargetTexture,
+				TargetUniform,
+				TargetShaderStorage,
+				TargetAtomicCounter,
+				TargetTransformFeedback,
+				TargetCount
+			};
+			enum IndexedTarget
+			{
+				IndexedUniform,
+				IndexedShaderStorage,
+				IndexedAtomicCounter,
+				IndexedTransformFeedback,
+				IndexedCount
+			};
+			struct IndexedBinding
+			{
+				GLuint buffer;
+				GLintptr offset;
+				GLsizeiptr size;
+			};
+
+			static int toCapability(GLenum cap);
+			static int toBufferTarget(GLenum target);
+			static int toIndexedTarget(GLenum target);
+			// Counts the call and returns true when the driver has to see it
+			bool changed(bool differs) { if (differs) ++m_Stats.issued; else ++m_Stats.avoided; return differs; }
+
+		private:
+			GLuint m_Program;
+			GLuint m_VertexArray;
+			GLuint m_Framebuffer;
+			GLuint m_Buffers[TargetCount];
+			IndexedBinding m_Indexed[IndexedCount][MaxIndexedBindings];
+			GLuint m_Textures[MaxTextureUnits];
+			GLuint m_Samplers[MaxTextureUnits];
+			// -1 unknown, 0 disabled, 1 enabled
+			int8_t m_Caps[CapCount];
+			GLenum m_BlendSrc, m_BlendDst;
+			GLenum m_DepthFunc;
+			int8_t m_DepthMask;
+			int8_t m_ColorMask;
+			GLenum m_CullFace;
+			GLint m_Viewport[4];
+			GLint m_Scissor[4];
+			FrameStats m_Stats;
+			FrameStats m_LastStats;
+		};
+	}
+}
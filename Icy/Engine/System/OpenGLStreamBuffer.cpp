@@ -0,0 +1,113 @@
+#include "OpenGLStreamBuffer.hpp"
+#include <chrono>
+
+icy::System::OpenGLStreamBuffer::OpenGLStreamBuffer()
+{
+	m_Buffer = 0;
+	m_Mapped = nullptr;
+	m_RegionSize = 0;
+	m_Head = 0;
+	m_UniformAlignment = 256;
+	m_StorageAlignment = 256;
+	m_Region = 0;
+	for (auto& fence : m_Fences)
+		fence = nullptr;
+	m_FenceWaitMs = 0.0;
+}
+
+icy::System::OpenGLStreamBuffer::~OpenGLStreamBuffer()
+{
+	destroy();
+}
+
+bool icy::System::OpenGLStreamBuffer::create(GLsizeiptr regionSize)
+{
+	destroy();
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0)
+		m_UniformAlignment = alignment;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0)
+		m_StorageAlignment = alignment;
+
+	// Keep every region start aligned for any binding type
+	GLsizeiptr regionAlignment = m_UniformAlignment > m_StorageAlignment ? m_UniformAlignment : m_StorageAlignment;
+	m_RegionSize = (regionSize + regionAlignment - 1) & ~(regionAlignment - 1);
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_Buffer);
+	glNamedBufferStorage(m_Buffer, m_RegionSize * RegionCount, nullptr, flags);
+	m_Mapped = static_cast<uint8_t*>(glMapNamedBufferRange(m_Buffer, 0, m_RegionSize * RegionCount, flags));
+	if (m_Mapped == nullptr)
+	{
+		destroy();
+		return false;
+	}
+	m_Region = 0;
+	m_Head = 0;
+	return true;
+}
+
+void icy::System::OpenGLStreamBuffer::destroy()
+{
+	for (auto& fence : m_Fences)
+	{
+		if (fence != nullptr)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (m_Buffer != 0)
+	{
+		if (m_Mapped != nullptr)
+			glUnmapNamedBuffer(m_Buffer);
+		glDeleteBuffers(1, &m_Buffer);
+	}
+	m_Buffer = 0;
+	m_Mapped = nullptr;
+	m_RegionSize = 0;
+	m_Head = 0;
+}
+
+void icy::System::OpenGLStreamBuffer::nextFrame()
+{
+	if (m_Mapped == nullptr)
+		return;
+	m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_Region = (m_Region + 1) % RegionCount;
+	m_Head = 0;
+	waitForRegion(m_Region);
+}
+
+icy::System::OpenGLStreamBuffer::Allocation icy::System::OpenGLStreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	GLsizeiptr offset = (m_Head + alignment - 1) & ~(alignment - 1);
+	if (m_Mapped == nullptr || offset + size > m_RegionSize)
+		return { nullptr, 0, 0 };
+	m_Head = offset + size;
+	GLintptr absolute = m_Region * m_RegionSize + offset;
+	return { m_Mapped + absolute, absolute, size };
+}
+
+void icy::System::OpenGLStreamBuffer::waitForRegion(int region)
+{
+	m_FenceWaitMs = 0.0;
+	GLsync fence = m_Fences[region];
+	if (fence == nullptr)
+		return;
+
+	// Most of the time the GPU is already done, check without flushing first
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		auto start = std::chrono::steady_clock::now();
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		m_FenceWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	glDeleteSync(fence);
+	m_Fences[region] = nullptr;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <glad\glad.h>
+#include <cstdint>
+
+namespace icy
+{
+	namespace System
+	{
+		// Ring of persistently mapped memory for data rewritten every frame (vertices, uniforms, instances)
+		// The buffer is split in one region per frame in flight, each region is guarded by a fence
+		// so the CPU writes straight into memory the GPU reads without orphaning or glBufferSubData
+		class OpenGLStreamBuffer
+		{
+		public:
+			static constexpr int RegionCount = 3;
+
+			// data is nullptr when the region is out of space
+			struct Allocation
+			{
+				void* data;
+				GLintptr offset;
+				GLsizeiptr size;
+			};
+
+			OpenGLStreamBuffer();
+			~OpenGLStreamBuffer();
+			OpenGLStreamBuffer(const OpenGLStreamBuffer&) = delete;
+			OpenGLStreamBuffer& operator=(const OpenGLStreamBuffer&) = delete;
+
+			// Creates and maps the buffer
+			// regionSize : The number of bytes that can be written each frame
+			bool create(GLsizeiptr regionSize);
+			void destroy();
+			// Fences the region written this frame and moves to the next one,
+			// waiting for the GPU if it is still reading it. Call once per frame after the last draw
+			void nextFrame();
+			// Carves size bytes out of the current region
+			// alignment : must be a power of two, use getUniformAlignment() for uniform buffer ranges
+			Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+			GLuint getBuffer() const { return m_Buffer; }
+			GLsizeiptr getRegionSize() const { return m_RegionSize; }
+			GLsizeiptr getUniformAlignment() const { return m_UniformAlignment; }
+			GLsizeiptr getStorageAlignment() const { return m_StorageAlignment; }
+			// Bytes handed out during the current frame
+			GLsizeiptr getBytesUsed() const { return m_Head; }
+			// Time the CPU spent blocked on the fence at the start of the current frame, in milliseconds
+			double getFenceWaitMs() const { return m_FenceWaitMs; }
+
+		private:
+			void waitForRegion(int region);
+
+		private:
+			GLuint m_Buffer;
+			uint8_t* m_Mapped;
+			GLsizeiptr m_RegionSize;
+			GLsizeiptr m_Head;
+			GLsizeiptr m_UniformAlignment;
+			GLsizeiptr m_StorageAlignment;
+			int m_Region;
+			GLsync m_Fences[RegionCount];
+			double m_FenceWaitMs;
+		};
+	}
+}
@@ -0,0 +1,137 @@
+#include "OpenGLTextRenderer.hpp"
+#include <cstring>
+#include <iostream>
+#include "OpenGLShaders.hpp"
+
+icy::System::OpenGLTextRenderer::OpenGLTextRenderer()
+{
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+	m_Program = 0;
+	m_VertexArray = 0;
+	for (uint32_t i = 0; i < GlyphAtlas::MaxPages; ++i)
+		m_Pages[i] = 0;
+	m_DrawCount = 0;
+}
+
+icy::System::OpenGLTextRenderer::~OpenGLTextRenderer()
+{
+	destroy();
+}
+
+bool icy::System::OpenGLTextRenderer::create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory, const char* fontPath)
+{
+	destroy();
+	m_StateCache = stateCache;
+	m_StreamBuffer = streamBuffer;
+	if (!m_Atlas.create(fontPath))
+	{
+		destroy();
+		return false;
+	}
+
+	const std::string directory = shaderDirectory;
+	const std::string vertexSource = readShaderFile(directory + "text.vert", "text");
+	const std::string fragmentSource = readShaderFile(directory + "text.frag", "text");
+	if (vertexSource.empty() || fragmentSource.empty())
+	{
+		destroy();
+		return false;
+	}
+	const GLuint shaders[] = { compileShader(GL_VERTEX_SHADER, vertexSource, "", "text"), compileShader(GL_FRAGMENT_SHADER, fragmentSource, "", "text") };
+	m_Program = linkProgram(shaders, 2, "text");
+	if (m_Program == 0)
+	{
+		destroy();
+		return false;
+	}
+	glCreateVertexArrays(1, &m_VertexArray);
+	return true;
+}
+
+void icy::System::OpenGLTextRenderer::destroy()
+{
+	if (m_StateCache == nullptr)
+		return;
+	for (uint32_t i = 0; i < GlyphAtlas::MaxPages; ++i)
+	{
+		if (m_Pages[i] != 0)
+			m_StateCache->deleteTexture(m_Pages[i]);
+		m_Pages[i] = 0;
+	}
+	if (m_Program != 0)
+		m_StateCache->deleteProgram(m_Program);
+	if (m_VertexArray != 0)
+		m_StateCache->deleteVertexArray(m_VertexArray);
+	m_Program = 0;
+	m_VertexArray = 0;
+	m_DrawCount = 0;
+	m_Atlas.destroy();
+	m_StateCache = nullptr;
+	m_StreamBuffer = nullptr;
+}
+
+void icy::System::OpenGLTextRenderer::draw(uint32_t width, uint32_t height)
+{
+	m_DrawCount = 0;
+	// Nothing to draw into still ends the frame, or a minimised window keeps piling up glyphs
+	if (m_Program == 0 || width == 0 || height == 0 || m_Atlas.getInstanceCount() == 0)
+	{
+		m_Atlas.endFrame();
+		return;
+	}
+	uploadPages();
+
+	m_StateCache->useProgram(m_Program);
+	m_StateCache->bindVertexArray(m_VertexArray);
+	glProgramUniform4f(m_Program, 0, 2.0f / static_cast<float>(width), 2.0f / static_cast<float>(height), 0.0f, 0.0f);
+	// Overlays, blended over the scene without testing or writing depth
+	m_StateCache->enable(GL_BLEND);
+	m_StateCache->blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	m_StateCache->disable(GL_DEPTH_TEST);
+	m_StateCache->disable(GL_CULL_FACE);
+
+	const GLsizeiptr alignment = m_StreamBuffer->getStorageAlignment();
+	for (uint32_t page = 0; page < m_Atlas.getPageCount(); ++page)
+	{
+		const std::vector<GlyphInstance>& instances = m_Atlas.getInstances(page);
+		if (instances.empty())
+			continue;
+		const GLsizeiptr size = static_cast<GLsizeiptr>(instances.size() * sizeof(GlyphInstance));
+		auto glyphs = m_StreamBuffer->allocate(size, alignment);
+		if (glyphs.data == nullptr)
+		{
+			std::cout << "Stream buffer out of space, " << instances.size() << " glyphs left out" << std::endl;
+			continue;
+		}
+		std::memcpy(glyphs.data, instances.data(), size);
+		m_StateCache->bindBufferRange(GL_SHADER_STORAGE_BUFFER, GlyphsBinding, m_StreamBuffer->getBuffer(), glyphs.offset, glyphs.size);
+		m_StateCache->bindTextureUnit(AtlasUnit, m_Pages[page]);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instances.size()));
+		++m_DrawCount;
+	}
+	m_Atlas.endFrame();
+}
+
+void icy::System::OpenGLTextRenderer::uploadPages()
+{
+	bool bUnbound = false;
+	for (uint32_t page = 0; page < m_Atlas.getPageCount(); ++page)
+	{
+		if (m_Pages[page] == 0)
+			m_Pages[page] = m_StateCache->createTexture2D(1, GL_R8, GlyphAtlas::PageSize, GlyphAtlas::PageSize);
+		uint32_t first = 0;
+		uint32_t count = 0;
+		if (!m_Atlas.takeDirtyRows(page, first, count))
+			continue;
+		if (!bUnbound)
+		{
+			// The rows come straight out of the atlas' copy, not out of a pixel buffer
+			m_StateCache->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			bUnbound = true;
+		}
+		// Whole rows are contiguous in the atlas' copy, so a band of them is one upload
+		m_StateCache->textureSubImage2D(m_Pages[page], 0, 0, first, GlyphAtlas::PageSize, count, GL_RED, GL_UNSIGNED_BYTE,
+			m_Atlas.getPixels(page) + static_cast<size_t>(first) * GlyphAtlas::PageSize);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include "GlyphAtlas.hpp"
+#include "OpenGLStateCache.hpp"
+#include "OpenGLStreamBuffer.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		// Screen space text for the OpenGL backend, drawn out of a GlyphAtlas with Engine\Shaders\text.vert and text.frag
+		// Every frame's glyphs go into the stream buffer and out as one instanced quad draw per atlas page, whatever the
+		// number of strings, and only the atlas rows written since the last frame are uploaded
+		class OpenGLTextRenderer
+		{
+		public:
+			// Storage block and texture unit of the text shaders, the glyphs share block 0 with the other GL systems,
+			// they never draw together
+			static constexpr GLuint GlyphsBinding = 0;
+			static constexpr GLuint AtlasUnit = 2;
+
+			OpenGLTextRenderer();
+			~OpenGLTextRenderer();
+			OpenGLTextRenderer(const OpenGLTextRenderer&) = delete;
+			OpenGLTextRenderer& operator=(const OpenGLTextRenderer&) = delete;
+
+			// shaderDirectory : where text.vert and text.frag are, ending in a separator
+			// fontPath : the font GlyphAtlas rasterizes
+			// Needs a current 4.5 context
+			bool create(OpenGLStateCache* stateCache, OpenGLStreamBuffer* streamBuffer, const char* shaderDirectory, const char* fontPath);
+			void destroy();
+
+			// Add this frame's text here, see GlyphAtlas::addText
+			GlyphAtlas& getAtlas() { return m_Atlas; }
+			const GlyphAtlas& getAtlas() const { return m_Atlas; }
+			// Draws the text added since the last draw over what is in the framebuffer, then starts the atlas' next frame, also when it draws nothing
+			// width, height : size of the framebuffer in pixels
+			void draw(uint32_t width, uint32_t height);
+			// Instanced draws the last draw() issued, one per page with glyphs on it
+			uint32_t getDrawCount() const { return m_DrawCount; }
+
+		private:
+			void uploadPages();
+
+		private:
+			OpenGLStateCache* m_StateCache;
+			OpenGLStreamBuffer* m_StreamBuffer;
+			GlyphAtlas m_Atlas;
+			GLuint m_Program;
+			// Core profiles can't draw without one, the quads have no vertex attributes
+			GLuint m_VertexArray;
+			// One R8 texture per atlas page, created as the atlas opens pages
+			GLuint m_Pages[GlyphAtlas::MaxPages];
+			uint32_t m_DrawCount;
+		};
+	}
+}
\ No newline at end of file
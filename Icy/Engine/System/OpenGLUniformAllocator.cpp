@@ -0,0 +1,43 @@
+#include "OpenGLUniformAllocator.hpp"
+#include <cstring>
+
+icy::System::OpenGLUniformAllocator::OpenGLUniformAllocator()
+{
+	m_StreamBuffer = nullptr;
+	m_StateCache = nullptr;
+	m_Bytes = 0;
+	m_LastBytes = 0;
+}
+
+void icy::System::OpenGLUniformAllocator::create(OpenGLStreamBuffer* streamBuffer, OpenGLStateCache* stateCache)
+{
+	m_StreamBuffer = streamBuffer;
+	m_StateCache = stateCache;
+}
+
+bool icy::System::OpenGLUniformAllocator::bind(GLuint binding, const void* data, GLsizeiptr size)
+{
+	return bindRange(GL_UNIFORM_BUFFER, binding, data, size, m_StreamBuffer->getUniformAlignment());
+}
+
+bool icy::System::OpenGLUniformAllocator::bindStorage(GLuint binding, const void* data, GLsizeiptr size)
+{
+	return bindRange(GL_SHADER_STORAGE_BUFFER, binding, data, size, m_StreamBuffer->getStorageAlignment());
+}
+
+void icy::System::OpenGLUniformAllocator::endFrame()
+{
+	m_LastBytes = m_Bytes;
+	m_Bytes = 0;
+}
+
+bool icy::System::OpenGLUniformAllocator::bindRange(GLenum target, GLuint binding, const void* data, GLsizeiptr size, GLsizeiptr alignment)
+{
+	OpenGLStreamBuffer::Allocation allocation = m_StreamBuffer->allocate(size, alignment);
+	if (allocation.data == nullptr)
+		return false;
+	std::memcpy(allocation.data, data, static_cast<size_t>(size));
+	m_StateCache->bindBufferRange(target, binding, m_StreamBuffer->getBuffer(), allocation.offset, allocation.size);
+	m_Bytes += allocation.size;
+	return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "OpenGLStateCache.hpp"
+#include "OpenGLStreamBuffer.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		// Per draw constants for the GL backend, written into the stream buffer and bound with glBindBufferRange
+		// No buffer is created and nothing is uploaded per draw, only a memcpy and (if it changed) one range bind
+		// GL has nothing like push constants, so small payloads take the same path
+		class OpenGLUniformAllocator
+		{
+		public:
+			OpenGLUniformAllocator();
+			void create(OpenGLStreamBuffer* streamBuffer, OpenGLStateCache* stateCache);
+
+			// Copies size bytes into this frame's region and binds them to the uniform block at binding
+			bool bind(GLuint binding, const void* data, GLsizeiptr size);
+			// Same, but for a shader storage block
+			bool bindStorage(GLuint binding, const void* data, GLsizeiptr size);
+
+			// Moves the byte counters to the last frame's, call once per frame
+			void endFrame();
+			GLsizeiptr getBytesThisFrame() const { return m_Bytes; }
+			GLsizeiptr getBytesLastFrame() const { return m_LastBytes; }
+
+		private:
+			bool bindRange(GLenum target, GLuint binding, const void* data, GLsizeiptr size, GLsizeiptr alignment);
+
+		private:
+			OpenGLStreamBuffer* m_StreamBuffer;
+			OpenGLStateCache* m_StateCache;
+			GLsizeiptr m_Bytes;
+			GLsizeiptr m_LastBytes;
+		};
+	}
+}
@@ -0,0 +1,84 @@
+#include "ParticleSimulation.hpp"
+#include <algorithm>
+#include <cstring>
+
+icy::System::ParticleSimulation::ParticleSimulation()
+{
+	reset(ParticleSortBlock);
+}
+
+uint32_t icy::System::ParticleSimulation::reset(uint32_t capacity)
+{
+	m_Capacity = ParticleSortBlock;
+	while (m_Capacity < capacity)
+		m_Capacity <<= 1;
+	m_Current = 0;
+	m_Step = 0;
+	m_EmitCarry = 0.0f;
+	m_Emitted = 0;
+	m_ReadbackStep = 0;
+	m_ReadbackEmitted = 0;
+	m_ReadbackAlive = 0;
+	for (uint32_t i = 0; i < History; ++i)
+		m_EmittedAt[i] = 0;
+	return m_Capacity;
+}
+
+void icy::System::ParticleSimulation::step(const ParticleEmitter& emitter, float dt, const float* cameraPosition, const float* viewProjection, ParticleParams& params)
+{
+	// Fractions carry over so low rates still emit at high frame rates
+	float emit = emitter.rate * dt + m_EmitCarry;
+	uint32_t emitCount = static_cast<uint32_t>(std::min(emit, static_cast<float>(m_Capacity)));
+	m_EmitCarry = emit - static_cast<float>(emitCount);
+	if (m_EmitCarry > 1.0f)
+		m_EmitCarry = 0.0f;
+	++m_Step;
+	m_Emitted += emitCount;
+	m_EmittedAt[m_Step % History] = m_Emitted;
+
+	std::memcpy(params.viewProjection, viewProjection, sizeof(params.viewProjection));
+	std::memcpy(params.emitterPosition, emitter.position, sizeof(params.emitterPosition));
+	params.emitCount = emitCount;
+	std::memcpy(params.emitterVelocity, emitter.velocity, sizeof(params.emitterVelocity));
+	params.spread = emitter.spread;
+	std::memcpy(params.gravity, emitter.gravity, sizeof(params.gravity));
+	params.deltaTime = dt;
+	std::memcpy(params.cameraPosition, cameraPosition, sizeof(params.cameraPosition));
+	params.drag = emitter.drag;
+	params.lifetimeMin = emitter.lifetimeMin;
+	params.lifetimeMax = std::max(emitter.lifetimeMin, emitter.lifetimeMax);
+	params.size = emitter.size;
+	params.color = emitter.color;
+	// Any odd constant will do, it just has to differ every step
+	params.seed = static_cast<uint32_t>(m_Step * 0x9E3779B9u);
+	params.current = m_Current;
+	params.next = m_Current ^ 1;
+	params.capacity = m_Capacity;
+	m_Current ^= 1;
+}
+
+void icy::System::ParticleSimulation::setReadback(uint64_t stepIndex, uint32_t aliveCount)
+{
+	// Too old to line up with the history, or older than what we already know
+	if (stepIndex + History <= m_Step || stepIndex <= m_ReadbackStep || stepIndex > m_Step)
+		return;
+	m_ReadbackStep = stepIndex;
+	m_ReadbackEmitted = m_EmittedAt[stepIndex % History];
+	m_ReadbackAlive = aliveCount;
+}
+
+uint32_t icy::System::ParticleSimulation::getAliveBound() const
+{
+	// Particles only appear through emission, so nothing can be alive beyond the last count plus what was emitted since
+	uint64_t bound = m_ReadbackAlive + (m_Emitted - m_ReadbackEmitted);
+	return static_cast<uint32_t>(std::min<uint64_t>(bound, m_Capacity));
+}
+
+uint32_t icy::System::ParticleSimulation::getSortSize() const
+{
+	uint32_t bound = getAliveBound();
+	uint32_t size = ParticleSortBlock;
+	while (size < bound)
+		size <<= 1;
+	return size;
+}
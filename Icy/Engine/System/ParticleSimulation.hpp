@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+
+namespace icy
+{
+	namespace System
+	{
+		// Settings of one particle emitter, can change every frame
+		struct ParticleEmitter
+		{
+			float position[3];
+			// Initial velocity, particles leave in a cone of half angle spread (radians) around it
+			float velocity[3];
+			float spread;
+			float gravity[3];
+			// Fraction of the velocity lost per second
+			float drag;
+			// Particles per second
+			float rate;
+			float lifetimeMin;
+			float lifetimeMax;
+			// Half size of the quad in clip space units at distance 1
+			float size;
+			// RGBA8, alpha fades to 0 over the lifetime
+			uint32_t color;
+		};
+
+		// The ParticleParams uniform block of Engine\Shaders\particles.comp and particle.vert (std140)
+		struct ParticleParams
+		{
+			float viewProjection[16];
+			float emitterPosition[3];
+			uint32_t emitCount;
+			float emitterVelocity[3];
+			float spread;
+			float gravity[3];
+			float deltaTime;
+			float cameraPosition[3];
+			float drag;
+			float lifetimeMin;
+			float lifetimeMax;
+			float size;
+			uint32_t color;
+			uint32_t seed;
+			uint32_t current;
+			uint32_t next;
+			uint32_t capacity;
+		};
+
+		// Passes of particles.comp, in the order a step runs them after the one off reset
+		enum class ParticlePass : uint32_t
+		{
+			Reset,
+			Emit,
+			Prepare,
+			Simulate,
+			Sort,
+			Finish,
+			Count
+		};
+
+		// Bytes per particle and where the indirect arguments sit in the counter buffer
+		static constexpr uint32_t ParticleStride = 48;
+		static constexpr uint32_t ParticleCounterSize = 48;
+		static constexpr uint32_t ParticleDispatchArgsOffset = 16;
+		static constexpr uint32_t ParticleDrawArgsOffset = 32;
+		static constexpr uint32_t ParticleWorkgroupSize = 256;
+		// Elements one sort workgroup sorts in shared memory
+		static constexpr uint32_t ParticleSortBlock = 512;
+
+		// The CPU side of a GPU particle system, shared by the Vulkan and OpenGL backends
+		// Turns the emitter rate into whole particles per step, swaps the alive lists and keeps an upper bound on
+		// the live count from counters read back a few frames late plus everything emitted since, so the sort only
+		// covers particles that can exist without the CPU ever waiting on this frame's counters
+		class ParticleSimulation
+		{
+		public:
+			ParticleSimulation();
+
+			// capacity : rounded up to a power of two of at least ParticleSortBlock, returned
+			uint32_t reset(uint32_t capacity);
+			// Fills params for the next step and advances the emission clock
+			// cameraPosition, viewProjection : where the particles are sorted from and drawn with, column major
+			void step(const ParticleEmitter& emitter, float dt, const float* cameraPosition, const float* viewProjection, ParticleParams& params);
+			// aliveCount : counters read back from step number stepIndex (see getStepIndex), older results than what we have are ignored
+			void setReadback(uint64_t stepIndex, uint32_t aliveCount);
+
+			uint32_t getCapacity() const { return m_Capacity; }
+			// Number of the last step() call, starting at 1
+			uint64_t getStepIndex() const { return m_Step; }
+			// At least as many particles as are alive after the last step
+			uint32_t getAliveBound() const;
+			// Elements the bitonic sort of the last step has to cover, a power of two
+			uint32_t getSortSize() const;
+			// Alive count from the newest readback
+			uint32_t getLastAliveCount() const { return m_ReadbackAlive; }
+
+		private:
+			uint32_t m_Capacity;
+			uint32_t m_Current;
+			uint64_t m_Step;
+			float m_EmitCarry;
+			// Emitted over all steps, and the total as of the newest readback
+			uint64_t m_Emitted;
+			uint64_t m_ReadbackStep;
+			uint64_t m_ReadbackEmitted;
+			uint32_t m_ReadbackAlive;
+			// Totals as of the last few steps, indexed by step number, to line readbacks up with
+			static constexpr uint32_t History = 8;
+			uint64_t m_EmittedAt[History];
+		};
+	}
+}
\ No newline at end of file
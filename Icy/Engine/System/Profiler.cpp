@@ -0,0 +1,144 @@
+#include "Profiler.hpp"
+#include <fstream>
+#include <iostream>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ICY_PROFILE_RDTSC() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ICY_PROFILE_RDTSC() __rdtsc()
+#endif
+
+namespace
+{
+	void writeEscaped(std::ostream& out, const char* text)
+	{
+		for (; *text != '\0'; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+				out << '\\';
+			out << *text;
+		}
+	}
+}
+
+thread_local icy::System::Profiler::ThreadBuffer* icy::System::Profiler::s_ThreadBuffer = nullptr;
+
+icy::System::Profiler& icy::System::Profiler::get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+icy::System::Profiler::Profiler()
+{
+	m_bRecording.store(false);
+	m_SessionStart = 0;
+}
+
+uint64_t icy::System::Profiler::now()
+{
+#ifdef ICY_PROFILE_RDTSC
+	return ICY_PROFILE_RDTSC();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void icy::System::Profiler::beginSession()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& buffer : m_Buffers)
+	{
+		buffer->count.store(0, std::memory_order_relaxed);
+		buffer->dropped = 0;
+	}
+	m_SessionStartTime = std::chrono::steady_clock::now();
+	m_SessionStart = now();
+	m_bRecording.store(true, std::memory_order_release);
+}
+
+bool icy::System::Profiler::endSession(const char* path)
+{
+	m_bRecording.store(false, std::memory_order_release);
+	uint64_t sessionEnd = now();
+	double sessionUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_SessionStartTime).count();
+	double ticksPerUs = sessionUs > 0.0 ? static_cast<double>(sessionEnd - m_SessionStart) / sessionUs : 1.0;
+
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Couldn't write the trace to " << path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (auto& buffer : m_Buffers)
+	{
+		if (buffer->name != nullptr)
+		{
+			file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"";
+			writeEscaped(file, buffer->name);
+			file << "\"}}";
+			first = false;
+		}
+		uint32_t count = buffer->count.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const Event& event = buffer->events[i];
+			// Zones that started before the session would come out negative
+			if (event.start < m_SessionStart)
+				continue;
+			double start = static_cast<double>(event.start - m_SessionStart) / ticksPerUs;
+			double duration = static_cast<double>(event.end - event.start) / ticksPerUs;
+			file << (first ? "" : ",") << "\n{\"ph\":\"X\",\"name\":\"";
+			writeEscaped(file, event.name);
+			file << "\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << start << ",\"dur\":" << duration << "}";
+			first = false;
+		}
+		if (buffer->dropped > 0)
+			std::cout << "Profiler dropped " << buffer->dropped << " zones on thread " << buffer->id << std::endl;
+	}
+	file << "\n]}\n";
+	return true;
+}
+
+void icy::System::Profiler::setThreadName(const char* name)
+{
+	threadBuffer().name = name;
+}
+
+void icy::System::Profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+	if (!m_bRecording.load(std::memory_order_relaxed))
+		return;
+	ThreadBuffer& buffer = threadBuffer();
+	uint32_t count = buffer.count.load(std::memory_order_relaxed);
+	if (count == EventsPerThread)
+	{
+		++buffer.dropped;
+		return;
+	}
+	buffer.events[count] = { name, start, end };
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+icy::System::Profiler::ThreadBuffer& icy::System::Profiler::threadBuffer()
+{
+	if (s_ThreadBuffer == nullptr)
+	{
+		std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+		buffer->events.reset(new Event[EventsPerThread]);
+		buffer->count.store(0);
+		buffer->dropped = 0;
+		buffer->name = nullptr;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		buffer->id = static_cast<uint32_t>(m_Buffers.size());
+		s_ThreadBuffer = buffer.get();
+		m_Buffers.push_back(std::move(buffer));
+	}
+	return *s_ThreadBuffer;
+}
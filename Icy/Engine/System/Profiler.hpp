@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Zones only exist when ICY_ENABLE_PROFILING is defined for both the engine and the application
+// Otherwise every macro below expands to nothing and costs nothing
+#ifdef ICY_ENABLE_PROFILING
+#define ICY_PROFILE_CONCAT_INNER(a, b) a##b
+#define ICY_PROFILE_CONCAT(a, b) ICY_PROFILE_CONCAT_INNER(a, b)
+// name : string literal, only the pointer is stored
+#define ICY_PROFILE_ZONE(name) icy::System::ProfileZone ICY_PROFILE_CONCAT(icyProfileZone, __LINE__)(name)
+#define ICY_PROFILE_FUNCTION() ICY_PROFILE_ZONE(__FUNCTION__)
+#define ICY_PROFILE_THREAD(name) icy::System::Profiler::get().setThreadName(name)
+#define ICY_PROFILE_BEGIN_SESSION() icy::System::Profiler::get().beginSession()
+#define ICY_PROFILE_END_SESSION(path) icy::System::Profiler::get().endSession(path)
+#else
+#define ICY_PROFILE_ZONE(name)
+#define ICY_PROFILE_FUNCTION()
+#define ICY_PROFILE_THREAD(name)
+#define ICY_PROFILE_BEGIN_SESSION()
+#define ICY_PROFILE_END_SESSION(path)
+#endif
+
+namespace icy
+{
+	namespace System
+	{
+		// Collects scoped zones into per thread buffers and writes them out as Chrome trace JSON
+		// Open the file in chrome://tracing or ui.perfetto.dev
+		class Profiler
+		{
+		public:
+			// Events per thread, a full buffer drops further zones until the next session
+			static constexpr uint32_t EventsPerThread = 1 << 16;
+
+			static Profiler& get();
+
+			// Clears every buffer and starts recording
+			void beginSession();
+			// Stops recording and writes everything recorded since beginSession
+			bool endSession(const char* path);
+			bool isRecording() const { return m_bRecording.load(std::memory_order_relaxed); }
+
+			// name : string literal, shows up as the thread's name in the trace
+			void setThreadName(const char* name);
+			void record(const char* name, uint64_t start, uint64_t end);
+
+			// Raw timestamp, rdtsc on x86 and steady_clock elsewhere
+			static uint64_t now();
+
+		private:
+			struct Event
+			{
+				const char* name;
+				uint64_t start;
+				uint64_t end;
+			};
+			struct ThreadBuffer
+			{
+				std::unique_ptr<Event[]> events;
+				// Only the owning thread writes, endSession reads up to count
+				std::atomic<uint32_t> count;
+				uint32_t dropped;
+				uint32_t id;
+				const char* name;
+			};
+			Profiler();
+			ThreadBuffer& threadBuffer();
+
+			static thread_local ThreadBuffer* s_ThreadBuffer;
+
+		private:
+			// Buffers outlive their threads so zones of finished workers still get written
+			std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+			std::mutex m_Mutex;
+			std::atomic<bool> m_bRecording;
+			// Both clocks are sampled at the start and end of a session to convert ticks to microseconds
+			uint64_t m_SessionStart;
+			std::chrono::steady_clock::time_point m_SessionStartTime;
+		};
+
+		// Records the time between its construction and destruction
+		class ProfileZone
+		{
+		public:
+			explicit ProfileZone(const char* name)
+			{
+				m_Name = name;
+				m_Start = Profiler::now();
+			}
+			~ProfileZone()
+			{
+				Profiler::get().record(m_Name, m_Start, Profiler::now());
+			}
+			ProfileZone(const ProfileZone&) = delete;
+			ProfileZone& operator=(const ProfileZone&) = delete;
+
+		private:
+			const char* m_Name;
+			uint64_t m_Start;
+		};
+	}
+}
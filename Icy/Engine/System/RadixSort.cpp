@@ -0,0 +1,148 @@
+#include "RadixSort.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstring>
+
+icy::System::RadixSorter::RadixSorter()
+{
+	m_SrcKeys = nullptr;
+	m_SrcValues = nullptr;
+	m_DstKeys = nullptr;
+	m_DstValues = nullptr;
+	m_Count = 0;
+	m_BlockSize = 0;
+	m_Shift = 0;
+	m_LastPasses = 0;
+}
+
+void icy::System::RadixSorter::reserve(uint32_t count)
+{
+	if (m_Keys.size() < count)
+	{
+		m_Keys.resize(count);
+		m_Values.resize(count);
+	}
+}
+
+void icy::System::RadixSorter::sort(uint64_t* keys, uint32_t* values, uint32_t count, ThreadPool* pool)
+{
+	ICY_PROFILE_FUNCTION();
+	m_LastPasses = 0;
+	if (count < 2)
+		return;
+	reserve(count);
+
+	uint32_t blocks = 1;
+	if (pool != nullptr && count >= ParallelThreshold)
+		blocks = std::min<uint32_t>(pool->getThreadCount() + 1, uint32_t(MaxBlocks));
+	m_Count = count;
+	m_BlockSize = (count + blocks - 1) / blocks;
+	blocks = (count + m_BlockSize - 1) / m_BlockSize;
+
+	// Runs the block function over every block, on the pool when there is more than one
+	auto forBlocks = [&](ThreadPool::RangeFunction function)
+	{
+		if (blocks == 1)
+			function(0, 1, this);
+		else
+			pool->parallelFor(blocks, 1, function, this);
+	};
+
+	m_SrcKeys = keys;
+	forBlocks(maskBlocks);
+	uint64_t mask = 0;
+	for (uint32_t block = 0; block < blocks; ++block)
+		mask |= m_Masks[block];
+
+	uint64_t* srcKeys = keys;
+	uint32_t* srcValues = values;
+	uint64_t* dstKeys = m_Keys.data();
+	uint32_t* dstValues = m_Values.data();
+	for (m_Shift = 0; m_Shift < 64; m_Shift += 8)
+	{
+		// Every key has the same byte here, the pass would not move anything
+		if (((mask >> m_Shift) & 0xFF) == 0)
+			continue;
+
+		m_SrcKeys = srcKeys;
+		m_SrcValues = srcValues;
+		m_DstKeys = dstKeys;
+		m_DstValues = dstValues;
+		forBlocks(countBlocks);
+
+		// Byte major, block minor, so equal bytes keep the order of the blocks they came from
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < 256; ++digit)
+		{
+			for (uint32_t block = 0; block < blocks; ++block)
+			{
+				uint32_t blockCount = m_Histograms[block][digit];
+				m_Histograms[block][digit] = offset;
+				offset += blockCount;
+			}
+		}
+		forBlocks(scatterBlocks);
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcValues, dstValues);
+		++m_LastPasses;
+	}
+
+	// An odd number of passes leaves the result in the scratch buffers
+	if (srcKeys != keys)
+	{
+		std::memcpy(keys, srcKeys, count * sizeof(uint64_t));
+		std::memcpy(values, srcValues, count * sizeof(uint32_t));
+	}
+}
+
+void icy::System::RadixSorter::maskBlocks(uint32_t begin, uint32_t end, void* data)
+{
+	RadixSorter& sorter = *static_cast<RadixSorter*>(data);
+	const uint64_t first = sorter.m_SrcKeys[0];
+	for (uint32_t block = begin; block < end; ++block)
+	{
+		uint32_t from = block * sorter.m_BlockSize;
+		uint32_t to = std::min(from + sorter.m_BlockSize, sorter.m_Count);
+		uint64_t mask = 0;
+		for (uint32_t i = from; i < to; ++i)
+			mask |= sorter.m_SrcKeys[i] ^ first;
+		sorter.m_Masks[block] = mask;
+	}
+}
+
+void icy::System::RadixSorter::countBlocks(uint32_t begin, uint32_t end, void* data)
+{
+	RadixSorter& sorter = *static_cast<RadixSorter*>(data);
+	const uint32_t shift = sorter.m_Shift;
+	for (uint32_t block = begin; block < end; ++block)
+	{
+		uint32_t* histogram = sorter.m_Histograms[block];
+		std::memset(histogram, 0, 256 * sizeof(uint32_t));
+		uint32_t from = block * sorter.m_BlockSize;
+		uint32_t to = std::min(from + sorter.m_BlockSize, sorter.m_Count);
+		for (uint32_t i = from; i < to; ++i)
+			++histogram[(sorter.m_SrcKeys[i] >> shift) & 0xFF];
+	}
+}
+
+void icy::System::RadixSorter::scatterBlocks(uint32_t begin, uint32_t end, void* data)
+{
+	RadixSorter& sorter = *static_cast<RadixSorter*>(data);
+	const uint32_t shift = sorter.m_Shift;
+	for (uint32_t block = begin; block < end; ++block)
+	{
+		uint32_t* offsets = sorter.m_Histograms[block];
+		uint32_t from = block * sorter.m_BlockSize;
+		uint32_t to = std::min(from + sorter.m_BlockSize, sorter.m_Count);
+		for (uint32_t i = from; i < to; ++i)
+		{
+			const uint64_t key = sorter.m_SrcKeys[i];
+			uint32_t& offset = offsets[(key >> shift) & 0xFF];
+			sorter.m_DstKeys[offset] = key;
+			sorter.m_DstValues[offset] = sorter.m_SrcValues[i];
+			++offset;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		class ThreadPool;
+
+		// Stable LSD radix sort of 64 bit keys carrying a 32 bit value each, eight passes of 8 bits
+		// Passes whose byte is the same in every key are skipped, so keys that only use a few bits sort in a few passes
+		// Large inputs are split into one block per thread: every pass counts the blocks in parallel,
+		// turns the counts into per block offsets and scatters the blocks in parallel, which keeps the sort stable
+		class RadixSorter
+		{
+		public:
+			// Below this many keys the threads cost more than they save
+			static constexpr uint32_t ParallelThreshold = 16 * 1024;
+			static constexpr uint32_t MaxBlocks = 64;
+
+			RadixSorter();
+			RadixSorter(const RadixSorter&) = delete;
+			RadixSorter& operator=(const RadixSorter&) = delete;
+
+			// Scratch space grows to the largest count seen, reserve it up front to keep sorting off the heap
+			void reserve(uint32_t count);
+			// Sorts keys ascending and moves values along with them
+			// pool : nullptr sorts on the calling thread
+			void sort(uint64_t* keys, uint32_t* values, uint32_t count, ThreadPool* pool = nullptr);
+
+			// Passes the last sort actually ran, out of eight
+			uint32_t getLastPassCount() const { return m_LastPasses; }
+
+		private:
+			static void maskBlocks(uint32_t begin, uint32_t end, void* data);
+			static void countBlocks(uint32_t begin, uint32_t end, void* data);
+			static void scatterBlocks(uint32_t begin, uint32_t end, void* data);
+
+		private:
+			std::vector<uint64_t> m_Keys;
+			std::vector<uint32_t> m_Values;
+
+			// State of the pass being run, read by the block functions
+			const uint64_t* m_SrcKeys;
+			const uint32_t* m_SrcValues;
+			uint64_t* m_DstKeys;
+			uint32_t* m_DstValues;
+			uint32_t m_Count;
+			uint32_t m_BlockSize;
+			uint32_t m_Shift;
+			// Bits that differ from the first key, per block
+			uint64_t m_Masks[MaxBlocks];
+			// Counts per block and byte, turned into scatter offsets before each scatter
+			uint32_t m_Histograms[MaxBlocks][256];
+			uint32_t m_LastPasses;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "SceneInstances.hpp"
+#include <cstring>
+
+icy::System::SceneInstances::SceneInstances()
+{
+	m_LiveCount = 0;
+	m_Stats = {};
+}
+
+icy::System::SceneInstances::InstanceId icy::System::SceneInstances::create()
+{
+	InstanceId id;
+	if (!m_FreeIds.empty())
+	{
+		id = m_FreeIds.back();
+		m_FreeIds.pop_back();
+	}
+	else
+	{
+		if (m_Instances.size() == MaxInstances)
+			return InvalidInstance;
+		id = static_cast<InstanceId>(m_Instances.size());
+		m_Instances.emplace_back();
+		m_Alive.push_back(false);
+		m_Marked.push_back(false);
+	}
+
+	SceneInstance& instance = m_Instances[id];
+	instance = {};
+	instance.model[0] = instance.model[5] = instance.model[10] = instance.model[15] = 1.0f;
+	m_Alive[id] = true;
+	++m_LiveCount;
+	mark(id);
+	return id;
+}
+
+void icy::System::SceneInstances::destroy(InstanceId id)
+{
+	if (!isAlive(id))
+		return;
+	// A pending mark stays in the list, takeDelta skips it while the id is dead
+	m_Alive[id] = false;
+	m_FreeIds.push_back(id);
+	--m_LiveCount;
+}
+
+void icy::System::SceneInstances::set(InstanceId id, const float* model, const uint32_t* texture)
+{
+	if (!isAlive(id))
+		return;
+	SceneInstance& instance = m_Instances[id];
+	if (model != nullptr)
+		std::memcpy(instance.model, model, sizeof(instance.model));
+	if (texture != nullptr)
+		std::memcpy(instance.texture, texture, sizeof(instance.texture));
+	mark(id);
+}
+
+uint32_t icy::System::SceneInstances::getDeltaCount() const
+{
+	const uint32_t count = static_cast<uint32_t>(m_Dirty.size());
+	return count < MaxDeltaInstances ? count : MaxDeltaInstances;
+}
+
+uint32_t icy::System::SceneInstances::takeDelta(uint32_t* ids, SceneInstance* instances)
+{
+	// Order doesn't matter, every id is in the list once
+	uint32_t count = 0;
+	uint32_t taken = 0;
+	while (taken < MaxDeltaInstances && !m_Dirty.empty())
+	{
+		const InstanceId id = m_Dirty.back();
+		m_Dirty.pop_back();
+		m_Marked[id] = false;
+		++taken;
+		if (!m_Alive[id])
+			continue;
+		ids[count] = id;
+		instances[count] = m_Instances[id];
+		++count;
+	}
+
+	m_Stats.instances = count;
+	m_Stats.bytes = count > 0 ? (count + 1) * sizeof(uint32_t) + count * sizeof(SceneInstance) : 0;
+	m_Stats.fullBytes = static_cast<uint64_t>(m_LiveCount) * sizeof(SceneInstance);
+	m_Stats.pending = static_cast<uint32_t>(m_Dirty.size());
+	return count;
+}
+
+void icy::System::SceneInstances::markAll()
+{
+	for (InstanceId id = 0; id < m_Instances.size(); ++id)
+	{
+		if (m_Alive[id])
+			mark(id);
+	}
+}
+
+void icy::System::SceneInstances::mark(InstanceId id)
+{
+	if (m_Marked[id])
+		return;
+	m_Marked[id] = true;
+	m_Dirty.push_back(id);
+}
\ No newline at end of file
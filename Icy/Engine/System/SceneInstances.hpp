@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		// One object of the GPU scene, matches IcyDrawData in OpenGLIndirectRenderer's preamble and IcySceneInstance
+		// in Engine\Shaders\scenescatter.comp (std430)
+		struct SceneInstance
+		{
+			// Column major
+			float model[16];
+			// OpenGLIndirectRenderer::getTextureWords fills it for the indirect renderer's materials
+			uint32_t texture[4];
+		};
+
+		struct SceneUploadStats
+		{
+			// Instances in the last delta and its bytes, ids and count included
+			uint32_t instances;
+			uint64_t bytes;
+			// What uploading every live instance again would have cost
+			uint64_t fullBytes;
+			// Changed instances that didn't fit in the delta, the next one carries them
+			uint32_t pending;
+		};
+
+		// CPU side of OpenGLSceneBuffer's persistent GPU instance buffer
+		// An instance keeps its id, and with it its place in the GPU buffer, for as long as it lives, so draws and culling
+		// can refer to it from frame to frame. set() only marks the instance, the next delta carries every marked instance
+		// once however often it changed, and scenescatter.comp scatters the delta into the buffer
+		class SceneInstances
+		{
+		public:
+			typedef uint32_t InstanceId;
+			static constexpr InstanceId InvalidInstance = 0xFFFFFFFFu;
+			static constexpr uint32_t MaxInstances = 1 << 16;
+			// Most instances a single delta carries
+			static constexpr uint32_t MaxDeltaInstances = 1 << 14;
+			// Matches the workgroup size of scenescatter.comp
+			static constexpr uint32_t ScatterWorkgroupSize = 64;
+
+			SceneInstances();
+			SceneInstances(const SceneInstances&) = delete;
+			SceneInstances& operator=(const SceneInstances&) = delete;
+
+			// An instance with an identity transform and a zero texture, InvalidInstance when all MaxInstances are taken
+			InstanceId create();
+			// The id is reused by a later create(), draws must stop referring to it
+			void destroy(InstanceId id);
+			// model : column major 4x4 transform, texture : 4 words, nullptr keeps the current ones
+			void set(InstanceId id, const float* model, const uint32_t* texture);
+			const SceneInstance& get(InstanceId id) const { return m_Instances[id]; }
+			bool isAlive(InstanceId id) const { return id < m_Alive.size() && m_Alive[id]; }
+			uint32_t getLiveCount() const { return m_LiveCount; }
+
+			// Instances the next delta will carry at most
+			uint32_t getDeltaCount() const;
+			// Writes the next delta and unmarks what it carries
+			// ids, instances : room for getDeltaCount() entries each, filled in the same order
+			// Returns the number written
+			uint32_t takeDelta(uint32_t* ids, SceneInstance* instances);
+			// Marks every live instance, for a GPU buffer that doesn't hold them yet
+			void markAll();
+			const SceneUploadStats& getStats() const { return m_Stats; }
+
+		private:
+			void mark(InstanceId id);
+
+		private:
+			std::vector<SceneInstance> m_Instances;
+			std::vector<bool> m_Alive;
+			std::vector<bool> m_Marked;
+			std::vector<InstanceId> m_FreeIds;
+			// Every marked id once
+			std::vector<InstanceId> m_Dirty;
+			uint32_t m_LiveCount;
+			SceneUploadStats m_Stats;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,427 @@
+#include "SpirvReflection.hpp"
+#include "VulkanPipelineCompiler.hpp"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// The parts of the SPIR-V spec the reflection reads
+	const uint32_t SpirvMagic = 0x07230203;
+	enum Op : uint32_t
+	{
+		OpEntryPoint = 15,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+	enum Decoration : uint32_t
+	{
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+	enum StorageClass : uint32_t
+	{
+		StorageUniformConstant = 0,
+		StorageInput = 1,
+		StorageUniform = 2,
+		StoragePushConstant = 9,
+		StorageStorageBuffer = 12
+	};
+	const uint32_t DimBuffer = 5;
+	const uint32_t DimSubpassData = 6;
+	const uint32_t NotSet = 0xFFFFFFFFu;
+
+	struct Id
+	{
+		uint32_t opcode = 0;
+		// Pointee, element, component or column type
+		uint32_t type = 0;
+		// Storage class of pointers and variables
+		uint32_t storage = 0;
+		// Width of scalars, component count of vectors and matrices, value of constants, array length id
+		uint32_t value = 0;
+		// Signedness of ints, dim of images
+		uint32_t extra = 0;
+		// Sampled operand of images
+		uint32_t sampled = 0;
+		uint32_t set = NotSet;
+		uint32_t binding = NotSet;
+		uint32_t location = NotSet;
+		uint32_t arrayStride = 0;
+		bool block = false;
+		bool bufferBlock = false;
+		bool builtIn = false;
+		// Struct members, index into Module::members
+		uint32_t firstMember = 0;
+		uint32_t memberCount = 0;
+	};
+	struct Member
+	{
+		uint32_t type = 0;
+		uint32_t offset = 0;
+		uint32_t matrixStride = 0;
+	};
+	struct Module
+	{
+		std::vector<Id> ids;
+		std::vector<Member> members;
+	};
+
+	// Shortest valid form of the instructions read here, 0 for the ones that are skipped
+	uint32_t minimumWords(uint32_t opcode)
+	{
+		switch (opcode)
+		{
+		case OpTypeSampler: return 2;
+		case OpTypeFloat:
+		case OpTypeSampledImage:
+		case OpTypeRuntimeArray:
+		case OpTypeStruct: return 2;
+		case OpEntryPoint:
+		case OpTypeInt:
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeArray:
+		case OpTypePointer:
+		case OpConstant:
+		case OpVariable:
+		case OpMemberDecorate: return 4;
+		case OpDecorate: return 3;
+		case OpTypeImage: return 9;
+		default: return 0;
+		}
+	}
+
+	uint32_t typeSize(const Module& module, uint32_t id, uint32_t matrixStride)
+	{
+		const Id& type = module.ids[id];
+		switch (type.opcode)
+		{
+		case OpTypeInt:
+		case OpTypeFloat:
+			return type.value / 8;
+		case OpTypeVector:
+			return type.value * typeSize(module, type.type, 0);
+		case OpTypeMatrix:
+			return type.value * (matrixStride != 0 ? matrixStride : typeSize(module, type.type, 0));
+		case OpTypeArray:
+		{
+			uint32_t length = module.ids[type.value].value;
+			return length * (type.arrayStride != 0 ? type.arrayStride : typeSize(module, type.type, matrixStride));
+		}
+		case OpTypeStruct:
+		{
+			uint32_t size = 0;
+			for (uint32_t i = 0; i < type.memberCount; ++i)
+			{
+				const Member& member = module.members[type.firstMember + i];
+				size = std::max(size, member.offset + typeSize(module, member.type, member.matrixStride));
+			}
+			return size;
+		}
+		default:
+			return 0;
+		}
+	}
+
+	VkShaderStageFlagBits toStage(uint32_t executionModel)
+	{
+		switch (executionModel)
+		{
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		default: return VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+	}
+
+	// Returns false for types that can't be a descriptor
+	bool toDescriptorType(const Module& module, uint32_t type, uint32_t storage, VkDescriptorType& descriptorType)
+	{
+		const Id& id = module.ids[type];
+		if (storage == StorageStorageBuffer)
+		{
+			descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			return true;
+		}
+		if (storage == StorageUniform)
+		{
+			// SPIR-V before 1.3 marks storage buffers as uniform BufferBlocks
+			descriptorType = id.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			return id.block || id.bufferBlock;
+		}
+		switch (id.opcode)
+		{
+		case OpTypeSampler:
+			descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			return true;
+		case OpTypeSampledImage:
+			descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			return true;
+		case OpTypeImage:
+			if (id.extra == DimSubpassData)
+				descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			else if (id.extra == DimBuffer)
+				descriptorType = id.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			else
+				descriptorType = id.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// 32 bit scalars and vectors only, which is all vertex inputs use in practice
+	VkFormat toFormat(const Module& module, uint32_t type, uint32_t& size)
+	{
+		const Id* id = &module.ids[type];
+		uint32_t components = 1;
+		if (id->opcode == OpTypeVector)
+		{
+			components = id->value;
+			id = &module.ids[id->type];
+		}
+		size = components * 4;
+		if (id->value != 32 || components > 4)
+			return VK_FORMAT_UNDEFINED;
+		static const VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat ints[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uints[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+		if (id->opcode == OpTypeFloat)
+			return floats[components - 1];
+		if (id->opcode == OpTypeInt)
+			return id->extra != 0 ? ints[components - 1] : uints[components - 1];
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+bool icy::System::reflectSpirv(const uint32_t* code, size_t wordCount, ShaderReflection& reflection)
+{
+	reflection = {};
+	if (wordCount < 5 || code[0] != SpirvMagic)
+		return false;
+
+	Module module;
+	module.ids.resize(code[3]);
+	// Member decorations come before the struct they belong to, keyed by struct id and member index
+	std::unordered_map<uint64_t, Member> memberDecorations;
+	std::vector<uint32_t> variables;
+	bool entryPoint = false;
+
+	size_t word = 5;
+	while (word < wordCount)
+	{
+		const uint32_t* op = code + word;
+		const uint32_t count = op[0] >> 16;
+		const uint32_t opcode = op[0] & 0xFFFF;
+		if (count == 0 || word + count > wordCount)
+			return false;
+		word += count;
+		// Ids have to be inside the bound from the header, anything further is trusted to come from a validating compiler
+		const uint32_t minimum = minimumWords(opcode);
+		if (count < minimum)
+			return false;
+		if (minimum != 0 && opcode != OpEntryPoint && opcode != OpMemberDecorate)
+		{
+			const uint32_t result = (opcode == OpConstant || opcode == OpVariable) ? op[2] : op[1];
+			if (result >= module.ids.size())
+				return false;
+		}
+		switch (opcode)
+		{
+		case OpEntryPoint:
+			if (!entryPoint)
+				reflection.stage = toStage(op[1]);
+			entryPoint = true;
+			break;
+		case OpTypeInt:
+			module.ids[op[1]].opcode = opcode;
+			module.ids[op[1]].value = op[2];
+			module.ids[op[1]].extra = op[3];
+			break;
+		case OpTypeFloat:
+			module.ids[op[1]].opcode = opcode;
+			module.ids[op[1]].value = op[2];
+			break;
+		case OpTypeVector:
+		case OpTypeMatrix:
+			module.ids[op[1]].opcode = opcode;
+			module.ids[op[1]].type = op[2];
+			module.ids[op[1]].value = op[3];
+			break;
+		case OpTypeImage:
+			module.ids[op[1]].opcode = opcode;
+			module.ids[op[1]].extra = op[3];
+			module.ids[op[1]].sampled = op[7];
+			break;
+		case OpTypeSampler:
+			module.ids[op[1]].opcode = opcode;
+			break;
+		case OpTypeSampledImage:
+		case OpTypeRuntimeArray:
+			module.ids[op[1]].opcode = opcode;
+			module.ids[op[1]].type = op[2];
+			break;
+		case OpTypeArray:
+			module.ids[op[1]].opcode = opcode;
+			module.ids[op[1]].type = op[2];
+			module.ids[op[1]].value = op[3];
+			break;
+		case OpTypeStruct:
+		{
+			Id& id = module.ids[op[1]];
+			id.opcode = opcode;
+			id.firstMember = static_cast<uint32_t>(module.members.size());
+			id.memberCount = count - 2;
+			for (uint32_t i = 0; i < id.memberCount; ++i)
+			{
+				Member member;
+				auto found = memberDecorations.find((static_cast<uint64_t>(op[1]) << 32) | i);
+				if (found != memberDecorations.end())
+					member = found->second;
+				member.type = op[2 + i];
+				module.members.push_back(member);
+			}
+			break;
+		}
+		case OpTypePointer:
+			module.ids[op[1]].opcode = opcode;
+			module.ids[op[1]].storage = op[2];
+			module.ids[op[1]].type = op[3];
+			break;
+		case OpConstant:
+			module.ids[op[2]].opcode = opcode;
+			module.ids[op[2]].value = op[3];
+			break;
+		case OpVariable:
+			module.ids[op[2]].opcode = opcode;
+			module.ids[op[2]].type = op[1];
+			module.ids[op[2]].storage = op[3];
+			variables.push_back(op[2]);
+			break;
+		case OpDecorate:
+		{
+			Id& id = module.ids[op[1]];
+			const uint32_t operand = count > 3 ? op[3] : 0;
+			switch (op[2])
+			{
+			case DecorationBlock: id.block = true; break;
+			case DecorationBufferBlock: id.bufferBlock = true; break;
+			case DecorationArrayStride: id.arrayStride = operand; break;
+			case DecorationBuiltIn: id.builtIn = true; break;
+			case DecorationLocation: id.location = operand; break;
+			case DecorationBinding: id.binding = operand; break;
+			case DecorationDescriptorSet: id.set = operand; break;
+			}
+			break;
+		}
+		case OpMemberDecorate:
+		{
+			Member& member = memberDecorations[(static_cast<uint64_t>(op[1]) << 32) | op[2]];
+			const uint32_t operand = count > 4 ? op[4] : 0;
+			if (op[3] == DecorationOffset)
+				member.offset = operand;
+			else if (op[3] == DecorationMatrixStride)
+				member.matrixStride = operand;
+			break;
+		}
+		}
+	}
+	if (!entryPoint)
+		return false;
+
+	for (uint32_t variable : variables)
+	{
+		const Id& var = module.ids[variable];
+		// Variables are always pointers, the type that matters is what they point at
+		uint32_t type = module.ids[var.type].type;
+		if (var.storage == StoragePushConstant)
+		{
+			reflection.pushConstantSize = std::max(reflection.pushConstantSize, typeSize(module, type, 0));
+		}
+		else if (var.storage == StorageInput && reflection.stage == VK_SHADER_STAGE_VERTEX_BIT)
+		{
+			if (var.builtIn || var.location == NotSet)
+				continue;
+			if (reflection.inputCount == ShaderReflection::MaxInputs)
+				return false;
+			ShaderReflection::Input& input = reflection.inputs[reflection.inputCount++];
+			input.location = var.location;
+			input.format = toFormat(module, type, input.size);
+			if (input.format == VK_FORMAT_UNDEFINED)
+			{
+				std::cout << "Unsupported vertex input type at location " << var.location << std::endl;
+				return false;
+			}
+		}
+		else if (var.storage == StorageUniformConstant || var.storage == StorageUniform || var.storage == StorageStorageBuffer)
+		{
+			if (var.set == NotSet || var.binding == NotSet)
+				continue;
+			uint32_t arraySize = 1;
+			while (module.ids[type].opcode == OpTypeArray || module.ids[type].opcode == OpTypeRuntimeArray)
+			{
+				if (module.ids[type].opcode == OpTypeArray)
+					arraySize *= module.ids[module.ids[type].value].value;
+				type = module.ids[type].type;
+			}
+			VkDescriptorType descriptorType;
+			if (!toDescriptorType(module, type, var.storage, descriptorType))
+				continue;
+			if (reflection.bindingCount == ShaderReflection::MaxBindings)
+				return false;
+			reflection.bindings[reflection.bindingCount++] = { var.set, var.binding, descriptorType, arraySize };
+		}
+	}
+
+	std::sort(reflection.bindings, reflection.bindings + reflection.bindingCount, [](const ShaderReflection::Binding& a, const ShaderReflection::Binding& b)
+	{
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(reflection.inputs, reflection.inputs + reflection.inputCount, [](const ShaderReflection::Input& a, const ShaderReflection::Input& b)
+	{
+		return a.location < b.location;
+	});
+	return true;
+}
+
+bool icy::System::fillVertexInput(const ShaderReflection& vertexShader, PipelineDesc& desc)
+{
+	if (vertexShader.stage != VK_SHADER_STAGE_VERTEX_BIT || vertexShader.inputCount > PipelineDesc::MaxAttributes)
+		return false;
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < vertexShader.inputCount; ++i)
+	{
+		const ShaderReflection::Input& input = vertexShader.inputs[i];
+		desc.attributes[i] = { input.location, static_cast<uint32_t>(input.format), offset };
+		offset += input.size;
+	}
+	for (uint32_t i = vertexShader.inputCount; i < PipelineDesc::MaxAttributes; ++i)
+		desc.attributes[i] = {};
+	desc.attributeCount = vertexShader.inputCount;
+	desc.vertexStride = offset;
+	return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "VulkanCommon.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace icy
+{
+	namespace System
+	{
+		struct PipelineDesc;
+
+		// What a pipeline layout needs to know about one shader stage, read straight from its SPIR-V at load time
+		struct ShaderReflection
+		{
+			static constexpr uint32_t MaxBindings = 32;
+			static constexpr uint32_t MaxInputs = 16;
+
+			struct Binding
+			{
+				uint32_t set;
+				uint32_t binding;
+				VkDescriptorType type;
+				// Array size, runtime sized arrays count as 1
+				uint32_t count;
+			};
+			struct Input
+			{
+				uint32_t location;
+				VkFormat format;
+				uint32_t size;
+			};
+
+			VkShaderStageFlagBits stage;
+			// Sorted by set, then binding
+			uint32_t bindingCount;
+			Binding bindings[MaxBindings];
+			// Bytes up to the end of the push constant block, 0 without one
+			uint32_t pushConstantSize;
+			// Vertex shaders only, sorted by location, built-ins are left out
+			uint32_t inputCount;
+			Input inputs[MaxInputs];
+		};
+
+		// code : SPIR-V words as loaded from the .spv file
+		// Only the first entry point is reflected
+		bool reflectSpirv(const uint32_t* code, size_t wordCount, ShaderReflection& reflection);
+
+		// Fills the vertex input of desc from a reflected vertex shader, assuming one interleaved buffer with
+		// the attributes tightly packed in location order
+		bool fillVertexInput(const ShaderReflection& vertexShader, PipelineDesc& desc);
+	}
+}
\ No newline at end of file
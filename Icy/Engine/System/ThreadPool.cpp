@@ -0,0 +1,132 @@
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+	// Shared by the caller and the helpers of one parallelFor, lives on the caller's stack
+	struct ParallelFor
+	{
+		icy::System::ThreadPool::RangeFunction function;
+		void* data;
+		uint32_t count;
+		uint32_t chunk;
+		std::atomic<uint32_t> next;
+		std::atomic<uint32_t> helpers;
+	};
+
+	void runChunks(ParallelFor& work)
+	{
+		for (;;)
+		{
+			uint32_t begin = work.next.fetch_add(work.chunk);
+			if (begin >= work.count)
+				return;
+			uint32_t end = begin + work.chunk < work.count ? begin + work.chunk : work.count;
+			work.function(begin, end, work.data);
+		}
+	}
+
+	void helperJob(void* data)
+	{
+		ParallelFor& work = *static_cast<ParallelFor*>(data);
+		runChunks(work);
+		// Last access to work, the caller may return as soon as this hits zero
+		work.helpers.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+icy::System::ThreadPool::ThreadPool(unsigned threadCount)
+{
+	m_Head = 0;
+	m_Count = 0;
+	m_Stop = false;
+	if (threadCount == 0)
+	{
+		unsigned cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+	m_Threads.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; ++i)
+		m_Threads.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+icy::System::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Wake.notify_all();
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+bool icy::System::ThreadPool::submit(JobFunction function, void* data)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Count == MaxQueuedJobs)
+			return false;
+		m_Jobs[(m_Head + m_Count) % MaxQueuedJobs] = { function, data };
+		++m_Count;
+	}
+	m_Wake.notify_one();
+	return true;
+}
+
+void icy::System::ThreadPool::parallelFor(uint32_t count, uint32_t minChunk, RangeFunction function, void* data)
+{
+	if (count == 0)
+		return;
+	if (minChunk == 0)
+		minChunk = 1;
+
+	// A few chunks per thread keeps the load balanced without too much contention on next
+	uint32_t workers = getThreadCount() + 1;
+	uint32_t chunk = count / (workers * 4);
+	if (chunk < minChunk)
+		chunk = minChunk;
+	uint32_t chunks = (count + chunk - 1) / chunk;
+
+	ParallelFor work;
+	work.function = function;
+	work.data = data;
+	work.count = count;
+	work.chunk = chunk;
+	work.next.store(0);
+	work.helpers.store(0);
+
+	uint32_t helpers = chunks - 1 < getThreadCount() ? chunks - 1 : getThreadCount();
+	for (uint32_t i = 0; i < helpers; ++i)
+	{
+		work.helpers.fetch_add(1);
+		if (!submit(helperJob, &work))
+		{
+			work.helpers.fetch_sub(1);
+			break;
+		}
+	}
+
+	runChunks(work);
+	while (work.helpers.load(std::memory_order_acquire) != 0)
+		std::this_thread::yield();
+}
+
+void icy::System::ThreadPool::workerLoop()
+{
+	ICY_PROFILE_THREAD("Worker");
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wake.wait(lock, [this] { return m_Stop || m_Count != 0; });
+			if (m_Stop && m_Count == 0)
+				return;
+			job = m_Jobs[m_Head];
+			m_Head = (m_Head + 1) % MaxQueuedJobs;
+			--m_Count;
+		}
+		job.function(job.data);
+	}
+}
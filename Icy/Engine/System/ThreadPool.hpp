@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		// Fixed set of worker threads fed from a fixed size job ring, submitting never allocates
+		class ThreadPool
+		{
+		public:
+			typedef void (*JobFunction)(void* data);
+			typedef void (*RangeFunction)(uint32_t begin, uint32_t end, void* data);
+			static constexpr uint32_t MaxQueuedJobs = 1024;
+
+			// threadCount : 0 uses one thread per core minus the calling thread
+			explicit ThreadPool(unsigned threadCount = 0);
+			~ThreadPool();
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+
+			// Queues a job, returns false when the ring is full
+			bool submit(JobFunction function, void* data);
+			// Runs function over [0, count) in chunks of at least minChunk items
+			// The calling thread works too and the call returns once every chunk is done
+			void parallelFor(uint32_t count, uint32_t minChunk, RangeFunction function, void* data);
+			unsigned getThreadCount() const { return static_cast<unsigned>(m_Threads.size()); }
+
+		private:
+			struct Job
+			{
+				JobFunction function;
+				void* data;
+			};
+			void workerLoop();
+
+		private:
+			std::vector<std::thread> m_Threads;
+			std::mutex m_Mutex;
+			std::condition_variable m_Wake;
+			Job m_Jobs[MaxQueuedJobs];
+			uint32_t m_Head;
+			uint32_t m_Count;
+			bool m_Stop;
+		};
+	}
+}
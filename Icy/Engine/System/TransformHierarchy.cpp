@@ -0,0 +1,332 @@
+#include "TransformHierarchy.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace
+{
+	// Reorders values so that values[i] is what was at order[i]
+	template <class T>
+	void permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+	{
+		std::vector<T> sorted(order.size());
+		for (uint32_t i = 0; i < order.size(); ++i)
+			sorted[i] = values[order[i]];
+		values.swap(sorted);
+	}
+
+	// parent * translation * rotation * scale, parent affine and column major, nullptr for a root
+	void composeWorld(const float* parent, const float* position, const float* rotation, const float* scale, float* world)
+	{
+		const float x = rotation[0];
+		const float y = rotation[1];
+		const float z = rotation[2];
+		const float w = rotation[3];
+		float local[12] = {
+			(1.0f - 2.0f * (y * y + z * z)) * scale[0], 2.0f * (x * y + z * w) * scale[0], 2.0f * (x * z - y * w) * scale[0],
+			2.0f * (x * y - z * w) * scale[1], (1.0f - 2.0f * (x * x + z * z)) * scale[1], 2.0f * (y * z + x * w) * scale[1],
+			2.0f * (x * z + y * w) * scale[2], 2.0f * (y * z - x * w) * scale[2], (1.0f - 2.0f * (x * x + y * y)) * scale[2],
+			position[0], position[1], position[2] };
+		if (parent == nullptr)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				for (int row = 0; row < 3; ++row)
+					world[column * 4 + row] = local[column * 3 + row];
+				world[column * 4 + 3] = column == 3 ? 1.0f : 0.0f;
+			}
+			return;
+		}
+		for (int column = 0; column < 4; ++column)
+		{
+			for (int row = 0; row < 3; ++row)
+			{
+				float value = parent[row] * local[column * 3] + parent[4 + row] * local[column * 3 + 1] + parent[8 + row] * local[column * 3 + 2];
+				world[column * 4 + row] = column == 3 ? value + parent[12 + row] : value;
+			}
+			world[column * 4 + 3] = column == 3 ? 1.0f : 0.0f;
+		}
+	}
+}
+
+// Passed by reference to the containers
+constexpr icy::System::TransformHierarchy::NodeHandle icy::System::TransformHierarchy::InvalidNode;
+
+icy::System::TransformHierarchy::TransformHierarchy()
+{
+	m_LevelStarts.push_back(0);
+	m_bLayoutDirty = false;
+	m_Frame = 0;
+	m_LastUpdated = 0;
+}
+
+void icy::System::TransformHierarchy::reserve(uint32_t count)
+{
+	m_Positions.reserve(count);
+	m_Rotations.reserve(count);
+	m_Scales.reserve(count);
+	m_World.reserve(count);
+	m_Parents.reserve(count);
+	m_FirstChildren.reserve(count);
+	m_ChildCounts.reserve(count);
+	m_Depths.reserve(count);
+	m_Handles.reserve(count);
+	m_Alive.reserve(count);
+	m_UpdatedFrames.reserve(count);
+	m_QueuedFrames.reserve(count);
+	m_Slots.reserve(count);
+}
+
+icy::System::TransformHierarchy::NodeHandle icy::System::TransformHierarchy::createNode(NodeHandle parent)
+{
+	uint32_t parentSlot = InvalidNode;
+	uint32_t depth = 0;
+	if (parent != InvalidNode)
+	{
+		parentSlot = m_Slots[parent];
+		depth = m_Depths[parentSlot] + 1;
+	}
+	NodeHandle handle = static_cast<NodeHandle>(m_Slots.size());
+	if (!m_FreeHandles.empty())
+	{
+		handle = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+	}
+	else
+		m_Slots.push_back(InvalidNode);
+
+	// Goes at the end until the next update sorts it into its level
+	const uint32_t slot = static_cast<uint32_t>(m_Handles.size());
+	m_Slots[handle] = slot;
+	m_Positions.push_back({ { 0.0f, 0.0f, 0.0f } });
+	m_Rotations.push_back({ { 0.0f, 0.0f, 0.0f, 1.0f } });
+	m_Scales.push_back({ { 1.0f, 1.0f, 1.0f } });
+	m_World.push_back({ { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } });
+	m_Parents.push_back(parentSlot);
+	m_FirstChildren.push_back(0);
+	m_ChildCounts.push_back(0);
+	m_Depths.push_back(depth);
+	m_Handles.push_back(handle);
+	m_Alive.push_back(true);
+	m_UpdatedFrames.push_back(0);
+	m_QueuedFrames.push_back(m_Frame + 1);
+	if (m_Queued.size() <= depth)
+		m_Queued.resize(depth + 1);
+	m_Queued[depth].push_back(slot);
+	m_bLayoutDirty = true;
+	return handle;
+}
+
+void icy::System::TransformHierarchy::destroyNode(NodeHandle node)
+{
+	m_Alive[m_Slots[node]] = false;
+	m_bLayoutDirty = true;
+}
+
+void icy::System::TransformHierarchy::setLocal(NodeHandle node, const float* position, const float* rotation, const float* scale)
+{
+	const uint32_t slot = m_Slots[node];
+	for (int i = 0; i < 3; ++i)
+	{
+		m_Positions[slot].v[i] = position[i];
+		m_Scales[slot].v[i] = scale[i];
+	}
+	for (int i = 0; i < 4; ++i)
+		m_Rotations[slot].v[i] = rotation[i];
+	if (m_QueuedFrames[slot] != m_Frame + 1)
+	{
+		m_QueuedFrames[slot] = m_Frame + 1;
+		m_Queued[m_Depths[slot]].push_back(slot);
+	}
+}
+
+void icy::System::TransformHierarchy::update(ThreadPool* pool)
+{
+	ICY_PROFILE_FUNCTION();
+	run(false, pool);
+}
+
+void icy::System::TransformHierarchy::updateAll(ThreadPool* pool)
+{
+	ICY_PROFILE_FUNCTION();
+	run(true, pool);
+}
+
+void icy::System::TransformHierarchy::sortLayout()
+{
+	ICY_PROFILE_FUNCTION();
+	const uint32_t count = static_cast<uint32_t>(m_Handles.size());
+
+	// Children of every slot in slot order, which keeps siblings in the order they were created
+	std::vector<uint32_t> childStarts(count + 1, 0);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		if (m_Alive[slot] && m_Parents[slot] != InvalidNode)
+			++childStarts[m_Parents[slot] + 1];
+	}
+	for (uint32_t slot = 0; slot < count; ++slot)
+		childStarts[slot + 1] += childStarts[slot];
+	std::vector<uint32_t> children(childStarts[count]);
+	std::vector<uint32_t> cursors(childStarts.begin(), childStarts.end() - 1);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		if (m_Alive[slot] && m_Parents[slot] != InvalidNode)
+			children[cursors[m_Parents[slot]]++] = slot;
+	}
+
+	// Breadth first from the roots, nodes under a destroyed one are never reached
+	std::vector<uint32_t> order;
+	order.reserve(count);
+	m_LevelStarts.assign(1, 0);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		if (m_Alive[slot] && m_Parents[slot] == InvalidNode)
+			order.push_back(slot);
+	}
+	for (uint32_t levelBegin = 0; levelBegin < order.size();)
+	{
+		const uint32_t levelEnd = static_cast<uint32_t>(order.size());
+		m_LevelStarts.push_back(levelEnd);
+		for (uint32_t i = levelBegin; i < levelEnd; ++i)
+			order.insert(order.end(), children.begin() + childStarts[order[i]], children.begin() + childStarts[order[i] + 1]);
+		levelBegin = levelEnd;
+	}
+
+	std::vector<uint32_t> newSlots(count, InvalidNode);
+	for (uint32_t i = 0; i < order.size(); ++i)
+		newSlots[order[i]] = i;
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		if (newSlots[slot] == InvalidNode)
+		{
+			m_Slots[m_Handles[slot]] = InvalidNode;
+			m_FreeHandles.push_back(m_Handles[slot]);
+		}
+	}
+
+	permute(m_Positions, order);
+	permute(m_Rotations, order);
+	permute(m_Scales, order);
+	permute(m_World, order);
+	permute(m_Depths, order);
+	permute(m_Handles, order);
+	permute(m_UpdatedFrames, order);
+	permute(m_QueuedFrames, order);
+	std::vector<uint32_t> parents(order.size(), InvalidNode);
+	for (uint32_t slot = 0; slot < order.size(); ++slot)
+	{
+		const uint32_t parent = m_Parents[order[slot]];
+		if (parent != InvalidNode)
+			parents[slot] = newSlots[parent];
+	}
+	m_Parents.swap(parents);
+	m_Alive.assign(order.size(), true);
+
+	// The order above puts the children of every node right after those of the node before it
+	m_FirstChildren.resize(order.size());
+	m_ChildCounts.resize(order.size());
+	uint32_t nextChild = m_LevelStarts.size() > 1 ? m_LevelStarts[1] : 0;
+	for (uint32_t slot = 0; slot < order.size(); ++slot)
+	{
+		m_Slots[m_Handles[slot]] = slot;
+		m_FirstChildren[slot] = nextChild;
+		m_ChildCounts[slot] = childStarts[order[slot] + 1] - childStarts[order[slot]];
+		nextChild += m_ChildCounts[slot];
+	}
+
+	for (auto& queued : m_Queued)
+	{
+		uint32_t kept = 0;
+		for (uint32_t slot : queued)
+		{
+			if (newSlots[slot] != InvalidNode)
+				queued[kept++] = newSlots[slot];
+		}
+		queued.resize(kept);
+	}
+	m_bLayoutDirty = false;
+}
+
+void icy::System::TransformHierarchy::run(bool all, ThreadPool* pool)
+{
+	++m_Frame;
+	m_LastUpdated = 0;
+	if (m_bLayoutDirty)
+		sortLayout();
+
+	m_Ranges.clear();
+	const uint32_t levels = getLevelCount();
+	for (uint32_t level = 0; level < levels; ++level)
+	{
+		// m_Ranges holds the children of what changed in the level above, nodes set since the last update
+		// join them unless their parent was just recomputed and so are in there already
+		if (all)
+			m_Ranges.assign(1, { m_LevelStarts[level], m_LevelStarts[level + 1] });
+		else if (level < m_Queued.size())
+		{
+			for (uint32_t slot : m_Queued[level])
+			{
+				const uint32_t parent = m_Parents[slot];
+				if (parent == InvalidNode || m_UpdatedFrames[parent] != m_Frame)
+					addRange(slot, slot + 1);
+			}
+		}
+		if (level < m_Queued.size())
+			m_Queued[level].clear();
+
+		m_RangeOffsets.resize(m_Ranges.size());
+		uint32_t total = 0;
+		for (size_t i = 0; i < m_Ranges.size(); ++i)
+		{
+			m_RangeOffsets[i] = total;
+			total += m_Ranges[i].end - m_Ranges[i].begin;
+		}
+		if (pool != nullptr && total >= ParallelThreshold)
+			pool->parallelFor(total, MinChunk, updateNodes, this);
+		else if (total > 0)
+			updateNodes(0, total, this);
+		m_LastUpdated += total;
+
+		// The children of a run are one run in the next level
+		m_NextRanges.clear();
+		for (const Range& range : m_Ranges)
+		{
+			const uint32_t last = range.end - 1;
+			const uint32_t begin = m_FirstChildren[range.begin];
+			const uint32_t end = m_FirstChildren[last] + m_ChildCounts[last];
+			if (begin == end)
+				continue;
+			if (!m_NextRanges.empty() && m_NextRanges.back().end == begin)
+				m_NextRanges.back().end = end;
+			else
+				m_NextRanges.push_back({ begin, end });
+		}
+		m_Ranges.swap(m_NextRanges);
+	}
+}
+
+void icy::System::TransformHierarchy::addRange(uint32_t begin, uint32_t end)
+{
+	if (!m_Ranges.empty() && m_Ranges.back().end == begin)
+		m_Ranges.back().end = end;
+	else
+		m_Ranges.push_back({ begin, end });
+}
+
+void icy::System::TransformHierarchy::updateNodes(uint32_t begin, uint32_t end, void* data)
+{
+	TransformHierarchy& hierarchy = *static_cast<TransformHierarchy*>(data);
+	// The run holding begin, then on through the runs after it
+	size_t range = std::upper_bound(hierarchy.m_RangeOffsets.begin(), hierarchy.m_RangeOffsets.end(), begin) - hierarchy.m_RangeOffsets.begin() - 1;
+	uint32_t slot = hierarchy.m_Ranges[range].begin + (begin - hierarchy.m_RangeOffsets[range]);
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		if (slot == hierarchy.m_Ranges[range].end)
+			slot = hierarchy.m_Ranges[++range].begin;
+		const uint32_t parent = hierarchy.m_Parents[slot];
+		composeWorld(parent != InvalidNode ? hierarchy.m_World[parent].m : nullptr, hierarchy.m_Positions[slot].v, hierarchy.m_Rotations[slot].v,
+			hierarchy.m_Scales[slot].v, hierarchy.m_World[slot].m);
+		hierarchy.m_UpdatedFrames[slot] = hierarchy.m_Frame;
+		++slot;
+	}
+}
\ No newline at end of file
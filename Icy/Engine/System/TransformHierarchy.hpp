@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		class ThreadPool;
+
+		// Scene graph of local transforms, world matrices are only recomputed under nodes that changed
+		// Nodes are kept in structure of arrays sorted by depth, and inside a level by their parent's place in the level above,
+		// so the children of any run of nodes are one run in the next level. update() walks the levels in order: the changed
+		// runs of a level give the runs of the next, nodes set since the last update add their own, and every run is
+		// recomputed in parallel since a level only reads the one above it
+		// Creating and destroying nodes only flags the layout, the next update sorts it again
+		class TransformHierarchy
+		{
+		public:
+			typedef uint32_t NodeHandle;
+			static constexpr NodeHandle InvalidNode = 0xFFFFFFFFu;
+			// Below this many nodes in a level the threads cost more than they save
+			static constexpr uint32_t ParallelThreshold = 8 * 1024;
+			static constexpr uint32_t MinChunk = 1024;
+
+			TransformHierarchy();
+			TransformHierarchy(const TransformHierarchy&) = delete;
+			TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+			void reserve(uint32_t count);
+			// A node with an identity local transform, parent : InvalidNode for a root
+			NodeHandle createNode(NodeHandle parent = InvalidNode);
+			// Destroys the node and everything under it, their handles are reused after the next update
+			void destroyNode(NodeHandle node);
+			// position : xyz, rotation : unit quaternion xyzw, scale : xyz
+			void setLocal(NodeHandle node, const float* position, const float* rotation, const float* scale);
+
+			// Brings every world matrix up to date
+			// pool : nullptr runs on the calling thread
+			void update(ThreadPool* pool = nullptr);
+			// Recomputes every world matrix whether it changed or not, what update() saves work over
+			void updateAll(ThreadPool* pool = nullptr);
+			// Column major, as of the last update
+			const float* getWorld(NodeHandle node) const { return m_World[m_Slots[node]].m; }
+
+			uint32_t getNodeCount() const { return static_cast<uint32_t>(m_Handles.size()); }
+			uint32_t getLevelCount() const { return static_cast<uint32_t>(m_LevelStarts.size()) - 1; }
+			// World matrices the last update recomputed
+			uint32_t getLastUpdatedCount() const { return m_LastUpdated; }
+
+		private:
+			struct Float3
+			{
+				float v[3];
+			};
+			struct Float4
+			{
+				float v[4];
+			};
+			struct Matrix
+			{
+				float m[16];
+			};
+			// Slots [begin, end) of one level
+			struct Range
+			{
+				uint32_t begin;
+				uint32_t end;
+			};
+
+			void sortLayout();
+			void run(bool all, ThreadPool* pool);
+			void addRange(uint32_t begin, uint32_t end);
+			static void updateNodes(uint32_t begin, uint32_t end, void* data);
+
+		private:
+			// Per slot, in depth order once the layout is sorted
+			std::vector<Float3> m_Positions;
+			std::vector<Float4> m_Rotations;
+			std::vector<Float3> m_Scales;
+			std::vector<Matrix> m_World;
+			std::vector<uint32_t> m_Parents;
+			std::vector<uint32_t> m_FirstChildren;
+			std::vector<uint32_t> m_ChildCounts;
+			std::vector<uint32_t> m_Depths;
+			std::vector<NodeHandle> m_Handles;
+			std::vector<bool> m_Alive;
+			// Update that last recomputed the slot and that it was last set for
+			std::vector<uint32_t> m_UpdatedFrames;
+			std::vector<uint32_t> m_QueuedFrames;
+			// Slot of every handle, InvalidNode for free handles
+			std::vector<uint32_t> m_Slots;
+			std::vector<NodeHandle> m_FreeHandles;
+			// First slot of every level, then the slot count
+			std::vector<uint32_t> m_LevelStarts;
+			bool m_bLayoutDirty;
+
+			// Slots set since the last update, per level
+			std::vector<std::vector<uint32_t>> m_Queued;
+			// Runs of the level being updated and the nodes before each
+			std::vector<Range> m_Ranges;
+			std::vector<Range> m_NextRanges;
+			std::vector<uint32_t> m_RangeOffsets;
+			uint32_t m_Frame;
+			uint32_t m_LastUpdated;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "VulkanClusteredLighting.hpp"
+#include "VulkanRenderer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+static_assert(icy::System::VulkanClusteredLighting::FramesInFlight == icy::System::VulkanRenderer::FramesInFlight, "Lights are uploaded per frame slot");
+
+namespace
+{
+	// Bytes of one frame slot's readback, the grid followed by the counters
+	const VkDeviceSize ReadbackGridSize = icy::System::ClusterCount * sizeof(icy::System::ClusterRange);
+	const VkDeviceSize ReadbackSlotSize = ReadbackGridSize + icy::System::ClusterCounterSize;
+	const VkDeviceSize IndexBufferSize = icy::System::ClusterCounterSize + icy::System::ClusterIndexCapacity * sizeof(uint32_t);
+	// Where the copy recordReadBack makes starts
+	const VkDeviceSize FullReadbackOffset = icy::System::VulkanClusteredLighting::FramesInFlight * ReadbackSlotSize;
+
+	void memoryBarrier(VkCommandBuffer commands, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		vkCmdPipelineBarrier(commands, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+icy::System::VulkanClusteredLighting::VulkanClusteredLighting()
+{
+	m_Renderer = nullptr;
+	m_device = VK_NULL_HANDLE;
+	m_Params = {};
+	m_FrameIndex = 0;
+	m_uploadBuffer = VK_NULL_HANDLE;
+	m_uploadMemory = VK_NULL_HANDLE;
+	m_Upload = nullptr;
+	m_LightsOffset = 0;
+	m_SlotSize = 0;
+	m_gridBuffer = VK_NULL_HANDLE;
+	m_gridMemory = VK_NULL_HANDLE;
+	m_indexBuffer = VK_NULL_HANDLE;
+	m_indexMemory = VK_NULL_HANDLE;
+	m_readbackBuffer = VK_NULL_HANDLE;
+	m_readbackMemory = VK_NULL_HANDLE;
+	m_Readback = nullptr;
+	for (uint32_t i = 0; i < FramesInFlight; ++i)
+	{
+		m_ReadbackValid[i] = false;
+		m_ReadbackLights[i] = 0;
+	}
+	m_queries = VK_NULL_HANDLE;
+	m_TimestampPeriod = 0.0f;
+	m_Stats = {};
+	m_setLayout = VK_NULL_HANDLE;
+	m_pool = VK_NULL_HANDLE;
+	m_set = VK_NULL_HANDLE;
+	m_layout = VK_NULL_HANDLE;
+	m_shader = VK_NULL_HANDLE;
+	m_pipeline = VK_NULL_HANDLE;
+}
+
+icy::System::VulkanClusteredLighting::~VulkanClusteredLighting()
+{
+	destroy();
+}
+
+bool icy::System::VulkanClusteredLighting::create(VulkanRenderer* renderer, const char* shaderDirectory)
+{
+	destroy();
+	m_Renderer = renderer;
+	m_device = renderer->getDevice();
+	for (uint32_t i = 0; i < FramesInFlight; ++i)
+		m_ReadbackValid[i] = false;
+	if (!createBuffers() || !createDescriptors() || !createPipeline(shaderDirectory))
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::VulkanClusteredLighting::destroy()
+{
+	if (m_Renderer == nullptr)
+		return;
+	// Frames in flight may still be binning or shading with these
+	VulkanDeletionQueue& deletionQueue = m_Renderer->getDeletionQueue();
+	deletionQueue.release(VulkanDeletionQueue::Type::Pipeline, m_pipeline);
+	deletionQueue.release(VulkanDeletionQueue::Type::ShaderModule, m_shader);
+	deletionQueue.release(VulkanDeletionQueue::Type::PipelineLayout, m_layout);
+	deletionQueue.release(VulkanDeletionQueue::Type::DescriptorPool, m_pool);
+	deletionQueue.release(VulkanDeletionQueue::Type::QueryPool, m_queries);
+	if (m_Upload != nullptr)
+		vkUnmapMemory(m_device, m_uploadMemory);
+	if (m_Readback != nullptr)
+		vkUnmapMemory(m_device, m_readbackMemory);
+	VkBuffer buffers[] = { m_uploadBuffer, m_gridBuffer, m_indexBuffer, m_readbackBuffer };
+	VkDeviceMemory memories[] = { m_uploadMemory, m_gridMemory, m_indexMemory, m_readbackMemory };
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		deletionQueue.release(VulkanDeletionQueue::Type::Buffer, buffers[i]);
+		deletionQueue.release(VulkanDeletionQueue::Type::Memory, memories[i]);
+	}
+
+	m_uploadBuffer = VK_NULL_HANDLE;
+	m_uploadMemory = VK_NULL_HANDLE;
+	m_Upload = nullptr;
+	m_gridBuffer = VK_NULL_HANDLE;
+	m_gridMemory = VK_NULL_HANDLE;
+	m_indexBuffer = VK_NULL_HANDLE;
+	m_indexMemory = VK_NULL_HANDLE;
+	m_readbackBuffer = VK_NULL_HANDLE;
+	m_readbackMemory = VK_NULL_HANDLE;
+	m_Readback = nullptr;
+	m_queries = VK_NULL_HANDLE;
+	m_pipeline = VK_NULL_HANDLE;
+	m_shader = VK_NULL_HANDLE;
+	m_layout = VK_NULL_HANDLE;
+	m_pool = VK_NULL_HANDLE;
+	m_set = VK_NULL_HANDLE;
+	m_setLayout = VK_NULL_HANDLE;
+	m_Renderer = nullptr;
+}
+
+void icy::System::VulkanClusteredLighting::update(VkCommandBuffer commands, uint32_t frameIndex, const ClusterCamera& camera, const ClusterLight* lights, uint32_t count)
+{
+	// The slot's last commands have finished, their grid copy and timestamps are in
+	collect(frameIndex);
+	m_FrameIndex = frameIndex;
+
+	count = std::min(count, ClusterMaxLights);
+	LightClusterer::fillParams(camera, count, m_Params);
+	uint8_t* slot = m_Upload + frameIndex * m_SlotSize;
+	std::memcpy(slot, &m_Params, sizeof(m_Params));
+	if (count > 0)
+		std::memcpy(slot + m_LightsOffset, lights, count * sizeof(ClusterLight));
+
+	if (m_queries != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commands, m_queries, frameIndex * 2, 2);
+		vkCmdWriteTimestamp(commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queries, frameIndex * 2);
+	}
+	// On an async compute queue the fragments are ordered by semaphores, and the fragment stage doesn't exist there
+	const bool bAsync = m_Renderer->getQueueScheduler().isAsync(commands);
+	const VkPipelineStageFlags fragmentStage = bAsync ? 0 : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	const VkAccessFlags fragmentAccess = bAsync ? 0 : VK_ACCESS_SHADER_READ_BIT;
+	// The counters start from zero, and last frame's fragments may still be reading the grid
+	memoryBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT | fragmentStage, VK_ACCESS_TRANSFER_READ_BIT | fragmentAccess,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	vkCmdFillBuffer(commands, m_indexBuffer, 0, ClusterCounterSize, 0);
+	memoryBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	bind(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0);
+	vkCmdDispatch(commands, (ClusterCount + ClusterWorkgroupSize - 1) / ClusterWorkgroupSize, 1, 1);
+	if (m_queries != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_queries, frameIndex * 2 + 1);
+
+	memoryBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | fragmentStage, VK_ACCESS_TRANSFER_READ_BIT | fragmentAccess);
+	VkBufferCopy copies[2] = {};
+	copies[0].dstOffset = frameIndex * ReadbackSlotSize;
+	copies[0].size = ReadbackGridSize;
+	vkCmdCopyBuffer(commands, m_gridBuffer, m_readbackBuffer, 1, &copies[0]);
+	copies[1].dstOffset = frameIndex * ReadbackSlotSize + ReadbackGridSize;
+	copies[1].size = ClusterCounterSize;
+	vkCmdCopyBuffer(commands, m_indexBuffer, m_readbackBuffer, 1, &copies[1]);
+	memoryBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+	m_ReadbackValid[frameIndex] = true;
+	m_ReadbackLights[frameIndex] = count;
+}
+
+void icy::System::VulkanClusteredLighting::bind(VkCommandBuffer commands, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set)
+{
+	// The params and lights of the slot the last update wrote
+	const uint32_t slotOffset = static_cast<uint32_t>(m_FrameIndex * m_SlotSize);
+	const uint32_t offsets[2] = { slotOffset, slotOffset + static_cast<uint32_t>(m_LightsOffset) };
+	vkCmdBindDescriptorSets(commands, bindPoint, layout, set, 1, &m_set, 2, offsets);
+}
+
+void icy::System::VulkanClusteredLighting::recordReadBack(VkCommandBuffer commands)
+{
+	VkBufferCopy copies[2] = {};
+	copies[0].dstOffset = FullReadbackOffset;
+	copies[0].size = ReadbackGridSize;
+	copies[1].dstOffset = FullReadbackOffset + ReadbackGridSize;
+	copies[1].size = IndexBufferSize;
+	vkCmdCopyBuffer(commands, m_gridBuffer, m_readbackBuffer, 1, &copies[0]);
+	vkCmdCopyBuffer(commands, m_indexBuffer, m_readbackBuffer, 1, &copies[1]);
+	memoryBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
+
+void icy::System::VulkanClusteredLighting::readBack(std::vector<ClusterRange>& grid, std::vector<uint32_t>& indices, uint32_t& overflowed) const
+{
+	const uint8_t* copy = m_Readback + FullReadbackOffset;
+	const uint32_t* counters = reinterpret_cast<const uint32_t*>(copy + ReadbackGridSize);
+	// Clusters that didn't fit still added to the counter
+	const uint32_t indexCount = std::min(counters[0], ClusterIndexCapacity);
+	overflowed = counters[1];
+	const ClusterRange* ranges = reinterpret_cast<const ClusterRange*>(copy);
+	grid.assign(ranges, ranges + ClusterCount);
+	const uint32_t* list = counters + ClusterCounterSize / sizeof(uint32_t);
+	indices.assign(list, list + indexCount);
+}
+
+bool icy::System::VulkanClusteredLighting::createBuffers()
+{
+	// Params and lights share a slot, both are bound with dynamic offsets so each has to start aligned
+	const VkPhysicalDeviceLimits& limits = m_Renderer->getDeviceInfo().properties.limits;
+	const VkDeviceSize alignment = std::max<VkDeviceSize>(std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment), 16);
+	m_LightsOffset = (sizeof(ClusterParams) + alignment - 1) & ~(alignment - 1);
+	m_SlotSize = (m_LightsOffset + ClusterMaxLights * sizeof(ClusterLight) + alignment - 1) & ~(alignment - 1);
+
+	// Read by the compute queue and by graphics, so shared between their families
+	if (!m_Renderer->createBuffer(FramesInFlight * m_SlotSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_uploadBuffer, m_uploadMemory, true))
+		return false;
+	if (!m_Renderer->createBuffer(ClusterCount * sizeof(ClusterRange), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, m_gridBuffer, m_gridMemory, true))
+		return false;
+	if (!m_Renderer->createBuffer(IndexBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, m_indexBuffer, m_indexMemory, true))
+		return false;
+	if (!m_Renderer->createBuffer(FullReadbackOffset + ReadbackGridSize + IndexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, m_readbackBuffer, m_readbackMemory, true))
+		return false;
+	void* mapped = nullptr;
+	if (!m_Renderer->checkResults(vkMapMemory(m_device, m_uploadMemory, 0, VK_WHOLE_SIZE, 0, &mapped)))
+		return false;
+	m_Upload = static_cast<uint8_t*>(mapped);
+	if (!m_Renderer->checkResults(vkMapMemory(m_device, m_readbackMemory, 0, VK_WHOLE_SIZE, 0, &mapped)))
+		return false;
+	m_Readback = static_cast<const uint8_t*>(mapped);
+
+	// Without timestamps on every graphics and compute queue the stats go without a build time
+	m_TimestampPeriod = limits.timestampPeriod;
+	if (limits.timestampComputeAndGraphics == VK_TRUE)
+	{
+		VkQueryPoolCreateInfo queryInfo = {};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = FramesInFlight * 2;
+		if (!m_Renderer->checkResults(vkCreateQueryPool(m_device, &queryInfo, nullptr, &m_queries)))
+			return false;
+	}
+	return true;
+}
+
+bool icy::System::VulkanClusteredLighting::createDescriptors()
+{
+	// Params, lights, grid and index list, the layout clustered.glsl declares at ICY_CLUSTER_SET
+	VkDescriptorSetLayoutBinding bindings[4] = {};
+	const VkDescriptorType types[4] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = types[i];
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	m_setLayout = m_Renderer->getLayoutCache().getSetLayout(bindings, 4);
+	if (m_setLayout == VK_NULL_HANDLE)
+		return false;
+
+	VkDescriptorPoolSize poolSizes[3] = { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 } };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+	if (!m_Renderer->checkResults(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool)))
+		return false;
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_pool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &m_setLayout;
+	if (!m_Renderer->checkResults(vkAllocateDescriptorSets(m_device, &allocateInfo, &m_set)))
+		return false;
+
+	VkDescriptorBufferInfo bufferInfos[4] = {};
+	bufferInfos[0].buffer = m_uploadBuffer;
+	bufferInfos[0].range = sizeof(ClusterParams);
+	bufferInfos[1].buffer = m_uploadBuffer;
+	bufferInfos[1].range = ClusterMaxLights * sizeof(ClusterLight);
+	bufferInfos[2].buffer = m_gridBuffer;
+	bufferInfos[2].range = VK_WHOLE_SIZE;
+	bufferInfos[3].buffer = m_indexBuffer;
+	bufferInfos[3].range = VK_WHOLE_SIZE;
+	VkWriteDescriptorSet writes[4] = {};
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = types[i];
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(m_device, 4, writes, 0, nullptr);
+	return true;
+}
+
+bool icy::System::VulkanClusteredLighting::createPipeline(const char* shaderDirectory)
+{
+	VkPipelineLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_setLayout;
+	if (!m_Renderer->checkResults(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &m_layout)))
+		return false;
+
+	m_shader = m_Renderer->loadShaderModule(std::string(shaderDirectory) + "lightclusters.comp.spv", "lighting");
+	if (m_shader == VK_NULL_HANDLE)
+		return false;
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = m_shader;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_layout;
+	return m_Renderer->checkResults(vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline));
+}
+
+void icy::System::VulkanClusteredLighting::collect(uint32_t frameIndex)
+{
+	if (!m_ReadbackValid[frameIndex])
+		return;
+	const uint8_t* copy = m_Readback + frameIndex * ReadbackSlotSize;
+	m_Stats = LightClusterer::computeStats(reinterpret_cast<const ClusterRange*>(copy), m_ReadbackLights[frameIndex]);
+	m_Stats.overflowed = reinterpret_cast<const uint32_t*>(copy + ReadbackGridSize)[1];
+	uint64_t ticks[2] = {};
+	if (m_queries != VK_NULL_HANDLE &&
+		vkGetQueryPoolResults(m_device, m_queries, frameIndex * 2, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		m_Stats.buildMs = static_cast<double>(ticks[1] - ticks[0]) * m_TimestampPeriod / 1e6;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include "LightClusters.hpp"
+#include "VulkanCommon.hpp"
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanRenderer;
+
+		// Clustered forward lighting for the Vulkan backend
+		// Every update writes the lights into this frame's slot of a mapped buffer and records Engine\Shaders\lightclusters.comp,
+		// which bins them into the froxel grid; fragment shaders that #include clustered.glsl bind the same set with bind()
+		// and only loop over their cluster's lights. The grid is copied back per frame slot for the stats
+		class VulkanClusteredLighting
+		{
+		public:
+			static constexpr uint32_t FramesInFlight = 2;
+
+			VulkanClusteredLighting();
+			~VulkanClusteredLighting();
+			VulkanClusteredLighting(const VulkanClusteredLighting&) = delete;
+			VulkanClusteredLighting& operator=(const VulkanClusteredLighting&) = delete;
+
+			// shaderDirectory : where lightclusters.comp.spv is, ending in a separator
+			bool create(VulkanRenderer* renderer, const char* shaderDirectory);
+			void destroy();
+
+			// Writes count lights (up to ClusterMaxLights) and records their binning
+			// commands : the frame's command buffer or one from VulkanQueueScheduler::begin(QueueType::Compute),
+			// in which case the draws have to wait for the submission (VulkanQueueScheduler::waitInFrame) and the submission
+			// for the last frame, whose fragments read the same grid (VulkanQueueScheduler::getLastFrame)
+			// frameIndex : below FramesInFlight, the commands last recorded with it must have finished
+			void update(VkCommandBuffer commands, uint32_t frameIndex, const ClusterCamera& camera, const ClusterLight* lights, uint32_t count);
+			// Binds the lighting set for shaders built with clustered.glsl
+			// layout : has getDescriptorSetLayout() at set, the set ICY_CLUSTER_SET the shaders were compiled with
+			void bind(VkCommandBuffer commands, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set);
+			VkDescriptorSetLayout getDescriptorSetLayout() const { return m_setLayout; }
+
+			// Stats of the newest grid that made it back, the build time is the GPU's when the device has timestamps
+			const ClusterStats& getStats() const { return m_Stats; }
+			const ClusterParams& getParams() const { return m_Params; }
+
+			// Records a copy of the whole grid and index list after the last update, for tests against LightClusterer
+			void recordReadBack(VkCommandBuffer commands);
+			// Reads the copy, the commands recordReadBack went into must have finished
+			void readBack(std::vector<ClusterRange>& grid, std::vector<uint32_t>& indices, uint32_t& overflowed) const;
+
+		private:
+			bool createBuffers();
+			bool createDescriptors();
+			bool createPipeline(const char* shaderDirectory);
+			void collect(uint32_t frameIndex);
+
+		private:
+			VulkanRenderer* m_Renderer;
+			VkDevice m_device;
+			ClusterParams m_Params;
+			uint32_t m_FrameIndex;
+
+			// Params then lights for every frame slot, mapped
+			VkBuffer m_uploadBuffer;
+			VkDeviceMemory m_uploadMemory;
+			uint8_t* m_Upload;
+			VkDeviceSize m_LightsOffset;
+			VkDeviceSize m_SlotSize;
+			VkBuffer m_gridBuffer;
+			VkDeviceMemory m_gridMemory;
+			// The counters followed by ClusterIndexCapacity light indices
+			VkBuffer m_indexBuffer;
+			VkDeviceMemory m_indexMemory;
+			// Grid then counters per frame slot, then room for a whole copy of the index list
+			VkBuffer m_readbackBuffer;
+			VkDeviceMemory m_readbackMemory;
+			const uint8_t* m_Readback;
+			bool m_ReadbackValid[FramesInFlight];
+			uint32_t m_ReadbackLights[FramesInFlight];
+			VkQueryPool m_queries;
+			float m_TimestampPeriod;
+			ClusterStats m_Stats;
+
+			// Owned by the renderer's layout cache
+			VkDescriptorSetLayout m_setLayout;
+			VkDescriptorPool m_pool;
+			VkDescriptorSet m_set;
+			VkPipelineLayout m_layout;
+			VkShaderModule m_shader;
+			VkPipeline m_pipeline;
+		};
+	}
+}
\ No newline at end of file
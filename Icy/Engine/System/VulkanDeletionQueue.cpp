@@ -0,0 +1,106 @@
+#include "VulkanDeletionQueue.hpp"
+
+namespace
+{
+	template <typename Handle>
+	Handle toHandle(uint64_t handle)
+	{
+		return reinterpret_cast<Handle>(handle);
+	}
+}
+
+icy::System::VulkanDeletionQueue::VulkanDeletionQueue()
+{
+	m_instance = VK_NULL_HANDLE;
+	m_device = VK_NULL_HANDLE;
+	m_CurrentValue = 0;
+	m_Head = 0;
+	m_Count = 0;
+	m_Entries.resize(256);
+}
+
+icy::System::VulkanDeletionQueue::~VulkanDeletionQueue()
+{
+	// Whoever owns the device should have flushed before destroying it
+	if (m_device != VK_NULL_HANDLE)
+		flush();
+}
+
+void icy::System::VulkanDeletionQueue::init(VkInstance instance, VkDevice device)
+{
+	m_instance = instance;
+	m_device = device;
+}
+
+void icy::System::VulkanDeletionQueue::release(Callback callback, void* data)
+{
+	push(Type::Callback, reinterpret_cast<uint64_t>(data), callback);
+}
+
+void icy::System::VulkanDeletionQueue::push(Type type, uint64_t handle, Callback callback)
+{
+	const uint32_t capacity = static_cast<uint32_t>(m_Entries.size());
+	if (m_Count == capacity)
+	{
+		// Unwrap into a ring twice the size
+		std::vector<Entry> entries(capacity * 2);
+		for (uint32_t i = 0; i < m_Count; ++i)
+			entries[i] = m_Entries[(m_Head + i) % capacity];
+		m_Entries.swap(entries);
+		m_Head = 0;
+	}
+	Entry& entry = m_Entries[(m_Head + m_Count) % m_Entries.size()];
+	entry.value = m_CurrentValue;
+	entry.handle = handle;
+	entry.callback = callback;
+	entry.type = type;
+	++m_Count;
+}
+
+uint32_t icy::System::VulkanDeletionQueue::collect(uint64_t completedValue)
+{
+	uint32_t destroyed = 0;
+	const uint32_t capacity = static_cast<uint32_t>(m_Entries.size());
+	while (m_Count > 0 && m_Entries[m_Head].value <= completedValue)
+	{
+		destroy(m_Entries[m_Head]);
+		m_Head = (m_Head + 1) % capacity;
+		--m_Count;
+		++destroyed;
+	}
+	return destroyed;
+}
+
+uint32_t icy::System::VulkanDeletionQueue::flush()
+{
+	return collect(UINT64_MAX);
+}
+
+void icy::System::VulkanDeletionQueue::destroy(const Entry& entry)
+{
+	const uint64_t handle = entry.handle;
+	switch (entry.type)
+	{
+	case Type::Buffer: vkDestroyBuffer(m_device, toHandle<VkBuffer>(handle), nullptr); break;
+	case Type::BufferView: vkDestroyBufferView(m_device, toHandle<VkBufferView>(handle), nullptr); break;
+	case Type::Image: vkDestroyImage(m_device, toHandle<VkImage>(handle), nullptr); break;
+	case Type::ImageView: vkDestroyImageView(m_device, toHandle<VkImageView>(handle), nullptr); break;
+	case Type::Memory: vkFreeMemory(m_device, toHandle<VkDeviceMemory>(handle), nullptr); break;
+	case Type::Sampler: vkDestroySampler(m_device, toHandle<VkSampler>(handle), nullptr); break;
+	case Type::ShaderModule: vkDestroyShaderModule(m_device, toHandle<VkShaderModule>(handle), nullptr); break;
+	case Type::Pipeline: vkDestroyPipeline(m_device, toHandle<VkPipeline>(handle), nullptr); break;
+	case Type::PipelineLayout: vkDestroyPipelineLayout(m_device, toHandle<VkPipelineLayout>(handle), nullptr); break;
+	case Type::DescriptorSetLayout: vkDestroyDescriptorSetLayout(m_device, toHandle<VkDescriptorSetLayout>(handle), nullptr); break;
+	case Type::DescriptorPool: vkDestroyDescriptorPool(m_device, toHandle<VkDescriptorPool>(handle), nullptr); break;
+	case Type::RenderPass: vkDestroyRenderPass(m_device, toHandle<VkRenderPass>(handle), nullptr); break;
+	case Type::Framebuffer: vkDestroyFramebuffer(m_device, toHandle<VkFramebuffer>(handle), nullptr); break;
+	case Type::CommandPool: vkDestroyCommandPool(m_device, toHandle<VkCommandPool>(handle), nullptr); break;
+	case Type::QueryPool: vkDestroyQueryPool(m_device, toHandle<VkQueryPool>(handle), nullptr); break;
+	case Type::Semaphore: vkDestroySemaphore(m_device, toHandle<VkSemaphore>(handle), nullptr); break;
+	case Type::Fence: vkDestroyFence(m_device, toHandle<VkFence>(handle), nullptr); break;
+	case Type::Event: vkDestroyEvent(m_device, toHandle<VkEvent>(handle), nullptr); break;
+	case Type::Swapchain: vkDestroySwapchainKHR(m_device, toHandle<VkSwapchainKHR>(handle), nullptr); break;
+	case Type::Surface: vkDestroySurfaceKHR(m_instance, toHandle<VkSurfaceKHR>(handle), nullptr); break;
+	case Type::Callback: entry.callback(reinterpret_cast<void*>(handle)); break;
+	}
+}
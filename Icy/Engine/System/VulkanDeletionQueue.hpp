@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include "VulkanCommon.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		// Holds on to released Vulkan objects until the GPU work that may still use them has finished
+		// Every release is stamped with the current frame (or timeline value) and destroyed once collect() is told that value completed
+		// Releasing never waits, and destruction happens in batches at the start of a frame
+		class VulkanDeletionQueue
+		{
+		public:
+			enum class Type : uint32_t
+			{
+				Buffer,
+				BufferView,
+				Image,
+				ImageView,
+				Memory,
+				Sampler,
+				ShaderModule,
+				Pipeline,
+				PipelineLayout,
+				DescriptorSetLayout,
+				DescriptorPool,
+				RenderPass,
+				Framebuffer,
+				CommandPool,
+				QueryPool,
+				Semaphore,
+				Fence,
+				Event,
+				Swapchain,
+				Surface,
+				// Calls a function instead, for anything that needs more than a vkDestroy call
+				Callback
+			};
+			typedef void (*Callback)(void* data);
+
+			VulkanDeletionQueue();
+			~VulkanDeletionQueue();
+
+			// instance is only needed for surfaces
+			void init(VkInstance instance, VkDevice device);
+
+			// Stamps everything released from now on with value, values have to increase
+			void setCurrentValue(uint64_t value) { m_CurrentValue = value; }
+			uint64_t getCurrentValue() const { return m_CurrentValue; }
+
+			// handle : any non-dispatchable Vulkan handle of the given type, VK_NULL_HANDLE is ignored
+			template <typename Handle>
+			void release(Type type, Handle handle)
+			{
+				if (handle != VK_NULL_HANDLE)
+					push(type, reinterpret_cast<uint64_t>(handle), nullptr);
+			}
+			void release(Callback callback, void* data);
+
+			// Destroys everything stamped with a value up to and including completedValue
+			uint32_t collect(uint64_t completedValue);
+			// Destroys everything, the device must be idle
+			uint32_t flush();
+
+			uint32_t getPendingCount() const { return m_Count; }
+
+		private:
+			struct Entry
+			{
+				uint64_t value;
+				uint64_t handle;
+				Callback callback;
+				Type type;
+			};
+			void push(Type type, uint64_t handle, Callback callback);
+			void destroy(const Entry& entry);
+
+		private:
+			VkInstance m_instance;
+			VkDevice m_device;
+			uint64_t m_CurrentValue;
+			// Ring in release order, so the front is always the oldest; it only grows when a frame releases more than ever before
+			std::vector<Entry> m_Entries;
+			uint32_t m_Head;
+			uint32_t m_Count;
+		};
+	}
+}
@@ -0,0 +1,174 @@
+#include "VulkanDeviceSelector.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::string readOverride(const char* name)
+	{
+#ifdef _WIN32
+		char* value = nullptr;
+		size_t size = 0;
+		if (_dupenv_s(&value, &size, name) != 0 || value == nullptr)
+			return std::string();
+		std::string result = value;
+		std::free(value);
+		return result;
+#else
+		const char* value = std::getenv(name);
+		return value != nullptr ? value : std::string();
+#endif
+	}
+
+	std::string toLower(std::string text)
+	{
+		for (auto& c : text)
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return text;
+	}
+
+	bool hasExtension(VkPhysicalDevice device, const char* name)
+	{
+		uint32_t count = 0;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+		std::vector<VkExtensionProperties> extensions(count);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extensions.data());
+		for (const auto& extension : extensions)
+		{
+			if (std::strcmp(extension.extensionName, name) == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+VkPhysicalDevice icy::System::VulkanDeviceSelector::select(VkInstance instance, VkSurfaceKHR surface, VulkanDeviceInfo& info)
+{
+	uint32_t count = 0;
+	vkEnumeratePhysicalDevices(instance, &count, nullptr);
+	std::vector<VkPhysicalDevice> devices(count);
+	vkEnumeratePhysicalDevices(instance, &count, devices.data());
+
+	std::string override = toLower(readOverride(OverrideVariable));
+	bool overrideIsIndex = !override.empty() && std::all_of(override.begin(), override.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; });
+	const std::string verbose = readOverride(VerboseVariable);
+	const bool bVerbose = !verbose.empty() && verbose != "0";
+
+	VkPhysicalDevice best = VK_NULL_HANDLE;
+	int bestScore = -1;
+	bool overridden = false;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		VulkanDeviceInfo candidate;
+		int candidateScore = score(devices[i], surface, candidate);
+		if (bVerbose)
+		{
+			std::cout << "GPU " << i << ": " << candidate.properties.deviceName;
+			if (candidateScore < 0)
+				std::cout << " (unusable)" << std::endl;
+			else
+				std::cout << " scores " << candidateScore << std::endl;
+		}
+		if (candidateScore < 0)
+			continue;
+		bool matches = !override.empty() && (overrideIsIndex ? std::atoi(override.c_str()) == static_cast<int>(i)
+			: toLower(candidate.properties.deviceName).find(override) != std::string::npos);
+		// The first device the override names wins outright, otherwise the highest score does
+		if (matches && !overridden)
+		{
+			best = devices[i];
+			info = candidate;
+			overridden = true;
+		}
+		else if (!overridden && candidateScore > bestScore)
+		{
+			best = devices[i];
+			bestScore = candidateScore;
+			info = candidate;
+		}
+	}
+	if (!override.empty() && !overridden)
+		std::cout << OverrideVariable << "=" << override << " matches no usable GPU, picking one instead" << std::endl;
+	if (bVerbose && best != VK_NULL_HANDLE)
+		std::cout << "Using " << info.properties.deviceName << std::endl;
+	return best;
+}
+
+VkPhysicalDeviceFeatures icy::System::VulkanDeviceSelector::getEnabledFeatures(const VkPhysicalDeviceFeatures& supported)
+{
+	VkPhysicalDeviceFeatures enabled = {};
+	// Wireframe pipelines (PipelineDesc::polygonMode)
+	enabled.fillModeNonSolid = supported.fillModeNonSolid;
+	// GPU driven submission, many draws per indirect call with the draw index in firstInstance
+	enabled.multiDrawIndirect = supported.multiDrawIndirect;
+	enabled.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+	enabled.samplerAnisotropy = supported.samplerAnisotropy;
+	return enabled;
+}
+
+int icy::System::VulkanDeviceSelector::score(VkPhysicalDevice device, VkSurfaceKHR surface, VulkanDeviceInfo& info)
+{
+	info = {};
+	vkGetPhysicalDeviceProperties(device, &info.properties);
+	vkGetPhysicalDeviceMemoryProperties(device, &info.memory);
+
+	// Hard requirements: something to draw with and something to present with
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+	info.graphicsFamily = familyCount;
+	bool asyncCompute = false;
+	for (uint32_t i = 0; i < familyCount; ++i)
+	{
+		// Frames are presented from the graphics queue, so it has to reach the window
+		VkBool32 present = VK_TRUE;
+		if (surface != VK_NULL_HANDLE)
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present);
+		if (info.graphicsFamily == familyCount && (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && present == VK_TRUE)
+			info.graphicsFamily = i;
+		if ((families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+			asyncCompute = true;
+	}
+	if (info.graphicsFamily == familyCount || !hasExtension(device, VK_KHR_SWAPCHAIN_EXTENSION_NAME))
+		return -1;
+
+	int total = 0;
+	switch (info.properties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: total += 10000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: total += 5000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: total += 2000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: total += 100; break;
+	default: break;
+	}
+
+	// A point per 64 MB of the biggest device local heap, capped at 32 GB
+	for (uint32_t i = 0; i < info.memory.memoryHeapCount; ++i)
+	{
+		if (info.memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			info.deviceLocalBytes = std::max(info.deviceLocalBytes, info.memory.memoryHeaps[i].size);
+	}
+	total += static_cast<int>(std::min<VkDeviceSize>(info.deviceLocalBytes >> 26, 512));
+
+	const VkPhysicalDeviceLimits& limits = info.properties.limits;
+	total += static_cast<int>(std::min(limits.maxImageDimension2D / 1024, 32u));
+	total += static_cast<int>(std::min(limits.maxPushConstantsSize / 64, 4u));
+	total += static_cast<int>(std::min(limits.maxComputeSharedMemorySize / 8192, 8u));
+
+	VkPhysicalDeviceFeatures supported;
+	vkGetPhysicalDeviceFeatures(device, &supported);
+	info.enabledFeatures = getEnabledFeatures(supported);
+	const VkPhysicalDeviceFeatures& enabled = info.enabledFeatures;
+	total += 50 * (enabled.fillModeNonSolid + enabled.multiDrawIndirect + enabled.drawIndirectFirstInstance + enabled.samplerAnisotropy);
+	if (asyncCompute)
+		total += 100;
+	if (hasExtension(device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		total += 100;
+	return total;
+}
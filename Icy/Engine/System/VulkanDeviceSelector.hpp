@@ -0,0 +1,43 @@
+#pragma once
+#include "VulkanCommon.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		// Everything about the chosen GPU the engine reads after startup
+		// Queried once, so alignment and limit checks on hot paths never go back to the driver
+		struct VulkanDeviceInfo
+		{
+			// limits are in here
+			VkPhysicalDeviceProperties properties;
+			VkPhysicalDeviceMemoryProperties memory;
+			// What the device was created with, only the features the engine uses and the GPU has
+			VkPhysicalDeviceFeatures enabledFeatures;
+			bool timelineSemaphores;
+			uint32_t graphicsFamily;
+			// Largest device local heap
+			VkDeviceSize deviceLocalBytes;
+		};
+
+		// Scores every GPU and picks the best one the engine can run on
+		// Discrete beats integrated beats virtual beats software, then video memory, limits and supported features break ties
+		// ICY_GPU overrides the choice with a device index or part of a device name, e.g. ICY_GPU=1 or ICY_GPU=intel
+		// ICY_GPU_VERBOSE=1 prints every GPU's score and the one picked
+		class VulkanDeviceSelector
+		{
+		public:
+			static constexpr const char* OverrideVariable = "ICY_GPU";
+			static constexpr const char* VerboseVariable = "ICY_GPU_VERBOSE";
+
+			// Fills info for the chosen device, enabledFeatures already masked by getEnabledFeatures
+			// surface : window the device has to present to, VK_NULL_HANDLE when nothing is presented
+			// Returns VK_NULL_HANDLE when no GPU has a graphics queue that can present to surface and swapchain support
+			static VkPhysicalDevice select(VkInstance instance, VkSurfaceKHR surface, VulkanDeviceInfo& info);
+			// The features the engine makes use of, masked by what the device supports
+			static VkPhysicalDeviceFeatures getEnabledFeatures(const VkPhysicalDeviceFeatures& supported);
+			// -1 when the device can't run the engine or has no graphics queue presenting to surface
+			static int score(VkPhysicalDevice device, VkSurfaceKHR surface, VulkanDeviceInfo& info);
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "VulkanLayoutCache.hpp"
+#include "VulkanPipelineCompiler.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+icy::System::VulkanLayoutCache::VulkanLayoutCache()
+{
+	m_device = VK_NULL_HANDLE;
+	m_PushConstantSize = 0;
+	m_Compiler = nullptr;
+}
+
+icy::System::VulkanLayoutCache::~VulkanLayoutCache()
+{
+	destroy();
+}
+
+void icy::System::VulkanLayoutCache::init(VkDevice device, uint32_t pushConstantSize, VulkanPipelineCompiler* compiler)
+{
+	m_device = device;
+	m_PushConstantSize = pushConstantSize;
+	m_Compiler = compiler;
+}
+
+void icy::System::VulkanLayoutCache::destroy()
+{
+	if (m_device == VK_NULL_HANDLE)
+		return;
+	for (auto& entry : m_PipelineLayouts)
+	{
+		if (m_Compiler != nullptr)
+			m_Compiler->unregisterLayout(entry.second.layout.id, entry.second.layout.layout);
+		vkDestroyPipelineLayout(m_device, entry.second.layout.layout, nullptr);
+	}
+	for (auto& entry : m_SetLayouts)
+		vkDestroyDescriptorSetLayout(m_device, entry.second.layout, nullptr);
+	m_PipelineLayouts.clear();
+	m_SetLayouts.clear();
+	m_device = VK_NULL_HANDLE;
+}
+
+bool icy::System::VulkanLayoutCache::getLayout(const ShaderReflection* stages, uint32_t stageCount, Layout& layout)
+{
+	// Union of the stages' bindings per set, a binding used by several stages is visible to all of them
+	VkDescriptorSetLayoutBinding bindings[MaxSets][MaxSetBindings];
+	uint32_t bindingCounts[MaxSets] = {};
+	uint32_t setCount = 0;
+	uint32_t pushConstantSize = 0;
+	for (uint32_t s = 0; s < stageCount; ++s)
+	{
+		const ShaderReflection& stage = stages[s];
+		pushConstantSize = std::max(pushConstantSize, stage.pushConstantSize);
+		for (uint32_t b = 0; b < stage.bindingCount; ++b)
+		{
+			const ShaderReflection::Binding& binding = stage.bindings[b];
+			if (binding.set >= MaxSets)
+			{
+				std::cout << "Descriptor set " << binding.set << " is past the last supported set" << std::endl;
+				return false;
+			}
+			VkDescriptorSetLayoutBinding* set = bindings[binding.set];
+			uint32_t& count = bindingCounts[binding.set];
+			uint32_t i = 0;
+			while (i < count && set[i].binding < binding.binding)
+				++i;
+			if (i < count && set[i].binding == binding.binding)
+			{
+				if (set[i].descriptorType != binding.type)
+				{
+					std::cout << "Set " << binding.set << " binding " << binding.binding << " has a different type in two stages" << std::endl;
+					return false;
+				}
+				set[i].descriptorCount = std::max(set[i].descriptorCount, binding.count);
+				set[i].stageFlags |= stage.stage;
+				continue;
+			}
+			if (count == MaxSetBindings)
+				return false;
+			// Keep each set sorted by binding number
+			for (uint32_t j = count; j > i; --j)
+				set[j] = set[j - 1];
+			set[i] = {};
+			set[i].binding = binding.binding;
+			set[i].descriptorType = binding.type;
+			set[i].descriptorCount = binding.count;
+			set[i].stageFlags = stage.stage;
+			++count;
+			setCount = std::max(setCount, binding.set + 1);
+		}
+	}
+	if (pushConstantSize > m_PushConstantSize)
+	{
+		std::cout << "Push constants use " << pushConstantSize << " bytes, layouts only have " << m_PushConstantSize << std::endl;
+		return false;
+	}
+
+	// Sets in between the used ones get the empty layout
+	PipelineKey key = {};
+	key.setCount = setCount;
+	key.pushConstantSize = m_PushConstantSize;
+	layout = {};
+	layout.setCount = setCount;
+	for (uint32_t s = 0; s < setCount; ++s)
+	{
+		layout.sets[s] = getSetLayout(bindings[s], bindingCounts[s], &key.sets[s]);
+		if (layout.sets[s] == VK_NULL_HANDLE)
+			return false;
+	}
+
+	uint64_t hash = hashBytes(&key, sizeof(key));
+	for (;;)
+	{
+		auto found = m_PipelineLayouts.find(hash);
+		if (found == m_PipelineLayouts.end())
+			break;
+		if (std::memcmp(&found->second.key, &key, sizeof(key)) == 0)
+		{
+			layout = found->second.layout;
+			return true;
+		}
+		++hash;
+	}
+
+	// The same range everywhere, so pushed data survives pipeline switches too
+	VkPushConstantRange pushRange = { VK_SHADER_STAGE_ALL, 0, m_PushConstantSize };
+	VkPipelineLayoutCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount = setCount;
+	createInfo.pSetLayouts = layout.sets;
+	createInfo.pushConstantRangeCount = m_PushConstantSize != 0 ? 1 : 0;
+	createInfo.pPushConstantRanges = &pushRange;
+	if (vkCreatePipelineLayout(m_device, &createInfo, nullptr, &layout.layout) != VK_SUCCESS)
+		return false;
+	layout.id = hash;
+	PipelineEntry& entry = m_PipelineLayouts[hash];
+	entry.key = key;
+	entry.layout = layout;
+	if (m_Compiler != nullptr)
+		m_Compiler->registerLayout(hash, layout.layout);
+	return true;
+}
+
+VkDescriptorSetLayout icy::System::VulkanLayoutCache::getSetLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t count, uint64_t* id)
+{
+	if (count > MaxSetBindings)
+		return VK_NULL_HANDLE;
+	SetKey key = {};
+	key.count = count;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		key.bindings[i][0] = bindings[i].binding;
+		key.bindings[i][1] = bindings[i].descriptorType;
+		key.bindings[i][2] = bindings[i].descriptorCount;
+		key.bindings[i][3] = bindings[i].stageFlags;
+	}
+
+	uint64_t hash = hashBytes(&key, sizeof(key));
+	for (;;)
+	{
+		auto found = m_SetLayouts.find(hash);
+		if (found == m_SetLayouts.end())
+			break;
+		if (std::memcmp(&found->second.key, &key, sizeof(key)) == 0)
+		{
+			if (id != nullptr)
+				*id = hash;
+			return found->second.layout;
+		}
+		++hash;
+	}
+
+	VkDescriptorSetLayoutCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	createInfo.bindingCount = count;
+	createInfo.pBindings = bindings;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if (vkCreateDescriptorSetLayout(m_device, &createInfo, nullptr, &layout) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	SetEntry& entry = m_SetLayouts[hash];
+	entry.key = key;
+	entry.layout = layout;
+	if (id != nullptr)
+		*id = hash;
+	return layout;
+}
+
+uint64_t icy::System::VulkanLayoutCache::hashBytes(const void* data, size_t size)
+{
+	// FNV-1a
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "SpirvReflection.hpp"
+#include "VulkanCommon.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanPipelineCompiler;
+
+		// Builds descriptor set layouts and pipeline layouts from reflected shaders and hands out one object per distinct layout
+		// Identical sets always get the same VkDescriptorSetLayout and every pipeline layout declares the same push constant range,
+		// so pipelines whose sets match up to N are compatible there and switching between them leaves those sets bound
+		// Ids are hashes of the layout contents, stable between runs so they can go into recorded PipelineDescs
+		// Meant for load time on one thread, nothing here is synchronised
+		class VulkanLayoutCache
+		{
+		public:
+			static constexpr uint32_t MaxSets = 4;
+			static constexpr uint32_t MaxSetBindings = 32;
+
+			struct Layout
+			{
+				uint64_t id;
+				VkPipelineLayout layout;
+				uint32_t setCount;
+				VkDescriptorSetLayout sets[MaxSets];
+			};
+
+			VulkanLayoutCache();
+			~VulkanLayoutCache();
+			VulkanLayoutCache(const VulkanLayoutCache&) = delete;
+			VulkanLayoutCache& operator=(const VulkanLayoutCache&) = delete;
+
+			// pushConstantSize : size of the range every layout declares, shaders may use less but never more
+			// compiler : new pipeline layouts are registered with it under their id, may be nullptr
+			void init(VkDevice device, uint32_t pushConstantSize, VulkanPipelineCompiler* compiler);
+			void destroy();
+
+			// Merges the bindings of every stage and returns the shared layout for them
+			bool getLayout(const ShaderReflection* stages, uint32_t stageCount, Layout& layout);
+			// bindings : sorted by binding number, without immutable samplers
+			VkDescriptorSetLayout getSetLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t count, uint64_t* id = nullptr);
+
+			uint32_t getSetLayoutCount() const { return static_cast<uint32_t>(m_SetLayouts.size()); }
+			uint32_t getPipelineLayoutCount() const { return static_cast<uint32_t>(m_PipelineLayouts.size()); }
+
+		private:
+			// Plain data compared as raw bytes to rule out hash collisions
+			struct SetKey
+			{
+				uint32_t count;
+				uint32_t bindings[MaxSetBindings][4];
+			};
+			struct PipelineKey
+			{
+				uint32_t setCount;
+				uint32_t pushConstantSize;
+				uint64_t sets[MaxSets];
+			};
+			struct SetEntry
+			{
+				SetKey key;
+				VkDescriptorSetLayout layout;
+			};
+			struct PipelineEntry
+			{
+				PipelineKey key;
+				Layout layout;
+			};
+
+			static uint64_t hashBytes(const void* data, size_t size);
+
+		private:
+			VkDevice m_device;
+			uint32_t m_PushConstantSize;
+			VulkanPipelineCompiler* m_Compiler;
+			std::unordered_map<uint64_t, SetEntry> m_SetLayouts;
+			std::unordered_map<uint64_t, PipelineEntry> m_PipelineLayouts;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include "VulkanParticleSystem.hpp"
+#include "VulkanRenderer.hpp"
+
+static_assert(icy::System::VulkanParticleSystem::FramesInFlight == icy::System::VulkanRenderer::FramesInFlight, "Counters are read back per frame slot");
+
+namespace
+{
+	// File name part of each pass's SPIR-V, particles.<name>.spv
+	const char* PassNames[] = { "reset", "emit", "prepare", "simulate", "sort", "finish" };
+	static_assert(sizeof(PassNames) / sizeof(PassNames[0]) == static_cast<size_t>(icy::System::ParticlePass::Count), "Every pass needs a file");
+
+	// Specialization constant ids of the draw variants, in the order of their feature bits
+	const icy::System::VulkanShaderPermutations::Feature DrawFeatures[] = { { "soft edges", 0 }, { "fade out", 1 } };
+
+	// Storage buffers in set 1 for the compute passes and the vertex shader, set 0 is the uniform allocator's
+	const uint32_t StorageBindingCount = 4;
+
+	void fillStorageBindings(VkDescriptorSetLayoutBinding* bindings)
+	{
+		for (uint32_t i = 0; i < StorageBindingCount; ++i)
+		{
+			bindings[i] = {};
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+		}
+	}
+
+	void memoryBarrier(VkCommandBuffer commands, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		vkCmdPipelineBarrier(commands, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Every pass reads what the one before it wrote, the indirect dispatch included
+	void computeBarrier(VkCommandBuffer commands)
+	{
+		memoryBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	}
+
+	uint32_t groupCount(uint32_t threads)
+	{
+		return (threads + icy::System::ParticleWorkgroupSize - 1) / icy::System::ParticleWorkgroupSize;
+	}
+}
+
+icy::System::VulkanParticleSystem::VulkanParticleSystem()
+{
+	m_Renderer = nullptr;
+	m_device = VK_NULL_HANDLE;
+	m_Emitter = {};
+	m_Params = {};
+	m_bReset = true;
+	m_particleBuffer = VK_NULL_HANDLE;
+	m_particleMemory = VK_NULL_HANDLE;
+	m_counterBuffer = VK_NULL_HANDLE;
+	m_counterMemory = VK_NULL_HANDLE;
+	m_deadBuffer = VK_NULL_HANDLE;
+	m_deadMemory = VK_NULL_HANDLE;
+	m_aliveBuffer = VK_NULL_HANDLE;
+	m_aliveMemory = VK_NULL_HANDLE;
+	m_readbackBuffer = VK_NULL_HANDLE;
+	m_readbackMemory = VK_NULL_HANDLE;
+	m_Readback = nullptr;
+	for (uint32_t i = 0; i < FramesInFlight; ++i)
+	{
+		m_ReadbackStep[i] = 0;
+		m_ReadbackList[i] = 0;
+	}
+	m_setLayout = VK_NULL_HANDLE;
+	m_pool = VK_NULL_HANDLE;
+	m_set = VK_NULL_HANDLE;
+	m_layout = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ParticlePass::Count); ++i)
+	{
+		m_passShaders[i] = VK_NULL_HANDLE;
+		m_passes[i] = VK_NULL_HANDLE;
+	}
+	m_DrawPipeline = VulkanPipelineCompiler::InvalidPipeline;
+}
+
+icy::System::VulkanParticleSystem::~VulkanParticleSystem()
+{
+	destroy();
+}
+
+bool icy::System::VulkanParticleSystem::create(VulkanRenderer* renderer, const char* shaderDirectory, uint32_t capacity)
+{
+	destroy();
+	m_Renderer = renderer;
+	m_device = renderer->getDevice();
+	m_ShaderDirectory = shaderDirectory;
+	m_Simulation.reset(capacity);
+	m_bReset = true;
+	for (uint32_t i = 0; i < FramesInFlight; ++i)
+		m_ReadbackStep[i] = 0;
+	if (!createBuffers() || !createDescriptors() || !createPipelines())
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::VulkanParticleSystem::destroy()
+{
+	if (m_Renderer == nullptr)
+		return;
+	// Frames in flight may still be simulating or drawing
+	// Later requests must not find the modules and layout once they are gone
+	m_DrawVariants.destroy();
+	m_Renderer->getPipelineCompiler().unregisterLayout(LayoutId, m_layout);
+	VulkanDeletionQueue& deletionQueue = m_Renderer->getDeletionQueue();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ParticlePass::Count); ++i)
+	{
+		deletionQueue.release(VulkanDeletionQueue::Type::Pipeline, m_passes[i]);
+		deletionQueue.release(VulkanDeletionQueue::Type::ShaderModule, m_passShaders[i]);
+		m_passes[i] = VK_NULL_HANDLE;
+		m_passShaders[i] = VK_NULL_HANDLE;
+	}
+	deletionQueue.release(VulkanDeletionQueue::Type::PipelineLayout, m_layout);
+	deletionQueue.release(VulkanDeletionQueue::Type::DescriptorPool, m_pool);
+	if (m_Readback != nullptr)
+		vkUnmapMemory(m_device, m_readbackMemory);
+	VkBuffer buffers[] = { m_particleBuffer, m_counterBuffer, m_deadBuffer, m_aliveBuffer, m_readbackBuffer };
+	VkDeviceMemory memories[] = { m_particleMemory, m_counterMemory, m_deadMemory, m_aliveMemory, m_readbackMemory };
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		deletionQueue.release(VulkanDeletionQueue::Type::Buffer, buffers[i]);
+		deletionQueue.release(VulkanDeletionQueue::Type::Memory, memories[i]);
+	}
+
+	m_particleBuffer = VK_NULL_HANDLE;
+	m_particleMemory = VK_NULL_HANDLE;
+	m_counterBuffer = VK_NULL_HANDLE;
+	m_counterMemory = VK_NULL_HANDLE;
+	m_deadBuffer = VK_NULL_HANDLE;
+	m_deadMemory = VK_NULL_HANDLE;
+	m_aliveBuffer = VK_NULL_HANDLE;
+	m_aliveMemory = VK_NULL_HANDLE;
+	m_readbackBuffer = VK_NULL_HANDLE;
+	m_readbackMemory = VK_NULL_HANDLE;
+	m_Readback = nullptr;
+	m_layout = VK_NULL_HANDLE;
+	m_pool = VK_NULL_HANDLE;
+	m_set = VK_NULL_HANDLE;
+	m_setLayout = VK_NULL_HANDLE;
+	m_DrawPipeline = VulkanPipelineCompiler::InvalidPipeline;
+	m_Renderer = nullptr;
+}
+
+void icy::System::VulkanParticleSystem::update(VkCommandBuffer commands, uint32_t frameIndex, float dt, const float* cameraPosition, const float* viewProjection)
+{
+	// The slot's last copy has landed, it holds the alive count of the step recorded then
+	if (m_ReadbackStep[frameIndex] != 0)
+	{
+		const uint32_t* counters = m_Readback + frameIndex * (ParticleCounterSize / sizeof(uint32_t));
+		m_Simulation.setReadback(m_ReadbackStep[frameIndex], counters[1 + m_ReadbackList[frameIndex]]);
+	}
+
+	// On an async compute queue the draws are ordered by semaphores, and the vertex stage doesn't exist there
+	const bool bAsync = m_Renderer->getQueueScheduler().isAsync(commands);
+	const VkPipelineStageFlags drawStages = bAsync ? 0 : VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	const VkAccessFlags drawAccess = bAsync ? 0 : VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	// The previous step's passes, draw and readback copy used the same buffers, nothing orders them before this step otherwise
+	memoryBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | drawStages,
+		VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT | drawAccess,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	VulkanUniformAllocator& constants = m_Renderer->getUniformAllocator();
+	const uint32_t capacity = m_Simulation.getCapacity();
+	if (m_bReset)
+	{
+		// Fills the dead list with every particle, once
+		ParticleParams resetParams = {};
+		resetParams.capacity = capacity;
+		constants.bindConstants(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, &resetParams, sizeof(resetParams));
+		bindPass(commands, ParticlePass::Reset);
+		vkCmdDispatch(commands, groupCount(capacity), 1, 1);
+		computeBarrier(commands);
+		m_bReset = false;
+	}
+
+	m_Simulation.step(m_Emitter, dt, cameraPosition, viewProjection, m_Params);
+	constants.bindConstants(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, &m_Params, sizeof(m_Params));
+	if (m_Params.emitCount > 0)
+	{
+		bindPass(commands, ParticlePass::Emit);
+		vkCmdDispatch(commands, groupCount(m_Params.emitCount), 1, 1);
+		computeBarrier(commands);
+	}
+	bindPass(commands, ParticlePass::Prepare);
+	vkCmdDispatch(commands, 1, 1, 1);
+	computeBarrier(commands);
+	// Sized by the live count the GPU just wrote
+	bindPass(commands, ParticlePass::Simulate);
+	vkCmdDispatchIndirect(commands, m_counterBuffer, ParticleDispatchArgsOffset);
+	computeBarrier(commands);
+	recordSort(commands, m_Params.next);
+	bindPass(commands, ParticlePass::Finish);
+	vkCmdDispatch(commands, 1, 1, 1);
+
+	memoryBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | drawStages, VK_ACCESS_TRANSFER_READ_BIT | drawAccess);
+	VkBufferCopy copy = {};
+	copy.dstOffset = frameIndex * ParticleCounterSize;
+	copy.size = ParticleCounterSize;
+	vkCmdCopyBuffer(commands, m_counterBuffer, m_readbackBuffer, 1, &copy);
+	memoryBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+	m_ReadbackStep[frameIndex] = m_Simulation.getStepIndex();
+	m_ReadbackList[frameIndex] = m_Params.next;
+}
+
+bool icy::System::VulkanParticleSystem::createDrawPipeline(uint64_t renderPassId, uint32_t subpass, uint32_t features)
+{
+	// Shaders, layout and specializations come from the variant
+	PipelineDesc desc = {};
+	desc.renderPass = renderPassId;
+	desc.subpass = subpass;
+	desc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+	desc.polygonMode = VK_POLYGON_MODE_FILL;
+	desc.cullMode = VK_CULL_MODE_NONE;
+	desc.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	// Sorted back to front, so they blend over each other and test against the scene without writing depth
+	desc.depthTest = 1;
+	desc.depthWrite = 0;
+	desc.depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+	desc.blendEnable = 1;
+	m_DrawPipeline = m_DrawVariants.request(features, desc);
+	return m_DrawPipeline != VulkanPipelineCompiler::InvalidPipeline;
+}
+
+void icy::System::VulkanParticleSystem::draw(VkCommandBuffer commands)
+{
+	if (m_DrawPipeline == VulkanPipelineCompiler::InvalidPipeline)
+		return;
+	VkPipeline pipeline = m_Renderer->getPipelineCompiler().get(m_DrawPipeline);
+	if (pipeline == VK_NULL_HANDLE)
+		return;
+	vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	m_Renderer->getUniformAllocator().bindConstants(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, 0, &m_Params, sizeof(m_Params));
+	vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, 1, 1, &m_set, 0, nullptr);
+	vkCmdDrawIndirect(commands, m_counterBuffer, ParticleDrawArgsOffset, 1, 0);
+}
+
+bool icy::System::VulkanParticleSystem::createBuffers()
+{
+	const VkDeviceSize capacity = m_Simulation.getCapacity();
+	// Written by the compute queue and read by graphics, so shared between their families
+	const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	if (!m_Renderer->createBuffer(capacity * ParticleStride, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, m_particleBuffer, m_particleMemory, true))
+		return false;
+	if (!m_Renderer->createBuffer(ParticleCounterSize, storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, m_counterBuffer, m_counterMemory, true))
+		return false;
+	if (!m_Renderer->createBuffer(capacity * sizeof(uint32_t), storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, m_deadBuffer, m_deadMemory, true))
+		return false;
+	// Two lists of (key, index) pairs
+	if (!m_Renderer->createBuffer(2 * capacity * 2 * sizeof(uint32_t), storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, m_aliveBuffer, m_aliveMemory, true))
+		return false;
+	if (!m_Renderer->createBuffer(FramesInFlight * ParticleCounterSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, m_readbackBuffer, m_readbackMemory, true))
+		return false;
+	void* mapped = nullptr;
+	if (!m_Renderer->checkResults(vkMapMemory(m_device, m_readbackMemory, 0, VK_WHOLE_SIZE, 0, &mapped)))
+		return false;
+	m_Readback = static_cast<const uint32_t*>(mapped);
+	return true;
+}
+
+bool icy::System::VulkanParticleSystem::createDescriptors()
+{
+	VkDescriptorSetLayoutBinding bindings[StorageBindingCount];
+	fillStorageBindings(bindings);
+	m_setLayout = m_Renderer->getLayoutCache().getSetLayout(bindings, StorageBindingCount);
+	if (m_setLayout == VK_NULL_HANDLE)
+		return false;
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (!m_Renderer->checkResults(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool)))
+		return false;
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_pool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &m_setLayout;
+	if (!m_Renderer->checkResults(vkAllocateDescriptorSets(m_device, &allocateInfo, &m_set)))
+		return false;
+
+	VkDescriptorBufferInfo bufferInfos[4] = {};
+	const VkBuffer buffers[4] = { m_particleBuffer, m_counterBuffer, m_deadBuffer, m_aliveBuffer };
+	VkWriteDescriptorSet writes[4] = {};
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		bufferInfos[i].buffer = buffers[i];
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(m_device, 4, writes, 0, nullptr);
+	return true;
+}
+
+bool icy::System::VulkanParticleSystem::createPipelines()
+{
+	// One layout for every pass and the draw, so the constants and buffers stay bound across them
+	VulkanUniformAllocator& constants = m_Renderer->getUniformAllocator();
+	VkDescriptorSetLayout setLayouts[2] = { constants.getDescriptorSetLayout(), m_setLayout };
+	VkPushConstantRange pushRange = constants.getPushConstantRange();
+	VkPipelineLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 2;
+	layoutInfo.pSetLayouts = setLayouts;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushRange;
+	if (!m_Renderer->checkResults(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &m_layout)))
+		return false;
+
+	// A handful of small compute pipelines built once, they don't need the background compiler
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ParticlePass::Count); ++i)
+	{
+		m_passShaders[i] = m_Renderer->loadShaderModule(m_ShaderDirectory + "particles." + PassNames[i] + ".spv", "particle");
+		if (m_passShaders[i] == VK_NULL_HANDLE)
+			return false;
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = m_passShaders[i];
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = m_layout;
+		if (!m_Renderer->checkResults(vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_passes[i])))
+			return false;
+	}
+
+	// The draw pipeline depends on the render pass, its variants go through the compiler once one is known
+	// They share the passes' layout, so the constants and buffers bound for the step stay valid for the draw
+	m_Renderer->getPipelineCompiler().registerLayout(LayoutId, m_layout);
+	VkDescriptorSetLayoutBinding bindings[StorageBindingCount];
+	fillStorageBindings(bindings);
+	return m_DrawVariants.create(m_Renderer, m_ShaderDirectory + "particle.vert", m_ShaderDirectory + "particle.frag", DrawFeatures,
+		static_cast<uint32_t>(sizeof(DrawFeatures) / sizeof(DrawFeatures[0])), LayoutId, bindings, StorageBindingCount);
+}
+
+void icy::System::VulkanParticleSystem::bindPass(VkCommandBuffer commands, ParticlePass pass)
+{
+	vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_passes[static_cast<uint32_t>(pass)]);
+	// Binding set 1 again is cheap and keeps every pass independent of what was bound before
+	vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 1, 1, &m_set, 0, nullptr);
+}
+
+void icy::System::VulkanParticleSystem::recordSort(VkCommandBuffer commands, uint32_t list)
+{
+	// Blocks of ParticleSortBlock sort in shared memory, merges whose distance is at least a block go through
+	// global steps until the distance fits in a block again
+	VulkanUniformAllocator& constants = m_Renderer->getUniformAllocator();
+	const uint32_t size = m_Simulation.getSortSize();
+	const uint32_t groups = size / ParticleSortBlock;
+	bindPass(commands, ParticlePass::Sort);
+	uint32_t step[4] = { 0, 0, 0, list };
+	constants.bindConstants(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, step, sizeof(step));
+	vkCmdDispatch(commands, groups, 1, 1);
+	computeBarrier(commands);
+	for (uint32_t k = ParticleSortBlock * 2; k <= size; k <<= 1)
+	{
+		for (uint32_t j = k / 2; j >= ParticleSortBlock; j >>= 1)
+		{
+			step[0] = k;
+			step[1] = j;
+			step[2] = 1;
+			constants.bindConstants(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, step, sizeof(step));
+			vkCmdDispatch(commands, groups, 1, 1);
+			computeBarrier(commands);
+		}
+		step[0] = k;
+		step[2] = 2;
+		constants.bindConstants(commands, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, step, sizeof(step));
+		vkCmdDispatch(commands, groups, 1, 1);
+		computeBarrier(commands);
+	}
+}
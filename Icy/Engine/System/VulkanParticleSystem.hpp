@@ -0,0 +1,108 @@
+#pragma once
+#include "ParticleSimulation.hpp"
+#include "VulkanCommon.hpp"
+#include "VulkanPipelineCompiler.hpp"
+#include "VulkanShaderPermutations.hpp"
+#include <string>
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanRenderer;
+
+		// GPU particles for the Vulkan backend, emitted, simulated, compacted and sorted by the passes of Engine\Shaders\particles.comp
+		// Dead and alive particles are index lists with atomic counters, the alive list is rebuilt by every step so dead
+		// particles drop out, then sorted back to front, and the step finishes by writing the indirect draw arguments
+		// Nothing is read back on the CPU path except the counters, a few frames late, to size the sort
+		class VulkanParticleSystem
+		{
+		public:
+			static constexpr uint32_t FramesInFlight = 2;
+			// Stable ids the pipeline layout and shaders are registered with the pipeline compiler under
+			static constexpr uint64_t LayoutId = 0x69637950524c4159ull;
+			// Draw variants, bits of the features passed to createDrawPipeline, specialization constants of particle.vert and particle.frag
+			static constexpr uint32_t SoftEdges = 1u << 0;
+			static constexpr uint32_t FadeOut = 1u << 1;
+			static constexpr uint32_t DefaultFeatures = SoftEdges | FadeOut;
+
+			VulkanParticleSystem();
+			~VulkanParticleSystem();
+			VulkanParticleSystem(const VulkanParticleSystem&) = delete;
+			VulkanParticleSystem& operator=(const VulkanParticleSystem&) = delete;
+
+			// shaderDirectory : where particles.<pass>.spv, particle.vert.spv and particle.frag.spv are, ending in a separator
+			// capacity : maximum live particles, rounded up to a power of two
+			bool create(VulkanRenderer* renderer, const char* shaderDirectory, uint32_t capacity);
+			// The pipeline compiler must no longer be compiling the draw pipeline
+			void destroy();
+
+			void setEmitter(const ParticleEmitter& emitter) { m_Emitter = emitter; }
+			const ParticleEmitter& getEmitter() const { return m_Emitter; }
+
+			// Records one step: emit, simulate and compact, sort and write the draw arguments
+			// commands : the frame's command buffer or one from VulkanQueueScheduler::begin(QueueType::Compute),
+			// in which case the draw has to wait for the submission (VulkanQueueScheduler::waitInFrame) and the submission
+			// for the last frame, which drew from the same buffers (VulkanQueueScheduler::getLastFrame)
+			// frameIndex : below FramesInFlight, the commands last recorded with it must have finished
+			// cameraPosition, viewProjection : sort origin and the transform draw() uses, column major
+			void update(VkCommandBuffer commands, uint32_t frameIndex, float dt, const float* cameraPosition, const float* viewProjection);
+
+			// Requests the draw pipeline of the features variant for a render pass registered with the pipeline compiler
+			// under renderPassId, draw() uses the last one requested
+			bool createDrawPipeline(uint64_t renderPassId, uint32_t subpass = 0, uint32_t features = DefaultFeatures);
+			// Draws what the last update left, inside a render pass the draw pipeline was requested for
+			// Skipped while the pipeline is still compiling
+			void draw(VkCommandBuffer commands);
+
+			uint32_t getCapacity() const { return m_Simulation.getCapacity(); }
+			// Live particles a few frames ago, the GPU is never waited on for the current count
+			uint32_t getAliveCount() const { return m_Simulation.getLastAliveCount(); }
+			const ParticleSimulation& getSimulation() const { return m_Simulation; }
+			// Variants requested so far and their compile times
+			const VulkanShaderPermutations& getDrawVariants() const { return m_DrawVariants; }
+
+		private:
+			bool createBuffers();
+			bool createDescriptors();
+			bool createPipelines();
+			void bindPass(VkCommandBuffer commands, ParticlePass pass);
+			void recordSort(VkCommandBuffer commands, uint32_t list);
+
+		private:
+			VulkanRenderer* m_Renderer;
+			VkDevice m_device;
+			std::string m_ShaderDirectory;
+			ParticleSimulation m_Simulation;
+			ParticleEmitter m_Emitter;
+			// Bound for the draw too, so it reads the list the last update sorted
+			ParticleParams m_Params;
+			bool m_bReset;
+
+			VkBuffer m_particleBuffer;
+			VkDeviceMemory m_particleMemory;
+			VkBuffer m_counterBuffer;
+			VkDeviceMemory m_counterMemory;
+			VkBuffer m_deadBuffer;
+			VkDeviceMemory m_deadMemory;
+			VkBuffer m_aliveBuffer;
+			VkDeviceMemory m_aliveMemory;
+			// One copy of the counters per frame slot, mapped
+			VkBuffer m_readbackBuffer;
+			VkDeviceMemory m_readbackMemory;
+			const uint32_t* m_Readback;
+			uint64_t m_ReadbackStep[FramesInFlight];
+			uint32_t m_ReadbackList[FramesInFlight];
+
+			// Owned by the renderer's layout cache
+			VkDescriptorSetLayout m_setLayout;
+			VkDescriptorPool m_pool;
+			VkDescriptorSet m_set;
+			VkPipelineLayout m_layout;
+			VkShaderModule m_passShaders[static_cast<uint32_t>(ParticlePass::Count)];
+			VkPipeline m_passes[static_cast<uint32_t>(ParticlePass::Count)];
+			VulkanShaderPermutations m_DrawVariants;
+			VulkanPipelineCompiler::PipelineHandle m_DrawPipeline;
+		};
+	}
+}
\ No newline at end of file
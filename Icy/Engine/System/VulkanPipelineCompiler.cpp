@@ -0,0 +1,454 @@
+#include "VulkanPipelineCompiler.hpp"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "Profiler.hpp"
+
+namespace
+{
+	// "ICYP", bumped whenever PipelineDesc changes
+	constexpr uint32_t PermutationMagic = 0x50594349;
+	constexpr uint32_t PermutationVersion = 2;
+}
+
+icy::System::VulkanPipelineCompiler::VulkanPipelineCompiler()
+{
+	m_device = VK_NULL_HANDLE;
+	m_cache = VK_NULL_HANDLE;
+	m_EntryCount = 0;
+	m_Pending.store(0);
+}
+
+icy::System::VulkanPipelineCompiler::~VulkanPipelineCompiler()
+{
+	shutdown();
+}
+
+bool icy::System::VulkanPipelineCompiler::init(VkDevice device, const char* cacheFile, unsigned threadCount)
+{
+	shutdown();
+	m_device = device;
+
+	// A cache from another driver or GPU is rejected by the driver itself, so it is safe to pass whatever is on disk
+	std::vector<char> cacheData;
+	std::ifstream file(cacheFile, std::ios::binary | std::ios::ate);
+	if (file.is_open())
+	{
+		cacheData.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(cacheData.data(), cacheData.size());
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = cacheData.size();
+	cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+	if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache) != VK_SUCCESS)
+	{
+		// Retry without the old data in case it was the problem
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache) != VK_SUCCESS)
+			return false;
+	}
+
+	m_Entries.reset(new Entry[MaxPipelines]);
+	m_EntryCount = 0;
+	m_Lookup.reserve(MaxPipelines);
+	m_Finished.reserve(MaxPipelines);
+	m_CompletedThisFrame.reserve(MaxPipelines);
+	m_Backlog.reserve(MaxPipelines);
+	m_Workers.reset(new ThreadPool(threadCount));
+	return true;
+}
+
+void icy::System::VulkanPipelineCompiler::shutdown()
+{
+	if (m_device == VK_NULL_HANDLE)
+		return;
+
+	// Joining the workers finishes whatever is still queued
+	m_Workers.reset();
+	for (uint32_t i = 0; i < m_EntryCount; ++i)
+	{
+		if (m_Entries[i].pipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(m_device, m_Entries[i].pipeline, nullptr);
+	}
+	if (m_cache != VK_NULL_HANDLE)
+		vkDestroyPipelineCache(m_device, m_cache, nullptr);
+
+	m_Entries.reset();
+	m_EntryCount = 0;
+	m_Lookup.clear();
+	m_Shaders.clear();
+	m_Layouts.clear();
+	m_RenderPasses.clear();
+	m_Finished.clear();
+	m_CompletedThisFrame.clear();
+	m_Backlog.clear();
+	m_Pending.store(0);
+	m_cache = VK_NULL_HANDLE;
+	m_device = VK_NULL_HANDLE;
+}
+
+void icy::System::VulkanPipelineCompiler::registerShader(uint64_t id, VkShaderModule module)
+{
+	m_Shaders[id] = module;
+}
+
+void icy::System::VulkanPipelineCompiler::registerLayout(uint64_t id, VkPipelineLayout layout)
+{
+	m_Layouts[id] = layout;
+}
+
+void icy::System::VulkanPipelineCompiler::registerRenderPass(uint64_t id, VkRenderPass renderPass)
+{
+	m_RenderPasses[id] = renderPass;
+}
+
+void icy::System::VulkanPipelineCompiler::unregisterShader(uint64_t id, VkShaderModule module)
+{
+	dropBacklog(module, VK_NULL_HANDLE);
+	auto found = m_Shaders.find(id);
+	if (found != m_Shaders.end() && found->second == module)
+		m_Shaders.erase(found);
+}
+
+void icy::System::VulkanPipelineCompiler::unregisterLayout(uint64_t id, VkPipelineLayout layout)
+{
+	dropBacklog(VK_NULL_HANDLE, layout);
+	auto found = m_Layouts.find(id);
+	if (found != m_Layouts.end() && found->second == layout)
+		m_Layouts.erase(found);
+}
+
+icy::System::VulkanPipelineCompiler::PipelineHandle icy::System::VulkanPipelineCompiler::request(const PipelineDesc& desc)
+{
+	// Collisions are resolved by probing the next hash value
+	uint64_t hash = hashDesc(desc);
+	for (;;)
+	{
+		auto found = m_Lookup.find(hash);
+		if (found == m_Lookup.end())
+			break;
+		if (std::memcmp(&m_Entries[found->second].desc, &desc, sizeof(desc)) == 0)
+			return found->second;
+		++hash;
+	}
+
+	auto vertex = m_Shaders.find(desc.vertexShader);
+	auto fragment = m_Shaders.find(desc.fragmentShader);
+	auto layout = m_Layouts.find(desc.layout);
+	auto renderPass = m_RenderPasses.find(desc.renderPass);
+	if (vertex == m_Shaders.end() || fragment == m_Shaders.end() || layout == m_Layouts.end() || renderPass == m_RenderPasses.end())
+		return InvalidPipeline;
+	if (m_EntryCount == MaxPipelines || desc.attributeCount > PipelineDesc::MaxAttributes || desc.specializationCount > PipelineDesc::MaxSpecializations)
+		return InvalidPipeline;
+
+	PipelineHandle handle = m_EntryCount++;
+	Entry& entry = m_Entries[handle];
+	entry.owner = this;
+	entry.desc = desc;
+	entry.vertexShader = vertex->second;
+	entry.fragmentShader = fragment->second;
+	entry.layout = layout->second;
+	entry.renderPass = renderPass->second;
+	entry.pipeline = VK_NULL_HANDLE;
+	entry.handle = handle;
+	entry.fallback = InvalidPipeline;
+	entry.compileMs = 0.0;
+	entry.state.store(Queued);
+	m_Lookup[hash] = handle;
+
+	queue(entry);
+	return handle;
+}
+
+void icy::System::VulkanPipelineCompiler::setFallback(PipelineHandle handle, PipelineHandle fallback)
+{
+	if (handle < m_EntryCount && handle != fallback)
+		m_Entries[handle].fallback = fallback;
+}
+
+VkPipeline icy::System::VulkanPipelineCompiler::get(PipelineHandle handle) const
+{
+	if (handle >= m_EntryCount)
+		return VK_NULL_HANDLE;
+	const Entry& entry = m_Entries[handle];
+	if (entry.state.load(std::memory_order_acquire) == Ready)
+		return entry.pipeline;
+	if (entry.fallback < m_EntryCount)
+	{
+		const Entry& fallback = m_Entries[entry.fallback];
+		if (fallback.state.load(std::memory_order_acquire) == Ready)
+			return fallback.pipeline;
+	}
+	return VK_NULL_HANDLE;
+}
+
+bool icy::System::VulkanPipelineCompiler::isReady(PipelineHandle handle) const
+{
+	return handle < m_EntryCount && m_Entries[handle].state.load(std::memory_order_acquire) == Ready;
+}
+
+void icy::System::VulkanPipelineCompiler::beginFrame()
+{
+	m_CompletedThisFrame.clear();
+	{
+		std::lock_guard<std::mutex> lock(m_FinishedMutex);
+		m_CompletedThisFrame.swap(m_Finished);
+	}
+
+	// Move as much of the backlog into the worker queue as fits
+	size_t submitted = 0;
+	while (submitted < m_Backlog.size() && m_Workers->submit(compileJob, &m_Entries[m_Backlog[submitted]]))
+		++submitted;
+	m_Backlog.erase(m_Backlog.begin(), m_Backlog.begin() + submitted);
+}
+
+double icy::System::VulkanPipelineCompiler::getCompileMs(PipelineHandle handle) const
+{
+	return handle < m_EntryCount ? m_Entries[handle].compileMs : 0.0;
+}
+
+bool icy::System::VulkanPipelineCompiler::savePermutations(const char* path) const
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+	file.write(reinterpret_cast<const char*>(&PermutationMagic), sizeof(PermutationMagic));
+	file.write(reinterpret_cast<const char*>(&PermutationVersion), sizeof(PermutationVersion));
+	file.write(reinterpret_cast<const char*>(&m_EntryCount), sizeof(m_EntryCount));
+	for (uint32_t i = 0; i < m_EntryCount; ++i)
+		file.write(reinterpret_cast<const char*>(&m_Entries[i].desc), sizeof(PipelineDesc));
+	return file.good();
+}
+
+uint32_t icy::System::VulkanPipelineCompiler::prewarm(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return 0;
+	uint32_t magic = 0, version = 0, count = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if (!file || magic != PermutationMagic || version != PermutationVersion)
+		return 0;
+
+	uint32_t queued = 0;
+	uint32_t before = m_EntryCount;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		PipelineDesc desc;
+		if (!file.read(reinterpret_cast<char*>(&desc), sizeof(desc)))
+			break;
+		PipelineHandle handle = request(desc);
+		if (handle != InvalidPipeline && handle >= before)
+			++queued;
+	}
+	return queued;
+}
+
+bool icy::System::VulkanPipelineCompiler::saveCache(const char* path) const
+{
+	if (m_cache == VK_NULL_HANDLE)
+		return false;
+	size_t size = 0;
+	if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS)
+		return false;
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS)
+		return false;
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(data.data(), size);
+	return file.good();
+}
+
+uint64_t icy::System::VulkanPipelineCompiler::hashDesc(const PipelineDesc& desc)
+{
+	// FNV-1a
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&desc);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(desc); ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void icy::System::VulkanPipelineCompiler::compileJob(void* data)
+{
+	Entry& entry = *static_cast<Entry*>(data);
+	entry.owner->compile(entry);
+}
+
+void icy::System::VulkanPipelineCompiler::queue(Entry& entry)
+{
+	m_Pending.fetch_add(1);
+	if (!m_Workers->submit(compileJob, &entry))
+		m_Backlog.push_back(entry.handle);
+}
+
+void icy::System::VulkanPipelineCompiler::dropBacklog(VkShaderModule shader, VkPipelineLayout layout)
+{
+	// Compiles already handed to the workers can't be taken back, the owner's deletion queue covers those
+	size_t kept = 0;
+	for (PipelineHandle handle : m_Backlog)
+	{
+		Entry& entry = m_Entries[handle];
+		const bool bUsesShader = shader != VK_NULL_HANDLE && (entry.vertexShader == shader || entry.fragmentShader == shader);
+		if (bUsesShader || (layout != VK_NULL_HANDLE && entry.layout == layout))
+		{
+			entry.state.store(Failed, std::memory_order_release);
+			m_Pending.fetch_sub(1);
+			// So the same description compiles again once its objects are registered anew
+			for (auto it = m_Lookup.begin(); it != m_Lookup.end(); ++it)
+			{
+				if (it->second == handle)
+				{
+					m_Lookup.erase(it);
+					break;
+				}
+			}
+		}
+		else
+			m_Backlog[kept++] = handle;
+	}
+	m_Backlog.resize(kept);
+}
+
+void icy::System::VulkanPipelineCompiler::compile(Entry& entry)
+{
+	ICY_PROFILE_FUNCTION();
+	auto start = std::chrono::steady_clock::now();
+	const PipelineDesc& desc = entry.desc;
+
+	VkPipelineShaderStageCreateInfo stages[2] = {};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = entry.vertexShader;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = entry.fragmentShader;
+	stages[1].pName = "main";
+
+	// Both stages get every constant, ids a module doesn't declare are ignored
+	VkSpecializationMapEntry specializationEntries[PipelineDesc::MaxSpecializations];
+	for (uint32_t i = 0; i < desc.specializationCount; ++i)
+		specializationEntries[i] = { i, i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t) };
+	VkSpecializationInfo specialization = {};
+	specialization.mapEntryCount = desc.specializationCount;
+	specialization.pMapEntries = specializationEntries;
+	specialization.dataSize = desc.specializationCount * sizeof(uint32_t);
+	specialization.pData = desc.specializations;
+	if (desc.specializationCount > 0)
+	{
+		stages[0].pSpecializationInfo = &specialization;
+		stages[1].pSpecializationInfo = &specialization;
+	}
+
+	VkVertexInputBindingDescription binding = {};
+	binding.binding = 0;
+	binding.stride = desc.vertexStride;
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	VkVertexInputAttributeDescription attributes[PipelineDesc::MaxAttributes] = {};
+	for (uint32_t i = 0; i < desc.attributeCount; ++i)
+	{
+		attributes[i].location = desc.attributes[i].location;
+		attributes[i].binding = 0;
+		attributes[i].format = static_cast<VkFormat>(desc.attributes[i].format);
+		attributes[i].offset = desc.attributes[i].offset;
+	}
+	VkPipelineVertexInputStateCreateInfo vertexInput = {};
+	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInput.vertexBindingDescriptionCount = desc.attributeCount > 0 ? 1 : 0;
+	vertexInput.pVertexBindingDescriptions = &binding;
+	vertexInput.vertexAttributeDescriptionCount = desc.attributeCount;
+	vertexInput.pVertexAttributeDescriptions = attributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = static_cast<VkPrimitiveTopology>(desc.topology);
+
+	// Viewport and scissor are dynamic so one pipeline works at any resolution
+	VkPipelineViewportStateCreateInfo viewport = {};
+	viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewport.viewportCount = 1;
+	viewport.scissorCount = 1;
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamic = {};
+	dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic.dynamicStateCount = 2;
+	dynamic.pDynamicStates = dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterization = {};
+	rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterization.polygonMode = static_cast<VkPolygonMode>(desc.polygonMode);
+	rasterization.cullMode = desc.cullMode;
+	rasterization.frontFace = static_cast<VkFrontFace>(desc.frontFace);
+	rasterization.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisample = {};
+	multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = static_cast<VkCompareOp>(desc.depthCompare);
+
+	VkPipelineColorBlendAttachmentState blendAttachment = {};
+	blendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+	blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	VkPipelineColorBlendStateCreateInfo blend = {};
+	blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blend.attachmentCount = 1;
+	blend.pAttachments = &blendAttachment;
+
+	VkGraphicsPipelineCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	createInfo.stageCount = 2;
+	createInfo.pStages = stages;
+	createInfo.pVertexInputState = &vertexInput;
+	createInfo.pInputAssemblyState = &inputAssembly;
+	createInfo.pViewportState = &viewport;
+	createInfo.pRasterizationState = &rasterization;
+	createInfo.pMultisampleState = &multisample;
+	createInfo.pDepthStencilState = &depthStencil;
+	createInfo.pColorBlendState = &blend;
+	createInfo.pDynamicState = &dynamic;
+	createInfo.layout = entry.layout;
+	createInfo.renderPass = entry.renderPass;
+	createInfo.subpass = desc.subpass;
+	createInfo.basePipelineIndex = -1;
+
+	VkResult result = vkCreateGraphicsPipelines(m_device, m_cache, 1, &createInfo, nullptr, &entry.pipeline);
+	entry.compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "Failed to compile pipeline " << entry.handle << " (" << result << ")" << std::endl;
+		entry.pipeline = VK_NULL_HANDLE;
+		entry.state.store(Failed, std::memory_order_release);
+	}
+	else
+	{
+		entry.state.store(Ready, std::memory_order_release);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_FinishedMutex);
+		m_Finished.push_back(entry.handle);
+	}
+	m_Pending.fetch_sub(1);
+}
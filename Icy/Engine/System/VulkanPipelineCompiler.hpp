@@ -0,0 +1,150 @@
+#pragma once
+#include "VulkanCommon.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		// Everything needed to build a graphics pipeline, shaders, layouts and render passes are referenced by
+		// the ids they were registered with so a description can be written to disk and replayed on the next run
+		// Plain data without padding, it is hashed and compared as raw bytes
+		struct PipelineDesc
+		{
+			static constexpr uint32_t MaxAttributes = 8;
+			static constexpr uint32_t MaxSpecializations = 8;
+			struct Attribute
+			{
+				uint32_t location;
+				uint32_t format;
+				uint32_t offset;
+			};
+
+			uint64_t vertexShader;
+			uint64_t fragmentShader;
+			uint64_t layout;
+			uint64_t renderPass;
+			uint32_t subpass;
+			uint32_t topology;
+			uint32_t polygonMode;
+			uint32_t cullMode;
+			uint32_t frontFace;
+			uint32_t depthTest;
+			uint32_t depthWrite;
+			uint32_t depthCompare;
+			uint32_t blendEnable;
+			uint32_t vertexStride;
+			uint32_t attributeCount;
+			// Specialization constants 0 to specializationCount - 1 of both stages, bools are 0 or 1
+			uint32_t specializationCount;
+			Attribute attributes[MaxAttributes];
+			uint32_t specializations[MaxSpecializations];
+		};
+
+		// Builds graphics pipelines on worker threads through a shared VkPipelineCache
+		// Requests never block, until a pipeline is ready get() returns its fallback or VK_NULL_HANDLE
+		class VulkanPipelineCompiler
+		{
+		public:
+			typedef uint32_t PipelineHandle;
+			static constexpr PipelineHandle InvalidPipeline = 0xFFFFFFFFu;
+			static constexpr uint32_t MaxPipelines = 4096;
+
+			VulkanPipelineCompiler();
+			~VulkanPipelineCompiler();
+			VulkanPipelineCompiler(const VulkanPipelineCompiler&) = delete;
+			VulkanPipelineCompiler& operator=(const VulkanPipelineCompiler&) = delete;
+
+			// cacheFile : pipeline cache data from an earlier run, may not exist yet
+			// threadCount : number of compile threads
+			bool init(VkDevice device, const char* cacheFile, unsigned threadCount = 2);
+			// Waits for the running compiles and destroys every pipeline
+			void shutdown();
+
+			// Objects a PipelineDesc can refer to, register them before requesting pipelines that use them
+			void registerShader(uint64_t id, VkShaderModule module);
+			void registerLayout(uint64_t id, VkPipelineLayout layout);
+			void registerRenderPass(uint64_t id, VkRenderPass renderPass);
+			// Call before destroying a registered object, requests that need it fail until it is registered again
+			// Nothing happens if id was registered again with another object since, pipelines already built stay valid
+			// and compiles still waiting in the backlog for the object are dropped
+			void unregisterShader(uint64_t id, VkShaderModule module);
+			void unregisterLayout(uint64_t id, VkPipelineLayout layout);
+
+			// Returns the handle for desc and queues its compilation the first time it is seen
+			// Returns InvalidPipeline if desc refers to an object that was not registered
+			PipelineHandle request(const PipelineDesc& desc);
+			// While handle compiles, get(handle) returns fallback instead
+			void setFallback(PipelineHandle handle, PipelineHandle fallback);
+			// The pipeline to bind for handle: the pipeline itself when ready, else its fallback when that is ready,
+			// else VK_NULL_HANDLE and the draw should be skipped
+			VkPipeline get(PipelineHandle handle) const;
+			bool isReady(PipelineHandle handle) const;
+
+			// Publishes the pipelines finished since the last call, call once per frame
+			void beginFrame();
+			const std::vector<PipelineHandle>& getCompletedThisFrame() const { return m_CompletedThisFrame; }
+			uint32_t getPendingCount() const { return m_Pending.load(); }
+			double getCompileMs(PipelineHandle handle) const;
+
+			// Writes every description requested this run, feed the file to prewarm() on the next one
+			bool savePermutations(const char* path) const;
+			// Requests every recorded description whose objects are registered, returns how many were queued
+			uint32_t prewarm(const char* path);
+			bool saveCache(const char* path) const;
+
+		private:
+			enum State : uint32_t
+			{
+				Queued,
+				Ready,
+				Failed
+			};
+			struct Entry
+			{
+				VulkanPipelineCompiler* owner;
+				PipelineDesc desc;
+				VkShaderModule vertexShader;
+				VkShaderModule fragmentShader;
+				VkPipelineLayout layout;
+				VkRenderPass renderPass;
+				VkPipeline pipeline;
+				PipelineHandle handle;
+				PipelineHandle fallback;
+				double compileMs;
+				std::atomic<uint32_t> state;
+			};
+
+			static uint64_t hashDesc(const PipelineDesc& desc);
+			static void compileJob(void* data);
+			void compile(Entry& entry);
+			void queue(Entry& entry);
+			// Fails the backlogged compiles matching shader or layout, VK_NULL_HANDLE matches neither
+			void dropBacklog(VkShaderModule shader, VkPipelineLayout layout);
+
+		private:
+			VkDevice m_device;
+			VkPipelineCache m_cache;
+			std::unique_ptr<ThreadPool> m_Workers;
+			std::unique_ptr<Entry[]> m_Entries;
+			uint32_t m_EntryCount;
+			std::unordered_map<uint64_t, PipelineHandle> m_Lookup;
+			std::unordered_map<uint64_t, VkShaderModule> m_Shaders;
+			std::unordered_map<uint64_t, VkPipelineLayout> m_Layouts;
+			std::unordered_map<uint64_t, VkRenderPass> m_RenderPasses;
+			std::atomic<uint32_t> m_Pending;
+
+			// Filled by the workers, moved to m_CompletedThisFrame in beginFrame()
+			std::mutex m_FinishedMutex;
+			std::vector<PipelineHandle> m_Finished;
+			std::vector<PipelineHandle> m_CompletedThisFrame;
+			// Compiles that did not fit in the worker queue, retried every frame
+			std::vector<PipelineHandle> m_Backlog;
+		};
+	}
+}
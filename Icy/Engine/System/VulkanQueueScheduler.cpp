@@ -0,0 +1,429 @@
+#include "VulkanQueueScheduler.hpp"
+#include "VulkanRenderer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const char* QueueNames[] = { "graphics", "compute", "transfer" };
+}
+
+icy::System::VulkanQueueScheduler::Families icy::System::VulkanQueueScheduler::selectFamilies(VkPhysicalDevice device, uint32_t graphicsFamily)
+{
+	uint32_t count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+	std::vector<VkQueueFamilyProperties> families(count);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &count, families.data());
+
+	const uint32_t None = 0xFFFFFFFFu;
+	uint32_t compute = None;
+	uint32_t transfer = None;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const VkQueueFlags flags = families[i].queueFlags;
+		if (compute == None && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+			compute = i;
+		if (transfer == None && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			transfer = i;
+	}
+
+	Families selected;
+	const uint32_t graphics = static_cast<uint32_t>(QueueType::Graphics);
+	const uint32_t computeSlot = static_cast<uint32_t>(QueueType::Compute);
+	const uint32_t transferSlot = static_cast<uint32_t>(QueueType::Transfer);
+	selected.family[graphics] = graphicsFamily;
+	selected.index[graphics] = 0;
+	// Next free queue of a family, falling back to its last one once they are all taken
+	std::vector<uint32_t> taken(count, 0);
+	taken[graphicsFamily] = 1;
+	auto take = [&](uint32_t slot, uint32_t family)
+	{
+		selected.family[slot] = family;
+		selected.index[slot] = std::min(taken[family], families[family].queueCount - 1);
+		taken[family] = std::min(taken[family] + 1, families[family].queueCount);
+	};
+	take(computeSlot, compute != None ? compute : graphicsFamily);
+	// Any queue can transfer, a spare compute queue is the next best thing to a dedicated copy engine
+	take(transferSlot, transfer != None ? transfer : selected.family[computeSlot]);
+	return selected;
+}
+
+icy::System::VulkanQueueScheduler::VulkanQueueScheduler()
+{
+	m_Renderer = nullptr;
+	m_device = VK_NULL_HANDLE;
+	m_bTimeline = false;
+	m_WaitSemaphores = nullptr;
+	m_GetSemaphoreCounterValue = nullptr;
+	m_TimestampPeriod = 1.0f;
+	std::memset(m_Queues, 0, sizeof(m_Queues));
+	m_FrameIndex = 0;
+	m_FrameCommands = VK_NULL_HANDLE;
+	m_FrameWaitCount = 0;
+	m_OverlapMs = 0.0;
+}
+
+icy::System::VulkanQueueScheduler::~VulkanQueueScheduler()
+{
+	destroy();
+}
+
+bool icy::System::VulkanQueueScheduler::create(VulkanRenderer* renderer, const Families& families, bool timeline)
+{
+	m_Renderer = renderer;
+	m_device = renderer->getDevice();
+	m_bTimeline = timeline;
+	if (m_bTimeline)
+	{
+		m_WaitSemaphores = reinterpret_cast<WaitSemaphoresProc>(vkGetDeviceProcAddr(m_device, "vkWaitSemaphoresKHR"));
+		m_GetSemaphoreCounterValue = reinterpret_cast<GetSemaphoreCounterValueProc>(vkGetDeviceProcAddr(m_device, "vkGetSemaphoreCounterValueKHR"));
+		m_bTimeline = m_WaitSemaphores != nullptr && m_GetSemaphoreCounterValue != nullptr;
+	}
+
+	m_TimestampPeriod = renderer->getDeviceInfo().properties.limits.timestampPeriod;
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer->getPhysicalDevice(), &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> familyProperties(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer->getPhysicalDevice(), &familyCount, familyProperties.data());
+
+	for (uint32_t q = 0; q < QueueCount; ++q)
+	{
+		Queue& queue = m_Queues[q];
+		queue.family = families.family[q];
+		vkGetDeviceQueue(m_device, queue.family, families.index[q], &queue.queue);
+		if (q != static_cast<uint32_t>(QueueType::Graphics) && isInline(static_cast<QueueType>(q)))
+			continue;
+
+		if (m_bTimeline)
+		{
+			VkSemaphoreTypeCreateInfo typeInfo = {};
+			typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+			typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			typeInfo.initialValue = 0;
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			semaphoreInfo.pNext = &typeInfo;
+			if (!renderer->checkResults(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &queue.timeline)))
+				return false;
+		}
+
+		// Resetting queries needs a graphics or compute queue, and some families don't count time at all
+		const VkQueueFamilyProperties& family = familyProperties[queue.family];
+		const uint32_t validBits = family.timestampValidBits;
+		queue.timestamps = validBits != 0 && (family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) != 0;
+		queue.timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = queue.family;
+		VkQueryPoolCreateInfo queryInfo = {};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = MaxSubmits * 2;
+		for (uint32_t f = 0; f < FramesInFlight; ++f)
+		{
+			if (queue.timestamps && !renderer->checkResults(vkCreateQueryPool(m_device, &queryInfo, nullptr, &queue.queries[f])))
+				return false;
+			// Graphics records into the renderer's frame command buffer
+			if (q == static_cast<uint32_t>(QueueType::Graphics))
+				continue;
+			if (!renderer->checkResults(vkCreateCommandPool(m_device, &poolInfo, nullptr, &queue.pools[f])))
+				return false;
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.commandPool = queue.pools[f];
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocateInfo.commandBufferCount = MaxSubmits;
+			if (!renderer->checkResults(vkAllocateCommandBuffers(m_device, &allocateInfo, queue.buffers[f])))
+				return false;
+		}
+	}
+	return true;
+}
+
+void icy::System::VulkanQueueScheduler::destroy()
+{
+	if (m_device == VK_NULL_HANDLE)
+		return;
+	for (auto& queue : m_Queues)
+	{
+		for (uint32_t f = 0; f < FramesInFlight; ++f)
+		{
+			if (queue.pools[f] != VK_NULL_HANDLE)
+				vkDestroyCommandPool(m_device, queue.pools[f], nullptr);
+			if (queue.queries[f] != VK_NULL_HANDLE)
+				vkDestroyQueryPool(m_device, queue.queries[f], nullptr);
+		}
+		if (queue.timeline != VK_NULL_HANDLE)
+			vkDestroySemaphore(m_device, queue.timeline, nullptr);
+	}
+	std::memset(m_Queues, 0, sizeof(m_Queues));
+	m_device = VK_NULL_HANDLE;
+}
+
+void icy::System::VulkanQueueScheduler::waitForSlot(uint32_t frameIndex)
+{
+	m_FrameIndex = frameIndex;
+	// The fence covered graphics, the other queues' work from this slot may still be running
+	for (uint32_t q = 1; q < QueueCount; ++q)
+	{
+		Queue& queue = m_Queues[q];
+		if (queue.pools[frameIndex] == VK_NULL_HANDLE)
+			continue;
+		wait({ static_cast<QueueType>(q), queue.slotValue[frameIndex] });
+	}
+	readTimestamps(frameIndex);
+	for (uint32_t q = 0; q < QueueCount; ++q)
+	{
+		Queue& queue = m_Queues[q];
+		queue.used[frameIndex] = 0;
+		if (queue.pools[frameIndex] != VK_NULL_HANDLE)
+			vkResetCommandPool(m_device, queue.pools[frameIndex], 0);
+	}
+}
+
+void icy::System::VulkanQueueScheduler::beginFrame(VkCommandBuffer frameCommands)
+{
+	const uint32_t frameIndex = m_FrameIndex;
+	m_FrameCommands = frameCommands;
+	m_FrameWaitCount = 0;
+	// Graphics is one submission a frame, timed from the top of its command buffer
+	Queue& graphics = m_Queues[static_cast<uint32_t>(QueueType::Graphics)];
+	if (graphics.timestamps)
+	{
+		graphics.used[frameIndex] = 1;
+		writeTimestamp(graphics, frameCommands, 0, false);
+	}
+}
+
+VkCommandBuffer icy::System::VulkanQueueScheduler::begin(QueueType type)
+{
+	if (isInline(type))
+		return m_FrameCommands;
+	Queue& queue = m_Queues[static_cast<uint32_t>(type)];
+	uint32_t& used = queue.used[m_FrameIndex];
+	if (used == MaxSubmits)
+		return VK_NULL_HANDLE;
+	VkCommandBuffer commands = queue.buffers[m_FrameIndex][used];
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commands, &beginInfo);
+	if (queue.timestamps)
+		writeTimestamp(queue, commands, used, false);
+	++used;
+	return commands;
+}
+
+icy::System::SyncPoint icy::System::VulkanQueueScheduler::submit(QueueType type, VkCommandBuffer commands, const SyncPoint* waits, uint32_t waitCount, VkPipelineStageFlags waitStage)
+{
+	if (isInline(type))
+	{
+		// Same command buffer as the graphics work, a barrier stands in for the semaphores
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		return { QueueType::Graphics, m_Queues[0].value + 1 };
+	}
+
+	Queue& queue = m_Queues[static_cast<uint32_t>(type)];
+	if (queue.timestamps)
+		writeTimestamp(queue, commands, queue.used[m_FrameIndex] - 1, true);
+	vkEndCommandBuffer(commands);
+
+	VkSemaphore waitSemaphores[MaxFrameWaits];
+	uint64_t waitValues[MaxFrameWaits];
+	VkPipelineStageFlags waitStages[MaxFrameWaits];
+	uint32_t semaphoreCount = 0;
+	for (uint32_t i = 0; i < waitCount && semaphoreCount < MaxFrameWaits; ++i)
+	{
+		// Waiting on our own queue is implied by submission order
+		if (waits[i].queue == type || isInline(waits[i].queue))
+			continue;
+		waitSemaphores[semaphoreCount] = getTimeline(waits[i].queue);
+		waitValues[semaphoreCount] = waits[i].value;
+		waitStages[semaphoreCount] = waitStage;
+		++semaphoreCount;
+	}
+	const uint64_t signalValue = ++queue.value;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = semaphoreCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = semaphoreCount;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commands;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &queue.timeline;
+	vkQueueSubmit(queue.queue, 1, &submitInfo, VK_NULL_HANDLE);
+	queue.slotValue[m_FrameIndex] = signalValue;
+	return { type, signalValue };
+}
+
+void icy::System::VulkanQueueScheduler::waitInFrame(SyncPoint point, VkPipelineStageFlags stage)
+{
+	if (isInline(point.queue) || point.queue == QueueType::Graphics || m_FrameWaitCount == MaxFrameWaits)
+		return;
+	m_FrameWaits[m_FrameWaitCount] = point;
+	m_FrameWaitStages[m_FrameWaitCount] = stage;
+	++m_FrameWaitCount;
+}
+
+bool icy::System::VulkanQueueScheduler::isComplete(SyncPoint point) const
+{
+	const Queue& queue = m_Queues[static_cast<uint32_t>(point.queue)];
+	if (queue.timeline == VK_NULL_HANDLE)
+		return true;
+	uint64_t value = 0;
+	m_GetSemaphoreCounterValue(m_device, queue.timeline, &value);
+	return value >= point.value;
+}
+
+void icy::System::VulkanQueueScheduler::wait(SyncPoint point) const
+{
+	const Queue& queue = m_Queues[static_cast<uint32_t>(point.queue)];
+	if (queue.timeline == VK_NULL_HANDLE || point.value == 0)
+		return;
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &queue.timeline;
+	waitInfo.pValues = &point.value;
+	m_WaitSemaphores(m_device, &waitInfo, UINT64_MAX);
+}
+
+uint32_t icy::System::VulkanQueueScheduler::getFrameWaits(VkSemaphore* semaphores, uint64_t* values, VkPipelineStageFlags* stages) const
+{
+	for (uint32_t i = 0; i < m_FrameWaitCount; ++i)
+	{
+		semaphores[i] = getTimeline(m_FrameWaits[i].queue);
+		values[i] = m_FrameWaits[i].value;
+		stages[i] = m_FrameWaitStages[i];
+	}
+	return m_FrameWaitCount;
+}
+
+uint64_t icy::System::VulkanQueueScheduler::signalFrame()
+{
+	Queue& graphics = m_Queues[static_cast<uint32_t>(QueueType::Graphics)];
+	graphics.slotValue[m_FrameIndex] = ++graphics.value;
+	return graphics.value;
+}
+
+void icy::System::VulkanQueueScheduler::endFrame(VkCommandBuffer frameCommands)
+{
+	Queue& graphics = m_Queues[static_cast<uint32_t>(QueueType::Graphics)];
+	if (graphics.timestamps)
+		writeTimestamp(graphics, frameCommands, 0, true);
+}
+
+bool icy::System::VulkanQueueScheduler::isAsync(QueueType type) const
+{
+	return type != QueueType::Graphics && !isInline(type) && getQueue(type) != getQueue(QueueType::Graphics);
+}
+
+bool icy::System::VulkanQueueScheduler::isAsync(VkCommandBuffer commands) const
+{
+	for (uint32_t q = 0; q < QueueCount; ++q)
+	{
+		if (!isAsync(static_cast<QueueType>(q)))
+			continue;
+		for (uint32_t slot = 0; slot < FramesInFlight; ++slot)
+		{
+			for (uint32_t i = 0; i < MaxSubmits; ++i)
+			{
+				if (m_Queues[q].buffers[slot][i] == commands)
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void icy::System::VulkanQueueScheduler::report(std::ostream& out) const
+{
+	for (uint32_t q = 0; q < QueueCount; ++q)
+	{
+		const QueueType type = static_cast<QueueType>(q);
+		const Queue& queue = m_Queues[q];
+		out << QueueNames[q] << ": family " << queue.family;
+		if (isInline(type))
+			out << ", recorded into the graphics frame";
+		else if (q != 0)
+			out << (isAsync(type) ? ", async" : ", shares the graphics queue");
+		if (queue.timestamps)
+			out << ", " << queue.busyMs << " ms busy";
+		out << std::endl;
+	}
+	out << "compute overlapped graphics for " << m_OverlapMs << " ms" << std::endl;
+}
+
+void icy::System::VulkanQueueScheduler::readTimestamps(uint32_t frameIndex)
+{
+	// Start and end ticks of every submission in the slot, for the overlap below
+	uint64_t ticks[QueueCount][MaxSubmits * 2];
+	uint32_t counts[QueueCount] = {};
+	for (uint32_t q = 0; q < QueueCount; ++q)
+	{
+		Queue& queue = m_Queues[q];
+		const uint32_t used = queue.used[frameIndex];
+		if (!queue.timestamps)
+			continue;
+		queue.busyMs = 0.0;
+		if (used == 0)
+			continue;
+		// The slot is known to be finished, so no waiting for availability
+		if (vkGetQueryPoolResults(m_device, queue.queries[frameIndex], 0, used * 2, sizeof(ticks[q]), ticks[q], sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+			continue;
+		uint64_t busy = 0;
+		for (uint32_t i = 0; i < used; ++i)
+		{
+			ticks[q][i * 2] &= queue.timestampMask;
+			ticks[q][i * 2 + 1] &= queue.timestampMask;
+			busy += ticks[q][i * 2 + 1] - ticks[q][i * 2];
+		}
+		queue.busyMs = busy * m_TimestampPeriod / 1e6;
+		counts[q] = used;
+	}
+
+	// Timestamps on one device share a time base, so intervals from different queues can be compared
+	const uint32_t graphics = static_cast<uint32_t>(QueueType::Graphics);
+	const uint32_t compute = static_cast<uint32_t>(QueueType::Compute);
+	uint64_t overlap = 0;
+	for (uint32_t g = 0; g < counts[graphics]; ++g)
+	{
+		for (uint32_t c = 0; c < counts[compute]; ++c)
+		{
+			uint64_t start = std::max(ticks[graphics][g * 2], ticks[compute][c * 2]);
+			uint64_t end = std::min(ticks[graphics][g * 2 + 1], ticks[compute][c * 2 + 1]);
+			if (end > start)
+				overlap += end - start;
+		}
+	}
+	m_OverlapMs = overlap * m_TimestampPeriod / 1e6;
+}
+
+void icy::System::VulkanQueueScheduler::writeTimestamp(Queue& queue, VkCommandBuffer commands, uint32_t submit, bool end)
+{
+	// The first submission of the slot resets the whole pool, it runs before any other use on this queue
+	if (!end && submit == 0)
+		vkCmdResetQueryPool(commands, queue.queries[m_FrameIndex], 0, MaxSubmits * 2);
+	vkCmdWriteTimestamp(commands, end ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queue.queries[m_FrameIndex], submit * 2 + (end ? 1 : 0));
+}
+
+bool icy::System::VulkanQueueScheduler::isInline(QueueType type) const
+{
+	return type != QueueType::Graphics && !m_bTimeline;
+}
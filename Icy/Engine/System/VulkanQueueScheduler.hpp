@@ -0,0 +1,141 @@
+#pragma once
+#include "VulkanCommon.hpp"
+#include <ostream>
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanRenderer;
+
+		enum class QueueType : uint32_t
+		{
+			Graphics,
+			Compute,
+			Transfer
+		};
+
+		// A point on a queue's timeline, reached once everything submitted to that queue up to it has finished
+		struct SyncPoint
+		{
+			QueueType queue;
+			uint64_t value;
+		};
+
+		// Spreads work over the graphics, async compute and transfer queues
+		// Every queue has a timeline semaphore that each submission bumps, so cross queue dependencies are just
+		// (queue, value) pairs and any number of submissions can wait on the same one
+		// Without timeline semaphores (or a second queue) compute and transfer work is recorded straight into the
+		// frame's graphics command buffer instead, which keeps it correct but serialised
+		// GPU timestamps around every submission give each queue's busy time and how much compute overlapped graphics
+		class VulkanQueueScheduler
+		{
+		public:
+			static constexpr uint32_t QueueCount = 3;
+			static constexpr uint32_t FramesInFlight = 2;
+			// Compute or transfer submissions per queue per frame
+			static constexpr uint32_t MaxSubmits = 8;
+			static constexpr uint32_t MaxFrameWaits = 8;
+
+			// Queue families picked for a device, a queue that has no family of its own shares one with index 1 if the family has a second queue
+			struct Families
+			{
+				uint32_t family[QueueCount];
+				uint32_t index[QueueCount];
+			};
+			// Prefers a compute family without graphics and a transfer family with neither, which is where the hardware
+			// queues that actually run alongside graphics live
+			static Families selectFamilies(VkPhysicalDevice device, uint32_t graphicsFamily);
+
+			VulkanQueueScheduler();
+			~VulkanQueueScheduler();
+			VulkanQueueScheduler(const VulkanQueueScheduler&) = delete;
+			VulkanQueueScheduler& operator=(const VulkanQueueScheduler&) = delete;
+
+			// timeline : the device was created with timeline semaphores enabled
+			bool create(VulkanRenderer* renderer, const Families& families, bool timeline);
+			void destroy();
+
+			// Called by the renderer once the frame slot's fence signalled, waits for the slot's other queues and collects their timings
+			void waitForSlot(uint32_t frameIndex);
+			// Called by the renderer once the frame's command buffer is recording
+			void beginFrame(VkCommandBuffer frameCommands);
+
+			// Returns a command buffer in the recording state for queue, or VK_NULL_HANDLE when this frame's are used up
+			// Only valid between the renderer's beginFrame and endFrame, submit buffers of one queue in the order they were begun
+			VkCommandBuffer begin(QueueType queue);
+			// Ends and submits commands, the submission waits for waits at waitStage and the returned point is reached once it finished
+			SyncPoint submit(QueueType queue, VkCommandBuffer commands, const SyncPoint* waits, uint32_t waitCount, VkPipelineStageFlags waitStage);
+			// Makes this frame's graphics submission wait for point before stage
+			void waitInFrame(SyncPoint point, VkPipelineStageFlags stage);
+			// Reached once the last frame submitted has finished, what compute overwriting that frame's inputs waits for
+			SyncPoint getLastFrame() const { return { QueueType::Graphics, m_Queues[static_cast<uint32_t>(QueueType::Graphics)].value }; }
+			// True for command buffers begin() returned for an async queue, their barriers can only name that queue's stages
+			// and the graphics work they depend on is ordered by the timeline semaphores instead
+			bool isAsync(VkCommandBuffer commands) const;
+
+			bool isComplete(SyncPoint point) const;
+			void wait(SyncPoint point) const;
+
+			// Filled into the renderer's frame submission, returns the number of waits written
+			uint32_t getFrameWaits(VkSemaphore* semaphores, uint64_t* values, VkPipelineStageFlags* stages) const;
+			// The graphics timeline value the frame submission signals
+			VkSemaphore getTimeline(QueueType queue) const { return m_Queues[static_cast<uint32_t>(queue)].timeline; }
+			uint64_t signalFrame();
+			// Timestamps around the frame's graphics work, recorded by the renderer
+			void endFrame(VkCommandBuffer frameCommands);
+
+			bool hasTimelineSemaphores() const { return m_bTimeline; }
+			// True when queue is a separate VkQueue from graphics, so its work can overlap the frame
+			bool isAsync(QueueType queue) const;
+			VkQueue getQueue(QueueType queue) const { return m_Queues[static_cast<uint32_t>(queue)].queue; }
+			uint32_t getFamily(QueueType queue) const { return m_Queues[static_cast<uint32_t>(queue)].family; }
+
+			// GPU time from the last completed frame, 0 for queues without timestamps
+			double getBusyMs(QueueType queue) const { return m_Queues[static_cast<uint32_t>(queue)].busyMs; }
+			// Time compute work ran at the same time as graphics work in the last completed frame
+			double getOverlapMs() const { return m_OverlapMs; }
+			void report(std::ostream& out) const;
+
+		private:
+			struct Queue
+			{
+				VkQueue queue;
+				uint32_t family;
+				VkSemaphore timeline;
+				// Last value a submission will signal
+				uint64_t value;
+				bool timestamps;
+				uint64_t timestampMask;
+				VkCommandPool pools[FramesInFlight];
+				VkCommandBuffer buffers[FramesInFlight][MaxSubmits];
+				uint32_t used[FramesInFlight];
+				VkQueryPool queries[FramesInFlight];
+				// Timeline value of the slot's last submission, waited on before the slot is reused
+				uint64_t slotValue[FramesInFlight];
+				double busyMs;
+			};
+			void readTimestamps(uint32_t frameIndex);
+			void writeTimestamp(Queue& queue, VkCommandBuffer commands, uint32_t submit, bool end);
+			bool isInline(QueueType queue) const;
+
+		private:
+			typedef VkResult (VKAPI_PTR* WaitSemaphoresProc)(VkDevice device, const VkSemaphoreWaitInfo* waitInfo, uint64_t timeout);
+			typedef VkResult (VKAPI_PTR* GetSemaphoreCounterValueProc)(VkDevice device, VkSemaphore semaphore, uint64_t* value);
+
+			VulkanRenderer* m_Renderer;
+			VkDevice m_device;
+			bool m_bTimeline;
+			WaitSemaphoresProc m_WaitSemaphores;
+			GetSemaphoreCounterValueProc m_GetSemaphoreCounterValue;
+			float m_TimestampPeriod;
+			Queue m_Queues[QueueCount];
+			uint32_t m_FrameIndex;
+			VkCommandBuffer m_FrameCommands;
+			uint32_t m_FrameWaitCount;
+			SyncPoint m_FrameWaits[MaxFrameWaits];
+			VkPipelineStageFlags m_FrameWaitStages[MaxFrameWaits];
+			double m_OverlapMs;
+		};
+	}
+}
\ No newline at end of file
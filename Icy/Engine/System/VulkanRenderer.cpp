@@ -1,14 +1,63 @@
 #include "VulkanRenderer.hpp"
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <vector>
+#include <cstring>
+#include "Profiler.hpp"
+#include "VulkanSwapchain.hpp"
+
+static_assert(icy::System::VulkanQueueScheduler::FramesInFlight == icy::System::VulkanRenderer::FramesInFlight, "The scheduler keeps per frame resources for every frame in flight");
 
 icy::System::VulkanRenderer::VulkanRenderer()
 {
+	m_instance = VK_NULL_HANDLE;
+	m_physicalDevice = VK_NULL_HANDLE;
+	m_device = VK_NULL_HANDLE;
+	m_graphicsQueue = VK_NULL_HANDLE;
+	m_graphicsQueueFamily = 0;
+	m_bTimelineSemaphores = false;
+	m_DeviceInfo = {};
+	m_FrameIndex = 0;
+	m_FrameNumber = 1;
+	m_bFrameResources = false;
+	m_SwapchainCount = 0;
+	m_AcquiredCount = 0;
 }
 
 icy::System::VulkanRenderer::~VulkanRenderer()
 {
+	if (m_device != VK_NULL_HANDLE)
+	{
+		vkDeviceWaitIdle(m_device);
+		// Everything still queued goes in one batch
+		m_DeletionQueue.flush();
+		m_UniformAllocator.destroy();
+		m_QueueScheduler.destroy();
+		destroyFrameResources();
+		// Keep what we compiled this run so the next one starts warm
+		m_PipelineCompiler.saveCache(PipelineCacheFile);
+		m_PipelineCompiler.savePermutations(PipelinePermutationFile);
+		m_PipelineCompiler.shutdown();
+		m_LayoutCache.destroy();
+		vkDestroyDevice(m_device, nullptr);
+	}
+	if (m_instance != VK_NULL_HANDLE)
+		vkDestroyInstance(m_instance, nullptr);
+}
+
+std::shared_ptr<icy::System::VulkanRenderer> icy::System::VulkanRenderer::getShared(SDL_Window* window)
+{
+	static std::weak_ptr<VulkanRenderer> shared;
+	std::shared_ptr<VulkanRenderer> renderer = shared.lock();
+	if (renderer)
+		return renderer;
+	renderer = std::make_shared<VulkanRenderer>();
+	if (!renderer->initVulkan(window))
+		return nullptr;
+	shared = renderer;
+	return renderer;
 }
 
 // returns true if our vkResult was SUCCESS
@@ -19,51 +68,481 @@ bool icy::System::VulkanRenderer::checkResults(VkResult result)
 	else return false;
 }
 
-bool icy::System::VulkanRenderer::initVulkan(SDL_SysWMinfo win)
+bool icy::System::VulkanRenderer::initVulkan(SDL_Window* window)
 {
-	createInstance();
-	return false;
+	ICY_PROFILE_FUNCTION();
+	if (!createInstance())
+		return false;
+	// A throwaway surface for the first window, so the GPU picked can present to it
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	if (window != nullptr && !VulkanSwapchain::createSurface(m_instance, window, surface))
+		return false;
+	const bool bCreated = createDevice(surface);
+	if (surface != VK_NULL_HANDLE)
+		vkDestroySurfaceKHR(m_instance, surface, nullptr);
+	if (!bCreated)
+		return false;
+	m_DeletionQueue.init(m_instance, m_device);
+	m_DeletionQueue.setCurrentValue(m_FrameNumber);
+	if (!createFrameResources())
+		return false;
+	if (!m_QueueScheduler.create(this, m_QueueFamilies, m_bTimelineSemaphores))
+		return false;
+	if (!m_UniformAllocator.create(this, FramesInFlight))
+		return false;
+	if (!m_PipelineCompiler.init(m_device, PipelineCacheFile))
+		return false;
+	// Layouts declare exactly the push range the uniform allocator pushes into
+	m_LayoutCache.init(m_device, m_UniformAllocator.getPushLimit(), &m_PipelineCompiler);
+	return true;
 }
 
 bool icy::System::VulkanRenderer::createInstance()
 {
+	ICY_PROFILE_FUNCTION();
 	VkApplicationInfo appInfo = {};
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 	appInfo.pApplicationName = "Icy Engine";
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "Icy Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_VERSION_1_1;
+	appInfo.apiVersion = VK_API_VERSION_1_1;
 
 	VkInstanceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	createInfo.pApplicationInfo = &appInfo;
 
-	// get extensions
-	uint32_t count;
-	auto result = vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
-	std::vector<VkExtensionProperties> properties(count);
-	result = vkEnumerateInstanceExtensionProperties(nullptr, &count, properties.data());
-	// get layers
-	result = vkEnumerateInstanceLayerProperties(&count, nullptr);
-	std::vector<VkLayerProperties> layerProps(count);
-	result = vkEnumerateInstanceLayerProperties(&count, layerProps.data());
-	// stores the strings to the ext/layers we want
+	// Only what presenting to a window needs, every extra extension and layer costs startup time and driver work
 	std::vector<const char*> extensionNames;
+	extensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+	if (isWindows)
+		extensionNames.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+	else
+		extensionNames.push_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
+
+	// get layers
 	std::vector<const char*> layerNames;
+	if (enableValidationLayers)
+	{
+		uint32_t count = 0;
+		vkEnumerateInstanceLayerProperties(&count, nullptr);
+		std::vector<VkLayerProperties> layerProps(count);
+		vkEnumerateInstanceLayerProperties(&count, layerProps.data());
+		for (const auto& layer : layerProps)
+		{
+			if (std::strcmp(layer.layerName, "VK_LAYER_KHRONOS_validation") == 0)
+				layerNames.push_back("VK_LAYER_KHRONOS_validation");
+		}
+	}
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensionNames.size());
+	createInfo.ppEnabledExtensionNames = extensionNames.data();
+	createInfo.enabledLayerCount = static_cast<uint32_t>(layerNames.size());
+	createInfo.ppEnabledLayerNames = layerNames.data();
 
-	for (const auto& ext : properties)
+	return checkResults(vkCreateInstance(&createInfo, nullptr, &m_instance));
+}
+
+bool icy::System::VulkanRenderer::createDevice(VkSurfaceKHR surface)
+{
+	ICY_PROFILE_FUNCTION();
+	m_physicalDevice = VulkanDeviceSelector::select(m_instance, surface, m_DeviceInfo);
+	if (m_physicalDevice == VK_NULL_HANDLE)
 	{
-		extensionNames.push_back(ext.extensionName);
+		std::cout << "No GPU with a graphics queue, present support and swapchain support found" << std::endl;
+		return false;
 	}
-	for (const auto& layers : layerProps)
+	m_graphicsQueueFamily = m_DeviceInfo.graphicsFamily;
+
+	// One create info per family, asking for as many queues as the scheduler picked from it
+	m_QueueFamilies = VulkanQueueScheduler::selectFamilies(m_physicalDevice, m_graphicsQueueFamily);
+	const float priorities[VulkanQueueScheduler::QueueCount] = { 1.0f, 1.0f, 1.0f };
+	VkDeviceQueueCreateInfo queueInfos[VulkanQueueScheduler::QueueCount] = {};
+	uint32_t queueInfoCount = 0;
+	for (uint32_t q = 0; q < VulkanQueueScheduler::QueueCount; ++q)
 	{
-		layerNames.push_back(layers.layerName);
+		uint32_t i = 0;
+		while (i < queueInfoCount && queueInfos[i].queueFamilyIndex != m_QueueFamilies.family[q])
+			++i;
+		if (i == queueInfoCount)
+		{
+			queueInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueInfos[i].queueFamilyIndex = m_QueueFamilies.family[q];
+			queueInfos[i].pQueuePriorities = priorities;
+			++queueInfoCount;
+		}
+		queueInfos[i].queueCount = std::max(queueInfos[i].queueCount, m_QueueFamilies.index[q] + 1);
 	}
-	createInfo.enabledExtensionCount = extensionNames.size();
-	createInfo.ppEnabledExtensionNames = extensionNames.data();
-	createInfo.enabledLayerCount = layerNames.size();
-	createInfo.ppEnabledLayerNames = layerNames.data();
 
-	checkResults(vkCreateInstance(&createInfo, nullptr, &m_instance));
+	// Timeline semaphores come from the extension, so this works on 1.1 drivers that have it
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, extensions.data());
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	for (const auto& extension : extensions)
+	{
+		if (std::strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0)
+		{
+			VkPhysicalDeviceFeatures2 features = {};
+			features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features.pNext = &timelineFeatures;
+			vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features);
+		}
+	}
+	m_bTimelineSemaphores = timelineFeatures.timelineSemaphore == VK_TRUE;
+	m_DeviceInfo.timelineSemaphores = m_bTimelineSemaphores;
+
+	const char* extensionNames[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME };
+
+	VkDeviceCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = m_bTimelineSemaphores ? &timelineFeatures : nullptr;
+	createInfo.queueCreateInfoCount = queueInfoCount;
+	createInfo.pQueueCreateInfos = queueInfos;
+	createInfo.enabledExtensionCount = m_bTimelineSemaphores ? 2 : 1;
+	createInfo.ppEnabledExtensionNames = extensionNames;
+	// Exactly the features the engine uses, never everything the GPU offers
+	createInfo.pEnabledFeatures = &m_DeviceInfo.enabledFeatures;
+
+	if (!checkResults(vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device)))
+		return false;
+	vkGetDeviceQueue(m_device, m_graphicsQueueFamily, 0, &m_graphicsQueue);
+	return true;
+}
+
+bool icy::System::VulkanRenderer::addSwapchain(VulkanSwapchain* swapchain)
+{
+	if (m_SwapchainCount == MaxSwapchains)
+	{
+		std::cout << "Too many Vulkan windows, the limit is " << MaxSwapchains << std::endl;
+		return false;
+	}
+	m_Swapchains[m_SwapchainCount++] = swapchain;
+	return true;
+}
+
+void icy::System::VulkanRenderer::removeSwapchain(VulkanSwapchain* swapchain)
+{
+	// Semaphores stay with their slot, by the time a slot is reused its waits have completed
+	for (uint32_t i = 0; i < m_SwapchainCount; ++i)
+	{
+		if (m_Swapchains[i] == swapchain)
+		{
+			m_Swapchains[i] = m_Swapchains[--m_SwapchainCount];
+			return;
+		}
+	}
+}
+
+bool icy::System::VulkanRenderer::createFrameResources()
+{
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = m_graphicsQueueFamily;
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	// Signalled so the first wait on each slot returns straight away
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	std::memset(m_Frames, 0, sizeof(m_Frames));
+	m_bFrameResources = true;
+	for (auto& frame : m_Frames)
+	{
+		if (!checkResults(vkCreateCommandPool(m_device, &poolInfo, nullptr, &frame.pool)))
+			return false;
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = frame.pool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+		if (!checkResults(vkAllocateCommandBuffers(m_device, &allocateInfo, &frame.commands)))
+			return false;
+		if (!checkResults(vkCreateFence(m_device, &fenceInfo, nullptr, &frame.fence)))
+			return false;
+		if (!checkResults(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &frame.renderFinished)))
+			return false;
+		for (auto& semaphore : frame.imageAvailable)
+		{
+			if (!checkResults(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore)))
+				return false;
+		}
+	}
+	return true;
+}
+
+void icy::System::VulkanRenderer::destroyFrameResources()
+{
+	if (!m_bFrameResources)
+		return;
+	// Partly created slots are zeroed, destroying VK_NULL_HANDLE is a no-op
+	for (auto& frame : m_Frames)
+	{
+		for (auto semaphore : frame.imageAvailable)
+			vkDestroySemaphore(m_device, semaphore, nullptr);
+		vkDestroySemaphore(m_device, frame.renderFinished, nullptr);
+		vkDestroyFence(m_device, frame.fence, nullptr);
+		vkDestroyCommandPool(m_device, frame.pool, nullptr);
+	}
+	m_bFrameResources = false;
+}
+
+bool icy::System::VulkanRenderer::beginFrame()
+{
+	ICY_PROFILE_FUNCTION();
+	FrameResources& frame = m_Frames[m_FrameIndex];
+	vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+	m_QueueScheduler.waitForSlot(m_FrameIndex);
+	// Frames complete in submission order, so everything up to this slot's last frame is finished
+	m_DeletionQueue.collect(frame.submittedFrame);
+	// The slot's uniform region was last read by that same frame
+	m_UniformAllocator.beginFrame(m_FrameIndex);
+
+	m_AcquiredCount = 0;
+	for (uint32_t i = 0; i < m_SwapchainCount; ++i)
+	{
+		VulkanSwapchain* swapchain = m_Swapchains[i];
+		// Minimised windows simply sit the frame out
+		if (swapchain->isOutOfDate() && !swapchain->recreate())
+			continue;
+		if (!swapchain->acquire(frame.imageAvailable[i]))
+			continue;
+		m_Acquired[m_AcquiredCount] = swapchain;
+		m_AcquiredSemaphores[m_AcquiredCount] = frame.imageAvailable[i];
+		++m_AcquiredCount;
+	}
+	// The fence stays signalled so the next attempt doesn't block
+	// With no windows at all the frame still runs, for work that only draws offscreen
+	if (m_AcquiredCount == 0 && m_SwapchainCount != 0)
+		return false;
+
+	vkResetFences(m_device, 1, &frame.fence);
+	vkResetCommandPool(m_device, frame.pool, 0);
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(frame.commands, &beginInfo);
+	m_QueueScheduler.beginFrame(frame.commands);
+
+	// Whatever was in the image is thrown away, it gets cleared anyway
+	transitionAcquired(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+	VkImageSubresourceRange range = {};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.levelCount = 1;
+	range.layerCount = 1;
+	for (uint32_t i = 0; i < m_AcquiredCount; ++i)
+	{
+		VkClearColorValue color;
+		std::memcpy(color.float32, m_Acquired[i]->getClearColor(), sizeof(color.float32));
+		vkCmdClearColorImage(frame.commands, m_Acquired[i]->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+	}
+	transitionAcquired(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	return true;
+}
+
+void icy::System::VulkanRenderer::endFrame()
+{
+	ICY_PROFILE_FUNCTION();
+	FrameResources& frame = m_Frames[m_FrameIndex];
+	transitionAcquired(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0);
+	m_QueueScheduler.endFrame(frame.commands);
+	vkEndCommandBuffer(frame.commands);
+
+	// The clears are the first thing touching each image, so that's where the acquire has to have finished
+	// Compute the frame depends on comes after, the binary semaphores' values are ignored
+	VkSemaphore waitSemaphores[MaxSwapchains + VulkanQueueScheduler::MaxFrameWaits];
+	uint64_t waitValues[MaxSwapchains + VulkanQueueScheduler::MaxFrameWaits] = {};
+	VkPipelineStageFlags waitStages[MaxSwapchains + VulkanQueueScheduler::MaxFrameWaits];
+	for (uint32_t i = 0; i < m_AcquiredCount; ++i)
+	{
+		waitSemaphores[i] = m_AcquiredSemaphores[i];
+		waitStages[i] = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	uint32_t waitCount = m_AcquiredCount;
+	waitCount += m_QueueScheduler.getFrameWaits(waitSemaphores + waitCount, waitValues + waitCount, waitStages + waitCount);
+
+	VkSemaphore signalSemaphores[2] = { frame.renderFinished, m_QueueScheduler.getTimeline(QueueType::Graphics) };
+	uint64_t signalValues[2] = { 0, m_QueueScheduler.signalFrame() };
+	// Nothing presents a frame without windows, so nothing would wait for renderFinished
+	const uint32_t firstSignal = m_AcquiredCount > 0 ? 0 : 1;
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = 2 - firstSignal;
+	timelineInfo.pSignalSemaphoreValues = signalValues + firstSignal;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = m_bTimelineSemaphores ? &timelineInfo : nullptr;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &frame.commands;
+	submitInfo.signalSemaphoreCount = (m_bTimelineSemaphores ? 2 : 1) - firstSignal;
+	submitInfo.pSignalSemaphores = signalSemaphores + firstSignal;
+	vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, frame.fence);
+
+	if (m_AcquiredCount > 0)
+	{
+		VkSwapchainKHR swapchains[MaxSwapchains];
+		uint32_t imageIndices[MaxSwapchains];
+		VkResult results[MaxSwapchains];
+		for (uint32_t i = 0; i < m_AcquiredCount; ++i)
+		{
+			swapchains[i] = m_Acquired[i]->getSwapchain();
+			imageIndices[i] = m_Acquired[i]->getImageIndex();
+		}
+		VkPresentInfoKHR presentInfo = {};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &frame.renderFinished;
+		presentInfo.swapchainCount = m_AcquiredCount;
+		presentInfo.pSwapchains = swapchains;
+		presentInfo.pImageIndices = imageIndices;
+		presentInfo.pResults = results;
+		vkQueuePresentKHR(m_graphicsQueue, &presentInfo);
+		for (uint32_t i = 0; i < m_AcquiredCount; ++i)
+		{
+			if (results[i] == VK_ERROR_OUT_OF_DATE_KHR || results[i] == VK_SUBOPTIMAL_KHR)
+				m_Acquired[i]->markOutOfDate();
+		}
+	}
+
+	frame.submittedFrame = m_FrameNumber;
+	m_DeletionQueue.setCurrentValue(++m_FrameNumber);
+	m_AcquiredCount = 0;
+	m_FrameIndex = (m_FrameIndex + 1) % FramesInFlight;
+}
+
+void icy::System::VulkanRenderer::waitForFrames()
+{
+	VkFence fences[FramesInFlight];
+	for (uint32_t i = 0; i < FramesInFlight; ++i)
+		fences[i] = m_Frames[i].fence;
+	vkWaitForFences(m_device, FramesInFlight, fences, VK_TRUE, UINT64_MAX);
+}
+
+uint32_t icy::System::VulkanRenderer::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const
+{
+	const VkPhysicalDeviceMemoryProperties& properties = m_DeviceInfo.memory;
+	uint32_t found = UINT32_MAX;
+	for (uint32_t i = 0; i < properties.memoryTypeCount; ++i)
+	{
+		const VkMemoryPropertyFlags flags = properties.memoryTypes[i].propertyFlags;
+		if ((typeBits & (1u << i)) == 0 || (flags & required) != required)
+			continue;
+		if ((flags & preferred) == preferred)
+			return i;
+		if (found == UINT32_MAX)
+			found = i;
+	}
+	return found;
+}
+
+bool icy::System::VulkanRenderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkBuffer& buffer, VkDeviceMemory& memory, bool shared)
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	uint32_t families[VulkanQueueScheduler::QueueCount];
+	if (shared)
+	{
+		// Concurrent sharing needs every family listed once, and only applies when there is more than one
+		uint32_t familyCount = 0;
+		for (uint32_t q = 0; q < VulkanQueueScheduler::QueueCount; ++q)
+		{
+			if (std::find(families, families + familyCount, m_QueueFamilies.family[q]) == families + familyCount)
+				families[familyCount++] = m_QueueFamilies.family[q];
+		}
+		if (familyCount > 1)
+		{
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = familyCount;
+			bufferInfo.pQueueFamilyIndices = families;
+		}
+	}
+	if (!checkResults(vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer)))
+		return false;
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = requirements.size;
+	allocateInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, required, preferred);
+	if (allocateInfo.memoryTypeIndex == UINT32_MAX || !checkResults(vkAllocateMemory(m_device, &allocateInfo, nullptr, &memory)))
+	{
+		vkDestroyBuffer(m_device, buffer, nullptr);
+		buffer = VK_NULL_HANDLE;
+		return false;
+	}
+	if (!checkResults(vkBindBufferMemory(m_device, buffer, memory, 0)))
+	{
+		vkDestroyBuffer(m_device, buffer, nullptr);
+		vkFreeMemory(m_device, memory, nullptr);
+		buffer = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+VkShaderModule icy::System::VulkanRenderer::loadShaderModule(const std::string& path, const char* name)
+{
+	std::ifstream stream(path, std::ios::binary | std::ios::ate);
+	if (!stream.is_open())
+	{
+		std::cout << "Missing " << name << " shader " << path << std::endl;
+		return VK_NULL_HANDLE;
+	}
+	std::vector<uint32_t> code(static_cast<size_t>(stream.tellg()) / sizeof(uint32_t));
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+	if (!stream || code.empty())
+		return VK_NULL_HANDLE;
+
+	VkShaderModuleCreateInfo moduleInfo = {};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size() * sizeof(uint32_t);
+	moduleInfo.pCode = code.data();
+	VkShaderModule module = VK_NULL_HANDLE;
+	if (!checkResults(vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module)))
+		return VK_NULL_HANDLE;
+	return module;
+}
+
+void icy::System::VulkanRenderer::transitionAcquired(VkImageLayout from, VkImageLayout to, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+{
+	// One barrier call for every window
+	VkImageMemoryBarrier barriers[MaxSwapchains];
+	for (uint32_t i = 0; i < m_AcquiredCount; ++i)
+	{
+		VkImageMemoryBarrier& barrier = barriers[i];
+		barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = from;
+		barrier.newLayout = to;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_Acquired[i]->getImage();
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = 1;
+	}
+	vkCmdPipelineBarrier(m_Frames[m_FrameIndex].commands, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, m_AcquiredCount, barriers);
 }
\ No newline at end of file
@@ -1,41 +1,140 @@
 #pragma once
-// check for windows, else system is linux
-#ifdef _WIN32
-constexpr bool isWindows = true;
-#define VK_USE_PLATFORM_WIN32_KHR
-#else
-constexpr bool isWindows = false;
-#define VK_USE_PLATFORM_XLIB_KHR
-#endif
-// if we are in debug mode then enable the validation layers
-#ifdef _DEBUG
-constexpr bool enableValidationLayers = true;
-#else
-constexpr bool enableValidationLayers = false;
-#endif
-
-#include <vulkan\vulkan.h>
-#include <SDL\SDL_syswm.h>
-// undef these since they are included by SDL
-#undef max
-#undef min
+#include <memory>
+#include <string>
+#include "VulkanCommon.hpp"
+#include "VulkanDeletionQueue.hpp"
+#include "VulkanDeviceSelector.hpp"
+#include "VulkanLayoutCache.hpp"
+#include "VulkanPipelineCompiler.hpp"
+#include "VulkanQueueScheduler.hpp"
+#include "VulkanUniformAllocator.hpp"
 
 namespace icy
 {
 	namespace System
 	{
+		class VulkanSwapchain;
+
+		// Owns the instance, the device and everything built on them, shared by every Vulkan window
+		// Each window only adds a VulkanSwapchain, and one submit and one present per frame cover all of them
 		class VulkanRenderer
 		{
 		public:
+			static constexpr uint32_t FramesInFlight = 2;
+			static constexpr uint32_t MaxSwapchains = 8;
+
 			VulkanRenderer();
 			~VulkanRenderer();
+			VulkanRenderer(const VulkanRenderer&) = delete;
+			VulkanRenderer& operator=(const VulkanRenderer&) = delete;
+
+			// The first window to ask creates the renderer, the last one to let go of it destroys it
+			// window : the first window, the device is picked to present to it, nullptr when nothing is presented
+			static std::shared_ptr<VulkanRenderer> getShared(SDL_Window* window = nullptr);
+
 			bool checkResults(VkResult results);
-			bool initVulkan(SDL_SysWMinfo win);
+			bool initVulkan(SDL_Window* window = nullptr);
+			// Enables only the surface extensions, plus validation in debug builds when it is installed
 			bool createInstance();
+			// Picks the GPU with VulkanDeviceSelector and creates the logical device on it, with async compute and transfer
+			// queues when the GPU has them and timeline semaphores when the driver supports them
+			// surface : has to be presentable from the graphics queue, may be VK_NULL_HANDLE
+			bool createDevice(VkSurfaceKHR surface);
+
+			// Called by VulkanSwapchain, registered swapchains are acquired and presented every frame
+			bool addSwapchain(VulkanSwapchain* swapchain);
+			void removeSwapchain(VulkanSwapchain* swapchain);
+
+			// Waits for the frame slot, acquires an image from every window, starts recording and clears them
+			// Returns false when no window can be drawn to this frame, endFrame must not be called then
+			// Without any windows the frame is recorded and submitted all the same, for offscreen work
+			bool beginFrame();
+			// Records into the frame's command buffer, every acquired image is in COLOR_ATTACHMENT_OPTIMAL
+			VkCommandBuffer getCommandBuffer() const { return m_Frames[m_FrameIndex].commands; }
+			// Slot of the frame being recorded, below FramesInFlight
+			uint32_t getFrameIndex() const { return m_FrameIndex; }
+			// Swapchains that got an image this frame
+			uint32_t getFrameSwapchainCount() const { return m_AcquiredCount; }
+			VulkanSwapchain* getFrameSwapchain(uint32_t index) const { return m_Acquired[index]; }
+			// One submit for the whole frame and one present for every window
+			void endFrame();
+			// Blocks until every submitted frame has finished, cheaper than a device wait idle
+			void waitForFrames();
+
+			// Index of a memory type allowed by typeBits that has every required flag, preferring ones that also have the preferred flags
+			// Returns UINT32_MAX if there is none
+			uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+			// Creates a buffer and binds it to a dedicated allocation
+			// shared : the compute and transfer queues use it too, without queue family ownership transfers
+			bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkBuffer& buffer, VkDeviceMemory& memory, bool shared = false);
+			// Shader module from the SPIR-V file at path, VK_NULL_HANDLE if it can't be read or created
+			// name : what the shader is for, it only goes into the message, e.g. "particle" prints "Missing particle shader"
+			VkShaderModule loadShaderModule(const std::string& path, const char* name);
+
+			// Objects that frames in flight may still use go here instead of being destroyed
+			VulkanDeletionQueue& getDeletionQueue() { return m_DeletionQueue; }
+			// Compute and transfer submissions and their dependencies, see VulkanQueueScheduler
+			VulkanQueueScheduler& getQueueScheduler() { return m_QueueScheduler; }
+			// Per draw constants, pushed or written into this frame's region of a mapped ring
+			VulkanUniformAllocator& getUniformAllocator() { return m_UniformAllocator; }
+			// Number of the frame being recorded, starts at 1
+			uint64_t getFrameNumber() const { return m_FrameNumber; }
+
+			// Pipelines are built on worker threads, see VulkanPipelineCompiler
+			VulkanPipelineCompiler& getPipelineCompiler() { return m_PipelineCompiler; }
+			// Pipeline layouts built from reflected shaders, registered with the pipeline compiler under their id
+			VulkanLayoutCache& getLayoutCache() { return m_LayoutCache; }
+			VkInstance getInstance() const { return m_instance; }
+			VkPhysicalDevice getPhysicalDevice() const { return m_physicalDevice; }
+			// Properties, limits and memory types of the GPU, read once when the device was created
+			const VulkanDeviceInfo& getDeviceInfo() const { return m_DeviceInfo; }
+			VkDevice getDevice() const { return m_device; }
+			VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
+			uint32_t getGraphicsQueueFamily() const { return m_graphicsQueueFamily; }
+
+			// Where the pipeline cache and the pipeline permutations seen this run are kept between runs
+			static constexpr const char* PipelineCacheFile = "pipeline_cache.bin";
+			static constexpr const char* PipelinePermutationFile = "pipeline_permutations.bin";
 		private:
+			struct FrameResources
+			{
+				VkCommandPool pool;
+				VkCommandBuffer commands;
+				VkFence fence;
+				VkSemaphore renderFinished;
+				// Frame number last submitted from this slot, once its fence signals everything up to it is done
+				uint64_t submittedFrame;
+				// One per swapchain slot, a window's image can't be used before its own semaphore signals
+				VkSemaphore imageAvailable[MaxSwapchains];
+			};
+			bool createFrameResources();
+			void destroyFrameResources();
+			void transitionAcquired(VkImageLayout from, VkImageLayout to, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage, VkAccessFlags srcAccess, VkAccessFlags dstAccess);
 
 		private:
 			VkInstance m_instance;
+			VkPhysicalDevice m_physicalDevice;
+			VulkanDeviceInfo m_DeviceInfo;
+			VkDevice m_device;
+			VkQueue m_graphicsQueue;
+			uint32_t m_graphicsQueueFamily;
+			VulkanPipelineCompiler m_PipelineCompiler;
+			VulkanLayoutCache m_LayoutCache;
+			VulkanDeletionQueue m_DeletionQueue;
+			VulkanQueueScheduler m_QueueScheduler;
+			VulkanQueueScheduler::Families m_QueueFamilies;
+			bool m_bTimelineSemaphores;
+			VulkanUniformAllocator m_UniformAllocator;
+
+			FrameResources m_Frames[FramesInFlight];
+			uint32_t m_FrameIndex;
+			uint64_t m_FrameNumber;
+			bool m_bFrameResources;
+			VulkanSwapchain* m_Swapchains[MaxSwapchains];
+			uint32_t m_SwapchainCount;
+			VulkanSwapchain* m_Acquired[MaxSwapchains];
+			VkSemaphore m_AcquiredSemaphores[MaxSwapchains];
+			uint32_t m_AcquiredCount;
 		};
 	}
 }
\ No newline at end of file
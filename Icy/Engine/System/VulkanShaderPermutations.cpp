@@ -0,0 +1,263 @@
+#include "VulkanShaderPermutations.hpp"
+#include "VulkanRenderer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	// FNV-1a over the path and the mask, stable between runs so recorded permutations still find their modules
+	uint64_t shaderId(const std::string& path, uint32_t compiledFeatures)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : path)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			hash ^= (compiledFeatures >> (i * 8)) & 0xFF;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	int bitCount(uint32_t bits)
+	{
+		int count = 0;
+		for (; bits != 0; bits &= bits - 1)
+			++count;
+		return count;
+	}
+}
+
+icy::System::VulkanShaderPermutations::VulkanShaderPermutations()
+{
+	m_Renderer = nullptr;
+	m_FeatureCount = 0;
+	m_CompiledMask = 0;
+	m_LayoutId = 0;
+}
+
+icy::System::VulkanShaderPermutations::~VulkanShaderPermutations()
+{
+	destroy();
+}
+
+bool icy::System::VulkanShaderPermutations::create(VulkanRenderer* renderer, const std::string& vertexPath, const std::string& fragmentPath, const Feature* features, uint32_t featureCount,
+	uint64_t layoutId, const VkDescriptorSetLayoutBinding* storageBindings, uint32_t storageBindingCount)
+{
+	destroy();
+	if (featureCount > MaxFeatures)
+		return false;
+	m_Renderer = renderer;
+	m_VertexPath = vertexPath;
+	m_FragmentPath = fragmentPath;
+	m_FeatureCount = featureCount;
+	m_CompiledMask = 0;
+	m_LayoutId = layoutId;
+	m_StorageBindings.assign(storageBindings, storageBindings + storageBindingCount);
+	std::sort(m_StorageBindings.begin(), m_StorageBindings.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+	for (uint32_t i = 0; i < featureCount; ++i)
+	{
+		m_Features[i] = features[i];
+		if (features[i].constantId == Compiled)
+			m_CompiledMask |= 1u << i;
+		else if (features[i].constantId >= PipelineDesc::MaxSpecializations)
+		{
+			destroy();
+			return false;
+		}
+	}
+	// Every variant goes through the base module, so a missing one fails here rather than on first use
+	if (getModule(0) == nullptr)
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::VulkanShaderPermutations::destroy()
+{
+	if (m_Renderer == nullptr)
+		return;
+	// Later requests must not find the modules once they are gone
+	VulkanPipelineCompiler& compiler = m_Renderer->getPipelineCompiler();
+	VulkanDeletionQueue& deletionQueue = m_Renderer->getDeletionQueue();
+	for (auto& module : m_Modules)
+	{
+		compiler.unregisterShader(module.second.vertexId, module.second.vertex);
+		compiler.unregisterShader(module.second.fragmentId, module.second.fragment);
+		deletionQueue.release(VulkanDeletionQueue::Type::ShaderModule, module.second.vertex);
+		deletionQueue.release(VulkanDeletionQueue::Type::ShaderModule, module.second.fragment);
+	}
+	m_Modules.clear();
+	m_Variants.clear();
+	m_StorageBindings.clear();
+	m_Renderer = nullptr;
+}
+
+icy::System::VulkanPipelineCompiler::PipelineHandle icy::System::VulkanShaderPermutations::request(uint32_t features, const PipelineDesc& base)
+{
+	features &= (1u << m_FeatureCount) - 1;
+	Module* module = getModule(features & m_CompiledMask);
+	if (module == nullptr)
+		return VulkanPipelineCompiler::InvalidPipeline;
+
+	PipelineDesc desc = base;
+	desc.vertexShader = module->vertexId;
+	desc.fragmentShader = module->fragmentId;
+	desc.layout = m_LayoutId;
+	desc.attributeCount = module->attributeCount;
+	desc.vertexStride = module->vertexStride;
+	for (uint32_t i = 0; i < PipelineDesc::MaxAttributes; ++i)
+		desc.attributes[i] = module->attributes[i];
+	desc.specializationCount = 0;
+	for (uint32_t i = 0; i < PipelineDesc::MaxSpecializations; ++i)
+		desc.specializations[i] = 0;
+	for (uint32_t i = 0; i < m_FeatureCount; ++i)
+	{
+		const uint32_t constantId = m_Features[i].constantId;
+		if (constantId == Compiled)
+			continue;
+		desc.specializations[constantId] = (features >> i) & 1;
+		desc.specializationCount = std::max(desc.specializationCount, constantId + 1);
+	}
+
+	// The compiler caches by description, asking again for a known variant is a lookup
+	VulkanPipelineCompiler::PipelineHandle handle = m_Renderer->getPipelineCompiler().request(desc);
+	if (handle != VulkanPipelineCompiler::InvalidPipeline)
+		m_Variants[handle] = features;
+	return handle;
+}
+
+void icy::System::VulkanShaderPermutations::report(std::ostream& out) const
+{
+	const int compiled = bitCount(m_CompiledMask);
+	out << m_VertexPath << " + " << m_FragmentPath << ": " << m_FeatureCount << " features, "
+		<< m_FeatureCount - compiled << " specialized, " << compiled << " compiled" << std::endl;
+	out << "  " << getPossibleCount() << " possible variants, " << (1u << compiled) << " possible modules" << std::endl;
+	out << "  " << getModuleCount() << " modules loaded, " << getPipelineCount() << " pipelines requested" << std::endl;
+	for (const auto& module : m_Modules)
+		out << "  module 0x" << std::hex << module.first << std::dec << " loaded in " << module.second.loadMs << " ms" << std::endl;
+	const VulkanPipelineCompiler& compiler = m_Renderer->getPipelineCompiler();
+	for (const auto& variant : m_Variants)
+	{
+		out << "  variant 0x" << std::hex << variant.second << std::dec << " pipeline " << variant.first;
+		if (compiler.isReady(variant.first))
+			out << " compiled in " << compiler.getCompileMs(variant.first) << " ms" << std::endl;
+		else
+			out << " not ready" << std::endl;
+	}
+}
+
+icy::System::VulkanShaderPermutations::Module* icy::System::VulkanShaderPermutations::getModule(uint32_t compiledFeatures)
+{
+	auto found = m_Modules.find(compiledFeatures);
+	if (found != m_Modules.end())
+		return &found->second;
+
+	auto start = std::chrono::steady_clock::now();
+	Module module = {};
+	ShaderReflection stages[2];
+	module.vertex = loadShader(m_VertexPath, compiledFeatures, stages[0], module.vertexId);
+	module.fragment = loadShader(m_FragmentPath, compiledFeatures, stages[1], module.fragmentId);
+	PipelineDesc vertexInput = {};
+	if (module.vertex == VK_NULL_HANDLE || module.fragment == VK_NULL_HANDLE || !fitsLayout(stages[0], m_VertexPath)
+		|| !fitsLayout(stages[1], m_FragmentPath) || !fillVertexInput(stages[0], vertexInput))
+	{
+		VkDevice device = m_Renderer->getDevice();
+		if (module.vertex != VK_NULL_HANDLE)
+			vkDestroyShaderModule(device, module.vertex, nullptr);
+		if (module.fragment != VK_NULL_HANDLE)
+			vkDestroyShaderModule(device, module.fragment, nullptr);
+		return nullptr;
+	}
+	module.attributeCount = vertexInput.attributeCount;
+	module.vertexStride = vertexInput.vertexStride;
+	for (uint32_t i = 0; i < PipelineDesc::MaxAttributes; ++i)
+		module.attributes[i] = vertexInput.attributes[i];
+
+	VulkanPipelineCompiler& compiler = m_Renderer->getPipelineCompiler();
+	compiler.registerShader(module.vertexId, module.vertex);
+	compiler.registerShader(module.fragmentId, module.fragment);
+	module.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return &(m_Modules[compiledFeatures] = module);
+}
+
+VkShaderModule icy::System::VulkanShaderPermutations::loadShader(const std::string& path, uint32_t compiledFeatures, ShaderReflection& reflection, uint64_t& id)
+{
+	std::string file = path;
+	if (compiledFeatures != 0)
+	{
+		char suffix[16];
+		std::snprintf(suffix, sizeof(suffix), ".%x", compiledFeatures);
+		file += suffix;
+	}
+	file += ".spv";
+
+	std::ifstream stream(file, std::ios::binary | std::ios::ate);
+	if (!stream.is_open())
+	{
+		std::cout << "Missing shader variant " << file << std::endl;
+		return VK_NULL_HANDLE;
+	}
+	std::vector<uint32_t> code(static_cast<size_t>(stream.tellg()) / sizeof(uint32_t));
+	stream.seekg(0);
+	stream.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+	if (!stream || !reflectSpirv(code.data(), code.size(), reflection))
+	{
+		std::cout << "Invalid SPIR-V in " << file << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size() * sizeof(uint32_t);
+	createInfo.pCode = code.data();
+	VkShaderModule module = VK_NULL_HANDLE;
+	if (!m_Renderer->checkResults(vkCreateShaderModule(m_Renderer->getDevice(), &createInfo, nullptr, &module)))
+		return VK_NULL_HANDLE;
+	id = shaderId(path, compiledFeatures);
+	return module;
+}
+
+bool icy::System::VulkanShaderPermutations::fitsLayout(const ShaderReflection& stage, const std::string& path) const
+{
+	if (stage.pushConstantSize > m_Renderer->getUniformAllocator().getPushLimit())
+	{
+		std::cout << path << " pushes " << stage.pushConstantSize << " bytes, more than the uniform allocator's range" << std::endl;
+		return false;
+	}
+	for (uint32_t i = 0; i < stage.bindingCount; ++i)
+	{
+		const ShaderReflection::Binding& binding = stage.bindings[i];
+		// The uniform allocator's dynamic offset descriptor, declared as a plain uniform block
+		if (binding.set == 0 && binding.binding == 0 && binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && binding.count == 1)
+			continue;
+		bool bFound = false;
+		if (binding.set == 1)
+		{
+			for (const VkDescriptorSetLayoutBinding& storage : m_StorageBindings)
+			{
+				if (storage.binding == binding.binding)
+				{
+					bFound = storage.descriptorType == binding.type && storage.descriptorCount >= binding.count && (storage.stageFlags & stage.stage) != 0;
+					break;
+				}
+			}
+		}
+		if (!bFound)
+		{
+			std::cout << path << " set " << binding.set << " binding " << binding.binding << " isn't in the layout its variants share" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
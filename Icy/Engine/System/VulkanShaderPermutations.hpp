@@ -0,0 +1,96 @@
+#pragma once
+#include "SpirvReflection.hpp"
+#include "VulkanCommon.hpp"
+#include "VulkanPipelineCompiler.hpp"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanRenderer;
+
+		// Material variants of one vertex/fragment shader pair, selected by a mask of feature toggles
+		// Toggles that only change code paths are specialization constants, so they share one SPIR-V module and only cost a pipeline.
+		// Toggles that change the interface (bindings, inputs, outputs) need their own module, precompiled offline to
+		// "<path>.<hex mask of the compiled toggles>.spv", mask 0 being plain "<path>.spv"
+		// Modules are loaded and pipelines requested the first time a mask is asked for, both are cached by key
+		// Every variant uses the owner's pipeline layout, set 0 the uniform allocator's and set 1 the owner's storage buffers,
+		// so switching variants leaves both bound, a module whose reflected bindings don't fit that layout fails to load
+		class VulkanShaderPermutations
+		{
+		public:
+			static constexpr uint32_t MaxFeatures = 16;
+			// Feature::constantId of toggles that need their own SPIR-V
+			static constexpr uint32_t Compiled = 0xFFFFFFFFu;
+
+			struct Feature
+			{
+				const char* name;
+				// Specialization constant id below PipelineDesc::MaxSpecializations, or Compiled
+				uint32_t constantId;
+			};
+
+			VulkanShaderPermutations();
+			~VulkanShaderPermutations();
+			VulkanShaderPermutations(const VulkanShaderPermutations&) = delete;
+			VulkanShaderPermutations& operator=(const VulkanShaderPermutations&) = delete;
+
+			// Feature i is bit i of the masks passed to request()
+			// vertexPath, fragmentPath : without the variant suffix and ".spv"
+			// layoutId : registered with the pipeline compiler, built from the uniform allocator's set layout and push constant range
+			// and a set 1 of storageBindings
+			bool create(VulkanRenderer* renderer, const std::string& vertexPath, const std::string& fragmentPath, const Feature* features, uint32_t featureCount,
+				uint64_t layoutId, const VkDescriptorSetLayoutBinding* storageBindings, uint32_t storageBindingCount);
+			// The pipeline compiler must no longer be compiling with these modules
+			void destroy();
+
+			// base : fixed function state and render pass, shaders, layout, vertex input and specializations are filled in
+			// Returns InvalidPipeline when a needed variant can't be loaded
+			VulkanPipelineCompiler::PipelineHandle request(uint32_t features, const PipelineDesc& base);
+
+			// Combinations the features allow against what was actually built, then load and compile times per variant
+			uint32_t getPossibleCount() const { return 1u << m_FeatureCount; }
+			uint32_t getModuleCount() const { return static_cast<uint32_t>(m_Modules.size()); }
+			uint32_t getPipelineCount() const { return static_cast<uint32_t>(m_Variants.size()); }
+			void report(std::ostream& out) const;
+
+		private:
+			struct Module
+			{
+				uint64_t vertexId;
+				uint64_t fragmentId;
+				uint32_t attributeCount;
+				uint32_t vertexStride;
+				PipelineDesc::Attribute attributes[PipelineDesc::MaxAttributes];
+				VkShaderModule vertex;
+				VkShaderModule fragment;
+				double loadMs;
+			};
+
+			Module* getModule(uint32_t compiledFeatures);
+			VkShaderModule loadShader(const std::string& path, uint32_t compiledFeatures, ShaderReflection& reflection, uint64_t& id);
+			// Whether every binding and push constant of stage is in the owner's layout
+			bool fitsLayout(const ShaderReflection& stage, const std::string& path) const;
+
+		private:
+			VulkanRenderer* m_Renderer;
+			std::string m_VertexPath;
+			std::string m_FragmentPath;
+			Feature m_Features[MaxFeatures];
+			uint32_t m_FeatureCount;
+			// Bits of the features that need their own module
+			uint32_t m_CompiledMask;
+			uint64_t m_LayoutId;
+			// Set 1 of the layout, sorted by binding number
+			std::vector<VkDescriptorSetLayoutBinding> m_StorageBindings;
+			// Keyed by the compiled bits of the mask
+			std::unordered_map<uint32_t, Module> m_Modules;
+			// Feature mask of every pipeline requested through here
+			std::unordered_map<VulkanPipelineCompiler::PipelineHandle, uint32_t> m_Variants;
+		};
+	}
+}
\ No newline at end of file
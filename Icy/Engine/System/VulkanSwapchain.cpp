@@ -0,0 +1,226 @@
+#include "VulkanSwapchain.hpp"
+#include "VulkanRenderer.hpp"
+#include <SDL\SDL.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+icy::System::VulkanSwapchain::VulkanSwapchain()
+{
+	m_Renderer = nullptr;
+	m_Window = nullptr;
+	m_surface = VK_NULL_HANDLE;
+	m_swapchain = VK_NULL_HANDLE;
+	m_Format = VK_FORMAT_UNDEFINED;
+	m_Extent = { 0, 0 };
+	m_ImageCount = 0;
+	m_ImageIndex = 0;
+	m_bOutOfDate = false;
+	setClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+icy::System::VulkanSwapchain::~VulkanSwapchain()
+{
+	destroy();
+}
+
+bool icy::System::VulkanSwapchain::create(VulkanRenderer* renderer, SDL_Window* window)
+{
+	m_Renderer = renderer;
+	m_Window = window;
+	if (!createSurface())
+		return false;
+
+	// The shared device was picked before this window existed, make sure it can present here
+	VkBool32 supported = VK_FALSE;
+	vkGetPhysicalDeviceSurfaceSupportKHR(m_Renderer->getPhysicalDevice(), m_Renderer->getGraphicsQueueFamily(), m_surface, &supported);
+	if (supported != VK_TRUE)
+	{
+		std::cout << "The graphics queue can't present to this window" << std::endl;
+		return false;
+	}
+
+	// A window created minimised gets its swapchain on the first frame it has an area
+	if (!createSwapchain())
+		m_bOutOfDate = true;
+	return m_Renderer->addSwapchain(this);
+}
+
+void icy::System::VulkanSwapchain::destroy()
+{
+	if (m_Renderer == nullptr)
+		return;
+	m_Renderer->removeSwapchain(this);
+	// The window goes away right after this, so the surface can't wait in the deletion queue
+	m_Renderer->waitForFrames();
+	// Swapchains recreate() retired are still in the deletion queue and have to go before their surface,
+	// every frame submitted so far has finished and windows are destroyed between frames
+	VulkanDeletionQueue& deletionQueue = m_Renderer->getDeletionQueue();
+	deletionQueue.collect(deletionQueue.getCurrentValue());
+	VkDevice device = m_Renderer->getDevice();
+	destroyViews();
+	if (m_swapchain != VK_NULL_HANDLE)
+		vkDestroySwapchainKHR(device, m_swapchain, nullptr);
+	if (m_surface != VK_NULL_HANDLE)
+		vkDestroySurfaceKHR(m_Renderer->getInstance(), m_surface, nullptr);
+	m_swapchain = VK_NULL_HANDLE;
+	m_surface = VK_NULL_HANDLE;
+	m_Renderer = nullptr;
+}
+
+bool icy::System::VulkanSwapchain::recreate()
+{
+	if (!createSwapchain())
+		return false;
+	m_bOutOfDate = false;
+	return true;
+}
+
+bool icy::System::VulkanSwapchain::acquire(VkSemaphore semaphore)
+{
+	VkResult result = vkAcquireNextImageKHR(m_Renderer->getDevice(), m_swapchain, UINT64_MAX, semaphore, VK_NULL_HANDLE, &m_ImageIndex);
+	if (result == VK_SUBOPTIMAL_KHR)
+	{
+		// Still usable this frame, rebuild on the next one
+		m_bOutOfDate = true;
+		return true;
+	}
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		m_bOutOfDate = true;
+	return result == VK_SUCCESS;
+}
+
+void icy::System::VulkanSwapchain::setClearColor(float r, float g, float b, float a)
+{
+	m_ClearColor[0] = r;
+	m_ClearColor[1] = g;
+	m_ClearColor[2] = b;
+	m_ClearColor[3] = a;
+}
+
+bool icy::System::VulkanSwapchain::createSurface()
+{
+	return createSurface(m_Renderer->getInstance(), m_Window, m_surface);
+}
+
+bool icy::System::VulkanSwapchain::createSurface(VkInstance instance, SDL_Window* window, VkSurfaceKHR& surface)
+{
+	SDL_SysWMinfo systemInfo;
+	SDL_VERSION(&systemInfo.version);
+	if (!SDL_GetWindowWMInfo(window, &systemInfo))
+		return false;
+
+#ifdef _WIN32
+	VkWin32SurfaceCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+	createInfo.hinstance = static_cast<HINSTANCE>(systemInfo.info.win.hinstance);
+	createInfo.hwnd = static_cast<HWND>(systemInfo.info.win.window);
+	return vkCreateWin32SurfaceKHR(instance, &createInfo, nullptr, &surface) == VK_SUCCESS;
+#else
+	VkXlibSurfaceCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
+	createInfo.dpy = systemInfo.info.x11.display;
+	createInfo.window = systemInfo.info.x11.window;
+	return vkCreateXlibSurfaceKHR(instance, &createInfo, nullptr, &surface) == VK_SUCCESS;
+#endif
+}
+
+bool icy::System::VulkanSwapchain::createSwapchain()
+{
+	VkPhysicalDevice physicalDevice = m_Renderer->getPhysicalDevice();
+	VkDevice device = m_Renderer->getDevice();
+
+	VkSurfaceCapabilitiesKHR capabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, m_surface, &capabilities);
+	VkExtent2D extent = capabilities.currentExtent;
+	if (extent.width == UINT32_MAX)
+	{
+		// The surface takes whatever size we give it
+		int width = 0;
+		int height = 0;
+		SDL_GetWindowSize(m_Window, &width, &height);
+		extent.width = std::min(std::max(static_cast<uint32_t>(width), capabilities.minImageExtent.width), capabilities.maxImageExtent.width);
+		extent.height = std::min(std::max(static_cast<uint32_t>(height), capabilities.minImageExtent.height), capabilities.maxImageExtent.height);
+	}
+	if (extent.width == 0 || extent.height == 0)
+		return false;
+
+	if (m_Format == VK_FORMAT_UNDEFINED)
+	{
+		uint32_t count = 0;
+		vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_surface, &count, nullptr);
+		std::vector<VkSurfaceFormatKHR> formats(count);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_surface, &count, formats.data());
+		if (count == 0)
+			return false;
+		m_Format = formats[0].format == VK_FORMAT_UNDEFINED ? VK_FORMAT_B8G8R8A8_UNORM : formats[0].format;
+		for (const auto& format : formats)
+		{
+			if (format.format == VK_FORMAT_B8G8R8A8_UNORM)
+				m_Format = format.format;
+		}
+	}
+
+	// One more than the minimum so we never wait on the driver to release an image
+	uint32_t imageCount = capabilities.minImageCount + 1;
+	if (capabilities.maxImageCount != 0)
+		imageCount = std::min(imageCount, capabilities.maxImageCount);
+	imageCount = std::min(imageCount, MaxImages);
+
+	VkSwapchainCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = m_surface;
+	createInfo.minImageCount = imageCount;
+	createInfo.imageFormat = m_Format;
+	createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+	createInfo.imageExtent = extent;
+	createInfo.imageArrayLayers = 1;
+	// Cleared with a transfer before anything draws into it
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.preTransform = capabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	// FIFO is the only mode every driver has to support
+	createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	createInfo.clipped = VK_TRUE;
+	createInfo.oldSwapchain = m_swapchain;
+
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	if (!m_Renderer->checkResults(vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain)))
+		return false;
+	// Frames in flight may still be presenting the old images, so they are retired rather than destroyed
+	VulkanDeletionQueue& deletionQueue = m_Renderer->getDeletionQueue();
+	for (uint32_t i = 0; i < m_ImageCount; ++i)
+		deletionQueue.release(VulkanDeletionQueue::Type::ImageView, m_Views[i]);
+	m_ImageCount = 0;
+	deletionQueue.release(VulkanDeletionQueue::Type::Swapchain, m_swapchain);
+	m_swapchain = swapchain;
+	m_Extent = extent;
+
+	m_ImageCount = MaxImages;
+	vkGetSwapchainImagesKHR(device, m_swapchain, &m_ImageCount, m_Images);
+	for (uint32_t i = 0; i < m_ImageCount; ++i)
+	{
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_Images[i];
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = m_Format;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (!m_Renderer->checkResults(vkCreateImageView(device, &viewInfo, nullptr, &m_Views[i])))
+		{
+			m_ImageCount = i;
+			return false;
+		}
+	}
+	return true;
+}
+
+void icy::System::VulkanSwapchain::destroyViews()
+{
+	for (uint32_t i = 0; i < m_ImageCount; ++i)
+		vkDestroyImageView(m_Renderer->getDevice(), m_Views[i], nullptr);
+	m_ImageCount = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "VulkanCommon.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanRenderer;
+
+		// Surface and swapchain of one window, the instance and device behind it are shared through VulkanRenderer
+		class VulkanSwapchain
+		{
+		public:
+			static constexpr uint32_t MaxImages = 8;
+
+			VulkanSwapchain();
+			~VulkanSwapchain();
+			VulkanSwapchain(const VulkanSwapchain&) = delete;
+			VulkanSwapchain& operator=(const VulkanSwapchain&) = delete;
+
+			// Creates the surface for window and registers with renderer so it is drawn and presented every frame
+			bool create(VulkanRenderer* renderer, SDL_Window* window);
+			void destroy();
+			// A surface for window on instance, the caller destroys it
+			static bool createSurface(VkInstance instance, SDL_Window* window, VkSurfaceKHR& surface);
+
+			// Rebuilds the swapchain for the window's current size, false while the window has no area
+			bool recreate();
+			// Gets the next image, semaphore is signalled once it can be written
+			bool acquire(VkSemaphore semaphore);
+			// Asks for a rebuild before the next acquire, set when presenting reports the swapchain stale
+			void markOutOfDate() { m_bOutOfDate = true; }
+			bool isOutOfDate() const { return m_bOutOfDate; }
+
+			void setClearColor(float r, float g, float b, float a);
+			const float* getClearColor() const { return m_ClearColor; }
+
+			VkSwapchainKHR getSwapchain() const { return m_swapchain; }
+			uint32_t getImageIndex() const { return m_ImageIndex; }
+			VkImage getImage() const { return m_Images[m_ImageIndex]; }
+			VkImageView getImageView() const { return m_Views[m_ImageIndex]; }
+			VkFormat getFormat() const { return m_Format; }
+			VkExtent2D getExtent() const { return m_Extent; }
+
+		private:
+			bool createSurface();
+			bool createSwapchain();
+			void destroyViews();
+
+		private:
+			VulkanRenderer* m_Renderer;
+			SDL_Window* m_Window;
+			VkSurfaceKHR m_surface;
+			VkSwapchainKHR m_swapchain;
+			VkFormat m_Format;
+			VkExtent2D m_Extent;
+			VkImage m_Images[MaxImages];
+			VkImageView m_Views[MaxImages];
+			uint32_t m_ImageCount;
+			uint32_t m_ImageIndex;
+			bool m_bOutOfDate;
+			float m_ClearColor[4];
+		};
+	}
+}
@@ -0,0 +1,426 @@
+#include "VulkanTextRenderer.hpp"
+#include "VulkanRenderer.hpp"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static_assert(icy::System::VulkanTextRenderer::FramesInFlight == icy::System::VulkanRenderer::FramesInFlight, "Glyphs are written per frame slot");
+// Slots are bound with dynamic offsets, no device asks for more than 256 byte alignment
+static_assert(icy::System::VulkanTextRenderer::MaxGlyphs * sizeof(icy::System::GlyphInstance) % 256 == 0, "Glyph slots must stay aligned");
+
+namespace
+{
+	const VkDeviceSize PageBytes = static_cast<VkDeviceSize>(icy::System::GlyphAtlas::PageSize) * icy::System::GlyphAtlas::PageSize;
+
+	// FNV-1a of the path, stable between runs so recorded pipelines still find their shaders
+	uint64_t shaderId(const std::string& path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : path)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void imageBarrier(VkCommandBuffer commands, VkImage image, VkImageLayout from, VkImageLayout to, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = from;
+		barrier.newLayout = to;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = 1;
+		vkCmdPipelineBarrier(commands, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
+
+icy::System::VulkanTextRenderer::VulkanTextRenderer()
+{
+	m_Renderer = nullptr;
+	m_device = VK_NULL_HANDLE;
+	m_glyphBuffer = VK_NULL_HANDLE;
+	m_glyphMemory = VK_NULL_HANDLE;
+	m_Glyphs = nullptr;
+	m_stagingBuffer = VK_NULL_HANDLE;
+	m_stagingMemory = VK_NULL_HANDLE;
+	m_Staging = nullptr;
+	for (uint32_t i = 0; i < GlyphAtlas::MaxPages; ++i)
+	{
+		m_pageImages[i] = VK_NULL_HANDLE;
+		m_pageMemory[i] = VK_NULL_HANDLE;
+		m_pageViews[i] = VK_NULL_HANDLE;
+		m_bPageWritten[i] = false;
+		m_pageSets[i] = VK_NULL_HANDLE;
+		m_PageFirst[i] = 0;
+		m_PageCount[i] = 0;
+	}
+	m_sampler = VK_NULL_HANDLE;
+	m_pageSetLayout = VK_NULL_HANDLE;
+	m_glyphSetLayout = VK_NULL_HANDLE;
+	m_pool = VK_NULL_HANDLE;
+	m_glyphSet = VK_NULL_HANDLE;
+	m_layout = VK_NULL_HANDLE;
+	m_vertexShader = VK_NULL_HANDLE;
+	m_fragmentShader = VK_NULL_HANDLE;
+	m_VertexId = 0;
+	m_FragmentId = 0;
+	m_DrawPipeline = VulkanPipelineCompiler::InvalidPipeline;
+	m_FrameIndex = 0;
+	m_DrawCount = 0;
+}
+
+icy::System::VulkanTextRenderer::~VulkanTextRenderer()
+{
+	destroy();
+}
+
+bool icy::System::VulkanTextRenderer::create(VulkanRenderer* renderer, const char* shaderDirectory, const char* fontPath)
+{
+	destroy();
+	m_Renderer = renderer;
+	m_device = renderer->getDevice();
+	if (!m_Atlas.create(fontPath) || !createBuffers() || !createPages() || !createDescriptors() || !createPipelineLayout(shaderDirectory))
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void icy::System::VulkanTextRenderer::destroy()
+{
+	if (m_Renderer == nullptr)
+		return;
+	// Frames in flight may still be drawing with these
+	// Later requests must not find the modules and layout once they are gone
+	VulkanPipelineCompiler& compiler = m_Renderer->getPipelineCompiler();
+	compiler.unregisterShader(m_VertexId, m_vertexShader);
+	compiler.unregisterShader(m_FragmentId, m_fragmentShader);
+	compiler.unregisterLayout(LayoutId, m_layout);
+	VulkanDeletionQueue& deletionQueue = m_Renderer->getDeletionQueue();
+	deletionQueue.release(VulkanDeletionQueue::Type::ShaderModule, m_vertexShader);
+	deletionQueue.release(VulkanDeletionQueue::Type::ShaderModule, m_fragmentShader);
+	deletionQueue.release(VulkanDeletionQueue::Type::PipelineLayout, m_layout);
+	deletionQueue.release(VulkanDeletionQueue::Type::DescriptorPool, m_pool);
+	deletionQueue.release(VulkanDeletionQueue::Type::Sampler, m_sampler);
+	for (uint32_t i = 0; i < GlyphAtlas::MaxPages; ++i)
+	{
+		deletionQueue.release(VulkanDeletionQueue::Type::ImageView, m_pageViews[i]);
+		deletionQueue.release(VulkanDeletionQueue::Type::Image, m_pageImages[i]);
+		deletionQueue.release(VulkanDeletionQueue::Type::Memory, m_pageMemory[i]);
+		m_pageViews[i] = VK_NULL_HANDLE;
+		m_pageImages[i] = VK_NULL_HANDLE;
+		m_pageMemory[i] = VK_NULL_HANDLE;
+		m_bPageWritten[i] = false;
+		m_pageSets[i] = VK_NULL_HANDLE;
+		m_PageCount[i] = 0;
+	}
+	if (m_Glyphs != nullptr)
+		vkUnmapMemory(m_device, m_glyphMemory);
+	if (m_Staging != nullptr)
+		vkUnmapMemory(m_device, m_stagingMemory);
+	deletionQueue.release(VulkanDeletionQueue::Type::Buffer, m_glyphBuffer);
+	deletionQueue.release(VulkanDeletionQueue::Type::Memory, m_glyphMemory);
+	deletionQueue.release(VulkanDeletionQueue::Type::Buffer, m_stagingBuffer);
+	deletionQueue.release(VulkanDeletionQueue::Type::Memory, m_stagingMemory);
+
+	m_glyphBuffer = VK_NULL_HANDLE;
+	m_glyphMemory = VK_NULL_HANDLE;
+	m_Glyphs = nullptr;
+	m_stagingBuffer = VK_NULL_HANDLE;
+	m_stagingMemory = VK_NULL_HANDLE;
+	m_Staging = nullptr;
+	m_sampler = VK_NULL_HANDLE;
+	m_pool = VK_NULL_HANDLE;
+	m_glyphSet = VK_NULL_HANDLE;
+	m_pageSetLayout = VK_NULL_HANDLE;
+	m_glyphSetLayout = VK_NULL_HANDLE;
+	m_layout = VK_NULL_HANDLE;
+	m_vertexShader = VK_NULL_HANDLE;
+	m_fragmentShader = VK_NULL_HANDLE;
+	m_DrawPipeline = VulkanPipelineCompiler::InvalidPipeline;
+	m_DrawCount = 0;
+	m_Atlas.destroy();
+	m_Renderer = nullptr;
+}
+
+void icy::System::VulkanTextRenderer::update(VkCommandBuffer commands, uint32_t frameIndex)
+{
+	if (m_Renderer == nullptr)
+		return;
+	m_FrameIndex = frameIndex;
+
+	// Rows written since the last upload, one band per page, staged in this frame's slot
+	uint8_t* staging = m_Staging + frameIndex * GlyphAtlas::MaxPages * PageBytes;
+	for (uint32_t page = 0; page < m_Atlas.getPageCount(); ++page)
+	{
+		uint32_t first = 0;
+		uint32_t count = 0;
+		if (!m_Atlas.takeDirtyRows(page, first, count))
+			continue;
+		const VkDeviceSize offset = first * static_cast<VkDeviceSize>(GlyphAtlas::PageSize);
+		const VkDeviceSize size = count * static_cast<VkDeviceSize>(GlyphAtlas::PageSize);
+		std::memcpy(staging + page * PageBytes + offset, m_Atlas.getPixels(page) + offset, static_cast<size_t>(size));
+
+		// The first upload starts from undefined contents, the rows it doesn't write are never sampled
+		const VkImageLayout from = m_bPageWritten[page] ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier(commands, m_pageImages[page], from, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		VkBufferImageCopy region = {};
+		region.bufferOffset = (frameIndex * GlyphAtlas::MaxPages + page) * PageBytes + offset;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset.y = static_cast<int32_t>(first);
+		region.imageExtent.width = GlyphAtlas::PageSize;
+		region.imageExtent.height = count;
+		region.imageExtent.depth = 1;
+		vkCmdCopyBufferToImage(commands, m_stagingBuffer, m_pageImages[page], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		imageBarrier(commands, m_pageImages[page], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		m_bPageWritten[page] = true;
+	}
+
+	// Pages back to back, each page's draw starts at its firstInstance
+	GlyphInstance* glyphs = m_Glyphs + frameIndex * MaxGlyphs;
+	uint32_t written = 0;
+	for (uint32_t page = 0; page < m_Atlas.getPageCount(); ++page)
+	{
+		const std::vector<GlyphInstance>& instances = m_Atlas.getInstances(page);
+		const uint32_t room = MaxGlyphs - written;
+		const uint32_t count = instances.size() < room ? static_cast<uint32_t>(instances.size()) : room;
+		if (count < instances.size())
+			std::cout << "Text glyph buffer full, " << instances.size() - count << " glyphs left out" << std::endl;
+		std::memcpy(glyphs + written, instances.data(), count * sizeof(GlyphInstance));
+		m_PageFirst[page] = written;
+		m_PageCount[page] = count;
+		written += count;
+	}
+}
+
+bool icy::System::VulkanTextRenderer::createDrawPipeline(uint64_t renderPassId, uint32_t subpass)
+{
+	PipelineDesc desc = {};
+	desc.vertexShader = m_VertexId;
+	desc.fragmentShader = m_FragmentId;
+	desc.layout = LayoutId;
+	desc.renderPass = renderPassId;
+	desc.subpass = subpass;
+	desc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+	desc.polygonMode = VK_POLYGON_MODE_FILL;
+	desc.cullMode = VK_CULL_MODE_NONE;
+	desc.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	// Overlays, blended over the scene without testing or writing depth
+	desc.depthTest = 0;
+	desc.depthWrite = 0;
+	desc.depthCompare = VK_COMPARE_OP_ALWAYS;
+	desc.blendEnable = 1;
+	m_DrawPipeline = m_Renderer->getPipelineCompiler().request(desc);
+	return m_DrawPipeline != VulkanPipelineCompiler::InvalidPipeline;
+}
+
+void icy::System::VulkanTextRenderer::draw(VkCommandBuffer commands, uint32_t width, uint32_t height)
+{
+	m_DrawCount = 0;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (m_DrawPipeline != VulkanPipelineCompiler::InvalidPipeline)
+		pipeline = m_Renderer->getPipelineCompiler().get(m_DrawPipeline);
+	if (pipeline != VK_NULL_HANDLE && width != 0 && height != 0 && m_Atlas.getInstanceCount() != 0)
+	{
+		vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		const float constants[4] = { 2.0f / static_cast<float>(width), 2.0f / static_cast<float>(height), 0.0f, 0.0f };
+		m_Renderer->getUniformAllocator().bindConstants(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, 0, constants, sizeof(constants));
+		const uint32_t offset = static_cast<uint32_t>(m_FrameIndex * MaxGlyphs * sizeof(GlyphInstance));
+		vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, 2, 1, &m_glyphSet, 1, &offset);
+		for (uint32_t page = 0; page < m_Atlas.getPageCount(); ++page)
+		{
+			if (m_PageCount[page] == 0)
+				continue;
+			vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, 1, 1, &m_pageSets[page], 0, nullptr);
+			vkCmdDraw(commands, 4, m_PageCount[page], 0, m_PageFirst[page]);
+			++m_DrawCount;
+		}
+	}
+	for (uint32_t page = 0; page < GlyphAtlas::MaxPages; ++page)
+		m_PageCount[page] = 0;
+	m_Atlas.endFrame();
+}
+
+bool icy::System::VulkanTextRenderer::createBuffers()
+{
+	const VkMemoryPropertyFlags hostFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	// Read straight out of host memory by the vertex shader, preferably memory the GPU reads fast too
+	if (!m_Renderer->createBuffer(FramesInFlight * MaxGlyphs * sizeof(GlyphInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostFlags,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_glyphBuffer, m_glyphMemory))
+		return false;
+	if (!m_Renderer->createBuffer(FramesInFlight * GlyphAtlas::MaxPages * PageBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostFlags, 0, m_stagingBuffer, m_stagingMemory))
+		return false;
+	void* mapped = nullptr;
+	if (!m_Renderer->checkResults(vkMapMemory(m_device, m_glyphMemory, 0, VK_WHOLE_SIZE, 0, &mapped)))
+		return false;
+	m_Glyphs = static_cast<GlyphInstance*>(mapped);
+	if (!m_Renderer->checkResults(vkMapMemory(m_device, m_stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped)))
+		return false;
+	m_Staging = static_cast<uint8_t*>(mapped);
+	return true;
+}
+
+bool icy::System::VulkanTextRenderer::createPages()
+{
+	for (uint32_t i = 0; i < GlyphAtlas::MaxPages; ++i)
+	{
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R8_UNORM;
+		imageInfo.extent.width = GlyphAtlas::PageSize;
+		imageInfo.extent.height = GlyphAtlas::PageSize;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (!m_Renderer->checkResults(vkCreateImage(m_device, &imageInfo, nullptr, &m_pageImages[i])))
+			return false;
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(m_device, m_pageImages[i], &requirements);
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = requirements.size;
+		allocateInfo.memoryTypeIndex = m_Renderer->findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (allocateInfo.memoryTypeIndex == UINT32_MAX)
+			return false;
+		if (!m_Renderer->checkResults(vkAllocateMemory(m_device, &allocateInfo, nullptr, &m_pageMemory[i])))
+			return false;
+		if (!m_Renderer->checkResults(vkBindImageMemory(m_device, m_pageImages[i], m_pageMemory[i], 0)))
+			return false;
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_pageImages[i];
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R8_UNORM;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (!m_Renderer->checkResults(vkCreateImageView(m_device, &viewInfo, nullptr, &m_pageViews[i])))
+			return false;
+	}
+
+	// The fragment shader fetches texels, the sampler is only there because the descriptor needs one
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	return m_Renderer->checkResults(vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler));
+}
+
+bool icy::System::VulkanTextRenderer::createDescriptors()
+{
+	// Set 1 is the page a draw samples, set 2 the glyphs at this frame's dynamic offset, set 0 is the uniform allocator's
+	VkDescriptorSetLayoutBinding pageBinding = {};
+	pageBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pageBinding.descriptorCount = 1;
+	pageBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutBinding glyphBinding = {};
+	glyphBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	glyphBinding.descriptorCount = 1;
+	glyphBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	m_pageSetLayout = m_Renderer->getLayoutCache().getSetLayout(&pageBinding, 1);
+	m_glyphSetLayout = m_Renderer->getLayoutCache().getSetLayout(&glyphBinding, 1);
+	if (m_pageSetLayout == VK_NULL_HANDLE || m_glyphSetLayout == VK_NULL_HANDLE)
+		return false;
+
+	VkDescriptorPoolSize poolSizes[2] = { { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, GlyphAtlas::MaxPages }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 } };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = GlyphAtlas::MaxPages + 1;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	if (!m_Renderer->checkResults(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool)))
+		return false;
+	VkDescriptorSetLayout setLayouts[GlyphAtlas::MaxPages + 1];
+	VkDescriptorSet sets[GlyphAtlas::MaxPages + 1];
+	for (uint32_t i = 0; i < GlyphAtlas::MaxPages; ++i)
+		setLayouts[i] = m_pageSetLayout;
+	setLayouts[GlyphAtlas::MaxPages] = m_glyphSetLayout;
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_pool;
+	allocateInfo.descriptorSetCount = GlyphAtlas::MaxPages + 1;
+	allocateInfo.pSetLayouts = setLayouts;
+	if (!m_Renderer->checkResults(vkAllocateDescriptorSets(m_device, &allocateInfo, sets)))
+		return false;
+
+	VkDescriptorImageInfo imageInfos[GlyphAtlas::MaxPages] = {};
+	VkWriteDescriptorSet writes[GlyphAtlas::MaxPages + 1] = {};
+	for (uint32_t i = 0; i < GlyphAtlas::MaxPages; ++i)
+	{
+		m_pageSets[i] = sets[i];
+		imageInfos[i].sampler = m_sampler;
+		imageInfos[i].imageView = m_pageViews[i];
+		imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_pageSets[i];
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[i].pImageInfo = &imageInfos[i];
+	}
+	m_glyphSet = sets[GlyphAtlas::MaxPages];
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = m_glyphBuffer;
+	bufferInfo.range = MaxGlyphs * sizeof(GlyphInstance);
+	VkWriteDescriptorSet& glyphWrite = writes[GlyphAtlas::MaxPages];
+	glyphWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	glyphWrite.dstSet = m_glyphSet;
+	glyphWrite.descriptorCount = 1;
+	glyphWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	glyphWrite.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_device, GlyphAtlas::MaxPages + 1, writes, 0, nullptr);
+	return true;
+}
+
+bool icy::System::VulkanTextRenderer::createPipelineLayout(const std::string& shaderDirectory)
+{
+	VulkanUniformAllocator& constants = m_Renderer->getUniformAllocator();
+	VkDescriptorSetLayout setLayouts[3] = { constants.getDescriptorSetLayout(), m_pageSetLayout, m_glyphSetLayout };
+	VkPushConstantRange pushRange = constants.getPushConstantRange();
+	VkPipelineLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 3;
+	layoutInfo.pSetLayouts = setLayouts;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushRange;
+	if (!m_Renderer->checkResults(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &m_layout)))
+		return false;
+
+	// The draw pipeline depends on the render pass, it goes through the compiler once one is known
+	const std::string vertexPath = shaderDirectory + "text.vert.spv";
+	const std::string fragmentPath = shaderDirectory + "text.frag.spv";
+	m_vertexShader = m_Renderer->loadShaderModule(vertexPath, "text");
+	m_fragmentShader = m_Renderer->loadShaderModule(fragmentPath, "text");
+	if (m_vertexShader == VK_NULL_HANDLE || m_fragmentShader == VK_NULL_HANDLE)
+		return false;
+	m_VertexId = shaderId(vertexPath);
+	m_FragmentId = shaderId(fragmentPath);
+	VulkanPipelineCompiler& compiler = m_Renderer->getPipelineCompiler();
+	compiler.registerShader(m_VertexId, m_vertexShader);
+	compiler.registerShader(m_FragmentId, m_fragmentShader);
+	compiler.registerLayout(LayoutId, m_layout);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+#include "GlyphAtlas.hpp"
+#include "VulkanCommon.hpp"
+#include "VulkanPipelineCompiler.hpp"
+#include <string>
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanRenderer;
+
+		// Screen space text for the Vulkan backend, drawn out of a GlyphAtlas with Engine\Shaders\text.vert and text.frag
+		// update() copies the frame's glyphs into this frame's slot of a mapped buffer and the atlas rows written since the
+		// last frame into the page images, draw() then issues one instanced quad draw per atlas page, whatever the number
+		// of strings
+		class VulkanTextRenderer
+		{
+		public:
+			static constexpr uint32_t FramesInFlight = 2;
+			// Most glyphs a frame draws, the rest are left out
+			static constexpr uint32_t MaxGlyphs = 1 << 17;
+			// Stable id the pipeline layout is registered with the pipeline compiler under
+			static constexpr uint64_t LayoutId = 0x69637954584c4159ull;
+
+			VulkanTextRenderer();
+			~VulkanTextRenderer();
+			VulkanTextRenderer(const VulkanTextRenderer&) = delete;
+			VulkanTextRenderer& operator=(const VulkanTextRenderer&) = delete;
+
+			// shaderDirectory : where text.vert.spv and text.frag.spv are, ending in a separator
+			// fontPath : the font GlyphAtlas rasterizes
+			bool create(VulkanRenderer* renderer, const char* shaderDirectory, const char* fontPath);
+			// The pipeline compiler must no longer be compiling the draw pipeline
+			void destroy();
+
+			// Add this frame's text here, see GlyphAtlas::addText
+			GlyphAtlas& getAtlas() { return m_Atlas; }
+			const GlyphAtlas& getAtlas() const { return m_Atlas; }
+
+			// Records the atlas uploads and writes the glyphs, outside a render pass and before draw()
+			// frameIndex : below FramesInFlight, the commands last recorded with it must have finished
+			void update(VkCommandBuffer commands, uint32_t frameIndex);
+			// Requests the draw pipeline for a render pass registered with the pipeline compiler under renderPassId
+			bool createDrawPipeline(uint64_t renderPassId, uint32_t subpass = 0);
+			// Draws what the last update wrote, inside a render pass the draw pipeline was requested for, then starts the
+			// atlas' next frame. Skipped while the pipeline is still compiling
+			// width, height : size of the render area in pixels
+			void draw(VkCommandBuffer commands, uint32_t width, uint32_t height);
+			// Instanced draws the last draw() issued, one per page with glyphs on it
+			uint32_t getDrawCount() const { return m_DrawCount; }
+
+		private:
+			bool createBuffers();
+			bool createPages();
+			bool createDescriptors();
+			bool createPipelineLayout(const std::string& shaderDirectory);
+
+		private:
+			VulkanRenderer* m_Renderer;
+			VkDevice m_device;
+			GlyphAtlas m_Atlas;
+
+			// MaxGlyphs instances for every frame slot, mapped
+			VkBuffer m_glyphBuffer;
+			VkDeviceMemory m_glyphMemory;
+			GlyphInstance* m_Glyphs;
+			// Room for every page for every frame slot, mapped
+			VkBuffer m_stagingBuffer;
+			VkDeviceMemory m_stagingMemory;
+			uint8_t* m_Staging;
+
+			// One R8 image per atlas page, all created up front
+			VkImage m_pageImages[GlyphAtlas::MaxPages];
+			VkDeviceMemory m_pageMemory[GlyphAtlas::MaxPages];
+			VkImageView m_pageViews[GlyphAtlas::MaxPages];
+			// Pages that left VK_IMAGE_LAYOUT_UNDEFINED
+			bool m_bPageWritten[GlyphAtlas::MaxPages];
+			VkSampler m_sampler;
+
+			// Owned by the renderer's layout cache
+			VkDescriptorSetLayout m_pageSetLayout;
+			VkDescriptorSetLayout m_glyphSetLayout;
+			VkDescriptorPool m_pool;
+			VkDescriptorSet m_pageSets[GlyphAtlas::MaxPages];
+			VkDescriptorSet m_glyphSet;
+			VkPipelineLayout m_layout;
+			VkShaderModule m_vertexShader;
+			VkShaderModule m_fragmentShader;
+			uint64_t m_VertexId;
+			uint64_t m_FragmentId;
+			VulkanPipelineCompiler::PipelineHandle m_DrawPipeline;
+
+			// What the last update wrote, draw() issues it
+			uint32_t m_FrameIndex;
+			uint32_t m_PageFirst[GlyphAtlas::MaxPages];
+			uint32_t m_PageCount[GlyphAtlas::MaxPages];
+			uint32_t m_DrawCount;
+		};
+	}
+}
\ No newline at end of file
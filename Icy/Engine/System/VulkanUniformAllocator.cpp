@@ -0,0 +1,163 @@
+#include "VulkanUniformAllocator.hpp"
+#include "VulkanRenderer.hpp"
+#include <algorithm>
+#include <cstring>
+
+icy::System::VulkanUniformAllocator::VulkanUniformAllocator()
+{
+	m_Renderer = nullptr;
+	m_buffer = VK_NULL_HANDLE;
+	m_memory = VK_NULL_HANDLE;
+	m_setLayout = VK_NULL_HANDLE;
+	m_pool = VK_NULL_HANDLE;
+	m_set = VK_NULL_HANDLE;
+	m_Mapped = nullptr;
+	m_RegionSize = 0;
+	m_Alignment = 256;
+	m_RegionStart = 0;
+	m_Head = 0;
+	m_PushLimit = MaxPushSize;
+	m_Bytes = 0;
+	m_PushBytes = 0;
+	m_LastBytes = 0;
+	m_LastPushBytes = 0;
+}
+
+icy::System::VulkanUniformAllocator::~VulkanUniformAllocator()
+{
+	destroy();
+}
+
+bool icy::System::VulkanUniformAllocator::create(VulkanRenderer* renderer, uint32_t framesInFlight, VkDeviceSize regionSize)
+{
+	m_Renderer = renderer;
+	VkDevice device = renderer->getDevice();
+
+	const VkPhysicalDeviceLimits& limits = renderer->getDeviceInfo().properties.limits;
+	m_Alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 16);
+	m_PushLimit = std::min(limits.maxPushConstantsSize, MaxPushSize);
+	// Keep every region aligned so offsets stay valid across frames
+	m_RegionSize = (regionSize + m_Alignment - 1) & ~(m_Alignment - 1);
+
+	// Device local and host visible if the GPU exposes it (resizable BAR), otherwise plain host memory
+	// Padded by one block, the descriptor range at the last region's final offset must still be inside the buffer
+	if (!renderer->createBuffer(m_RegionSize * framesInFlight + MaxBlockSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_buffer, m_memory))
+		return false;
+	void* mapped = nullptr;
+	if (!renderer->checkResults(vkMapMemory(device, m_memory, 0, VK_WHOLE_SIZE, 0, &mapped)))
+		return false;
+	m_Mapped = static_cast<uint8_t*>(mapped);
+
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_ALL;
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	if (!renderer->checkResults(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_setLayout)))
+		return false;
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (!renderer->checkResults(vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_pool)))
+		return false;
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_pool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &m_setLayout;
+	if (!renderer->checkResults(vkAllocateDescriptorSets(device, &allocateInfo, &m_set)))
+		return false;
+
+	// Written once, the dynamic offset picks the block at bind time
+	VkDescriptorBufferInfo bufferInfo = { m_buffer, 0, MaxBlockSize };
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	return true;
+}
+
+void icy::System::VulkanUniformAllocator::destroy()
+{
+	if (m_Renderer == nullptr)
+		return;
+	VkDevice device = m_Renderer->getDevice();
+	if (m_pool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(device, m_pool, nullptr);
+	if (m_setLayout != VK_NULL_HANDLE)
+		vkDestroyDescriptorSetLayout(device, m_setLayout, nullptr);
+	if (m_buffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(device, m_buffer, nullptr);
+	if (m_memory != VK_NULL_HANDLE)
+		vkFreeMemory(device, m_memory, nullptr);
+	m_pool = VK_NULL_HANDLE;
+	m_setLayout = VK_NULL_HANDLE;
+	m_set = VK_NULL_HANDLE;
+	m_buffer = VK_NULL_HANDLE;
+	m_memory = VK_NULL_HANDLE;
+	m_Mapped = nullptr;
+	m_Renderer = nullptr;
+}
+
+void icy::System::VulkanUniformAllocator::beginFrame(uint32_t frameIndex)
+{
+	m_LastBytes = m_Bytes;
+	m_LastPushBytes = m_PushBytes;
+	m_Bytes = 0;
+	m_PushBytes = 0;
+	m_RegionStart = m_RegionSize * frameIndex;
+	m_Head = 0;
+}
+
+icy::System::VulkanUniformAllocator::Allocation icy::System::VulkanUniformAllocator::allocate(uint32_t size)
+{
+	Allocation allocation = { nullptr, 0 };
+	// Reads through the descriptor past its range are undefined
+	if (size > MaxBlockSize || m_Head + size > m_RegionSize)
+		return allocation;
+	allocation.data = m_Mapped + m_RegionStart + m_Head;
+	allocation.offset = static_cast<uint32_t>(m_RegionStart + m_Head);
+	// The next block has to start on the device's offset alignment
+	m_Head += (size + m_Alignment - 1) & ~(m_Alignment - 1);
+	m_Bytes += size;
+	return allocation;
+}
+
+bool icy::System::VulkanUniformAllocator::bindConstants(VkCommandBuffer commands, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, const void* data, uint32_t size)
+{
+	if (size <= m_PushLimit)
+	{
+		vkCmdPushConstants(commands, layout, VK_SHADER_STAGE_ALL, 0, size, data);
+		m_PushBytes += size;
+		return true;
+	}
+	Allocation allocation = allocate(size);
+	if (allocation.data == nullptr)
+		return false;
+	std::memcpy(allocation.data, data, size);
+	vkCmdBindDescriptorSets(commands, bindPoint, layout, set, 1, &m_set, 1, &allocation.offset);
+	return true;
+}
+
+VkPushConstantRange icy::System::VulkanUniformAllocator::getPushConstantRange() const
+{
+	VkPushConstantRange range;
+	range.stageFlags = VK_SHADER_STAGE_ALL;
+	range.offset = 0;
+	range.size = m_PushLimit;
+	return range;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "VulkanCommon.hpp"
+
+namespace icy
+{
+	namespace System
+	{
+		class VulkanRenderer;
+
+		// Per draw constants for the Vulkan backend
+		// One persistently mapped buffer holds a region per frame in flight, allocations are a bump of an offset,
+		// and a single dynamic uniform buffer descriptor covers every allocation through its dynamic offset,
+		// so there is no buffer creation or descriptor update per draw
+		class VulkanUniformAllocator
+		{
+		public:
+			static constexpr VkDeviceSize DefaultRegionSize = 4 * 1024 * 1024;
+			// Largest block bound through the descriptor, every device supports uniform ranges this big
+			static constexpr uint32_t MaxBlockSize = 16 * 1024;
+			// Payloads up to this size are pushed, the spec guarantees 128 bytes of push constants
+			static constexpr uint32_t MaxPushSize = 128;
+
+			// data is nullptr when the region is out of space
+			struct Allocation
+			{
+				void* data;
+				uint32_t offset;
+			};
+
+			VulkanUniformAllocator();
+			~VulkanUniformAllocator();
+			VulkanUniformAllocator(const VulkanUniformAllocator&) = delete;
+			VulkanUniformAllocator& operator=(const VulkanUniformAllocator&) = delete;
+
+			bool create(VulkanRenderer* renderer, uint32_t framesInFlight, VkDeviceSize regionSize = DefaultRegionSize);
+			void destroy();
+
+			// Starts handing out frameIndex's region, its previous contents must no longer be in use
+			void beginFrame(uint32_t frameIndex);
+			Allocation allocate(uint32_t size);
+
+			// Pushes payloads of up to getPushLimit() bytes, anything bigger is written to the ring and bound at set with its dynamic offset
+			// layout : has to include getPushConstantRange() and getDescriptorSetLayout() at set
+			// Shaders declare blocks that fit as push_constant and bigger ones as a uniform block at set, binding 0
+			bool bindConstants(VkCommandBuffer commands, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, const void* data, uint32_t size);
+
+			VkDescriptorSetLayout getDescriptorSetLayout() const { return m_setLayout; }
+			VkDescriptorSet getDescriptorSet() const { return m_set; }
+			VkPushConstantRange getPushConstantRange() const;
+			uint32_t getPushLimit() const { return m_PushLimit; }
+
+			// Bytes written into the ring and pushed, the last frame's are kept for stats displays
+			VkDeviceSize getBytesLastFrame() const { return m_LastBytes; }
+			VkDeviceSize getPushBytesLastFrame() const { return m_LastPushBytes; }
+
+		private:
+			VulkanRenderer* m_Renderer;
+			VkBuffer m_buffer;
+			VkDeviceMemory m_memory;
+			VkDescriptorSetLayout m_setLayout;
+			VkDescriptorPool m_pool;
+			VkDescriptorSet m_set;
+			uint8_t* m_Mapped;
+			VkDeviceSize m_RegionSize;
+			VkDeviceSize m_Alignment;
+			VkDeviceSize m_RegionStart;
+			VkDeviceSize m_Head;
+			uint32_t m_PushLimit;
+			VkDeviceSize m_Bytes;
+			VkDeviceSize m_PushBytes;
+			VkDeviceSize m_LastBytes;
+			VkDeviceSize m_LastPushBytes;
+		};
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Window.hpp"
+
+namespace icy
+{
+	namespace Window
+	{
+		// Window bound to one backend at compile time, every call is direct and inlinable
+		// and the object only carries the state its backend needs
+		// Backend has to provide:
+		//   static constexpr Uint32 WindowFlags : SDL flags the backend needs on the window
+		//   bool create(SDL_Window* window), void destroy(), void present(SDL_Window* window)
+		template <class Backend>
+		class BasicWindow
+		{
+		public:
+			BasicWindow()
+			{
+				m_Window = nullptr;
+				m_bClosed = false;
+			}
+			~BasicWindow()
+			{
+				// The backend's resources belong to the window, so they go first
+				m_Backend.destroy();
+				if (m_Window != nullptr)
+					destroySDLWindow(m_Window);
+			}
+			BasicWindow(const BasicWindow&) = delete;
+			BasicWindow& operator=(const BasicWindow&) = delete;
+
+			// Creates a window
+			// title : The title of the Window
+			// xPos : The left position of the window
+			// yPos : The top position of the window
+			// width : The width of the Window
+			// height : The height of the Window
+			// flags : SDL flags, look at SDL wiki for more info, the backend adds what it needs
+			bool createWindow(const char* title, const int xPos, const int yPos, const int width, const int height, const Uint32 flags)
+			{
+				m_Window = createSDLWindow(title, xPos, yPos, width, height, flags | Backend::WindowFlags);
+				if (m_Window == nullptr)
+					return false;
+				return m_Backend.create(m_Window);
+			}
+			bool pollEvents(SDL_Event* ev) { return SDL_PollEvent(ev) != 0; }
+			// Checks if the window is still valid and opened
+			bool isOpen() const { return !m_bClosed; }
+			void close() { m_bClosed = true; }
+			void display() { m_Backend.present(m_Window); }
+			SDL_Window* getSDLWindow() { return m_Window; }
+			Backend& getBackend() { return m_Backend; }
+
+		private:
+			SDL_Window* m_Window;
+			bool m_bClosed;
+			Backend m_Backend;
+		};
+
+		// Puts a BasicWindow behind the Window interface for code that chooses the backend at runtime
+		template <class Backend>
+		class DynamicWindow : public Window
+		{
+		public:
+			virtual bool createWindow(const char* title, const int xPos, const int yPos, const int width, const int height, const Uint32 flags)
+			{
+				return m_Window.createWindow(title, xPos, yPos, width, height, flags);
+			}
+			virtual bool isOpen() { return m_Window.isOpen(); }
+			virtual void close() { m_Window.close(); }
+			virtual void display() { m_Window.display(); }
+			virtual SDL_Window* getSDLWindow() { return m_Window.getSDLWindow(); }
+			Backend& getBackend() { return m_Window.getBackend(); }
+
+		private:
+			BasicWindow<Backend> m_Window;
+		};
+	}
+}
@@ -0,0 +1,64 @@
+#include "OpenGLBackend.hpp"
+#include <SDL\SDL.h>
+#include <glad\glad.h>
+#include <Engine\System\Profiler.hpp>
+
+icy::Window::OpenGLBackend::OpenGLBackend()
+{
+	m_RenderContext = nullptr;
+}
+
+bool icy::Window::OpenGLBackend::create(SDL_Window* window)
+{
+	ICY_PROFILE_FUNCTION();
+	// Setup our openGL settings, these only apply to contexts created after them
+	// The state cache relies on DSA so we need a 4.5 core context
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+
+	// Create a openGL renderer
+	m_RenderContext = SDL_GL_CreateContext(window);
+	if (m_RenderContext == nullptr)
+		return false;
+
+	// Setup glad to load the openGL functions
+	if (!gladLoadGLLoader(SDL_GL_GetProcAddress))
+		return false;
+
+	// The context starts with default state we never told the cache about
+	m_StateCache.invalidate();
+
+	if (!m_StreamBuffer.create(StreamRegionSize))
+		return false;
+	if (!m_Renderer.create(&m_StateCache, &m_StreamBuffer))
+		return false;
+	m_Renderer.setSceneBuffer(&m_SceneBuffer);
+	m_UniformAllocator.create(&m_StreamBuffer, &m_StateCache);
+
+	return true;
+}
+
+void icy::Window::OpenGLBackend::destroy()
+{
+	if (m_RenderContext == nullptr)
+		return;
+	// GL objects have to go before the context that owns them
+	m_Renderer.destroy();
+	m_SceneBuffer.destroy();
+	m_StreamBuffer.destroy();
+
+	// Delete our OpengL context
+	SDL_GL_DeleteContext(m_RenderContext);
+	m_RenderContext = nullptr;
+}
+
+void icy::Window::OpenGLBackend::present(SDL_Window* window)
+{
+	SDL_GL_SwapWindow(window);
+	m_StreamBuffer.nextFrame();
+	m_UniformAllocator.endFrame();
+	m_StateCache.endFrame();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <SDL\SDL_video.h>
+#include <Engine\System\OpenGLIndirectRenderer.hpp>
+#include <Engine\System\OpenGLSceneBuffer.hpp>
+#include <Engine\System\OpenGLStateCache.hpp>
+#include <Engine\System\OpenGLStreamBuffer.hpp>
+#include <Engine\System\OpenGLUniformAllocator.hpp>
+
+namespace icy
+{
+	namespace Window
+	{
+		// Everything an OpenGL window owns besides the SDL window itself
+		class OpenGLBackend
+		{
+		public:
+			static constexpr Uint32 WindowFlags = SDL_WINDOW_OPENGL;
+			// Bytes of streaming memory available each frame
+			static constexpr GLsizeiptr StreamRegionSize = 4 * 1024 * 1024;
+
+			OpenGLBackend();
+			// Creates the context and the GL objects for window
+			bool create(SDL_Window* window);
+			void destroy();
+			// Swaps and moves the per frame resources on
+			void present(SDL_Window* window);
+
+			SDL_GLContext getContext() { return m_RenderContext; }
+			// All GL state changes should go through the cache so redundant calls are filtered out
+			icy::System::OpenGLStateCache& getStateCache() { return m_StateCache; }
+			// Per frame vertex, uniform and instance data should be written here
+			icy::System::OpenGLStreamBuffer& getStreamBuffer() { return m_StreamBuffer; }
+			// Batches submitted draws into one multi draw indirect call per material
+			icy::System::OpenGLIndirectRenderer& getRenderer() { return m_Renderer; }
+			// Per draw constants, bound as ranges of the stream buffer
+			icy::System::OpenGLUniformAllocator& getUniformAllocator() { return m_UniformAllocator; }
+			// Persistent instances the renderer draws with submitInstance, create() it with the shader directory first
+			icy::System::OpenGLSceneBuffer& getSceneBuffer() { return m_SceneBuffer; }
+
+		private:
+			SDL_GLContext m_RenderContext;
+			icy::System::OpenGLStateCache m_StateCache;
+			icy::System::OpenGLStreamBuffer m_StreamBuffer;
+			icy::System::OpenGLIndirectRenderer m_Renderer;
+			icy::System::OpenGLUniformAllocator m_UniformAllocator;
+			icy::System::OpenGLSceneBuffer m_SceneBuffer;
+		};
+	}
+}
\ No newline at end of file
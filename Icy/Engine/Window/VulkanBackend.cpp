@@ -0,0 +1,18 @@
+#include "VulkanBackend.hpp"
+#include <Engine\System\Profiler.hpp>
+
+bool icy::Window::VulkanBackend::create(SDL_Window* window)
+{
+	ICY_PROFILE_FUNCTION();
+	m_Renderer = icy::System::VulkanRenderer::getShared(window);
+	if (!m_Renderer)
+		return false;
+	return m_Swapchain.create(m_Renderer.get(), window);
+}
+
+void icy::Window::VulkanBackend::destroy()
+{
+	// The swapchain has to go while the device it was made on is still alive
+	m_Swapchain.destroy();
+	m_Renderer.reset();
+}
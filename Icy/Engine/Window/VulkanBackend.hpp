@@ -0,0 +1,31 @@
+#pragma once
+#include <memory>
+#include <SDL\SDL_video.h>
+#include <Engine\System\VulkanRenderer.hpp>
+#include <Engine\System\VulkanSwapchain.hpp>
+
+namespace icy
+{
+	namespace Window
+	{
+		// A Vulkan window only owns its swapchain, the renderer with the instance and device is shared by all of them
+		class VulkanBackend
+		{
+		public:
+			static constexpr Uint32 WindowFlags = SDL_WINDOW_VULKAN;
+
+			// Joins the shared renderer, creating it for the first window, and adds a swapchain for window
+			bool create(SDL_Window* window);
+			void destroy();
+			// Presenting happens for every window at once in VulkanRenderer::endFrame
+			void present(SDL_Window* window) {}
+
+			icy::System::VulkanRenderer& getRenderer() { return *m_Renderer; }
+			icy::System::VulkanSwapchain& getSwapchain() { return m_Swapchain; }
+
+		private:
+			std::shared_ptr<icy::System::VulkanRenderer> m_Renderer;
+			icy::System::VulkanSwapchain m_Swapchain;
+		};
+	}
+}
\ No newline at end of file
@@ -1,8 +1,36 @@
 #include "Window.hpp"
 #include <SDL\SDL.h>
-#include <glad\glad.h>
+#include <Engine\System\Profiler.hpp>
 
-icy::Window::Window::Window()
+namespace
 {
-	m_bClosed = false;
-}
\ No newline at end of file
+	// SDL is started with the first window and shut down with the last one
+	int s_WindowCount = 0;
+}
+
+SDL_Window* icy::Window::createSDLWindow(const char* title, const int xPos, const int yPos, const int width, const int height, const Uint32 flags)
+{
+	ICY_PROFILE_FUNCTION();
+	// Init SDL
+	if (s_WindowCount == 0 && SDL_Init(SDL_INIT_VIDEO) != 0)
+		return nullptr;
+	// Create the window, nullptr if it failed
+	SDL_Window* window = SDL_CreateWindow(title, xPos, yPos, width, height, flags);
+	if (window != nullptr)
+		++s_WindowCount;
+	else if (s_WindowCount == 0)
+		SDL_Quit();
+	return window;
+}
+
+void icy::Window::destroySDLWindow(SDL_Window* window)
+{
+	if (window == nullptr)
+		return;
+	// Destroy our window
+	SDL_DestroyWindow(window);
+
+	// Shutdown SDL 2 once no window needs it
+	if (--s_WindowCount == 0)
+		SDL_Quit();
+}
@@ -1,15 +1,15 @@
 #pragma once
-#include <string>
 #include <SDL\SDL_render.h>
 #include <SDL\SDL_events.h>
 namespace icy
 {
-	namespace Window 
+	namespace Window
 	{
+		// Runtime polymorphic window, for tools that pick or switch the backend while running
+		// Code that only ever targets one backend should use BasicWindow<Backend> and skip the virtual calls
 		class Window
 		{
 		public:
-			Window();
 			virtual ~Window() {};
 			// Creates a window
 			// title : The title of the Window
@@ -18,15 +18,19 @@ namespace icy
 			// width : The width of the Window
 			// height : The height of the Window
 			// flags : SDL flags, look at SDL wiki for more info
-			virtual bool createWindow(const std::string title, const int xPos, const int yPos, const int width, const int height, const Uint32 flags) = 0;
-			virtual bool pollEvents(SDL_Event* ev) { return SDL_PollEvent(ev); }
+			virtual bool createWindow(const char* title, const int xPos, const int yPos, const int width, const int height, const Uint32 flags) = 0;
+			// Pulls a single event, prefer icy::Input::EventPump which drains the queue in bulk
+			bool pollEvents(SDL_Event* ev) { return SDL_PollEvent(ev) != 0; }
 			// Checks if the window is still valid and opened
 			virtual bool isOpen() = 0;
 			virtual void close() = 0;
 			virtual void display() = 0;
-			SDL_Window * m_Window;
-			SDL_GLContext m_RenderContext;
-			bool m_bClosed;
+			virtual SDL_Window* getSDLWindow() = 0;
 		};
+
+		// Shared by every window type so the templates stay small
+		// Initialises SDL and creates the window, returns nullptr on failure
+		SDL_Window* createSDLWindow(const char* title, const int xPos, const int yPos, const int width, const int height, const Uint32 flags);
+		void destroySDLWindow(SDL_Window* window);
 	}
-}
\ No newline at end of file
+}